@@ -130,10 +130,12 @@ namespace x265 {
 // ====================================================================================================================
 // Sbac interface
 // ====================================================================================================================
+/* A context model is packed in a single byte: bits 0-6 hold the CABAC state
+ * (probability state index << 1 | MPS) and bit 7 is set once the context has
+ * coded a bin into a real bitstream. It is used to select cabac_init_idc */
 typedef struct ContextModel
 {
     uint8_t m_state;  ///< internal state variable
-    uint8_t bBinsCoded;
 } ContextModel;
 
 extern const uint32_t g_entropyBits[128];
@@ -141,9 +143,10 @@ extern const uint8_t g_nextState[128][2];
 uint8_t sbacInit(int qp, int initValue);   ///< initialize state with initial probability
 
 #define sbacGetMps(S)               ((S) & 1)
-#define sbacGetState(S)             ((S) >> 1)
-#define sbacNext(S, V)              (g_nextState[(S)][(V)])
-#define sbacGetEntropyBits(S, V)    (g_entropyBits[(S) ^ (V)])
+#define sbacGetState(S)             (((S) >> 1) & 63)
+#define sbacNext(S, V)              (g_nextState[(S) & 127][(V)])
+#define sbacGetEntropyBits(S, V)    (g_entropyBits[((S) ^ (V)) & 127])
+#define sbacBinsCoded(S)            ((S) & 128)
 #define sbacGetEntropyBitsTrm(V)    (g_entropyBits[126 ^ (V)])
 #define  CHANNEL_TYPE_LUMA         0
 #define  CHANNEL_TYPE_CHROMA       1
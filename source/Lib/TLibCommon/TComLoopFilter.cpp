@@ -70,6 +70,9 @@ const uint8_t TComLoopFilter::sm_betaTable[52] =
 
 TComLoopFilter::TComLoopFilter()
     : m_numPartitions(0)
+    , m_leafZOrder(NULL)
+    , m_leafDepth(NULL)
+    , m_numLeaves(0)
     , m_bLFCrossTileBoundary(true)
 {
     for (uint32_t dir = 0; dir < 2; dir++)
@@ -77,6 +80,11 @@ TComLoopFilter::TComLoopFilter()
         m_blockingStrength[dir] = NULL;
         m_bEdgeFilter[dir] = NULL;
     }
+
+    delete [] m_leafZOrder;
+    m_leafZOrder = NULL;
+    delete [] m_leafDepth;
+    m_leafDepth = NULL;
 }
 
 TComLoopFilter::~TComLoopFilter()
@@ -99,6 +107,9 @@ void TComLoopFilter::create(uint32_t maxCuDepth)
         m_blockingStrength[dir] = new uint8_t[m_numPartitions];
         m_bEdgeFilter[dir] = new bool[m_numPartitions];
     }
+
+    m_leafZOrder = new uint32_t[m_numPartitions];
+    m_leafDepth = new uint8_t[m_numPartitions];
 }
 
 void TComLoopFilter::destroy()
@@ -110,6 +121,11 @@ void TComLoopFilter::destroy()
         delete [] m_bEdgeFilter[dir];
         m_bEdgeFilter[dir] = NULL;
     }
+
+    delete [] m_leafZOrder;
+    m_leafZOrder = NULL;
+    delete [] m_leafDepth;
+    m_leafDepth = NULL;
 }
 
 /**
@@ -123,43 +139,40 @@ void TComLoopFilter::loopFilterPic(TComPic* pic)
     // Horizontal filtering
     for (uint32_t cuAddr = 0; cuAddr < pic->getNumCUsInFrame(); cuAddr++)
     {
-        TComDataCU* cu = pic->getCU(cuAddr);
-
-        ::memset(m_blockingStrength[EDGE_VER], 0, sizeof(uint8_t) * m_numPartitions);
-        ::memset(m_bEdgeFilter[EDGE_VER], 0, sizeof(bool) * m_numPartitions);
-
-        // CU-based deblocking
-        xDeblockCU(cu, 0, 0, EDGE_VER);
+        loopFilterCU(pic->getCU(cuAddr), EDGE_VER);
 
         // Vertical filtering
         // NOTE: delay one CU to avoid conflict between V and H
         if (cuAddr > 0)
         {
-            cu = pic->getCU(cuAddr - 1);
-            ::memset(m_blockingStrength[EDGE_HOR], 0, sizeof(uint8_t) * m_numPartitions);
-            ::memset(m_bEdgeFilter[EDGE_HOR], 0, sizeof(bool) * m_numPartitions);
-
-            xDeblockCU(cu, 0, 0, EDGE_HOR);
+            loopFilterCU(pic->getCU(cuAddr - 1), EDGE_HOR);
         }
     }
 
     // Last H-Filter
-    {
-        TComDataCU* cu = pic->getCU(pic->getNumCUsInFrame() - 1);
-        ::memset(m_blockingStrength[EDGE_HOR], 0, sizeof(uint8_t) * m_numPartitions);
-        ::memset(m_bEdgeFilter[EDGE_HOR], 0, sizeof(bool) * m_numPartitions);
-
-        xDeblockCU(cu, 0, 0, EDGE_HOR);
-    }
+    loopFilterCU(pic->getCU(pic->getNumCUsInFrame() - 1), EDGE_HOR);
 }
 
+/**
+ - Deblocking of one CTU in one direction. The edge map and the boundary
+   strengths of the whole CTU are derived first, then every CU is filtered
+ .
+ \param cu            CTU to filter
+ \param dir           EDGE_VER or EDGE_HOR
+ */
 void TComLoopFilter::loopFilterCU(TComDataCU* cu, int dir)
 {
     ::memset(m_blockingStrength[dir], 0, sizeof(uint8_t) * m_numPartitions);
     ::memset(m_bEdgeFilter[dir], 0, sizeof(bool) * m_numPartitions);
 
-    // CU-based deblocking
+    m_numLeaves = 0;
     xDeblockCU(cu, 0, 0, dir);
+    xGetBoundaryStrengthCTU(cu, dir);
+
+    for (uint32_t i = 0; i < m_numLeaves; i++)
+    {
+        xEdgeFilterCU(cu, m_leafZOrder[i], m_leafDepth[i], dir);
+    }
 }
 
 // ====================================================================================================================
@@ -167,7 +180,8 @@ void TComLoopFilter::loopFilterCU(TComDataCU* cu, int dir)
 // ====================================================================================================================
 
 /**
- - Deblocking filter process in CU-based (the same function as conventional's)
+ - Edge map of the CUs of a CTU, and the strengths implied by TU and PU
+   boundaries. The CUs are queued for filtering
  .
  \param Edge          the direction of the edge in block boundary (horizonta/vertical), which is added newly
 */
@@ -201,30 +215,57 @@ void TComLoopFilter::xDeblockCU(TComDataCU* cu, uint32_t absZOrderIdx, uint32_t
     xSetEdgefilterTU(cu, absZOrderIdx, absZOrderIdx, depth);
     xSetEdgefilterPU(cu, absZOrderIdx);
 
-    int dir = edge;
-    for (uint32_t partIdx = absZOrderIdx; partIdx < absZOrderIdx + curNumParts; partIdx++)
+    m_leafZOrder[m_numLeaves] = absZOrderIdx;
+    m_leafDepth[m_numLeaves] = (uint8_t)depth;
+    m_numLeaves++;
+}
+
+/**
+ - Boundary strength of every flagged edge of the CTU in one pass over its
+   edge map. Intra Q blocks need no neighbour lookup
+ .
+ \param dir           EDGE_VER or EDGE_HOR
+ */
+void TComLoopFilter::xGetBoundaryStrengthCTU(TComDataCU* cu, int dir)
+{
+    const bool bHalfUnits = (g_maxCUSize >> g_maxCUDepth) == 4;
+
+    for (uint32_t partIdx = 0; partIdx < m_numPartitions; partIdx++)
     {
-        uint32_t bsCheck;
-        if ((g_maxCUSize >> g_maxCUDepth) == 4)
+        if (!m_bEdgeFilter[dir][partIdx])
         {
-            bsCheck = (dir == EDGE_VER && partIdx % 2 == 0) || (dir == EDGE_HOR && (partIdx - ((partIdx >> 2) << 2)) / 2 == 0);
+            continue;
         }
-        else
+
+        if (bHalfUnits)
         {
-            bsCheck = 1;
+            // 4x4 units, strengths are only needed on the 8x8 grid
+            bool bsCheck = (dir == EDGE_VER && partIdx % 2 == 0) || (dir == EDGE_HOR && (partIdx - ((partIdx >> 2) << 2)) / 2 == 0);
+            if (!bsCheck)
+            {
+                continue;
+            }
         }
 
-        if (m_bEdgeFilter[dir][partIdx] && bsCheck)
+        if (cu->isIntra(partIdx))
+        {
+            m_blockingStrength[dir][partIdx] = 2;
+        }
+        else
         {
             xGetBoundaryStrengthSingle(cu, dir, partIdx);
         }
     }
+}
 
+void TComLoopFilter::xEdgeFilterCU(TComDataCU* cu, uint32_t absZOrderIdx, uint32_t depth, int dir)
+{
+    TComPic* pic = cu->getPic();
     uint32_t pelsInPart = g_maxCUSize >> g_maxCUDepth;
     uint32_t partIdxIncr = DEBLOCK_SMALLEST_BLOCK / pelsInPart ? DEBLOCK_SMALLEST_BLOCK / pelsInPart : 1;
 
     uint32_t sizeInPU = pic->getNumPartInCUSize() >> (depth);
-    uint32_t shiftFactor = (edge == EDGE_VER) ? cu->getHorzChromaShift() : cu->getVertChromaShift();
+    uint32_t shiftFactor = (dir == EDGE_VER) ? cu->getHorzChromaShift() : cu->getVertChromaShift();
     const bool bAlwaysDoChroma = (cu->getChromaFormat() == CHROMA_444);
     for (uint32_t e = 0; e < sizeInPU; e += partIdxIncr)
     {
@@ -524,49 +565,54 @@ void TComLoopFilter::xEdgeFilterLuma(TComDataCU* cu, uint32_t absZOrderIdx, uint
 {
     TComPicYuv* reconYuv = cu->getPic()->getPicYuvRec();
     pixel* src = reconYuv->getLumaAddr(cu->getAddr(), absZOrderIdx);
-    pixel* tmpsrc = src;
 
-    int stride = reconYuv->getStride();
-    int qp = 0;
-    int qpP = 0;
-    int qpQ = 0;
+    intptr_t stride = reconYuv->getStride();
     uint32_t numParts = cu->getPic()->getNumPartInCUSize() >> depth;
 
     uint32_t pelsInPart = g_maxCUSize >> g_maxCUDepth;
-    uint32_t bsAbsIdx = 0, bs = 0;
-    int  offset, srcStep;
+    uint32_t blocksInPart = pelsInPart / 4 ? pelsInPart / 4 : 1;
+    intptr_t offset, srcStep;
 
     bool  bPCMFilter = (cu->getSlice()->getSPS()->getUsePCM() && cu->getSlice()->getSPS()->getPCMFilterDisableFlag()) ? true : false;
-    bool  bPartPNoFilter = false;
-    bool  bPartQNoFilter = false;
+    bool  bCheckNoFilter = bPCMFilter || cu->getSlice()->getPPS()->getTransquantBypassEnableFlag();
     uint32_t  partP = 0;
-    uint32_t  partQ = 0;
     TComDataCU* cuP = cu;
     TComDataCU* cuQ = cu;
     int  betaOffsetDiv2 = cuQ->getSlice()->getDeblockingFilterBetaOffsetDiv2();
     int  tcOffsetDiv2 = cuQ->getSlice()->getDeblockingFilterTcOffsetDiv2();
+    int  bitdepthScale = 1 << (X265_DEPTH - 8);
 
     if (dir == EDGE_VER)
     {
         offset = 1;
         srcStep = stride;
-        tmpsrc += edge * pelsInPart;
+        src += edge * pelsInPart;
     }
     else // (dir == EDGE_HOR)
     {
         offset = stride;
         srcStep = 1;
-        tmpsrc += edge * pelsInPart * stride;
+        src += edge * pelsInPart * stride;
     }
 
+    /* thresholds of every 4 line segment of the edge, tc 0 skips a segment */
+    int32_t tc[MAX_CU_SIZE / 4];
+    int32_t beta[MAX_CU_SIZE / 4];
+    bool bPartPNoFilter[MAX_CU_SIZE / 4];
+    bool bPartQNoFilter[MAX_CU_SIZE / 4];
+    bool bAnyNoFilter = false;
+
     for (uint32_t idx = 0; idx < numParts; idx++)
     {
-        bsAbsIdx = xCalcBsIdx(cu, absZOrderIdx, dir, edge, idx);
-        bs = m_blockingStrength[dir][bsAbsIdx];
+        uint32_t bsAbsIdx = xCalcBsIdx(cu, absZOrderIdx, dir, edge, idx);
+        uint32_t bs = m_blockingStrength[dir][bsAbsIdx];
+        int tcPart = 0, betaPart = 0;
+        bool bNoFilterP = false, bNoFilterQ = false;
+
         if (bs)
         {
-            qpQ = cu->getQP(bsAbsIdx);
-            partQ = bsAbsIdx;
+            uint32_t partQ = bsAbsIdx;
+            int qpQ = cu->getQP(bsAbsIdx);
             // Derive neighboring PU index
             if (dir == EDGE_VER)
             {
@@ -577,55 +623,73 @@ void TComLoopFilter::xEdgeFilterLuma(TComDataCU* cu, uint32_t absZOrderIdx, uint
                 cuP = cuQ->getPUAbove(partP, partQ, !true, false, !m_bLFCrossTileBoundary);
             }
 
-            qpP = cuP->getQP(partP);
-            qp = (qpP + qpQ + 1) >> 1;
-            int bitdepthScale = 1 << (X265_DEPTH - 8);
+            int qpP = cuP->getQP(partP);
+            int qp = (qpP + qpQ + 1) >> 1;
 
             int indexTC = Clip3(0, MAX_QP + DEFAULT_INTRA_TC_OFFSET, int(qp + DEFAULT_INTRA_TC_OFFSET * (bs - 1) + (tcOffsetDiv2 << 1)));
             int indexB = Clip3(0, MAX_QP, qp + (betaOffsetDiv2 << 1));
 
-            int tc =  sm_tcTable[indexTC] * bitdepthScale;
-            int beta = sm_betaTable[indexB] * bitdepthScale;
-            int sideThreshold = (beta + (beta >> 1)) >> 3;
-            int thrCut = tc * 10;
+            tcPart = sm_tcTable[indexTC] * bitdepthScale;
+            betaPart = sm_betaTable[indexB] * bitdepthScale;
 
-            uint32_t blocksInPart = pelsInPart / 4 ? pelsInPart / 4 : 1;
-            for (uint32_t blkIdx = 0; blkIdx < blocksInPart; blkIdx++)
+            if (bCheckNoFilter)
             {
-                int dp0 = xCalcDP(tmpsrc + srcStep * (idx * pelsInPart + blkIdx * 4 + 0), offset);
-                int dq0 = xCalcDQ(tmpsrc + srcStep * (idx * pelsInPart + blkIdx * 4 + 0), offset);
-                int dp3 = xCalcDP(tmpsrc + srcStep * (idx * pelsInPart + blkIdx * 4 + 3), offset);
-                int dq3 = xCalcDQ(tmpsrc + srcStep * (idx * pelsInPart + blkIdx * 4 + 3), offset);
-                int d0 = dp0 + dq0;
-                int d3 = dp3 + dq3;
-
-                int dp = dp0 + dp3;
-                int dq = dq0 + dq3;
-                int d =  d0 + d3;
-
-                if (bPCMFilter || cu->getSlice()->getPPS()->getTransquantBypassEnableFlag())
-                {
-                    // Check if each of PUs is I_PCM with LF disabling
-                    bPartPNoFilter = (bPCMFilter && cuP->getIPCMFlag(partP));
-                    bPartQNoFilter = (bPCMFilter && cuQ->getIPCMFlag(partQ));
+                // I_PCM with LF disabling, or lossless coded
+                bNoFilterP = (bPCMFilter && cuP->getIPCMFlag(partP)) || cuP->isLosslessCoded(partP);
+                bNoFilterQ = (bPCMFilter && cuQ->getIPCMFlag(partQ)) || cuQ->isLosslessCoded(partQ);
+                bAnyNoFilter |= bNoFilterP || bNoFilterQ;
+            }
+        }
 
-                    // check if each of PUs is lossless coded
-                    bPartPNoFilter = bPartPNoFilter || (cuP->isLosslessCoded(partP));
-                    bPartQNoFilter = bPartQNoFilter || (cuQ->isLosslessCoded(partQ));
-                }
+        for (uint32_t blkIdx = 0; blkIdx < blocksInPart; blkIdx++)
+        {
+            tc[idx * blocksInPart + blkIdx] = tcPart;
+            beta[idx * blocksInPart + blkIdx] = betaPart;
+            bPartPNoFilter[idx * blocksInPart + blkIdx] = bNoFilterP;
+            bPartQNoFilter[idx * blocksInPart + blkIdx] = bNoFilterQ;
+        }
+    }
 
-                if (d < beta)
-                {
-                    bool bFilterP = (dp < sideThreshold);
-                    bool bFilterQ = (dq < sideThreshold);
+    const int numSeg = numParts * blocksInPart;
 
-                    bool sw =  xUseStrongFiltering(offset, 2 * d0, beta, tc, tmpsrc + srcStep * (idx * pelsInPart + blkIdx * 4 + 0))
-                        && xUseStrongFiltering(offset, 2 * d3, beta, tc, tmpsrc + srcStep * (idx * pelsInPart + blkIdx * 4 + 3));
+    if (!bAnyNoFilter)
+    {
+        primitives.deblock_luma[dir](src, stride, tc, beta, numSeg);
+        return;
+    }
 
-                    for (int i = 0; i < DEBLOCK_SMALLEST_BLOCK / 2; i++)
-                    {
-                        xPelFilterLuma(tmpsrc + srcStep * (idx * pelsInPart + blkIdx * 4 + i), offset, tc, sw, bPartPNoFilter, bPartQNoFilter, thrCut, bFilterP, bFilterQ);
-                    }
+    /* keep the three samples next to the edge on the sides that must not be
+     * filtered, and restore them afterwards */
+    pixel saved[MAX_CU_SIZE][6];
+    for (int seg = 0; seg < numSeg; seg++)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            pixel* line = src + (seg * 4 + i) * srcStep;
+            for (int k = 0; k < 3; k++)
+            {
+                saved[seg * 4 + i][k] = line[-offset * (k + 1)];
+                saved[seg * 4 + i][3 + k] = line[offset * k];
+            }
+        }
+    }
+
+    primitives.deblock_luma[dir](src, stride, tc, beta, numSeg);
+
+    for (int seg = 0; seg < numSeg; seg++)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            pixel* line = src + (seg * 4 + i) * srcStep;
+            for (int k = 0; k < 3; k++)
+            {
+                if (bPartPNoFilter[seg])
+                {
+                    line[-offset * (k + 1)] = saved[seg * 4 + i][k];
+                }
+                if (bPartQNoFilter[seg])
+                {
+                    line[offset * k] = saved[seg * 4 + i][3 + k];
                 }
             }
         }
@@ -635,26 +699,22 @@ void TComLoopFilter::xEdgeFilterLuma(TComDataCU* cu, uint32_t absZOrderIdx, uint
 void TComLoopFilter::xEdgeFilterChroma(TComDataCU* cu, uint32_t absZOrderIdx, uint32_t depth, int dir, int edge)
 {
     TComPicYuv* reconYuv = cu->getPic()->getPicYuvRec();
-    int stride = reconYuv->getCStride();
+    intptr_t stride = reconYuv->getCStride();
     pixel* srcCb = reconYuv->getCbAddr(cu->getAddr(), absZOrderIdx);
     pixel* srcCr = reconYuv->getCrAddr(cu->getAddr(), absZOrderIdx);
-    int qp = 0;
-    int qpP = 0;
-    int qpQ = 0;
     uint32_t  pelsInPartChromaH = g_maxCUSize >> (g_maxCUDepth + cu->getHorzChromaShift());
     uint32_t  pelsInPartChromaV = g_maxCUSize >> (g_maxCUDepth + cu->getVertChromaShift());
-    int   offset, srcStep;
+    intptr_t  offset, srcStep;
 
     const uint32_t lcuWidthInBaseUnits = cu->getPic()->getNumPartInCUSize();
 
     bool  bPCMFilter = (cu->getSlice()->getSPS()->getUsePCM() && cu->getSlice()->getSPS()->getPCMFilterDisableFlag()) ? true : false;
-    bool  bPartPNoFilter = false;
-    bool  bPartQNoFilter = false;
+    bool  bCheckNoFilter = bPCMFilter || cu->getSlice()->getPPS()->getTransquantBypassEnableFlag();
     uint32_t  partP;
-    uint32_t  partQ;
     TComDataCU* cuP;
     TComDataCU* cuQ = cu;
     int tcOffsetDiv2 = cu->getSlice()->getDeblockingFilterTcOffsetDiv2();
+    int bitdepthScale = 1 << (X265_DEPTH - 8);
 
     // Vertical Position
     uint32_t edgeNumInLCUVert = g_zscanToRaster[absZOrderIdx] % lcuWidthInBaseUnits + edge;
@@ -668,40 +728,43 @@ void TComLoopFilter::xEdgeFilterChroma(TComDataCU* cu, uint32_t absZOrderIdx, ui
     }
 
     uint32_t numParts = cu->getPic()->getNumPartInCUSize() >> depth;
-
-    uint32_t bsAbsIdx;
-    uint8_t bs;
-
-    pixel* tmpSrcCb = srcCb;
-    pixel* tmpSrcCr = srcCr;
     uint32_t loopLength;
 
     if (dir == EDGE_VER)
     {
         offset     = 1;
         srcStep    = stride;
-        tmpSrcCb   += edge * pelsInPartChromaH;
-        tmpSrcCr   += edge * pelsInPartChromaH;
+        srcCb      += edge * pelsInPartChromaH;
+        srcCr      += edge * pelsInPartChromaH;
         loopLength = pelsInPartChromaV;
     }
     else // (dir == EDGE_HOR)
     {
         offset     = stride;
         srcStep    = 1;
-        tmpSrcCb   += edge * stride * pelsInPartChromaV;
-        tmpSrcCr   += edge * stride * pelsInPartChromaV;
+        srcCb      += edge * stride * pelsInPartChromaV;
+        srcCr      += edge * stride * pelsInPartChromaV;
         loopLength = pelsInPartChromaH;
     }
 
+    /* tc of every part of the edge, only bs 2 edges are filtered */
+    int32_t tc[2][MAX_CU_SIZE / 4];
+    bool bPartPNoFilter[MAX_CU_SIZE / 4];
+    bool bPartQNoFilter[MAX_CU_SIZE / 4];
+    bool bAnyFilter = false, bAnyNoFilter = false;
+
     for (uint32_t idx = 0; idx < numParts; idx++)
     {
-        bsAbsIdx = xCalcBsIdx(cu, absZOrderIdx, dir, edge, idx);
-        bs = m_blockingStrength[dir][bsAbsIdx];
+        uint32_t bsAbsIdx = xCalcBsIdx(cu, absZOrderIdx, dir, edge, idx);
+        uint8_t bs = m_blockingStrength[dir][bsAbsIdx];
+
+        tc[0][idx] = tc[1][idx] = 0;
+        bPartPNoFilter[idx] = bPartQNoFilter[idx] = false;
 
         if (bs > 1)
         {
-            qpQ = cu->getQP(bsAbsIdx);
-            partQ = bsAbsIdx;
+            int qpQ = cu->getQP(bsAbsIdx);
+            uint32_t partQ = bsAbsIdx;
             // Derive neighboring PU index
             if (dir == EDGE_VER)
             {
@@ -712,173 +775,65 @@ void TComLoopFilter::xEdgeFilterChroma(TComDataCU* cu, uint32_t absZOrderIdx, ui
                 cuP = cuQ->getPUAbove(partP, partQ, !true, false, !m_bLFCrossTileBoundary);
             }
 
-            qpP = cuP->getQP(partP);
+            int qpP = cuP->getQP(partP);
 
-            if (bPCMFilter || cu->getSlice()->getPPS()->getTransquantBypassEnableFlag())
+            if (bCheckNoFilter)
             {
-                // Check if each of PUs is I_PCM with LF disabling
-                bPartPNoFilter = (bPCMFilter && cuP->getIPCMFlag(partP));
-                bPartQNoFilter = (bPCMFilter && cuQ->getIPCMFlag(partQ));
-
-                // check if each of PUs is lossless coded
-                bPartPNoFilter = bPartPNoFilter || (cuP->isLosslessCoded(partP));
-                bPartQNoFilter = bPartQNoFilter || (cuQ->isLosslessCoded(partQ));
+                // I_PCM with LF disabling, or lossless coded
+                bPartPNoFilter[idx] = (bPCMFilter && cuP->getIPCMFlag(partP)) || cuP->isLosslessCoded(partP);
+                bPartQNoFilter[idx] = (bPCMFilter && cuQ->getIPCMFlag(partQ)) || cuQ->isLosslessCoded(partQ);
+                bAnyNoFilter |= bPartPNoFilter[idx] || bPartQNoFilter[idx];
             }
 
             for (uint32_t chromaIdx = 0; chromaIdx < 2; chromaIdx++)
             {
                 int chromaQPOffset  = (chromaIdx == 0) ? cu->getSlice()->getPPS()->getChromaCbQpOffset() : cu->getSlice()->getPPS()->getChromaCrQpOffset();
-                pixel* piTmpSrcChroma = (chromaIdx == 0) ? tmpSrcCb : tmpSrcCr;
-                qp = QpUV((((qpP + qpQ + 1) >> 1) + chromaQPOffset), cu->getChromaFormat());
-                int iBitdepthScale = 1 << (X265_DEPTH - 8);
-
-                int iIndexTC = Clip3(0, MAX_QP + DEFAULT_INTRA_TC_OFFSET, qp + DEFAULT_INTRA_TC_OFFSET * (bs - 1) + (tcOffsetDiv2 << 1));
-                int iTc =  sm_tcTable[iIndexTC] * iBitdepthScale;
+                int qp = QpUV((((qpP + qpQ + 1) >> 1) + chromaQPOffset), cu->getChromaFormat());
 
-                for (uint32_t uiStep = 0; uiStep < loopLength; uiStep++)
-                {
-                    xPelFilterChroma(piTmpSrcChroma + srcStep * (uiStep + idx * loopLength), offset, iTc, bPartPNoFilter, bPartQNoFilter);
-                }
+                int indexTC = Clip3(0, MAX_QP + DEFAULT_INTRA_TC_OFFSET, qp + DEFAULT_INTRA_TC_OFFSET * (bs - 1) + (tcOffsetDiv2 << 1));
+                tc[chromaIdx][idx] = sm_tcTable[indexTC] * bitdepthScale;
             }
+
+            bAnyFilter = true;
         }
     }
-}
 
-/**
- - Deblocking for the luminance component with strong or weak filter
- .
- \param src           pointer to picture data
- \param offset         offset value for picture data
- \param tc              tc value
- \param sw              decision strong/weak filter
- \param bPartPNoFilter  indicator to disable filtering on partP
- \param bPartQNoFilter  indicator to disable filtering on partQ
- \param iThrCut         threshold value for weak filter decision
- \param bFilterSecondP  decision weak filter/no filter for partP
- \param bFilterSecondQ  decision weak filter/no filter for partQ
-*/
-inline void TComLoopFilter::xPelFilterLuma(pixel* src, int offset, int tc, bool sw, bool bPartPNoFilter, bool bPartQNoFilter, int thrCut, bool bFilterSecondP, bool bFilterSecondQ)
-{
-    int delta;
-
-    int16_t m4  = (int16_t)src[0];
-    int16_t m3  = (int16_t)src[-offset];
-    int16_t m5  = (int16_t)src[offset];
-    int16_t m2  = (int16_t)src[-offset * 2];
-    int16_t m6  = (int16_t)src[offset * 2];
-    int16_t m1  = (int16_t)src[-offset * 3];
-    int16_t m7  = (int16_t)src[offset * 3];
-    int16_t m0  = (int16_t)src[-offset * 4];
-
-    if (sw)
-    {
-        src[-offset]     = (pixel)Clip3(m3 - 2 * tc, m3 + 2 * tc, ((m1 + 2 * m2 + 2 * m3 + 2 * m4 + m5 + 4) >> 3));
-        src[0]           = (pixel)Clip3(m4 - 2 * tc, m4 + 2 * tc, ((m2 + 2 * m3 + 2 * m4 + 2 * m5 + m6 + 4) >> 3));
-        src[-offset * 2] = (pixel)Clip3(m2 - 2 * tc, m2 + 2 * tc, ((m1 + m2 + m3 + m4 + 2) >> 2));
-        src[offset]      = (pixel)Clip3(m5 - 2 * tc, m5 + 2 * tc, ((m3 + m4 + m5 + m6 + 2) >> 2));
-        src[-offset * 3] = (pixel)Clip3(m1 - 2 * tc, m1 + 2 * tc, ((2 * m0 + 3 * m1 + m2 + m3 + m4 + 4) >> 3));
-        src[offset * 2]  = (pixel)Clip3(m6 - 2 * tc, m6 + 2 * tc, ((m3 + m4 + m5 + 3 * m6 + 2 * m7 + 4) >> 3));
+    if (!bAnyFilter)
+    {
+        return;
     }
-    else
+
+    for (uint32_t chromaIdx = 0; chromaIdx < 2; chromaIdx++)
     {
-        /* Weak filter */
-        delta = (9 * (m4 - m3) - 3 * (m5 - m2) + 8) >> 4;
+        pixel* src = (chromaIdx == 0) ? srcCb : srcCr;
+
+        if (!bAnyNoFilter)
+        {
+            primitives.deblock_chroma[dir](src, stride, tc[chromaIdx], loopLength, numParts);
+            continue;
+        }
 
-        if (abs(delta) < thrCut)
+        pixel saved[MAX_CU_SIZE][2];
+        for (uint32_t i = 0; i < numParts * loopLength; i++)
         {
-            delta = Clip3(-tc, tc, delta);
-            src[-offset] = Clip(m3 + delta);
-            src[0] = Clip(m4 - delta);
+            saved[i][0] = src[i * srcStep - offset];
+            saved[i][1] = src[i * srcStep];
+        }
 
-            int tc2 = tc >> 1;
-            if (bFilterSecondP)
+        primitives.deblock_chroma[dir](src, stride, tc[chromaIdx], loopLength, numParts);
+
+        for (uint32_t i = 0; i < numParts * loopLength; i++)
+        {
+            if (bPartPNoFilter[i / loopLength])
             {
-                int delta1 = Clip3(-tc2, tc2, ((((m1 + m3 + 1) >> 1) - m2 + delta) >> 1));
-                src[-offset * 2] = Clip(m2 + delta1);
+                src[i * srcStep - offset] = saved[i][0];
             }
-            if (bFilterSecondQ)
+            if (bPartQNoFilter[i / loopLength])
             {
-                int delta2 = Clip3(-tc2, tc2, ((((m6 + m4 + 1) >> 1) - m5 - delta) >> 1));
-                src[offset] = Clip(m5 + delta2);
+                src[i * srcStep] = saved[i][1];
             }
         }
     }
-
-    if (bPartPNoFilter)
-    {
-        src[-offset] = (pixel)m3;
-        src[-offset * 2] = (pixel)m2;
-        src[-offset * 3] = (pixel)m1;
-    }
-    if (bPartQNoFilter)
-    {
-        src[0] = (pixel)m4;
-        src[offset] = (pixel)m5;
-        src[offset * 2] = (pixel)m6;
-    }
-}
-
-/**
- - Deblocking of one line/column for the chrominance component
- .
- \param src           pointer to picture data
- \param offset         offset value for picture data
- \param tc              tc value
- \param bPartPNoFilter  indicator to disable filtering on partP
- \param bPartQNoFilter  indicator to disable filtering on partQ
- */
-inline void TComLoopFilter::xPelFilterChroma(pixel* src, int offset, int tc, bool bPartPNoFilter, bool bPartQNoFilter)
-{
-    int delta;
-
-    int16_t m4  = (int16_t)src[0];
-    int16_t m3  = (int16_t)src[-offset];
-    int16_t m5  = (int16_t)src[offset];
-    int16_t m2  = (int16_t)src[-offset * 2];
-
-    delta = Clip3(-tc, tc, ((((m4 - m3) << 2) + m2 - m5 + 4) >> 3));
-    src[-offset] = Clip(m3 + delta);
-    src[0] = Clip(m4 - delta);
-
-    if (bPartPNoFilter)
-    {
-        src[-offset] = (pixel)m3;
-    }
-    if (bPartQNoFilter)
-    {
-        src[0] = (pixel)m4;
-    }
-}
-
-/**
- - Decision between strong and weak filter
- .
- \param offset         offset value for picture data
- \param d               d value
- \param beta            beta value
- \param tc              tc value
- \param src           pointer to picture data
- */
-inline bool TComLoopFilter::xUseStrongFiltering(int offset, int d, int beta, int tc, pixel* src)
-{
-    int16_t m4  = (int16_t)src[0];
-    int16_t m3  = (int16_t)src[-offset];
-    int16_t m7  = (int16_t)src[offset * 3];
-    int16_t m0  = (int16_t)src[-offset * 4];
-
-    int d_strong = abs(m0 - m3) + abs(m7 - m4);
-
-    return (d_strong < (beta >> 3)) && (d < (beta >> 2)) && (abs(m3 - m4) < ((tc * 5 + 1) >> 1));
-}
-
-inline int TComLoopFilter::xCalcDP(pixel* src, int offset)
-{
-    return abs(static_cast<int>(src[-offset * 3]) - 2 * src[-offset * 2] + src[-offset]);
-}
-
-inline int TComLoopFilter::xCalcDQ(pixel* src, int offset)
-{
-    return abs(static_cast<int>(src[0]) - 2 * src[offset] + src[offset * 2]);
 }
 
 //! \}
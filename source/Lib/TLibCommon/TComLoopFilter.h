@@ -72,12 +72,17 @@ private:
     bool*       m_bEdgeFilter[2];
     LFCUParam   m_lfcuParam;           ///< status structure
 
+    uint32_t*   m_leafZOrder;          ///< CUs of the current CTU, in z-order
+    uint8_t*    m_leafDepth;
+    uint32_t    m_numLeaves;
+
     bool        m_bLFCrossTileBoundary;
 
 protected:
 
-    /// CU-level deblocking function
+    /// CU-level edge map and initial strengths
     void xDeblockCU(TComDataCU* cu, uint32_t absZOrderIdx, uint32_t depth, int Edge);
+    void xEdgeFilterCU(TComDataCU* cu, uint32_t absZOrderIdx, uint32_t depth, int dir);
 
     // set / get functions
     void xSetLoopfilterParam(TComDataCU* cu, uint32_t absZOrderIdx);
@@ -85,6 +90,7 @@ protected:
     void xSetEdgefilterTU(TComDataCU* cu, uint32_t absTUPartIdx, uint32_t absZOrderIdx, uint32_t depth);
     void xSetEdgefilterPU(TComDataCU* cu, uint32_t absZOrderIdx);
     void xGetBoundaryStrengthSingle(TComDataCU* cu, int dir, uint32_t partIdx);
+    void xGetBoundaryStrengthCTU(TComDataCU* cu, int dir);
     uint32_t xCalcBsIdx(TComDataCU* cu, uint32_t absZOrderIdx, int dir, int edgeIdx, int baseUnitIdx)
     {
         TComPic* const pic = cu->getPic();
@@ -105,13 +111,6 @@ protected:
     void xEdgeFilterLuma(TComDataCU* cu, uint32_t absZOrderIdx, uint32_t depth, int dir, int edge);
     void xEdgeFilterChroma(TComDataCU* cu, uint32_t absZOrderIdx, uint32_t depth, int dir, int edge);
 
-    inline void xPelFilterLuma(pixel* src, int offset, int tc, bool sw, bool bPartPNoFilter, bool bPartQNoFilter, int iThrCut, bool bFilterSecondP, bool bFilterSecondQ);
-    inline void xPelFilterChroma(pixel* src, int offset, int tc, bool bPartPNoFilter, bool bPartQNoFilter);
-
-    inline bool xUseStrongFiltering(int offset, int d, int beta, int tc, pixel* src);
-    inline int xCalcDP(pixel* src, int offset);
-    inline int xCalcDQ(pixel* src, int offset);
-
     static const uint8_t sm_tcTable[54];
     static const uint8_t sm_betaTable[52];
 
@@ -88,23 +88,43 @@ static void md5_plane(MD5Context& md5, const pixel* plane, uint32_t width, uint3
     }
 }
 
+/* CRC-16 (polynomial 0x1021) of a zero byte shifted through each possible
+ * high byte of the register. The SEI CRC shifts picture data in at the low
+ * end, so eight steps only ever feed back from the bits of that high byte */
+struct CRCTable
+{
+    uint16_t t[256];
+
+    CRCTable()
+    {
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t crcVal = i << 8;
+            for (int bitIdx = 0; bitIdx < 8; bitIdx++)
+            {
+                uint32_t crcMsb = (crcVal >> 15) & 1;
+                crcVal = ((crcVal << 1) & 0xffff) ^ (crcMsb * 0x1021);
+            }
+
+            t[i] = (uint16_t)crcVal;
+        }
+    }
+};
+
+static const CRCTable s_crcTable;
+
 void updateCRC(const pixel* plane, uint32_t& crcVal, uint32_t height, uint32_t width, uint32_t stride)
 {
-    uint32_t crcMsb;
-    uint32_t bitVal;
-    uint32_t bitIdx;
+    uint32_t crc = crcVal;
 
     for (uint32_t y = 0; y < height; y++)
     {
+        const pixel* line = plane + y * stride;
+
         for (uint32_t x = 0; x < width; x++)
         {
             // take CRC of first pictureData byte
-            for (bitIdx = 0; bitIdx < 8; bitIdx++)
-            {
-                crcMsb = (crcVal >> 15) & 1;
-                bitVal = (plane[y * stride + x] >> (7 - bitIdx)) & 1;
-                crcVal = (((crcVal << 1) + bitVal) & 0xffff) ^ (crcMsb * 0x1021);
-            }
+            crc = (((crc << 8) | (line[x] & 0xff)) & 0xffff) ^ s_crcTable.t[crc >> 8];
 
 #if _MSC_VER
 #pragma warning(disable: 4127) // conditional expression is constant
@@ -112,15 +132,12 @@ void updateCRC(const pixel* plane, uint32_t& crcVal, uint32_t height, uint32_t w
             // take CRC of second pictureData byte if bit depth is greater than 8-bits
             if (X265_DEPTH > 8)
             {
-                for (bitIdx = 0; bitIdx < 8; bitIdx++)
-                {
-                    crcMsb = (crcVal >> 15) & 1;
-                    bitVal = (plane[y * stride + x] >> (15 - bitIdx)) & 1;
-                    crcVal = (((crcVal << 1) + bitVal) & 0xffff) ^ (crcMsb * 0x1021);
-                }
+                crc = (((crc << 8) | ((line[x] >> 7 >> 1) & 0xff)) & 0xffff) ^ s_crcTable.t[crc >> 8];
             }
         }
     }
+
+    crcVal = crc;
 }
 
 void crcFinish(uint32_t& crcVal, uint8_t digest[16])
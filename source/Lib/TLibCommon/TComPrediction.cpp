@@ -65,6 +65,8 @@ TComPrediction::TComPrediction()
     m_refLeft = NULL;
     m_refLeftFlt = NULL;
     m_immedVals = NULL;
+    m_mcCacheCount = 0;
+    m_mcCacheNext = 0;
 }
 
 TComPrediction::~TComPrediction()
@@ -81,6 +83,8 @@ TComPrediction::~TComPrediction()
     m_predShortYuv[0].destroy();
     m_predShortYuv[1].destroy();
     m_predTempYuv.destroy();
+    for (int i = 0; i < MC_CACHE_SIZE; i++)
+        m_mcCache[i].pred.destroy();
 }
 
 void TComPrediction::initTempBuff(int csp)
@@ -104,6 +108,8 @@ void TComPrediction::initTempBuff(int csp)
         m_predShortYuv[0].create(MAX_CU_SIZE, MAX_CU_SIZE, csp);
         m_predShortYuv[1].create(MAX_CU_SIZE, MAX_CU_SIZE, csp);
         m_predTempYuv.create(MAX_CU_SIZE, MAX_CU_SIZE, csp);
+        for (int i = 0; i < MC_CACHE_SIZE; i++)
+            m_mcCache[i].pred.create(MAX_CU_SIZE, MAX_CU_SIZE, csp);
 
         m_immedVals = X265_MALLOC(int16_t, 64 * (64 + NTAPS_LUMA - 1));
     }
@@ -249,6 +255,75 @@ bool TComPrediction::xCheckIdenticalMotion(TComDataCU* cu, uint32_t partAddr)
     return false;
 }
 
+/* motion of a partition as seen by motionCompensation(), lists which are not
+ * predicted from have a refIdx of NOT_VALID and a zero MV */
+static void getPartMotion(TComDataCU* cu, int list, uint32_t partAddr, int refIdx[2], MV mv[2])
+{
+    for (int l = 0; l < 2; l++)
+    {
+        refIdx[l] = NOT_VALID;
+        mv[l] = 0;
+        if (list == REF_PIC_LIST_X || list == l)
+        {
+            refIdx[l] = cu->getCUMvField(l)->getRefIdx(partAddr);
+            if (refIdx[l] >= 0)
+                mv[l] = cu->getCUMvField(l)->getMv(partAddr);
+        }
+    }
+}
+
+TComPrediction::MCCacheEntry* TComPrediction::xFindMCCache(TComDataCU* cu, int list, uint32_t partAddr, int width, int height, bool& bCacheable)
+{
+    int refIdx[2];
+    MV mv[2];
+
+    getPartMotion(cu, list, partAddr, refIdx, mv);
+
+    /* an unweighted uni-directional prediction at a full pel position (for
+     * luma and chroma) is a plain block copy, caching it gains nothing */
+    TComPPS* pps = cu->getSlice()->getPPS();
+    bool bWeighted = cu->getSlice()->isInterP() ? pps->getUseWP() : pps->getWPBiPred();
+    if (!bWeighted && (refIdx[0] < 0 || refIdx[1] < 0))
+    {
+        const MV& m = refIdx[0] >= 0 ? mv[0] : mv[1];
+        bCacheable = !!((m.x | m.y) & 7);
+    }
+    else
+        bCacheable = true;
+
+    if (!bCacheable)
+        return NULL;
+
+    uint32_t absPartIdx = cu->getZorderIdxInCU() + partAddr;
+    for (int i = 0; i < m_mcCacheCount; i++)
+    {
+        MCCacheEntry& e = m_mcCache[i];
+        if (e.absPartIdx == absPartIdx && e.width == width && e.height == height && e.cuAddr == cu->getAddr() &&
+            e.refIdx[0] == refIdx[0] && e.refIdx[1] == refIdx[1] && e.mv[0] == mv[0] && e.mv[1] == mv[1])
+            return &e;
+    }
+
+    return NULL;
+}
+
+TComPrediction::MCCacheEntry* TComPrediction::xAllocMCCache(TComDataCU* cu, int list, uint32_t partAddr, int width, int height)
+{
+    /* round-robin replacement once the cache is full */
+    MCCacheEntry& e = m_mcCache[m_mcCacheNext];
+    m_mcCacheNext = (m_mcCacheNext + 1) % MC_CACHE_SIZE;
+    if (m_mcCacheCount < MC_CACHE_SIZE)
+        m_mcCacheCount++;
+
+    getPartMotion(cu, list, partAddr, e.refIdx, e.mv);
+    e.cuAddr = cu->getAddr();
+    e.absPartIdx = cu->getZorderIdxInCU() + partAddr;
+    e.width = width;
+    e.height = height;
+    e.bLuma = false;
+    e.bChroma = false;
+    return &e;
+}
+
 void TComPrediction::motionCompensation(TComDataCU* cu, TComYuv* predYuv, int list, int partIdx, bool bLuma, bool bChroma)
 {
     int  width;
@@ -260,6 +335,15 @@ void TComPrediction::motionCompensation(TComDataCU* cu, TComYuv* predYuv, int li
         cu->getPartIndexAndSize(partIdx, partAddr, width, height);
         if (cu->getSlice()->isInterP())
             list = REF_PIC_LIST_0;
+
+        bool bCacheable;
+        MCCacheEntry* entry = xFindMCCache(cu, list, partAddr, width, height, bCacheable);
+        if (entry && (entry->bLuma || !bLuma) && (entry->bChroma || !bChroma))
+        {
+            entry->pred.copyPartToPartYuv(predYuv, partAddr, width, height, bLuma, bChroma);
+            return;
+        }
+
         if (list != REF_PIC_LIST_X)
         {
             if (cu->getSlice()->getPPS()->getUseWP())
@@ -293,6 +377,15 @@ void TComPrediction::motionCompensation(TComDataCU* cu, TComYuv* predYuv, int li
                 xPredInterBi(cu, partAddr, width, height, predYuv, bLuma, bChroma);
             }
         }
+
+        if (bCacheable)
+        {
+            if (!entry)
+                entry = xAllocMCCache(cu, list, partAddr, width, height);
+            predYuv->copyPartToPartYuv(&entry->pred, partAddr, width, height, bLuma, bChroma);
+            entry->bLuma |= bLuma;
+            entry->bChroma |= bChroma;
+        }
     }
 }
 
@@ -72,6 +72,30 @@ protected:
     int       m_hChromaShift;
     int       m_vChromaShift;
 
+    /* Cache of motion compensated prediction blocks of the current CTU, keyed
+     * by partition and motion (ref index and MV of each list). Merge
+     * candidates often share motion with each other or with the AMVP winner,
+     * and the RD merge loop predicts each candidate twice, so duplicate
+     * predictions are copied from here instead of being re-interpolated */
+    struct MCCacheEntry
+    {
+        TComYuv  pred;
+        MV       mv[2];
+        int      refIdx[2];
+        uint32_t cuAddr;
+        uint32_t absPartIdx;
+        int      width;
+        int      height;
+        bool     bLuma;     // luma plane of pred is valid
+        bool     bChroma;   // chroma planes of pred are valid
+    };
+
+    enum { MC_CACHE_SIZE = 8 };
+
+    MCCacheEntry m_mcCache[MC_CACHE_SIZE];
+    int          m_mcCacheCount;
+    int          m_mcCacheNext;
+
     // motion compensation functions
     void xPredInterUni(TComDataCU* cu, uint32_t partAddr, int width, int height, int picList, TComYuv* outPredYuv, bool bLuma, bool bChroma);
     void xPredInterUni(TComDataCU* cu, uint32_t partAddr, int width, int height, int picList, ShortYuv* outPredYuv, bool bLuma, bool bChroma);
@@ -86,6 +110,9 @@ protected:
 
     bool xCheckIdenticalMotion(TComDataCU* cu, uint32_t PartAddr);
 
+    MCCacheEntry* xFindMCCache(TComDataCU* cu, int list, uint32_t partAddr, int width, int height, bool& bCacheable);
+    MCCacheEntry* xAllocMCCache(TComDataCU* cu, int list, uint32_t partAddr, int width, int height);
+
 public:
 
     pixel*    m_predBuf;
@@ -100,6 +127,8 @@ public:
     void initTempBuff(int csp);
 
     // inter
+    void resetMCCache() { m_mcCacheCount = 0; m_mcCacheNext = 0; }
+
     void motionCompensation(TComDataCU* cu, TComYuv* predYuv, int picList = REF_PIC_LIST_X, int partIdx = -1, bool bLuma = true, bool bChroma = true);
 
     // Angular Intra
@@ -580,6 +580,13 @@ const uint8_t g_lpsTable[64][4] =
     {   2,   2,   2,   2 }
 };
 
+/* number of renormalization shifts after coding an LPS, indexed by lps >> 3 */
+const uint8_t g_renormTable[32] =
+{
+    6, 5, 4, 4, 3, 3, 3, 3, 2, 2, 2, 2, 2, 2, 2, 2,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1
+};
+
 const uint8_t x265_exp2_lut[64] =
 {
     0,  3,  6,  8,  11, 14,  17,  20,  23,  26,  29,  32,  36,  39,  42,  45,
@@ -275,6 +275,7 @@ extern const double x265_lambda2_tab[MAX_MAX_QP + 1];
 
 // CABAC tables
 extern const uint8_t g_lpsTable[64][4];
+extern const uint8_t g_renormTable[32];
 extern const uint8_t x265_exp2_lut[64];
 }
 
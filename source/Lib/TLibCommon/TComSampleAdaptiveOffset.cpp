@@ -59,8 +59,6 @@ TComSampleAdaptiveOffset::TComSampleAdaptiveOffset()
     m_clipTableBase = NULL;
     m_chromaClipTable = NULL;
     m_chromaClipTableBase = NULL;
-    m_offsetBo = NULL;
-    m_chromaOffsetBo = NULL;
     m_lumaTableBo = NULL;
     m_chromaTableBo = NULL;
     m_upBuff1 = NULL;
@@ -191,9 +189,10 @@ void TComSampleAdaptiveOffset::create(uint32_t sourceWidth, uint32_t sourceHeigh
         m_chromaTableBo[k2] = 1 + (k2 >> boRangeShiftC);
     }
 
-    m_upBuff1 = X265_MALLOC(int, m_picWidth + 2);
-    m_upBuff2 = X265_MALLOC(int, m_picWidth + 2);
-    m_upBufft = X265_MALLOC(int, m_picWidth + 2);
+    /* the SAO primitives read and write the sign rows in chunks of 16 */
+    m_upBuff1 = X265_MALLOC(int8_t, m_picWidth + 2 + 16);
+    m_upBuff2 = X265_MALLOC(int8_t, m_picWidth + 2 + 16);
+    m_upBufft = X265_MALLOC(int8_t, m_picWidth + 2 + 16);
 
     m_upBuff1++;
     m_upBuff2++;
@@ -206,7 +205,6 @@ void TComSampleAdaptiveOffset::create(uint32_t sourceWidth, uint32_t sourceHeigh
     int rangeExt = maxY >> 1;
 
     m_clipTableBase = X265_MALLOC(pixel, maxY + 2 * rangeExt);
-    m_offsetBo      = X265_MALLOC(int, maxY + 2 * rangeExt);
 
     for (i = 0; i < (minY + rangeExt); i++)
     {
@@ -231,7 +229,6 @@ void TComSampleAdaptiveOffset::create(uint32_t sourceWidth, uint32_t sourceHeigh
     int rangeExtC = maxC >> 1;
 
     m_chromaClipTableBase = X265_MALLOC(pixel, maxC + 2 * rangeExtC);
-    m_chromaOffsetBo      = X265_MALLOC(int, maxC + 2 * rangeExtC);
 
     for (i = 0; i < (minC + rangeExtC); i++)
     {
@@ -269,14 +266,10 @@ void TComSampleAdaptiveOffset::destroy()
 {
     X265_FREE(m_clipTableBase);
     m_clipTableBase = NULL;
-    X265_FREE(m_offsetBo);
-    m_offsetBo = NULL;
     X265_FREE(m_lumaTableBo);
     m_lumaTableBo = NULL;
     X265_FREE(m_chromaClipTableBase);
     m_chromaClipTableBase = NULL;
-    X265_FREE(m_chromaOffsetBo);
-    m_chromaOffsetBo = NULL;
     X265_FREE(m_chromaTableBo);
     m_chromaTableBo = NULL;
 
@@ -524,7 +517,6 @@ void TComSampleAdaptiveOffset::processSaoCu(int addr, int saoType, int yCbCr)
     uint32_t rpelx;
     uint32_t bpely;
     int  edgeType;
-    int  signDown;
     int  signDown1;
     int  signDown2;
     int picWidthTmp;
@@ -540,8 +532,8 @@ void TComSampleAdaptiveOffset::processSaoCu(int addr, int saoType, int yCbCr)
     pixel* tmpL;
     pixel* tmpU;
     pixel* clipTbl = NULL;
-    int32_t *offsetBo = NULL;
-    int32_t *tmp_swap;
+    int8_t* offsetBo = NULL;
+    int8_t* tmp_swap;
 
     picWidthTmp  = (isChroma == 0) ? m_picWidth  : m_picWidth  >> m_hChromaShift;
     picHeightTmp = (isChroma == 0) ? m_picHeight : m_picHeight >> m_vChromaShift;
@@ -663,15 +655,7 @@ void TComSampleAdaptiveOffset::processSaoCu(int addr, int saoType, int yCbCr)
 
         for (y = startY; y < endY; y++)
         {
-            for (x = 0; x < lcuWidth; x++)
-            {
-                signDown  = xSign(rec[x] - rec[x + stride]);
-                edgeType = signDown + m_upBuff1[x] + 2;
-                m_upBuff1[x] = -signDown;
-
-                rec[x] = clipTbl[rec[x] + m_offsetEo[edgeType]];
-            }
-
+            primitives.saoCuOrgE1(rec, m_upBuff1, m_offsetEo, stride, lcuWidth);
             rec += stride;
         }
 
@@ -698,13 +682,7 @@ void TComSampleAdaptiveOffset::processSaoCu(int addr, int saoType, int yCbCr)
         for (y = startY; y < endY; y++)
         {
             signDown2 = xSign(rec[stride + startX] - tmpL[y]);
-            for (x = startX; x < endX; x++)
-            {
-                signDown1      =  xSign(rec[x] - rec[x + stride + 1]);
-                edgeType      =  signDown1 + m_upBuff1[x] + 2;
-                m_upBufft[x + 1] = -signDown1;
-                rec[x] = clipTbl[rec[x] + m_offsetEo[edgeType]];
-            }
+            primitives.saoCuOrgE2(rec + startX, m_upBufft + startX, m_upBuff1 + startX, m_offsetEo, endX - startX, stride);
 
             m_upBufft[startX] = signDown2;
 
@@ -742,13 +720,7 @@ void TComSampleAdaptiveOffset::processSaoCu(int addr, int saoType, int yCbCr)
             edgeType      =  signDown1 + m_upBuff1[x] + 2;
             m_upBuff1[x - 1] = -signDown1;
             rec[x] = clipTbl[rec[x] + m_offsetEo[edgeType]];
-            for (x = startX + 1; x < endX; x++)
-            {
-                signDown1      =  xSign(rec[x] - rec[x + stride - 1]);
-                edgeType      =  signDown1 + m_upBuff1[x] + 2;
-                m_upBuff1[x - 1] = -signDown1;
-                rec[x] = clipTbl[rec[x] + m_offsetEo[edgeType]];
-            }
+            primitives.saoCuOrgE3(rec, m_upBuff1, m_offsetEo, stride, startX + 1, endX);
 
             m_upBuff1[endX - 1] = xSign(rec[endX - 1 + stride] - rec[endX]);
 
@@ -759,15 +731,7 @@ void TComSampleAdaptiveOffset::processSaoCu(int addr, int saoType, int yCbCr)
     }
     case SAO_BO:
     {
-        for (y = 0; y < lcuHeight; y++)
-        {
-            for (x = 0; x < lcuWidth; x++)
-            {
-                rec[x] = offsetBo[rec[x]];
-            }
-
-            rec += stride;
-        }
+        primitives.saoCuOrgB0(rec, offsetBo, lcuWidth, lcuHeight, stride);
 
         break;
     }
@@ -853,9 +817,7 @@ void TComSampleAdaptiveOffset::processSaoUnitAll(SaoLcuParam* saoLcuParam, bool
 
     int  i;
     uint32_t edgeType;
-    pixel* lumaTable = NULL;
-    pixel* clipTable = NULL;
-    int32_t* offsetBo = NULL;
+    int8_t* offsetBo = NULL;
     int  typeIdx;
 
     int offset[LUMA_GROUP_NUM + 1];
@@ -929,12 +891,9 @@ void TComSampleAdaptiveOffset::processSaoUnitAll(SaoLcuParam* saoLcuParam, bool
                             offset[(saoLcuParam[addr].subTypeIdx + i) % SAO_MAX_BO_CLASSES  + 1] = saoLcuParam[addr].offset[i] << saoBitIncrease;
                         }
 
-                        lumaTable = (yCbCr == 0) ? m_lumaTableBo : m_chromaTableBo;
-                        clipTable = (yCbCr == 0) ? m_clipTable : m_chromaClipTable;
-
-                        for (i = 0; i < (1 << X265_DEPTH); i++)
+                        for (i = 0; i < SAO_MAX_BO_CLASSES; i++)
                         {
-                            offsetBo[i] = clipTable[i + offset[lumaTable[i]]];
+                            offsetBo[i] = (int8_t)offset[i + 1];
                         }
                     }
                     if (typeIdx == SAO_EO_0 || typeIdx == SAO_EO_1 || typeIdx == SAO_EO_2 || typeIdx == SAO_EO_3)
@@ -1009,9 +968,7 @@ void TComSampleAdaptiveOffset::processSaoUnitRow(SaoLcuParam* saoLcuParam, int i
 
     int  i;
     uint32_t edgeType;
-    pixel* lumaTable = NULL;
-    pixel* clipTable = NULL;
-    int32_t* offsetBo = NULL;
+    int8_t* offsetBo = NULL;
     int  typeIdx;
 
     int offset[LUMA_GROUP_NUM + 1];
@@ -1075,12 +1032,9 @@ void TComSampleAdaptiveOffset::processSaoUnitRow(SaoLcuParam* saoLcuParam, int i
                             offset[(saoLcuParam[addr].subTypeIdx + i) % SAO_MAX_BO_CLASSES  + 1] = saoLcuParam[addr].offset[i] << saoBitIncrease;
                         }
 
-                        lumaTable = (yCbCr == 0) ? m_lumaTableBo : m_chromaTableBo;
-                        clipTable = (yCbCr == 0) ? m_clipTable : m_chromaClipTable;
-
-                        for (i = 0; i < (1 << X265_DEPTH); i++)
+                        for (i = 0; i < SAO_MAX_BO_CLASSES; i++)
                         {
-                            offsetBo[i] = clipTable[i + offset[lumaTable[i]]];
+                            offsetBo[i] = (int8_t)offset[i + 1];
                         }
                     }
                     if (typeIdx == SAO_EO_0 || typeIdx == SAO_EO_1 || typeIdx == SAO_EO_2 || typeIdx == SAO_EO_3)
@@ -143,8 +143,8 @@ protected:
     static const int m_numCulPartsLevel[5];
     static const uint32_t m_eoTable[9];
     static const int m_numClass[MAX_NUM_SAO_TYPE];
-    int32_t *m_offsetBo;
-    int32_t *m_chromaOffsetBo;
+    int8_t m_offsetBo[SAO_MAX_BO_CLASSES];  //!< offset of each band
+    int8_t m_chromaOffsetBo[SAO_MAX_BO_CLASSES];
     int8_t m_offsetEo[LUMA_GROUP_NUM];
     int  m_picWidth;
     int  m_picHeight;
@@ -167,9 +167,9 @@ protected:
     pixel* m_chromaClipTable;
     pixel* m_chromaClipTableBase;
     pixel* m_chromaTableBo;
-    int32_t    *m_upBuff1;
-    int32_t    *m_upBuff2;
-    int32_t    *m_upBufft;
+    int8_t     *m_upBuff1;
+    int8_t     *m_upBuff2;
+    int8_t     *m_upBufft;
     TComPicYuv* m_tmpYuv;  //!< temporary picture buffer pointer when non-across slice/tile boundary SAO is enabled
 
     pixel* m_tmpU1[3];
@@ -39,6 +39,7 @@
 #include "TComPic.h"
 #include "ContextTables.h"
 #include "primitives.h"
+#include "threading.h"
 
 using namespace x265;
 
@@ -143,45 +144,42 @@ void TComTrQuant::setQPforQuant(int qpy, TextType ttype, int qpBdOffset, int chr
 // To minimize the distortion only. No rate is considered.
 void TComTrQuant::signBitHidingHDQ(coeff_t* qCoef, coeff_t* coef, int32_t* deltaU, const TUEntropyCodingParameters &codingParameters)
 {
-    const uint32_t log2TrSizeCG = codingParameters.log2TrSizeCG;
+    const uint32_t log2TrSize = codingParameters.log2TrSizeCG + 2;
+
+    /* significance and sign masks of every coefficient group up to the last */
+    uint16_t coeffFlag[MLS_GRP_NUM];
+    uint16_t coeffSign[MLS_GRP_NUM];
+    uint8_t coeffNum[MLS_GRP_NUM];
+    int numSig = primitives.count_nonzero(qCoef, 1 << (log2TrSize * 2));
+    int lastScanPos = primitives.scan_poslast(qCoef, codingParameters.scan, log2TrSize, coeffFlag, coeffSign, coeffNum, numSig);
 
     int lastCG = 1;
 
-    for (int subSet = (1 << log2TrSizeCG * 2) - 1; subSet >= 0; subSet--)
+    for (int subSet = lastScanPos >> LOG2_SCAN_SET_SIZE; subSet >= 0; subSet--)
     {
         int subPos = subSet << LOG2_SCAN_SET_SIZE;
         int n;
 
-        for (n = SCAN_SET_SIZE - 1; n >= 0; --n)
-        {
-            if (qCoef[codingParameters.scan[n + subPos]])
-            {
-                break;
-            }
-        }
+        uint32_t sigFlags = coeffFlag[subSet];
+        if (!sigFlags) continue;
 
-        if (n < 0) continue;
+        unsigned long lastNZ, firstNZ;
+        CLZ32(lastNZ, sigFlags);
+        CTZ64(firstNZ, (uint64_t)sigFlags);
 
-        int  lastNZPosInCG = n;
-
-        for (n = 0;; n++)
-        {
-            if (qCoef[codingParameters.scan[n + subPos]])
-            {
-                break;
-            }
-        }
-
-        int  firstNZPosInCG = n;
+        int  lastNZPosInCG = (int)lastNZ;
+        int  firstNZPosInCG = (int)firstNZ;
 
         if (lastNZPosInCG - firstNZPosInCG >= SBH_THRESHOLD)
         {
-            uint32_t signbit = (qCoef[codingParameters.scan[subPos + firstNZPosInCG]] > 0 ? 0 : 1);
+            uint32_t signbit = (coeffSign[subSet] >> firstNZPosInCG) & 1;
             int  absSum = 0;
 
-            for (n = firstNZPosInCG; n <= lastNZPosInCG; n++)
+            for (uint32_t flags = sigFlags; flags; flags &= flags - 1)
             {
-                absSum += qCoef[codingParameters.scan[n + subPos]];
+                unsigned long pos;
+                CTZ64(pos, (uint64_t)flags);
+                absSum += qCoef[codingParameters.scan[subPos + pos]];
             }
 
             if (signbit != (absSum & 0x1)) //compare signbit with sum_parity
@@ -350,6 +348,13 @@ uint32_t TComTrQuant::transformNxN(TComDataCU* cu,
     }
     else
     {
+        // the noise reduction statistics and scaling lists need the coefficients
+        if (!m_nr->bNoiseReduction && !getUseScalingList() && xIsZeroBlock(residual, stride, trSize))
+        {
+            memset(coeff, 0, sizeof(coeff_t) * trSize * trSize);
+            return 0;
+        }
+
         // TODO: this may need larger data types for X265_DEPTH > 8
         const uint32_t log2BlockSize = g_convertToBit[trSize];
         primitives.dct[DCT_4x4 + log2BlockSize - ((trSize == 4) && (mode != REG_DCT))](residual, m_tmpCoeff, stride);
@@ -366,6 +371,37 @@ uint32_t TComTrQuant::transformNxN(TComDataCU* cu,
     return xQuant(cu, m_tmpCoeff, coeff, trSize, ttype, absPartIdx, lastPos, curUseRDOQ);
 }
 
+/* returns 4 or 8 when every non-zero coefficient of the block lies within its
+ * top-left 4x4 or 8x8 corner, else 0. lastPos always addresses a non-zero
+ * coefficient, so dense blocks are rejected without looking at the block */
+static int nonZeroCorner(const int32_t* coef, uint32_t trSize, uint32_t log2TrSize, int lastPos)
+{
+    if ((uint32_t)(lastPos & (trSize - 1)) >= 8 || (uint32_t)(lastPos >> log2TrSize) >= 8)
+        return 0;
+
+    if (trSize > 8 && primitives.count_nonzero(coef + 8 * trSize, (trSize - 8) * trSize))
+        return 0;
+
+    int corner = 4;
+    for (uint32_t y = 0; y < 8; y++)
+    {
+        const int32_t* row = coef + y * trSize;
+        for (uint32_t x = 8; x < trSize; x++)
+        {
+            if (row[x])
+                return 0;
+        }
+
+        for (uint32_t x = y < 4 ? 4 : 0; x < 8; x++)
+        {
+            if (row[x])
+                corner = 8;
+        }
+    }
+
+    return corner;
+}
+
 void TComTrQuant::invtransformNxN(bool transQuantBypass, uint32_t mode, int16_t* residual, uint32_t stride, coeff_t* coeff, uint32_t trSize, int scalingListType, bool useTransformSkip, int lastPos)
 {
     if (transQuantBypass)
@@ -427,6 +463,21 @@ void TComTrQuant::invtransformNxN(bool transQuantBypass, uint32_t mode, int16_t*
             return;
         }
 
+        if (trSize >= 8)
+        {
+            int corner = nonZeroCorner(m_tmpCoeff, trSize, log2TrSize, lastPos);
+            if (corner == 4)
+            {
+                primitives.idct_corner4[IDCT_4x4 + log2BlockSize](m_tmpCoeff, residual, stride);
+                return;
+            }
+            if (corner == 8 && trSize > 8)
+            {
+                primitives.idct_corner8[IDCT_4x4 + log2BlockSize](m_tmpCoeff, residual, stride);
+                return;
+            }
+        }
+
         // TODO: this may need larger data types for X265_DEPTH > 8
         primitives.idct[IDCT_4x4 + log2BlockSize - ((trSize == 4) && (mode != REG_DCT))](m_tmpCoeff, residual, stride);
     }
@@ -436,6 +487,49 @@ void TComTrQuant::invtransformNxN(bool transQuantBypass, uint32_t mode, int16_t*
 // Logical transform
 // ------------------------------------------------------------------------------------------------
 
+/** Zero block prediction ahead of the forward transform
+ *  \param residual input residual block
+ *  \param stride stride of the residual block
+ *  \param trSize transform size (trSize x trSize)
+ *  \returns true when the block certainly quantizes to all zero levels
+ *
+ * Both transform passes are bounded by the largest basis value (90) and their
+ * rounding, so every coefficient is at most (90 * (90 * SAD / 2^shift1 + N / 2)
+ * / 2^shift2 + 1/2). Keeping coef * scale below half a quantization step makes
+ * the level zero with every rounding offset in use, RDOQ included, so skipping
+ * transform and quant is exact. The SAD sum stops as soon as the limit is met
+ */
+bool TComTrQuant::xIsZeroBlock(int16_t* residual, uint32_t stride, uint32_t trSize)
+{
+    const uint32_t log2TrSize = g_convertToBit[trSize] + 2;
+    const int shift1 = log2TrSize - 1 + X265_DEPTH - 8;
+    const int shift2 = log2TrSize + 6;
+    const int transformShift = MAX_TR_DYNAMIC_RANGE - X265_DEPTH - log2TrSize;
+    const int qbits = QUANT_SHIFT + m_qpParam.m_per + transformShift;
+    const int64_t maxBasis = 90;
+
+    int64_t limit = ((((int64_t)1) << (qbits - 1 + shift1 + shift2)) - 1) / g_quantScales[m_qpParam.m_rem];
+    limit -= (maxBasis * trSize) << (shift1 - 1);
+    limit -= ((int64_t)1) << (shift1 + shift2 - 1);
+    if (limit < 0)
+        return false;
+
+    const uint32_t maxSad = (uint32_t)X265_MIN(limit / (maxBasis * maxBasis), (int64_t)MAX_INT);
+    uint32_t sad = 0;
+    for (uint32_t y = 0; y < trSize; y++)
+    {
+        for (uint32_t x = 0; x < trSize; x++)
+        {
+            sad += abs(residual[y * stride + x]);
+        }
+
+        if (sad > maxSad)
+            return false;
+    }
+
+    return true;
+}
+
 /** Wrapper function between HM interface and core 4x4 transform skipping
  *  \param resiBlock input data (residual)
  *  \param psCoeff output data (transform coefficients)
@@ -533,6 +627,8 @@ uint32_t TComTrQuant::xRateDistOptQuant(TComDataCU* cu, int32_t* srcCoeff, coeff
     double costCoeff[32 * 32];
     double costSig[32 * 32];
     double costCoeff0[32 * 32];
+    ALIGN_VAR_16(double, costUncoded[32 * 32]);
+    ALIGN_VAR_16(int32_t, levelDoubles[32 * 32]);
 
     int rateIncUp[32 * 32];
     int rateIncDown[32 * 32];
@@ -557,6 +653,13 @@ uint32_t TComTrQuant::xRateDistOptQuant(TComDataCU* cu, int32_t* srcCoeff, coeff
     int scanPos;
     coeffGroupRDStats rdStats;
 
+    /* scaled levels, rounded levels and uncoded distortion of the whole block
+     * in raster order; a block that rounds to all zero is left all zero */
+    if (!primitives.rdoq_levels(srcCoeff, qCoef, errScale, levelDoubles, dstCoeff, costUncoded, qbits, trSize * trSize))
+    {
+        return absSum;
+    }
+
     for (int cgScanPos = cgNum - 1; cgScanPos >= 0; cgScanPos--)
     {
         const uint32_t cgBlkPos = codingParameters.scanCG[cgScanPos];
@@ -566,22 +669,79 @@ uint32_t TComTrQuant::xRateDistOptQuant(TComDataCU* cu, int32_t* srcCoeff, coeff
         memset(&rdStats, 0, sizeof(coeffGroupRDStats));
         X265_CHECK((trSize >> 2) == (1 << codingParameters.log2TrSizeCG), "transform size invalid\n");
         const int patternSigCtx = TComTrQuant::calcPatternSigCtx(sigCoeffGroupFlag64, cgPosX, cgPosY, codingParameters.log2TrSizeCG);
-        for (int scanPosinCG = cgSize - 1; scanPosinCG >= 0; scanPosinCG--)
+
+        int scanPosinCG = cgSize - 1;
+        if (lastScanPos < 0)
+        {
+            /* coefficients past the last significant one only add their
+             * uncoded distortion, in the same order as the full loop below */
+            for (; scanPosinCG >= 0; scanPosinCG--)
+            {
+                scanPos = cgScanPos * cgSize + scanPosinCG;
+                uint32_t blkPos = codingParameters.scan[scanPos];
+                if (dstCoeff[blkPos])
+                    break;
+
+                costCoeff0[scanPos] = costUncoded[blkPos];
+                blockUncodedCost   += costCoeff0[scanPos];
+                costCoeff[scanPos]  = 0;
+                baseCost           += costCoeff0[scanPos];
+            }
+
+            if (scanPosinCG < 0)
+                continue;
+        }
+        else if (cgScanPos)
+        {
+            /* a group before the last position whose levels all round to zero
+             * can only be coded with its group flag off: it costs its uncoded
+             * distortion plus the zero group flag, without level estimation */
+            int pos = scanPosinCG;
+            while (pos >= 0 && !dstCoeff[codingParameters.scan[cgScanPos * cgSize + pos]])
+                pos--;
+
+            if (pos < 0)
+            {
+                for (; scanPosinCG >= 0; scanPosinCG--)
+                {
+                    scanPos = cgScanPos * cgSize + scanPosinCG;
+                    uint32_t blkPos = codingParameters.scan[scanPos];
+                    costCoeff0[scanPos] = costUncoded[blkPos];
+                    blockUncodedCost   += costCoeff0[scanPos];
+                    costCoeff[scanPos]  = costCoeff0[scanPos];
+                    costSig[scanPos]    = 0;
+                    baseCost           += costCoeff0[scanPos];
+                }
+
+                //===== context set update =====
+                c2 = 0;
+                goRiceParam = 0;
+                c1Idx = 0;
+                c2Idx = 0;
+                ctxSet = (cgScanPos == 1 || ttype != TEXT_LUMA) ? 0 : 2;
+                ctxSet -= ((int32_t)(c1 - 1) >> 31);
+                c1 = 1;
+
+                uint32_t ctxSig = getSigCoeffGroupCtxInc(sigCoeffGroupFlag64, cgPosX, cgPosY, codingParameters.log2TrSizeCG);
+                costCoeffGroupSig[cgScanPos] = xGetRateSigCoeffGroup(0, ctxSig);
+                baseCost += costCoeffGroupSig[cgScanPos];
+                continue;
+            }
+        }
+
+        for (; scanPosinCG >= 0; scanPosinCG--)
         {
             scanPos = cgScanPos * cgSize + scanPosinCG;
             //===== quantization =====
             uint32_t blkPos = codingParameters.scan[scanPos];
             // set coeff
-            int Q = qCoef[blkPos];
             double scaleFactor = errScale[blkPos];
-            int levelDouble    = srcCoeff[blkPos];
-            levelDouble        = (int)std::min<int64_t>((int64_t)abs((int)levelDouble) * Q, MAX_INT - (1 << (qbits - 1)));
+            int levelDouble    = levelDoubles[blkPos];
 
-            uint32_t maxAbsLevel = (levelDouble + (1 << (qbits - 1))) >> qbits;
+            uint32_t maxAbsLevel = dstCoeff[blkPos];
 
-            costCoeff0[scanPos] = ((uint64_t)levelDouble * levelDouble) * scaleFactor;
+            costCoeff0[scanPos] = costUncoded[blkPos];
             blockUncodedCost   += costCoeff0[scanPos];
-            dstCoeff[blkPos]    = maxAbsLevel;
 
             if (maxAbsLevel > 0 && lastScanPos < 0)
             {
@@ -759,9 +919,9 @@ uint32_t TComTrQuant::xRateDistOptQuant(TComDataCU* cu, int32_t* srcCoeff, coeff
                                 costCoeffGroupSig[cgScanPos] = xGetRateSigCoeffGroup(0, ctxSig);
                             }
                             // reset coeffs to 0 in this block
-                            for (int scanPosinCG = cgSize - 1; scanPosinCG >= 0; scanPosinCG--)
+                            for (int pos = cgSize - 1; pos >= 0; pos--)
                             {
-                                scanPos      = cgScanPos * cgSize + scanPosinCG;
+                                scanPos      = cgScanPos * cgSize + pos;
                                 uint32_t blkPos = codingParameters.scan[scanPos];
                                 if (dstCoeff[blkPos])
                                 {
@@ -223,6 +223,7 @@ protected:
 private:
 
     void xTransformSkip(int16_t* resiBlock, uint32_t stride, int32_t* coeff, int trSize);
+    bool xIsZeroBlock(int16_t* residual, uint32_t stride, uint32_t trSize);
     void signBitHidingHDQ(coeff_t* qcoeff, coeff_t* coeff, int32_t* deltaU, const TUEntropyCodingParameters &codingParameters);
     uint32_t xQuant(TComDataCU* cu, int32_t* src, coeff_t* dst, int trSize, TextType ttype, uint32_t absPartIdx, int32_t *lastPos, bool curUseRDOQ = true);
 
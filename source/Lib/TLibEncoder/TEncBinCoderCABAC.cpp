@@ -37,7 +37,6 @@
 
 #include "TEncBinCoderCABAC.h"
 #include "TLibCommon/TComRom.h"
-#include "threading.h"  // CLZ32
 
 using namespace x265;
 
@@ -100,7 +99,7 @@ void TEncBinCABAC::finish()
             m_numBufferedBytes--;
         }
     }
-    m_bitIf->write(m_low >> 8, 13 + m_bitsLeft);
+    m_bitIf->write((uint32_t)(m_low >> 8), 13 + m_bitsLeft);
 }
 
 void TEncBinCABAC::flush()
@@ -186,7 +185,7 @@ void TEncBinCABAC::encodeBin(uint32_t binValue, ContextModel &ctxModel)
         m_fracBits += sbacGetEntropyBits(mstate, binValue);
         return;
     }
-    ctxModel.bBinsCoded = 1;
+    ctxModel.m_state |= 128; // bins coded
 
     uint32_t range = m_range;
     uint32_t state = sbacGetState(mstate);
@@ -195,29 +194,20 @@ void TEncBinCABAC::encodeBin(uint32_t binValue, ContextModel &ctxModel)
 
     X265_CHECK(lps >= 2, "lps is too small\n");
 
-    int numBits = (uint32_t)(range - 256) >> 31;
-    uint32_t low = m_low;
-
     // NOTE: MPS must be LOWEST bit in mstate
     X265_CHECK(((binValue ^ mstate) & 1) == (binValue != sbacGetMps(mstate)), "binValue failure\n");
-    if ((binValue ^ mstate) & 1)
-    {
-        // NOTE: lps is non-zero and the maximum of idx is 8 because lps less than 256
-        //numBits   = g_renormTable[lps >> 3];
-        unsigned long idx;
-        CLZ32(idx, lps);
-        X265_CHECK(state != 63 || idx == 1, "state failure\n");
-
-        numBits = 8 - idx;
-        if (state >= 63)
-            numBits = 6;
-        X265_CHECK(numBits <= 6, "numBits failure\n");
-
-        low    += range;
-        range   = lps;
-    }
-    m_low = (low << numBits);
-    m_range = (range << numBits);
+
+    /* select the MPS or LPS sub-interval with masks rather than a branch, the
+     * outcome of a bin is close to random for the branch predictor */
+    uint32_t lpsMask = 0 - ((binValue ^ mstate) & 1);
+    uint64_t low = m_low + (range & lpsMask);
+    range = (range & ~lpsMask) | (lps & lpsMask);
+
+    // NOTE: lps is at least 2, so an LPS renormalizes by at most 6 bits
+    int numBits = lpsMask ? g_renormTable[lps >> 3] : (uint32_t)(range - 256) >> 31;
+
+    m_low = low << numBits;
+    m_range = range << numBits;
     m_bitsLeft += numBits;
 
     if (m_bitsLeft >= 0)
@@ -279,23 +269,8 @@ void TEncBinCABAC::encodeBinsEP(uint32_t binValues, int numBins)
         DTRACE_CABAC_T("\n")
     }
 
-    while (numBins > 8)
-    {
-        numBins -= 8;
-        uint32_t pattern = binValues >> numBins;
-        m_low <<= 8;
-        m_low += m_range * pattern;
-        binValues -= pattern << numBins;
-        m_bitsLeft += 8;
-
-        if (m_bitsLeft >= 0)
-        {
-            writeOut();
-        }
-    }
-
-    m_low <<= numBins;
-    m_low += m_range * binValues;
+    /* the 64 bit low register has room for all 32 bins at once */
+    m_low = (m_low << numBins) + (uint64_t)m_range * binValues;
     m_bitsLeft += numBins;
 
     if (m_bitsLeft >= 0)
@@ -343,39 +318,44 @@ void TEncBinCABAC::encodeBinTrm(uint32_t binValue)
 }
 
 /**
- * \brief Move bits from register into bitstream
+ * \brief Move all complete bytes from register into bitstream
  */
 void TEncBinCABAC::writeOut()
 {
-    uint32_t leadByte = m_low >> (13 + m_bitsLeft);
-    uint32_t low_mask = (uint32_t)(~0) >> (11 + 8 - m_bitsLeft);
+    /* only the first byte taken from the register can hold a carry, the
+     * bytes below it are masked out of the register as they are taken */
+    do
+    {
+        uint32_t leadByte = (uint32_t)(m_low >> (13 + m_bitsLeft));
 
-    m_bitsLeft -= 8;
-    m_low &= low_mask;
+        m_low &= ((uint64_t)1 << (13 + m_bitsLeft)) - 1;
+        m_bitsLeft -= 8;
 
-    if (leadByte == 0xff)
-    {
-        m_numBufferedBytes++;
-    }
-    else
-    {
-        uint32_t numBufferedBytes = m_numBufferedBytes;
-        if (numBufferedBytes > 0)
+        if (leadByte == 0xff)
         {
-            uint32_t carry = leadByte >> 8;
-            uint32_t byteTowrite = m_bufferedByte + carry;
-            m_bitIf->writeByte(byteTowrite);
-
-            byteTowrite = (0xff + carry) & 0xff;
-            while (numBufferedBytes > 1)
+            m_numBufferedBytes++;
+        }
+        else
+        {
+            uint32_t numBufferedBytes = m_numBufferedBytes;
+            if (numBufferedBytes > 0)
             {
+                uint32_t carry = leadByte >> 8;
+                uint32_t byteTowrite = m_bufferedByte + carry;
                 m_bitIf->writeByte(byteTowrite);
-                numBufferedBytes--;
+
+                byteTowrite = (0xff + carry) & 0xff;
+                while (numBufferedBytes > 1)
+                {
+                    m_bitIf->writeByte(byteTowrite);
+                    numBufferedBytes--;
+                }
             }
+            m_numBufferedBytes = 1;
+            m_bufferedByte = (uint8_t)leadByte;
         }
-        m_numBufferedBytes = 1;
-        m_bufferedByte = (uint8_t)leadByte;
     }
+    while (m_bitsLeft >= 0);
 }
 
 //! \}
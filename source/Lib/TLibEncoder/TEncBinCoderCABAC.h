@@ -85,7 +85,7 @@ protected:
 public:
 
     TComBitIf* m_bitIf;
-    uint32_t   m_low;
+    uint64_t   m_low;
     uint32_t   m_range;
     uint32_t   m_bufferedByte;
     int        m_numBufferedBytes;
@@ -86,6 +86,12 @@ TEncCu::TEncCu()
     m_entropyCoder    = NULL;
     m_rdSbacCoders    = NULL;
     m_rdGoOnSbacCoder = NULL;
+
+    m_numStaticCTUs   = 0;
+    m_lowresCosts     = NULL;
+    m_lowresWidth     = 0;
+    m_lowresHeight    = 0;
+    m_fdColocated     = NULL;
 }
 
 /**
@@ -375,6 +381,7 @@ void TEncCu::compressCU(TComDataCU* cu)
     // initialize CU data
     m_bestCU[0]->initCU(cu->getPic(), cu->getAddr());
     m_tempCU[0]->initCU(cu->getPic(), cu->getAddr());
+    m_search->resetMCCache();
 
     // analysis of CU
 #if LOG_CU_STATISTICS
@@ -407,6 +414,14 @@ void TEncCu::compressCU(TComDataCU* cu)
         }
         while (i < numPartition);
 #endif // if LOG_CU_STATISTICS
+    }
+    else if (m_param->bEnableStaticSkip && xCompressStaticCU(m_bestCU[0]))
+    {
+        m_numStaticCTUs++;
+#if LOG_CU_STATISTICS
+        m_log->cntTotalCu[0]++;
+        m_log->cntSkipCu[0]++;
+#endif
     }
     else
     {
@@ -1582,6 +1597,117 @@ void TEncCu::xCheckBestMode(TComDataCU*& outBestCU, TComDataCU*& outTempCU, uint
     }
 }
 
+/** Check whether the source of the CTU is unchanged from the source of the
+ *  first reference picture of the given list, by the SAD of each 8x8 luma
+ *  block and of its co-sited chroma blocks */
+bool TEncCu::xIsStaticCTU(TComDataCU* cu, int list)
+{
+    TComSlice* slice = cu->getSlice();
+
+    if (slice->getNumRefIdx(list) <= 0)
+        return false;
+
+    /* a weighted reference does not predict the unchanged source */
+    wpScalingParam* wp = slice->m_weightPredTable[list][0];
+    if (wp[0].bPresentFlag || wp[1].bPresentFlag || wp[2].bPresentFlag)
+        return false;
+
+    TComPicYuv* fenc = cu->getPic()->getPicYuvOrg();
+    TComPicYuv* ref = slice->getRefPic(list, 0)->getPicYuvOrg();
+    uint32_t cuAddr = cu->getAddr();
+    int hShift = cu->getHorzChromaShift();
+    int vShift = cu->getVertChromaShift();
+    int lumaPart = partitionFromSizes(8, 8);
+    int chromaPart = partitionFromSizes(8 >> hShift, 8 >> vShift);
+    intptr_t stride = fenc->getStride();
+    intptr_t cstride = fenc->getCStride();
+    int threshold = m_param->staticThreshold;
+
+    for (uint32_t y = 0; y < g_maxCUSize; y += 8)
+    {
+        for (uint32_t x = 0; x < g_maxCUSize; x += 8)
+        {
+            intptr_t offset = y * stride + x;
+            if (primitives.sad[lumaPart](fenc->getLumaAddr(cuAddr) + offset, stride, ref->getLumaAddr(cuAddr) + offset, stride) > threshold)
+                return false;
+
+            intptr_t coffset = (y >> vShift) * cstride + (x >> hShift);
+            if (primitives.sad[chromaPart](fenc->getCbAddr(cuAddr) + coffset, cstride, ref->getCbAddr(cuAddr) + coffset, cstride) > threshold ||
+                primitives.sad[chromaPart](fenc->getCrAddr(cuAddr) + coffset, cstride, ref->getCrAddr(cuAddr) + coffset, cstride) > threshold)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+/** Static region fast path. If the CTU is unchanged from a reference picture
+ *  and a zero-MV merge candidate predicts only from such references, code
+ *  the whole CTU as a 2Nx2N skip CU with that candidate, without any further
+ *  analysis. Returns false if the CTU must be analyzed normally */
+bool TEncCu::xCompressStaticCU(TComDataCU* cu)
+{
+    TComSlice* slice = cu->getSlice();
+    TComPic* pic = cu->getPic();
+
+    if (m_param->bLossless || m_CUTransquantBypassFlagValue ||
+        cu->getCUPelX() + g_maxCUSize > slice->getSPS()->getPicWidthInLumaSamples() ||
+        cu->getCUPelY() + g_maxCUSize > slice->getSPS()->getPicHeightInLumaSamples())
+        return false;
+
+    bool bStatic[2];
+    bStatic[0] = xIsStaticCTU(cu, REF_PIC_LIST_0);
+    bStatic[1] = slice->isInterB() && xIsStaticCTU(cu, REF_PIC_LIST_1);
+    if (!bStatic[0] && !bStatic[1])
+        return false;
+
+    TComMvField mvFieldNeighbours[MRG_MAX_NUM_CANDS][2]; // double length for mv of both lists
+    uint8_t interDirNeighbours[MRG_MAX_NUM_CANDS];
+    uint32_t maxNumMergeCand = slice->getMaxNumMergeCand();
+
+    cu->setPartSizeSubParts(SIZE_2Nx2N, 0, 0);
+    cu->setCUTransquantBypassSubParts(false, 0, 0);
+    cu->getInterMergeCandidates(0, 0, mvFieldNeighbours, interDirNeighbours, maxNumMergeCand);
+
+    /* find a candidate whose every used list predicts from a static reference with a zero MV */
+    uint32_t mergeCand;
+    for (mergeCand = 0; mergeCand < maxNumMergeCand; mergeCand++)
+    {
+        bool bMatch = true;
+        for (int list = 0; list < 2; list++)
+        {
+            if (interDirNeighbours[mergeCand] & (1 << list))
+            {
+                const TComMvField& mvField = mvFieldNeighbours[mergeCand][list];
+                if (!bStatic[list] || mvField.refIdx != 0 || mvField.mv.word)
+                    bMatch = false;
+            }
+        }
+
+        if (bMatch)
+            break;
+    }
+
+    if (mergeCand == maxNumMergeCand)
+        return false;
+
+    cu->setPredModeSubParts(MODE_INTER, 0, 0);
+    cu->setMergeFlag(0, true);
+    cu->setMergeIndex(0, mergeCand);
+    cu->setInterDirSubParts(interDirNeighbours[mergeCand], 0, 0, 0);
+    cu->getCUMvField(REF_PIC_LIST_0)->setAllMvField(mvFieldNeighbours[mergeCand][0], SIZE_2Nx2N, 0, 0);
+    cu->getCUMvField(REF_PIC_LIST_1)->setAllMvField(mvFieldNeighbours[mergeCand][1], SIZE_2Nx2N, 0, 0);
+
+    m_origYuv[0]->copyFromPicYuv(pic->getPicYuvOrg(), cu->getAddr(), 0);
+    m_search->motionCompensation(cu, m_bestPredYuv[0], REF_PIC_LIST_X, 0, true, true);
+    m_search->encodeResAndCalcRdInterCU(cu, m_origYuv[0], m_bestPredYuv[0], m_tmpResiYuv[0], m_bestResiYuv[0], m_bestRecoYuv[0], true, true);
+    xCheckDQP(cu);
+
+    cu->copyToPic(0);
+    xCopyYuv2Pic(pic, cu->getAddr(), 0, 0);
+    return true;
+}
+
 void TEncCu::xCheckDQP(TComDataCU* cu)
 {
     uint32_t depth = cu->getDepth(0);
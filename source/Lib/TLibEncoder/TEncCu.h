@@ -75,6 +75,25 @@ struct StatisticLog
 namespace x265 {
 // private namespace
 
+/* counters of the fast CU depth decision rules (--fast-decision) */
+struct FastDecisionStats
+{
+    uint64_t cuCount;             // CUs considered by the rules
+    uint64_t skipDepth;           // depths skipped, neighbours and co-located CU all went deeper
+    uint64_t stopSplitNeighbour;  // splits avoided, neighbours and co-located CU did not go deeper
+    uint64_t stopSplitLookahead;  // splits avoided, lookahead costs of the CU are uniform
+
+    FastDecisionStats()  { memset(this, 0, sizeof(*this)); }
+
+    void add(const FastDecisionStats& other)
+    {
+        cuCount += other.cuCount;
+        skipDepth += other.skipDepth;
+        stopSplitNeighbour += other.stopSplitNeighbour;
+        stopSplitLookahead += other.stopSplitLookahead;
+    }
+};
+
 class Encoder;
 class TEncSbac;
 class TEncCavlc;
@@ -126,12 +145,24 @@ private:
     bool         m_bEncodeDQP;
     bool         m_CUTransquantBypassFlagValue;
 
+    // fast decision
+    TComDataCU*  m_fdColocated;   ///< co-located CTU in the nearest reference, or NULL
+
 public:
 
 #if LOG_CU_STATISTICS
     StatisticLog  m_sliceTypeLog[3];
     StatisticLog* m_log;
 #endif
+    FastDecisionStats m_fdStats;
+    uint64_t     m_numStaticCTUs;   ///< CTUs coded by the static region fast path
+
+    /* lookahead 8x8 lowres inter costs of the current picture, one entry per
+     * 16x16 block, or NULL when not available. Set per frame by FrameEncoder */
+    uint16_t*    m_lowresCosts;
+    int          m_lowresWidth;
+    int          m_lowresHeight;
+
     TEncCu();
 
     void init(Encoder* top);
@@ -187,6 +218,14 @@ protected:
                            bool &bTestMergeAMP_Hor, bool &bTestMergeAMP_Ver);
 
     void xFillPCMBuffer(TComDataCU* outCU, TComYuv* origYuv);
+
+    bool xIsStaticCTU(TComDataCU* cu, int list);
+    bool xCompressStaticCU(TComDataCU* cu);
+
+    void xInitFastDecision(TComDataCU* cu);
+    int  xFastEdgeDepths(TComDataCU* cu, uint8_t& minDepth, uint8_t& maxDepth);
+    bool xFastSkipDepth(TComDataCU* cu, uint32_t depth);
+    bool xFastStopSplit(TComDataCU* cu, TComDataCU* bestCU, uint32_t depth);
 };
 }
 //! \}
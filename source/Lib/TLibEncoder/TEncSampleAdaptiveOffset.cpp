@@ -44,6 +44,12 @@ using namespace x265;
 //! \ingroup TLibEncoder
 //! \{
 
+/* fast SAO decision (--sao-fast): share of the best possible gain a merge
+ * candidate must reach to be taken without a search, and the bits of chroma
+ * offsets the chroma gain must be able to pay for to be searched at all */
+#define SAO_FAST_MERGE_RATIO  0.75
+#define SAO_FAST_CHROMA_BITS  8
+
 TEncSampleAdaptiveOffset::TEncSampleAdaptiveOffset()
     : m_entropyCoder(NULL)
     , m_rdSbacCoders(NULL)
@@ -60,6 +66,7 @@ TEncSampleAdaptiveOffset::TEncSampleAdaptiveOffset()
     , m_costPartBest(NULL)
     , m_distOrg(NULL)
     , m_typePartBest(NULL)
+    , m_saoFast(false)
     , lumaLambda(0.)
     , chromaLambda(0.)
     , depth(0)
@@ -538,35 +545,113 @@ inline int xSign(int x)
     return (x >> 31) | ((int)((((uint32_t)-x)) >> 31));
 }
 
+/** Accumulate the SAO statistics of one type over a block of a CTU
+ * \param  typeIdx     SAO_EO_0 to SAO_EO_3 or SAO_BO
+ * \param  x, y        top left of the block in the CTU, width and height may be empty
+ * \param  bSubsample  gather from about half of the lines, scaled to the whole block
+ */
+void TEncSampleAdaptiveOffset::addSaoStats(int typeIdx, pixel* fenc, pixel* rec, int stride, int x, int y, int width, int height, int64_t* stats, int64_t* count, bool bSubsample)
+{
+    if (width <= 0 || height <= 0)
+    {
+        return;
+    }
+
+    int32_t sum[SAO_MAX_BO_CLASSES];
+    int32_t cnt[SAO_MAX_BO_CLASSES];
+    const int numClasses = (typeIdx == SAO_BO) ? SAO_MAX_BO_CLASSES : 5;
+    int sampled = height;
+
+    fenc += y * stride + x;
+    rec += y * stride + x;
+
+    if (!bSubsample || height < 4)
+    {
+        if (typeIdx == SAO_BO)
+            primitives.sao_stats_bo(fenc, rec, stride, width, height, sum, cnt);
+        else
+            primitives.sao_stats_eo[typeIdx](fenc, rec, stride, width, height, sum, cnt);
+    }
+    else if (typeIdx == SAO_BO || typeIdx == SAO_EO_0)
+    {
+        // every other line, these classes do not look at the lines above and below
+        sampled = (height + 1) >> 1;
+        if (typeIdx == SAO_BO)
+            primitives.sao_stats_bo(fenc, rec, 2 * stride, width, sampled, sum, cnt);
+        else
+            primitives.sao_stats_eo[SAO_EO_0](fenc, rec, 2 * stride, width, sampled, sum, cnt);
+    }
+    else
+    {
+        // pairs of lines out of every four, keeping the real vertical neighbours
+        int32_t pairSum[5];
+        int32_t pairCnt[5];
+
+        memset(sum, 0, sizeof(int32_t) * 5);
+        memset(cnt, 0, sizeof(int32_t) * 5);
+        sampled = 0;
+        for (int line = 0; line < height; line += 4)
+        {
+            int lines = X265_MIN(2, height - line);
+            primitives.sao_stats_eo[typeIdx](fenc + line * stride, rec + line * stride, stride, width, lines, pairSum, pairCnt);
+            for (int edgeType = 0; edgeType < 5; edgeType++)
+            {
+                sum[edgeType] += pairSum[edgeType];
+                cnt[edgeType] += pairCnt[edgeType];
+            }
+
+            sampled += lines;
+        }
+    }
+
+    for (int i = 0; i < numClasses; i++)
+    {
+        int classIdx = (typeIdx == SAO_BO) ? i + 1 : m_eoTable[i];
+        if (sampled == height)
+        {
+            stats[classIdx] += sum[i];
+            count[classIdx] += cnt[i];
+        }
+        else
+        {
+            stats[classIdx] += (int64_t)sum[i] * height / sampled;
+            count[classIdx] += (int64_t)cnt[i] * height / sampled;
+        }
+    }
+}
+
+/** Accumulate the SAO statistics of [x0, x1) x [y0, y1) outside of the area
+ *  [0, startX) x [0, startY) of a CTU
+ */
+void TEncSampleAdaptiveOffset::addSaoStatsOutside(int typeIdx, pixel* fenc, pixel* rec, int stride, int x0, int x1, int y0, int y1, int startX, int startY, int64_t* stats, int64_t* count)
+{
+    int rightX = X265_MAX(x0, startX);
+    int belowY = X265_MAX(y0, startY);
+
+    addSaoStats(typeIdx, fenc, rec, stride, rightX, y0, x1 - rightX, X265_MIN(startY, y1) - y0, stats, count);
+    addSaoStats(typeIdx, fenc, rec, stride, x0, belowY, x1 - x0, y1 - belowY, stats, count);
+}
+
 /** Calculate SAO statistics for current LCU without non-crossing slice
  * \param  addr,  partIdx,  yCbCr
  */
 void TEncSampleAdaptiveOffset::calcSaoStatsCu(int addr, int partIdx, int yCbCr)
 {
-    int x, y;
     TComDataCU *pTmpCu = m_pic->getCU(addr);
     TComSPS *pTmpSPS =  m_pic->getSlice()->getSPS();
 
-    pixel* fenc;
-    pixel* pRec;
-    int stride;
     int iLcuHeight = pTmpSPS->getMaxCUSize();
     int iLcuWidth  = pTmpSPS->getMaxCUSize();
     uint32_t lpelx   = pTmpCu->getCUPelX();
     uint32_t tpely   = pTmpCu->getCUPelY();
     uint32_t rpelx;
     uint32_t bpely;
-    int64_t* iStats;
-    int64_t* iCount;
-    int iClassIdx;
     int iPicWidthTmp;
     int iPicHeightTmp;
     int iStartX;
     int iStartY;
     int iEndX;
     int iEndY;
-    pixel* pTableBo = (yCbCr == 0) ? m_lumaTableBo : m_chromaTableBo;
-    int32_t *tmp_swap;
 
     int iIsChroma = (yCbCr != 0) ? 1 : 0;
     int numSkipLine = iIsChroma ? 4 - (2 * m_vChromaShift) : 4;
@@ -595,228 +680,75 @@ void TEncSampleAdaptiveOffset::calcSaoStatsCu(int addr, int partIdx, int yCbCr)
     iLcuWidth     = rpelx - lpelx;
     iLcuHeight    = bpely - tpely;
 
-    stride    =  (yCbCr == 0) ? m_pic->getStride() : m_pic->getCStride();
+    int stride = (yCbCr == 0) ? m_pic->getStride() : m_pic->getCStride();
+    pixel* fenc = getPicYuvAddr(m_pic->getPicYuvOrg(), yCbCr, addr);
+    pixel* pRec = getPicYuvAddr(m_pic->getPicYuvRec(), yCbCr, addr);
 
-//if(iSaoType == BO_0 || iSaoType == BO_1)
+    //if(iSaoType == BO_0 || iSaoType == BO_1)
     {
         if (m_saoLcuBasedOptimization && m_saoLcuBoundary)
         {
             numSkipLine      = iIsChroma ? 3 - (2 * m_vChromaShift) : 3;
             numSkipLineRight = iIsChroma ? 4 - (2 * m_hChromaShift) : 4;
         }
-        iStats = m_offsetOrg[partIdx][SAO_BO];
-        iCount = m_count[partIdx][SAO_BO];
-
-        fenc = getPicYuvAddr(m_pic->getPicYuvOrg(), yCbCr, addr);
-        pRec = getPicYuvAddr(m_pic->getPicYuvRec(), yCbCr, addr);
 
         iEndX   = (rpelx == iPicWidthTmp) ? iLcuWidth : iLcuWidth - numSkipLineRight;
         iEndY   = (bpely == iPicHeightTmp) ? iLcuHeight : iLcuHeight - numSkipLine;
-        for (y = 0; y < iEndY; y++)
-        {
-            for (x = 0; x < iEndX; x++)
-            {
-                iClassIdx = pTableBo[pRec[x]];
-                if (iClassIdx)
-                {
-                    iStats[iClassIdx] += (fenc[x] - pRec[x]);
-                    iCount[iClassIdx]++;
-                }
-            }
-
-            fenc += stride;
-            pRec += stride;
-        }
+        addSaoStats(SAO_BO, fenc, pRec, stride, 0, 0, iEndX, iEndY, m_offsetOrg[partIdx][SAO_BO], m_count[partIdx][SAO_BO], m_saoFast);
     }
-    int iSignLeft;
-    int iSignRight;
-    int iSignDown;
-    int iSignDown1;
-    int iSignDown2;
 
-    uint32_t uiEdgeType;
-
-//if (iSaoType == EO_0  || iSaoType == EO_1 || iSaoType == EO_2 || iSaoType == EO_3)
+    //if (iSaoType == EO_0)
     {
-        //if (iSaoType == EO_0)
+        if (m_saoLcuBasedOptimization && m_saoLcuBoundary)
         {
-            if (m_saoLcuBasedOptimization && m_saoLcuBoundary)
-            {
-                numSkipLine      = iIsChroma ? 3 - (2 * m_vChromaShift) : 3;
-                numSkipLineRight = iIsChroma ? 5 - (2 * m_hChromaShift) : 5;
-            }
-            iStats = m_offsetOrg[partIdx][SAO_EO_0];
-            iCount = m_count[partIdx][SAO_EO_0];
-
-            fenc = getPicYuvAddr(m_pic->getPicYuvOrg(), yCbCr, addr);
-            pRec = getPicYuvAddr(m_pic->getPicYuvRec(), yCbCr, addr);
-
-            iStartX = (lpelx == 0) ? 1 : 0;
-            iEndX   = (rpelx == iPicWidthTmp) ? iLcuWidth - 1 : iLcuWidth - numSkipLineRight;
-            for (y = 0; y < iLcuHeight - numSkipLine; y++)
-            {
-                iSignLeft = xSign(pRec[iStartX] - pRec[iStartX - 1]);
-                for (x = iStartX; x < iEndX; x++)
-                {
-                    iSignRight =  xSign(pRec[x] - pRec[x + 1]);
-                    uiEdgeType =  iSignRight + iSignLeft + 2;
-                    iSignLeft  = -iSignRight;
-
-                    iStats[m_eoTable[uiEdgeType]] += (fenc[x] - pRec[x]);
-                    iCount[m_eoTable[uiEdgeType]]++;
-                }
-
-                fenc += stride;
-                pRec += stride;
-            }
+            numSkipLine      = iIsChroma ? 3 - (2 * m_vChromaShift) : 3;
+            numSkipLineRight = iIsChroma ? 5 - (2 * m_hChromaShift) : 5;
         }
 
-        //if (iSaoType == EO_1)
-        {
-            if (m_saoLcuBasedOptimization && m_saoLcuBoundary)
-            {
-                numSkipLine      = iIsChroma ? 4 - (2 * m_vChromaShift) : 4;
-                numSkipLineRight = iIsChroma ? 4 - (2 * m_hChromaShift) : 4;
-            }
-            iStats = m_offsetOrg[partIdx][SAO_EO_1];
-            iCount = m_count[partIdx][SAO_EO_1];
-
-            fenc = getPicYuvAddr(m_pic->getPicYuvOrg(), yCbCr, addr);
-            pRec = getPicYuvAddr(m_pic->getPicYuvRec(), yCbCr, addr);
-
-            iStartY = (tpely == 0) ? 1 : 0;
-            iEndX   = (rpelx == iPicWidthTmp) ? iLcuWidth : iLcuWidth - numSkipLineRight;
-            iEndY   = (bpely == iPicHeightTmp) ? iLcuHeight - 1 : iLcuHeight - numSkipLine;
-            if (tpely == 0)
-            {
-                fenc += stride;
-                pRec += stride;
-            }
-
-            for (x = 0; x < iLcuWidth; x++)
-            {
-                m_upBuff1[x] = xSign(pRec[x] - pRec[x - stride]);
-            }
-
-            for (y = iStartY; y < iEndY; y++)
-            {
-                for (x = 0; x < iEndX; x++)
-                {
-                    iSignDown     =  xSign(pRec[x] - pRec[x + stride]);
-                    uiEdgeType    =  iSignDown + m_upBuff1[x] + 2;
-                    m_upBuff1[x] = -iSignDown;
-
-                    iStats[m_eoTable[uiEdgeType]] += (fenc[x] - pRec[x]);
-                    iCount[m_eoTable[uiEdgeType]]++;
-                }
+        iStartX = (lpelx == 0) ? 1 : 0;
+        iEndX   = (rpelx == iPicWidthTmp) ? iLcuWidth - 1 : iLcuWidth - numSkipLineRight;
+        addSaoStats(SAO_EO_0, fenc, pRec, stride, iStartX, 0, iEndX - iStartX, iLcuHeight - numSkipLine, m_offsetOrg[partIdx][SAO_EO_0], m_count[partIdx][SAO_EO_0], m_saoFast);
+    }
 
-                fenc += stride;
-                pRec += stride;
-            }
-        }
-        //if (iSaoType == EO_2)
+    //if (iSaoType == EO_1)
+    {
+        if (m_saoLcuBasedOptimization && m_saoLcuBoundary)
         {
-            if (m_saoLcuBasedOptimization && m_saoLcuBoundary)
-            {
-                numSkipLine      = iIsChroma ? 4 - (2 * m_vChromaShift) : 4;
-                numSkipLineRight = iIsChroma ? 5 - (2 * m_hChromaShift) : 5;
-            }
-            iStats = m_offsetOrg[partIdx][SAO_EO_2];
-            iCount = m_count[partIdx][SAO_EO_2];
-
-            fenc = getPicYuvAddr(m_pic->getPicYuvOrg(), yCbCr, addr);
-            pRec = getPicYuvAddr(m_pic->getPicYuvRec(), yCbCr, addr);
-
-            iStartX = (lpelx == 0) ? 1 : 0;
-            iEndX   = (rpelx == iPicWidthTmp) ? iLcuWidth - 1 : iLcuWidth - numSkipLineRight;
-
-            iStartY = (tpely == 0) ? 1 : 0;
-            iEndY   = (bpely == iPicHeightTmp) ? iLcuHeight - 1 : iLcuHeight - numSkipLine;
-            if (tpely == 0)
-            {
-                fenc += stride;
-                pRec += stride;
-            }
-
-            for (x = iStartX; x < iEndX; x++)
-            {
-                m_upBuff1[x] = xSign(pRec[x] - pRec[x - stride - 1]);
-            }
-
-            for (y = iStartY; y < iEndY; y++)
-            {
-                iSignDown2 = xSign(pRec[stride + iStartX] - pRec[iStartX - 1]);
-                for (x = iStartX; x < iEndX; x++)
-                {
-                    iSignDown1      =  xSign(pRec[x] - pRec[x + stride + 1]);
-                    uiEdgeType      =  iSignDown1 + m_upBuff1[x] + 2;
-                    m_upBufft[x + 1] = -iSignDown1;
-                    iStats[m_eoTable[uiEdgeType]] += (fenc[x] - pRec[x]);
-                    iCount[m_eoTable[uiEdgeType]]++;
-                }
-
-                m_upBufft[iStartX] = iSignDown2;
-                tmp_swap  = m_upBuff1;
-                m_upBuff1 = m_upBufft;
-                m_upBufft = tmp_swap;
-
-                pRec += stride;
-                fenc += stride;
-            }
+            numSkipLine      = iIsChroma ? 4 - (2 * m_vChromaShift) : 4;
+            numSkipLineRight = iIsChroma ? 4 - (2 * m_hChromaShift) : 4;
         }
-        //if (iSaoType == EO_3  )
-        {
-            if (m_saoLcuBasedOptimization && m_saoLcuBoundary)
-            {
-                numSkipLine      = iIsChroma ? 4 - (2 * m_vChromaShift) : 4;
-                numSkipLineRight = iIsChroma ? 5 - (2 * m_hChromaShift) : 5;
-            }
-            iStats = m_offsetOrg[partIdx][SAO_EO_3];
-            iCount = m_count[partIdx][SAO_EO_3];
-
-            fenc = getPicYuvAddr(m_pic->getPicYuvOrg(), yCbCr, addr);
-            pRec = getPicYuvAddr(m_pic->getPicYuvRec(), yCbCr, addr);
 
-            iStartX = (lpelx == 0) ? 1 : 0;
-            iEndX   = (rpelx == iPicWidthTmp) ? iLcuWidth - 1 : iLcuWidth - numSkipLineRight;
-
-            iStartY = (tpely == 0) ? 1 : 0;
-            iEndY   = (bpely == iPicHeightTmp) ? iLcuHeight - 1 : iLcuHeight - numSkipLine;
-            if (iStartY == 1)
-            {
-                fenc += stride;
-                pRec += stride;
-            }
-
-            for (x = iStartX - 1; x < iEndX; x++)
-            {
-                m_upBuff1[x] = xSign(pRec[x] - pRec[x - stride + 1]);
-            }
+        iStartY = (tpely == 0) ? 1 : 0;
+        iEndX   = (rpelx == iPicWidthTmp) ? iLcuWidth : iLcuWidth - numSkipLineRight;
+        iEndY   = (bpely == iPicHeightTmp) ? iLcuHeight - 1 : iLcuHeight - numSkipLine;
+        addSaoStats(SAO_EO_1, fenc, pRec, stride, 0, iStartY, iEndX, iEndY - iStartY, m_offsetOrg[partIdx][SAO_EO_1], m_count[partIdx][SAO_EO_1], m_saoFast);
+    }
 
-            for (y = iStartY; y < iEndY; y++)
-            {
-                for (x = iStartX; x < iEndX; x++)
-                {
-                    iSignDown1      =  xSign(pRec[x] - pRec[x + stride - 1]);
-                    uiEdgeType      =  iSignDown1 + m_upBuff1[x] + 2;
-                    m_upBuff1[x - 1] = -iSignDown1;
-                    iStats[m_eoTable[uiEdgeType]] += (fenc[x] - pRec[x]);
-                    iCount[m_eoTable[uiEdgeType]]++;
-                }
+    //if (iSaoType == EO_2 || iSaoType == EO_3)
+    for (int typeIdx = SAO_EO_2; typeIdx <= SAO_EO_3; typeIdx++)
+    {
+        if (m_saoLcuBasedOptimization && m_saoLcuBoundary)
+        {
+            numSkipLine      = iIsChroma ? 4 - (2 * m_vChromaShift) : 4;
+            numSkipLineRight = iIsChroma ? 5 - (2 * m_hChromaShift) : 5;
+        }
 
-                m_upBuff1[iEndX - 1] = xSign(pRec[iEndX - 1 + stride] - pRec[iEndX]);
+        iStartX = (lpelx == 0) ? 1 : 0;
+        iEndX   = (rpelx == iPicWidthTmp) ? iLcuWidth - 1 : iLcuWidth - numSkipLineRight;
 
-                pRec += stride;
-                fenc += stride;
-            }
-        }
+        iStartY = (tpely == 0) ? 1 : 0;
+        iEndY   = (bpely == iPicHeightTmp) ? iLcuHeight - 1 : iLcuHeight - numSkipLine;
+        addSaoStats(typeIdx, fenc, pRec, stride, iStartX, iStartY, iEndX - iStartX, iEndY - iStartY, m_offsetOrg[partIdx][typeIdx], m_count[partIdx][typeIdx], m_saoFast);
     }
 }
 
-void TEncSampleAdaptiveOffset::calcSaoStatsRowCus_BeforeDblk(TComPic* pic, int idxY)
+/** Statistics of the CTU areas that the deblocking of its right and lower
+ *  neighbours will change, taken from the not yet deblocked reconstruction.
+ *  Must run before the vertical edges of this CTU are filtered.
+ */
+void TEncSampleAdaptiveOffset::calcSaoStatsCu_BeforeDblk(TComPic* pic, int idxX, int idxY)
 {
     int addr, yCbCr;
-    int x, y;
     TComSPS *pTmpSPS =  pic->getSlice()->getSPS();
 
     pixel* fenc;
@@ -826,9 +758,6 @@ void TEncSampleAdaptiveOffset::calcSaoStatsRowCus_BeforeDblk(TComPic* pic, int i
     int lcuWidth;
     uint32_t rPelX;
     uint32_t bPelY;
-    int64_t* stats;
-    int64_t* count;
-    int classIdx;
     int picWidthTmp = 0;
     int picHeightTmp = 0;
     int startX;
@@ -837,7 +766,6 @@ void TEncSampleAdaptiveOffset::calcSaoStatsRowCus_BeforeDblk(TComPic* pic, int i
     int endY;
     int firstX, firstY;
 
-    int idxX;
     int frameWidthInCU  = m_numCuInWidth;
 
     int isChroma;
@@ -845,274 +773,116 @@ void TEncSampleAdaptiveOffset::calcSaoStatsRowCus_BeforeDblk(TComPic* pic, int i
 
     uint32_t lPelX, tPelY;
     TComDataCU *pTmpCu;
-    pixel* pTableBo;
-    int32_t *tmp_swap;
-
-    {
-        for (idxX = 0; idxX < frameWidthInCU; idxX++)
-        {
-            lcuHeight = pTmpSPS->getMaxCUSize();
-            lcuWidth  = pTmpSPS->getMaxCUSize();
-            addr     = idxX  + frameWidthInCU * idxY;
-            pTmpCu = pic->getCU(addr);
-            lPelX   = pTmpCu->getCUPelX();
-            tPelY   = pTmpCu->getCUPelY();
-
-            memset(m_countPreDblk[addr], 0, 3 * MAX_NUM_SAO_TYPE * MAX_NUM_SAO_CLASS * sizeof(int64_t));
-            memset(m_offsetOrgPreDblk[addr], 0, 3 * MAX_NUM_SAO_TYPE * MAX_NUM_SAO_CLASS * sizeof(int64_t));
-            for (yCbCr = 0; yCbCr < 3; yCbCr++)
-            {
-                isChroma = (yCbCr != 0) ? 1 : 0;
-
-                if (yCbCr == 0)
-                {
-                    picWidthTmp  = m_picWidth;
-                    picHeightTmp = m_picHeight;
-                }
-                else if (yCbCr == 1)
-                {
-                    picWidthTmp  = m_picWidth  >> isChroma;
-                    picHeightTmp = m_picHeight >> isChroma;
-                    lcuWidth     = lcuWidth    >> isChroma;
-                    lcuHeight    = lcuHeight   >> isChroma;
-                    lPelX       = lPelX      >> isChroma;
-                    tPelY       = tPelY      >> isChroma;
-                }
-                rPelX       = lPelX + lcuWidth;
-                bPelY       = tPelY + lcuHeight;
-                rPelX       = rPelX > picWidthTmp  ? picWidthTmp  : rPelX;
-                bPelY       = bPelY > picHeightTmp ? picHeightTmp : bPelY;
-                lcuWidth     = rPelX - lPelX;
-                lcuHeight    = bPelY - tPelY;
-
-                stride    =  (yCbCr == 0) ? pic->getStride() : pic->getCStride();
-                pTableBo = (yCbCr == 0) ? m_lumaTableBo : m_chromaTableBo;
-
-                //if(iSaoType == BO)
-
-                numSkipLine = isChroma ? 1 : 3;
-                numSkipLineRight = isChroma ? 2 : 4;
-
-                stats = m_offsetOrgPreDblk[addr][yCbCr][SAO_BO];
-                count = m_countPreDblk[addr][yCbCr][SAO_BO];
-
-                fenc = getPicYuvAddr(pic->getPicYuvOrg(), yCbCr, addr);
-                pRec = getPicYuvAddr(pic->getPicYuvRec(), yCbCr, addr);
-
-                startX   = (rPelX == picWidthTmp) ? lcuWidth : lcuWidth - numSkipLineRight;
-                startY   = (bPelY == picHeightTmp) ? lcuHeight : lcuHeight - numSkipLine;
-
-                for (y = 0; y < lcuHeight; y++)
-                {
-                    for (x = 0; x < lcuWidth; x++)
-                    {
-                        if (x < startX && y < startY)
-                            continue;
-
-                        classIdx = pTableBo[pRec[x]];
-                        if (classIdx)
-                        {
-                            stats[classIdx] += (fenc[x] - pRec[x]);
-                            count[classIdx]++;
-                        }
-                    }
-
-                    fenc += stride;
-                    pRec += stride;
-                }
-
-                int signLeft;
-                int signRight;
-                int signDown;
-                int signDown1;
-                int signDown2;
 
-                uint32_t uiEdgeType;
+    lcuHeight = pTmpSPS->getMaxCUSize();
+    lcuWidth  = pTmpSPS->getMaxCUSize();
+    addr     = idxX  + frameWidthInCU * idxY;
+    pTmpCu = pic->getCU(addr);
+    lPelX   = pTmpCu->getCUPelX();
+    tPelY   = pTmpCu->getCUPelY();
 
-                //if (iSaoType == EO_0)
-
-                numSkipLine = isChroma ? 1 : 3;
-                numSkipLineRight = isChroma ? 3 : 5;
-
-                stats = m_offsetOrgPreDblk[addr][yCbCr][SAO_EO_0];
-                count = m_countPreDblk[addr][yCbCr][SAO_EO_0];
-
-                fenc = getPicYuvAddr(pic->getPicYuvOrg(), yCbCr, addr);
-                pRec = getPicYuvAddr(pic->getPicYuvRec(), yCbCr, addr);
-
-                startX   = (rPelX == picWidthTmp) ? lcuWidth - 1 : lcuWidth - numSkipLineRight;
-                startY   = (bPelY == picHeightTmp) ? lcuHeight : lcuHeight - numSkipLine;
-                firstX   = (lPelX == 0) ? 1 : 0;
-                endX   = (rPelX == picWidthTmp) ? lcuWidth - 1 : lcuWidth;
-
-                for (y = 0; y < lcuHeight; y++)
-                {
-                    signLeft = xSign(pRec[firstX] - pRec[firstX - 1]);
-                    for (x = firstX; x < endX; x++)
-                    {
-                        signRight =  xSign(pRec[x] - pRec[x + 1]);
-                        uiEdgeType =  signRight + signLeft + 2;
-                        signLeft  = -signRight;
-
-                        if (x < startX && y < startY)
-                            continue;
-
-                        stats[m_eoTable[uiEdgeType]] += (fenc[x] - pRec[x]);
-                        count[m_eoTable[uiEdgeType]]++;
-                    }
-
-                    fenc += stride;
-                    pRec += stride;
-                }
-
-                //if (iSaoType == EO_1)
-
-                numSkipLine = isChroma ? 2 : 4;
-                numSkipLineRight = isChroma ? 2 : 4;
-
-                stats = m_offsetOrgPreDblk[addr][yCbCr][SAO_EO_1];
-                count = m_countPreDblk[addr][yCbCr][SAO_EO_1];
-
-                fenc = getPicYuvAddr(pic->getPicYuvOrg(), yCbCr, addr);
-                pRec = getPicYuvAddr(pic->getPicYuvRec(), yCbCr, addr);
-
-                startX   = (rPelX == picWidthTmp) ? lcuWidth : lcuWidth - numSkipLineRight;
-                startY   = (bPelY == picHeightTmp) ? lcuHeight - 1 : lcuHeight - numSkipLine;
-                firstY = (tPelY == 0) ? 1 : 0;
-                endY   = (bPelY == picHeightTmp) ? lcuHeight - 1 : lcuHeight;
-                if (firstY == 1)
-                {
-                    fenc += stride;
-                    pRec += stride;
-                }
-
-                for (x = 0; x < lcuWidth; x++)
-                {
-                    m_upBuff1[x] = xSign(pRec[x] - pRec[x - stride]);
-                }
-
-                for (y = firstY; y < endY; y++)
-                {
-                    for (x = 0; x < lcuWidth; x++)
-                    {
-                        signDown     =  xSign(pRec[x] - pRec[x + stride]);
-                        uiEdgeType    =  signDown + m_upBuff1[x] + 2;
-                        m_upBuff1[x] = -signDown;
-
-                        if (x < startX && y < startY)
-                            continue;
-
-                        stats[m_eoTable[uiEdgeType]] += (fenc[x] - pRec[x]);
-                        count[m_eoTable[uiEdgeType]]++;
-                    }
-
-                    fenc += stride;
-                    pRec += stride;
-                }
-
-                //if (iSaoType == EO_2)
-
-                numSkipLine = isChroma ? 2 : 4;
-                numSkipLineRight = isChroma ? 3 : 5;
-
-                stats = m_offsetOrgPreDblk[addr][yCbCr][SAO_EO_2];
-                count = m_countPreDblk[addr][yCbCr][SAO_EO_2];
-
-                fenc = getPicYuvAddr(pic->getPicYuvOrg(), yCbCr, addr);
-                pRec = getPicYuvAddr(pic->getPicYuvRec(), yCbCr, addr);
-
-                startX   = (rPelX == picWidthTmp) ? lcuWidth - 1 : lcuWidth - numSkipLineRight;
-                startY   = (bPelY == picHeightTmp) ? lcuHeight - 1 : lcuHeight - numSkipLine;
-                firstX   = (lPelX == 0) ? 1 : 0;
-                firstY = (tPelY == 0) ? 1 : 0;
-                endX   = (rPelX == picWidthTmp) ? lcuWidth - 1 : lcuWidth;
-                endY   = (bPelY == picHeightTmp) ? lcuHeight - 1 : lcuHeight;
-                if (firstY == 1)
-                {
-                    fenc += stride;
-                    pRec += stride;
-                }
-
-                for (x = firstX; x < endX; x++)
-                {
-                    m_upBuff1[x] = xSign(pRec[x] - pRec[x - stride - 1]);
-                }
-
-                for (y = firstY; y < endY; y++)
-                {
-                    signDown2 = xSign(pRec[stride + startX] - pRec[startX - 1]);
-                    for (x = firstX; x < endX; x++)
-                    {
-                        signDown1      =  xSign(pRec[x] - pRec[x + stride + 1]);
-                        uiEdgeType      =  signDown1 + m_upBuff1[x] + 2;
-                        m_upBufft[x + 1] = -signDown1;
+    memset(m_countPreDblk[addr], 0, 3 * MAX_NUM_SAO_TYPE * MAX_NUM_SAO_CLASS * sizeof(int64_t));
+    memset(m_offsetOrgPreDblk[addr], 0, 3 * MAX_NUM_SAO_TYPE * MAX_NUM_SAO_CLASS * sizeof(int64_t));
+    for (yCbCr = 0; yCbCr < 3; yCbCr++)
+    {
+        isChroma = (yCbCr != 0) ? 1 : 0;
 
-                        if (x < startX && y < startY)
-                            continue;
+        if (yCbCr == 0)
+        {
+            picWidthTmp  = m_picWidth;
+            picHeightTmp = m_picHeight;
+        }
+        else if (yCbCr == 1)
+        {
+            picWidthTmp  = m_picWidth  >> isChroma;
+            picHeightTmp = m_picHeight >> isChroma;
+            lcuWidth     = lcuWidth    >> isChroma;
+            lcuHeight    = lcuHeight   >> isChroma;
+            lPelX       = lPelX      >> isChroma;
+            tPelY       = tPelY      >> isChroma;
+        }
+        rPelX       = lPelX + lcuWidth;
+        bPelY       = tPelY + lcuHeight;
+        rPelX       = rPelX > picWidthTmp  ? picWidthTmp  : rPelX;
+        bPelY       = bPelY > picHeightTmp ? picHeightTmp : bPelY;
+        lcuWidth     = rPelX - lPelX;
+        lcuHeight    = bPelY - tPelY;
 
-                        stats[m_eoTable[uiEdgeType]] += (fenc[x] - pRec[x]);
-                        count[m_eoTable[uiEdgeType]]++;
-                    }
+        stride    =  (yCbCr == 0) ? pic->getStride() : pic->getCStride();
+        fenc = getPicYuvAddr(pic->getPicYuvOrg(), yCbCr, addr);
+        pRec = getPicYuvAddr(pic->getPicYuvRec(), yCbCr, addr);
 
-                    m_upBufft[firstX] = signDown2;
-                    tmp_swap  = m_upBuff1;
-                    m_upBuff1 = m_upBufft;
-                    m_upBufft = tmp_swap;
+        //if(iSaoType == BO)
 
-                    pRec += stride;
-                    fenc += stride;
-                }
+        numSkipLine = isChroma ? 1 : 3;
+        numSkipLineRight = isChroma ? 2 : 4;
 
-                //if (iSaoType == EO_3)
+        startX   = (rPelX == picWidthTmp) ? lcuWidth : lcuWidth - numSkipLineRight;
+        startY   = (bPelY == picHeightTmp) ? lcuHeight : lcuHeight - numSkipLine;
+        addSaoStatsOutside(SAO_BO, fenc, pRec, stride, 0, lcuWidth, 0, lcuHeight, startX, startY,
+                           m_offsetOrgPreDblk[addr][yCbCr][SAO_BO], m_countPreDblk[addr][yCbCr][SAO_BO]);
 
-                numSkipLine = isChroma ? 2 : 4;
-                numSkipLineRight = isChroma ? 3 : 5;
+        //if (iSaoType == EO_0)
 
-                stats = m_offsetOrgPreDblk[addr][yCbCr][SAO_EO_3];
-                count = m_countPreDblk[addr][yCbCr][SAO_EO_3];
+        numSkipLine = isChroma ? 1 : 3;
+        numSkipLineRight = isChroma ? 3 : 5;
 
-                fenc = getPicYuvAddr(pic->getPicYuvOrg(), yCbCr, addr);
-                pRec = getPicYuvAddr(pic->getPicYuvRec(), yCbCr, addr);
+        startX   = (rPelX == picWidthTmp) ? lcuWidth - 1 : lcuWidth - numSkipLineRight;
+        startY   = (bPelY == picHeightTmp) ? lcuHeight : lcuHeight - numSkipLine;
+        firstX   = (lPelX == 0) ? 1 : 0;
+        endX   = (rPelX == picWidthTmp) ? lcuWidth - 1 : lcuWidth;
+        addSaoStatsOutside(SAO_EO_0, fenc, pRec, stride, firstX, endX, 0, lcuHeight, startX, startY,
+                           m_offsetOrgPreDblk[addr][yCbCr][SAO_EO_0], m_countPreDblk[addr][yCbCr][SAO_EO_0]);
 
-                startX   = (rPelX == picWidthTmp) ? lcuWidth - 1 : lcuWidth - numSkipLineRight;
-                startY   = (bPelY == picHeightTmp) ? lcuHeight - 1 : lcuHeight - numSkipLine;
-                firstX   = (lPelX == 0) ? 1 : 0;
-                firstY = (tPelY == 0) ? 1 : 0;
-                endX   = (rPelX == picWidthTmp) ? lcuWidth - 1 : lcuWidth;
-                endY   = (bPelY == picHeightTmp) ? lcuHeight - 1 : lcuHeight;
-                if (firstY == 1)
-                {
-                    fenc += stride;
-                    pRec += stride;
-                }
+        //if (iSaoType == EO_1)
 
-                for (x = firstX - 1; x < endX; x++)
+        numSkipLine = isChroma ? 2 : 4;
+        numSkipLineRight = isChroma ? 2 : 4;
+
+        startX   = (rPelX == picWidthTmp) ? lcuWidth : lcuWidth - numSkipLineRight;
+        startY   = (bPelY == picHeightTmp) ? lcuHeight - 1 : lcuHeight - numSkipLine;
+        firstY = (tPelY == 0) ? 1 : 0;
+        endY   = (bPelY == picHeightTmp) ? lcuHeight - 1 : lcuHeight;
+        addSaoStatsOutside(SAO_EO_1, fenc, pRec, stride, 0, lcuWidth, firstY, endY, startX, startY,
+                           m_offsetOrgPreDblk[addr][yCbCr][SAO_EO_1], m_countPreDblk[addr][yCbCr][SAO_EO_1]);
+
+        //if (iSaoType == EO_2 || iSaoType == EO_3)
+
+        numSkipLine = isChroma ? 2 : 4;
+        numSkipLineRight = isChroma ? 3 : 5;
+
+        startX   = (rPelX == picWidthTmp) ? lcuWidth - 1 : lcuWidth - numSkipLineRight;
+        startY   = (bPelY == picHeightTmp) ? lcuHeight - 1 : lcuHeight - numSkipLine;
+        firstX   = (lPelX == 0) ? 1 : 0;
+        firstY = (tPelY == 0) ? 1 : 0;
+        endX   = (rPelX == picWidthTmp) ? lcuWidth - 1 : lcuWidth;
+        endY   = (bPelY == picHeightTmp) ? lcuHeight - 1 : lcuHeight;
+
+        /* the 135 degree class takes the up-left sign of column firstX
+         * below the first row from column startX, that column stays
+         * scalar to keep the decisions unchanged */
+        int64_t* stats = m_offsetOrgPreDblk[addr][yCbCr][SAO_EO_2];
+        int64_t* count = m_countPreDblk[addr][yCbCr][SAO_EO_2];
+        if (firstX < endX)
+        {
+            for (int y = firstY; y < endY; y++)
+            {
+                if (firstX < startX && y < startY)
                 {
-                    m_upBuff1[x] = xSign(pRec[x] - pRec[x - stride + 1]);
+                    continue;
                 }
 
-                for (y = firstY; y < endY; y++)
-                {
-                    for (x = firstX; x < endX; x++)
-                    {
-                        signDown1      =  xSign(pRec[x] - pRec[x + stride - 1]);
-                        uiEdgeType      =  signDown1 + m_upBuff1[x] + 2;
-                        m_upBuff1[x - 1] = -signDown1;
-
-                        if (x < startX && y < startY)
-                            continue;
-
-                        stats[m_eoTable[uiEdgeType]] += (fenc[x] - pRec[x]);
-                        count[m_eoTable[uiEdgeType]]++;
-                    }
-
-                    m_upBuff1[endX - 1] = xSign(pRec[endX - 1 + stride] - pRec[endX]);
-
-                    pRec += stride;
-                    fenc += stride;
-                }
+                pixel* recY = pRec + y * stride;
+                int signUp = (y == firstY) ? xSign(recY[firstX] - recY[firstX - stride - 1]) : xSign(recY[startX] - recY[startX - stride - 1]);
+                int edgeType = xSign(recY[firstX] - recY[firstX + stride + 1]) + signUp + 2;
+                stats[m_eoTable[edgeType]] += (fenc[y * stride + firstX] - recY[firstX]);
+                count[m_eoTable[edgeType]]++;
             }
         }
+
+        addSaoStatsOutside(SAO_EO_2, fenc, pRec, stride, firstX + 1, endX, firstY, endY, startX, startY, stats, count);
+        addSaoStatsOutside(SAO_EO_3, fenc, pRec, stride, firstX, endX, firstY, endY, startX, startY,
+                           m_offsetOrgPreDblk[addr][yCbCr][SAO_EO_3], m_countPreDblk[addr][yCbCr][SAO_EO_3]);
     }
 }
 
@@ -1402,9 +1172,12 @@ void TEncSampleAdaptiveOffset::rdoSaoUnitRowEnd(SAOParam *saoParam, int numlcus)
     }
 }
 
-void TEncSampleAdaptiveOffset::rdoSaoUnitRow(SAOParam *saoParam, int idxY)
+/** SAO parameter decision of one CTU, in raster order within the row. The
+ *  statistics read the deblocked pixels up to the skipped boundary area, so
+ *  the horizontal edges of the CTU to the right must already be filtered
+ */
+void TEncSampleAdaptiveOffset::rdoSaoUnitCU(SAOParam *saoParam, int idxX, int idxY)
 {
-    int idxX;
     int frameWidthInCU  = saoParam->numCuInWidth;
     int j, k;
     int addr = 0;
@@ -1414,143 +1187,182 @@ void TEncSampleAdaptiveOffset::rdoSaoUnitRow(SAOParam *saoParam, int idxY)
     SaoLcuParam mergeSaoParam[3][2];
     double compDistortion[3];
 
+    addr     = idxX  + frameWidthInCU * idxY;
+    addrUp   = addr < frameWidthInCU ? -1 : idxX   + frameWidthInCU * (idxY - 1);
+    addrLeft = idxX == 0               ? -1 : idxX - 1 + frameWidthInCU * idxY;
+    int allowMergeLeft = 1;
+    int allowMergeUp   = 1;
+    uint32_t rate;
+    double bestCost, mergeCost;
+    if (idxX == 0)
     {
-        for (idxX = 0; idxX < frameWidthInCU; idxX++)
-        {
-            addr     = idxX  + frameWidthInCU * idxY;
-            addrUp   = addr < frameWidthInCU ? -1 : idxX   + frameWidthInCU * (idxY - 1);
-            addrLeft = idxX == 0               ? -1 : idxX - 1 + frameWidthInCU * idxY;
-            int allowMergeLeft = 1;
-            int allowMergeUp   = 1;
-            uint32_t rate;
-            double bestCost, mergeCost;
-            if (idxX == 0)
-            {
-                allowMergeLeft = 0;
-            }
-            if (idxY == 0)
+        allowMergeLeft = 0;
+    }
+    if (idxY == 0)
+    {
+        allowMergeUp = 0;
+    }
+
+    compDistortion[0] = 0;
+    compDistortion[1] = 0;
+    compDistortion[2] = 0;
+    m_rdGoOnSbacCoder->load(m_rdSbacCoders[0][CI_CURR_BEST]);
+    if (allowMergeLeft)
+    {
+        m_entropyCoder->m_entropyCoderIf->codeSaoMerge(0);
+    }
+    if (allowMergeUp)
+    {
+        m_entropyCoder->m_entropyCoderIf->codeSaoMerge(0);
+    }
+    m_rdGoOnSbacCoder->store(m_rdSbacCoders[0][CI_TEMP_BEST]);
+    // reset stats Y, Cb, Cr
+    for (compIdx = 0; compIdx < 3; compIdx++)
+    {
+        for (j = 0; j < MAX_NUM_SAO_TYPE; j++)
+        {
+            for (k = 0; k < MAX_NUM_SAO_CLASS; k++)
             {
-                allowMergeUp = 0;
+                m_offset[compIdx][j][k] = 0;
+                if (m_saoLcuBasedOptimization && m_saoLcuBoundary)
+                {
+                    m_count[compIdx][j][k] = m_countPreDblk[addr][compIdx][j][k];
+                    m_offsetOrg[compIdx][j][k] = m_offsetOrgPreDblk[addr][compIdx][j][k];
+                }
+                else
+                {
+                    m_count[compIdx][j][k] = 0;
+                    m_offsetOrg[compIdx][j][k] = 0;
+                }
             }
+        }
+
+        saoParam->saoLcuParam[compIdx][addr].typeIdx       =  -1;
+        saoParam->saoLcuParam[compIdx][addr].mergeUpFlag   = 0;
+        saoParam->saoLcuParam[compIdx][addr].mergeLeftFlag = 0;
+        saoParam->saoLcuParam[compIdx][addr].subTypeIdx    = 0;
+        if ((compIdx == 0 && saoParam->bSaoFlag[0]) || (compIdx > 0 && saoParam->bSaoFlag[1]))
+        {
+            calcSaoStatsCu(addr, compIdx,  compIdx);
+        }
+    }
+
+    if (m_saoFast && (saoParam->bSaoFlag[0] || saoParam->bSaoFlag[1]))
+    {
+        m_fastStats.ctuCount++;
+
+        int mergeUp = fastMergeDecision(saoParam, allowMergeLeft, allowMergeUp, addrUp, addrLeft);
+        if (mergeUp >= 0)
+        {
+            m_fastStats.mergeReuse++;
 
-            compDistortion[0] = 0;
-            compDistortion[1] = 0;
-            compDistortion[2] = 0;
             m_rdGoOnSbacCoder->load(m_rdSbacCoders[0][CI_CURR_BEST]);
             if (allowMergeLeft)
             {
-                m_entropyCoder->m_entropyCoderIf->codeSaoMerge(0);
+                m_entropyCoder->m_entropyCoderIf->codeSaoMerge(1 - mergeUp);
             }
-            if (allowMergeUp)
+            if (allowMergeUp && (mergeUp == 1))
             {
-                m_entropyCoder->m_entropyCoderIf->codeSaoMerge(0);
+                m_entropyCoder->m_entropyCoderIf->codeSaoMerge(1);
             }
-            m_rdGoOnSbacCoder->store(m_rdSbacCoders[0][CI_TEMP_BEST]);
-            // reset stats Y, Cb, Cr
+            m_rdGoOnSbacCoder->store(m_rdSbacCoders[0][CI_CURR_BEST]);
+
+            int addrMerge = mergeUp ? addrUp : addrLeft;
             for (compIdx = 0; compIdx < 3; compIdx++)
             {
-                for (j = 0; j < MAX_NUM_SAO_TYPE; j++)
-                {
-                    for (k = 0; k < MAX_NUM_SAO_CLASS; k++)
-                    {
-                        m_offset[compIdx][j][k] = 0;
-                        if (m_saoLcuBasedOptimization && m_saoLcuBoundary)
-                        {
-                            m_count[compIdx][j][k] = m_countPreDblk[addr][compIdx][j][k];
-                            m_offsetOrg[compIdx][j][k] = m_offsetOrgPreDblk[addr][compIdx][j][k];
-                        }
-                        else
-                        {
-                            m_count[compIdx][j][k] = 0;
-                            m_offsetOrg[compIdx][j][k] = 0;
-                        }
-                    }
-                }
-
-                saoParam->saoLcuParam[compIdx][addr].typeIdx       =  -1;
-                saoParam->saoLcuParam[compIdx][addr].mergeUpFlag   = 0;
-                saoParam->saoLcuParam[compIdx][addr].mergeLeftFlag = 0;
-                saoParam->saoLcuParam[compIdx][addr].subTypeIdx    = 0;
                 if ((compIdx == 0 && saoParam->bSaoFlag[0]) || (compIdx > 0 && saoParam->bSaoFlag[1]))
                 {
-                    calcSaoStatsCu(addr, compIdx,  compIdx);
+                    SaoLcuParam* saoLcuParam = &saoParam->saoLcuParam[compIdx][addr];
+                    copySaoUnit(saoLcuParam, &saoParam->saoLcuParam[compIdx][addrMerge]);
+                    saoLcuParam->mergeLeftFlag = !mergeUp;
+                    saoLcuParam->mergeUpFlag   = !!mergeUp;
                 }
             }
 
-            saoComponentParamDist(allowMergeLeft, allowMergeUp, saoParam, addr, addrUp, addrLeft, 0,  lumaLambda, &mergeSaoParam[0][0], &compDistortion[0]);
-            sao2ChromaParamDist(allowMergeLeft, allowMergeUp, saoParam, addr, addrUp, addrLeft, chromaLambda, &mergeSaoParam[1][0], &mergeSaoParam[2][0], &compDistortion[0]);
-            if (saoParam->bSaoFlag[0] || saoParam->bSaoFlag[1])
+            if (saoParam->saoLcuParam[0][addr].typeIdx == -1)
+            {
+                numNoSao[0]++;
+            }
+            if (saoParam->saoLcuParam[1][addr].typeIdx == -1)
+            {
+                numNoSao[1] += 2;
+            }
+            return;
+        }
+    }
+
+    saoComponentParamDist(allowMergeLeft, allowMergeUp, saoParam, addr, addrUp, addrLeft, 0,  lumaLambda, &mergeSaoParam[0][0], &compDistortion[0]);
+    sao2ChromaParamDist(allowMergeLeft, allowMergeUp, saoParam, addr, addrUp, addrLeft, chromaLambda, &mergeSaoParam[1][0], &mergeSaoParam[2][0], &compDistortion[0]);
+    if (saoParam->bSaoFlag[0] || saoParam->bSaoFlag[1])
+    {
+        // Cost of new SAO_params
+        m_rdGoOnSbacCoder->load(m_rdSbacCoders[0][CI_CURR_BEST]);
+        m_rdGoOnSbacCoder->resetBits();
+        if (allowMergeLeft)
+        {
+            m_entropyCoder->m_entropyCoderIf->codeSaoMerge(0);
+        }
+        if (allowMergeUp)
+        {
+            m_entropyCoder->m_entropyCoderIf->codeSaoMerge(0);
+        }
+        for (compIdx = 0; compIdx < 3; compIdx++)
+        {
+            if ((compIdx == 0 && saoParam->bSaoFlag[0]) || (compIdx > 0 && saoParam->bSaoFlag[1]))
+            {
+                m_entropyCoder->encodeSaoOffset(&saoParam->saoLcuParam[compIdx][addr], compIdx);
+            }
+        }
+
+        rate = m_entropyCoder->getNumberOfWrittenBits();
+        bestCost = compDistortion[0] + (double)rate;
+        m_rdGoOnSbacCoder->store(m_rdSbacCoders[0][CI_TEMP_BEST]);
+
+        // Cost of Merge
+        for (int mergeUp = 0; mergeUp < 2; ++mergeUp)
+        {
+            if ((allowMergeLeft && (mergeUp == 0)) || (allowMergeUp && (mergeUp == 1)))
             {
-                // Cost of new SAO_params
                 m_rdGoOnSbacCoder->load(m_rdSbacCoders[0][CI_CURR_BEST]);
                 m_rdGoOnSbacCoder->resetBits();
                 if (allowMergeLeft)
                 {
-                    m_entropyCoder->m_entropyCoderIf->codeSaoMerge(0);
-                }
-                if (allowMergeUp)
-                {
-                    m_entropyCoder->m_entropyCoderIf->codeSaoMerge(0);
+                    m_entropyCoder->m_entropyCoderIf->codeSaoMerge(1 - mergeUp);
                 }
-                for (compIdx = 0; compIdx < 3; compIdx++)
+                if (allowMergeUp && (mergeUp == 1))
                 {
-                    if ((compIdx == 0 && saoParam->bSaoFlag[0]) || (compIdx > 0 && saoParam->bSaoFlag[1]))
-                    {
-                        m_entropyCoder->encodeSaoOffset(&saoParam->saoLcuParam[compIdx][addr], compIdx);
-                    }
+                    m_entropyCoder->m_entropyCoderIf->codeSaoMerge(1);
                 }
 
                 rate = m_entropyCoder->getNumberOfWrittenBits();
-                bestCost = compDistortion[0] + (double)rate;
-                m_rdGoOnSbacCoder->store(m_rdSbacCoders[0][CI_TEMP_BEST]);
-
-                // Cost of Merge
-                for (int mergeUp = 0; mergeUp < 2; ++mergeUp)
+                mergeCost = compDistortion[mergeUp + 1] + (double)rate;
+                if (mergeCost < bestCost)
                 {
-                    if ((allowMergeLeft && (mergeUp == 0)) || (allowMergeUp && (mergeUp == 1)))
+                    bestCost = mergeCost;
+                    m_rdGoOnSbacCoder->store(m_rdSbacCoders[0][CI_TEMP_BEST]);
+                    for (compIdx = 0; compIdx < 3; compIdx++)
                     {
-                        m_rdGoOnSbacCoder->load(m_rdSbacCoders[0][CI_CURR_BEST]);
-                        m_rdGoOnSbacCoder->resetBits();
-                        if (allowMergeLeft)
+                        mergeSaoParam[compIdx][mergeUp].mergeLeftFlag = !mergeUp;
+                        mergeSaoParam[compIdx][mergeUp].mergeUpFlag = !!mergeUp;
+                        if ((compIdx == 0 && saoParam->bSaoFlag[0]) || (compIdx > 0 && saoParam->bSaoFlag[1]))
                         {
-                            m_entropyCoder->m_entropyCoderIf->codeSaoMerge(1 - mergeUp);
-                        }
-                        if (allowMergeUp && (mergeUp == 1))
-                        {
-                            m_entropyCoder->m_entropyCoderIf->codeSaoMerge(1);
-                        }
-
-                        rate = m_entropyCoder->getNumberOfWrittenBits();
-                        mergeCost = compDistortion[mergeUp + 1] + (double)rate;
-                        if (mergeCost < bestCost)
-                        {
-                            bestCost = mergeCost;
-                            m_rdGoOnSbacCoder->store(m_rdSbacCoders[0][CI_TEMP_BEST]);
-                            for (compIdx = 0; compIdx < 3; compIdx++)
-                            {
-                                mergeSaoParam[compIdx][mergeUp].mergeLeftFlag = !mergeUp;
-                                mergeSaoParam[compIdx][mergeUp].mergeUpFlag = !!mergeUp;
-                                if ((compIdx == 0 && saoParam->bSaoFlag[0]) || (compIdx > 0 && saoParam->bSaoFlag[1]))
-                                {
-                                    copySaoUnit(&saoParam->saoLcuParam[compIdx][addr], &mergeSaoParam[compIdx][mergeUp]);
-                                }
-                            }
+                            copySaoUnit(&saoParam->saoLcuParam[compIdx][addr], &mergeSaoParam[compIdx][mergeUp]);
                         }
                     }
                 }
-
-                if (saoParam->saoLcuParam[0][addr].typeIdx == -1)
-                {
-                    numNoSao[0]++;
-                }
-                if (saoParam->saoLcuParam[1][addr].typeIdx == -1)
-                {
-                    numNoSao[1] += 2;
-                }
-                m_rdGoOnSbacCoder->load(m_rdSbacCoders[0][CI_TEMP_BEST]);
-                m_rdGoOnSbacCoder->store(m_rdSbacCoders[0][CI_CURR_BEST]);
             }
         }
+
+        if (saoParam->saoLcuParam[0][addr].typeIdx == -1)
+        {
+            numNoSao[0]++;
+        }
+        if (saoParam->saoLcuParam[1][addr].typeIdx == -1)
+        {
+            numNoSao[1] += 2;
+        }
+        m_rdGoOnSbacCoder->load(m_rdSbacCoders[0][CI_TEMP_BEST]);
+        m_rdGoOnSbacCoder->store(m_rdSbacCoders[0][CI_CURR_BEST]);
     }
 }
 
@@ -1562,7 +1374,7 @@ void TEncSampleAdaptiveOffset::rdoSaoUnitRow(SAOParam *saoParam, int idxY)
  * \param yCbCr color component index
  * \param lambda
  */
-inline int64_t TEncSampleAdaptiveOffset::estSaoTypeDist(int compIdx, int typeIdx, int shift, double lambda, int32_t *currentDistortionTableBo, double *currentRdCostTableBo)
+inline int64_t TEncSampleAdaptiveOffset::estSaoTypeDist(int compIdx, int typeIdx, int shift, double lambda, int32_t *currentDistortionTableBo, double *currentRdCostTableBo, int bandStart)
 {
     int64_t estDist = 0;
     int classIdx;
@@ -1575,6 +1387,13 @@ inline int64_t TEncSampleAdaptiveOffset::estSaoTypeDist(int compIdx, int typeIdx
         {
             currentDistortionTableBo[classIdx - 1] = 0;
             currentRdCostTableBo[classIdx - 1] = lambda;
+
+            // bands outside of the window given by the fast decision keep a zero offset
+            if (bandStart >= 0 && (classIdx - 1 < bandStart || classIdx - 1 >= bandStart + SAO_BO_LEN))
+            {
+                m_offset[compIdx][typeIdx][classIdx] = 0;
+                continue;
+            }
         }
         if (m_count[compIdx][typeIdx][classIdx])
         {
@@ -1651,6 +1470,147 @@ inline int64_t TEncSampleAdaptiveOffset::estIterOffset(int typeIdx, int classIdx
     return offsetOutput;
 }
 
+/** Distortion change of a component taking the SAO parameters of a
+ *  neighbouring CTU, from the statistics of the current CTU
+ */
+int64_t TEncSampleAdaptiveOffset::estMergeDist(int compIdx, const SaoLcuParam* neighbour, int shift)
+{
+    int64_t estDist = 0;
+    int typeIdx = neighbour->typeIdx;
+
+    if (typeIdx >= 0)
+    {
+        int mergeBandPosition = (typeIdx == SAO_BO) ? neighbour->subTypeIdx : 0;
+        for (int classIdx = 0; classIdx < m_numClass[typeIdx]; classIdx++)
+        {
+            estDist += estSaoDist(m_count[compIdx][typeIdx][classIdx + mergeBandPosition + 1], neighbour->offset[classIdx], m_offsetOrg[compIdx][typeIdx][classIdx + mergeBandPosition + 1], shift);
+        }
+    }
+
+    return estDist;
+}
+
+/** Upper bound of the distortion reduction a SAO type can give a component,
+ *  each class taking its unquantized best offset (with the edge offset sign
+ *  restrictions). For band offset, the bound of the best window of SAO_BO_LEN
+ *  bands, whose first band is returned in bandStart
+ */
+double TEncSampleAdaptiveOffset::estSaoGainBound(int compIdx, int typeIdx, int shift, int* bandStart)
+{
+    double gain[SAO_MAX_BO_CLASSES];
+    int numClasses = (typeIdx == SAO_BO) ? SAO_MAX_BO_CLASSES : m_numClass[typeIdx];
+
+    for (int classIdx = 0; classIdx < numClasses; classIdx++)
+    {
+        int64_t count = m_count[compIdx][typeIdx][classIdx + 1];
+        int64_t offsetOrg = m_offsetOrg[compIdx][typeIdx][classIdx + 1];
+
+        gain[classIdx] = 0;
+        if (count && (typeIdx == SAO_BO || (classIdx < 2 ? offsetOrg > 0 : offsetOrg < 0)))
+        {
+            gain[classIdx] = (double)offsetOrg * (double)offsetOrg / (double)(count << shift);
+        }
+    }
+
+    double bound = 0;
+    if (typeIdx != SAO_BO)
+    {
+        for (int classIdx = 0; classIdx < numClasses; classIdx++)
+        {
+            bound += gain[classIdx];
+        }
+
+        return bound;
+    }
+
+    *bandStart = 0;
+    for (int i = 0; i < SAO_MAX_BO_CLASSES - SAO_BO_LEN + 1; i++)
+    {
+        double windowGain = 0;
+        for (int j = i; j < i + SAO_BO_LEN; j++)
+        {
+            windowGain += gain[j];
+        }
+
+        if (windowGain > bound)
+        {
+            bound = windowGain;
+            *bandStart = i;
+        }
+    }
+
+    return bound;
+}
+
+/** Best gain bound over the SAO types of numComp components sharing a type */
+double TEncSampleAdaptiveOffset::estBestGainBound(int compIdx, int numComp, int shift)
+{
+    double bestBound = 0;
+    int bandStart;
+
+    for (int typeIdx = 0; typeIdx < MAX_NUM_SAO_TYPE; typeIdx++)
+    {
+        double bound = 0;
+        for (int i = compIdx; i < compIdx + numComp; i++)
+        {
+            bound += estSaoGainBound(i, typeIdx, shift, &bandStart);
+        }
+
+        bestBound = X265_MAX(bestBound, bound);
+    }
+
+    return bestBound;
+}
+
+/** Fast SAO decision: the left (0) or up (1) merge candidate whose gain on
+ *  the current CTU is within SAO_FAST_MERGE_RATIO of the best gain new
+ *  parameters could give, or -1 if new parameters must be searched
+ */
+int TEncSampleAdaptiveOffset::fastMergeDecision(SAOParam *saoParam, int allowMergeLeft, int allowMergeUp, int addrUp, int addrLeft)
+{
+    int shift = 2 * DISTORTION_PRECISION_ADJUSTMENT(X265_DEPTH - 8);
+    double bound = 0;
+
+    if (saoParam->bSaoFlag[0])
+    {
+        bound += estBestGainBound(0, 1, shift) / lumaLambda;
+    }
+    if (saoParam->bSaoFlag[1])
+    {
+        bound += estBestGainBound(1, 2, shift) / chromaLambda;
+    }
+
+    int bestMerge = -1;
+    double bestGain = 0;
+    for (int mergeUp = 0; mergeUp < 2; mergeUp++)
+    {
+        int addrMerge = mergeUp ? addrUp : addrLeft;
+        if (!(mergeUp ? allowMergeUp : allowMergeLeft) || addrMerge < 0)
+        {
+            continue;
+        }
+
+        double gain = 0;
+        if (saoParam->bSaoFlag[0])
+        {
+            gain -= (double)estMergeDist(0, &saoParam->saoLcuParam[0][addrMerge], shift) / lumaLambda;
+        }
+        if (saoParam->bSaoFlag[1])
+        {
+            gain -= (double)estMergeDist(1, &saoParam->saoLcuParam[1][addrMerge], shift) / chromaLambda;
+            gain -= (double)estMergeDist(2, &saoParam->saoLcuParam[2][addrMerge], shift) / chromaLambda;
+        }
+
+        if (gain >= bound * SAO_FAST_MERGE_RATIO && (bestMerge < 0 || gain > bestGain))
+        {
+            bestMerge = mergeUp;
+            bestGain = gain;
+        }
+    }
+
+    return bestMerge;
+}
+
 void TEncSampleAdaptiveOffset::saoComponentParamDist(int allowMergeLeft, int allowMergeUp, SAOParam *saoParam, int addr, int addrUp, int addrLeft, int yCbCr, double lambda, SaoLcuParam *compSaoParam, double *compDistortion)
 {
     int typeIdx;
@@ -1689,14 +1649,26 @@ void TEncSampleAdaptiveOffset::saoComponentParamDist(int allowMergeLeft, int all
 
     for (typeIdx = 0; typeIdx < MAX_NUM_SAO_TYPE; typeIdx++)
     {
-        estDist = estSaoTypeDist(yCbCr, typeIdx, shift, lambda, currentDistortionTableBo, currentRdCostTableBo);
+        int bandStart = -1;
+        if (typeIdx == SAO_BO && m_saoFast)
+        {
+            estSaoGainBound(yCbCr, SAO_BO, shift, &bandStart);
+            m_fastStats.boWindows += saoParam->bSaoFlag[!!yCbCr];
+        }
+
+        estDist = estSaoTypeDist(yCbCr, typeIdx, shift, lambda, currentDistortionTableBo, currentRdCostTableBo, bandStart);
 
         if (typeIdx == SAO_BO)
         {
             // Estimate Best Position
             double currentRDCost = 0.0;
 
-            for (int i = 0; i < SAO_MAX_BO_CLASSES - SAO_BO_LEN + 1; i++)
+            if (bandStart >= 0)
+            {
+                bestClassTableBo = bandStart;
+            }
+
+            for (int i = 0; i < SAO_MAX_BO_CLASSES - SAO_BO_LEN + 1 && bandStart < 0; i++)
             {
                 currentRDCost = 0.0;
                 for (uint32_t uj = i; uj < i + SAO_BO_LEN; uj++)
@@ -1765,22 +1737,7 @@ void TEncSampleAdaptiveOffset::saoComponentParamDist(int allowMergeLeft, int all
         }
         if (saoLcuParamNeighbor != NULL)
         {
-            estDist = 0;
-            typeIdx = saoLcuParamNeighbor->typeIdx;
-            if (typeIdx >= 0)
-            {
-                int mergeBandPosition = (typeIdx == SAO_BO) ? saoLcuParamNeighbor->subTypeIdx : 0;
-                int   merge_iOffset;
-                for (classIdx = 0; classIdx < m_numClass[typeIdx]; classIdx++)
-                {
-                    merge_iOffset = saoLcuParamNeighbor->offset[classIdx];
-                    estDist   += estSaoDist(m_count[yCbCr][typeIdx][classIdx + mergeBandPosition + 1], merge_iOffset, m_offsetOrg[yCbCr][typeIdx][classIdx + mergeBandPosition + 1],  shift);
-                }
-            }
-            else
-            {
-                estDist = 0;
-            }
+            estDist = estMergeDist(yCbCr, saoLcuParamNeighbor, shift);
 
             copySaoUnit(&compSaoParam[idxNeighbor], saoLcuParamNeighbor);
             compSaoParam[idxNeighbor].mergeUpFlag   = !!idxNeighbor;
@@ -1838,7 +1795,15 @@ void TEncSampleAdaptiveOffset::sao2ChromaParamDist(int allowMergeLeft, int allow
     copySaoUnit(saoLcuParam[0], &saoLcuParamRdo[0]);
     copySaoUnit(saoLcuParam[1], &saoLcuParamRdo[1]);
 
-    for (typeIdx = 0; typeIdx < MAX_NUM_SAO_TYPE; typeIdx++)
+    // flat chroma, the best possible gain cannot pay for the offsets
+    int numTypes = MAX_NUM_SAO_TYPE;
+    if (m_saoFast && estBestGainBound(1, 2, shift) < lambda * SAO_FAST_CHROMA_BITS)
+    {
+        numTypes = 0;
+        m_fastStats.chromaSkip += saoParam->bSaoFlag[1];
+    }
+
+    for (typeIdx = 0; typeIdx < numTypes; typeIdx++)
     {
         if (typeIdx == SAO_BO)
         {
@@ -1846,9 +1811,17 @@ void TEncSampleAdaptiveOffset::sao2ChromaParamDist(int allowMergeLeft, int allow
             for (int compIdx = 0; compIdx < 2; compIdx++)
             {
                 double currentRDCost = 0.0;
+                int bandStart = -1;
+                if (m_saoFast)
+                {
+                    estSaoGainBound(compIdx + 1, SAO_BO, shift, &bandStart);
+                    bestClassTableBo[compIdx] = bandStart;
+                    m_fastStats.boWindows += saoParam->bSaoFlag[1];
+                }
+
                 bestRDCostTableBo = MAX_DOUBLE;
-                estDist[compIdx] = estSaoTypeDist(compIdx + 1, typeIdx, shift, lambda, currentDistortionTableBo, currentRdCostTableBo);
-                for (int i = 0; i < SAO_MAX_BO_CLASSES - SAO_BO_LEN + 1; i++)
+                estDist[compIdx] = estSaoTypeDist(compIdx + 1, typeIdx, shift, lambda, currentDistortionTableBo, currentRdCostTableBo, bandStart);
+                for (int i = 0; i < SAO_MAX_BO_CLASSES - SAO_BO_LEN + 1 && bandStart < 0; i++)
                 {
                     currentRDCost = 0.0;
                     for (uint32_t uj = i; uj < i + SAO_BO_LEN; uj++)
@@ -1932,22 +1905,7 @@ void TEncSampleAdaptiveOffset::sao2ChromaParamDist(int allowMergeLeft, int allow
             }
             if (saoLcuParamNeighbor[compIdx] != NULL)
             {
-                estDist[compIdx] = 0;
-                typeIdx = saoLcuParamNeighbor[compIdx]->typeIdx;
-                if (typeIdx >= 0)
-                {
-                    int mergeBandPosition = (typeIdx == SAO_BO) ? saoLcuParamNeighbor[compIdx]->subTypeIdx : 0;
-                    int   merge_iOffset;
-                    for (classIdx = 0; classIdx < m_numClass[typeIdx]; classIdx++)
-                    {
-                        merge_iOffset = saoLcuParamNeighbor[compIdx]->offset[classIdx];
-                        estDist[compIdx]   += estSaoDist(m_count[compIdx + 1][typeIdx][classIdx + mergeBandPosition + 1], merge_iOffset, m_offsetOrg[compIdx + 1][typeIdx][classIdx + mergeBandPosition + 1],  shift);
-                    }
-                }
-                else
-                {
-                    estDist[compIdx] = 0;
-                }
+                estDist[compIdx] = estMergeDist(compIdx + 1, saoLcuParamNeighbor[compIdx], shift);
 
                 copySaoUnit(saoMergeParam[compIdx][idxNeighbor], saoLcuParamNeighbor[compIdx]);
                 saoMergeParam[compIdx][idxNeighbor]->mergeUpFlag   = !!idxNeighbor;
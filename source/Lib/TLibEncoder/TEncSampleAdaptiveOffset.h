@@ -55,6 +55,25 @@
 namespace x265 {
 // private namespace
 
+/* counters of the fast SAO decision shortcuts (--sao-fast) */
+struct SaoFastStats
+{
+    uint64_t ctuCount;      // CTUs decided in fast mode
+    uint64_t mergeReuse;    // CTUs merged without searching new parameters
+    uint64_t chromaSkip;    // CTUs whose chroma search was skipped as flat
+    uint64_t boWindows;     // band offset searches limited to the histogram window
+
+    SaoFastStats()  { memset(this, 0, sizeof(*this)); }
+
+    void add(const SaoFastStats& other)
+    {
+        ctuCount += other.ctuCount;
+        mergeReuse += other.mergeReuse;
+        chromaSkip += other.chromaSkip;
+        boWindows += other.boWindows;
+    }
+};
+
 class TEncSampleAdaptiveOffset : public TComSampleAdaptiveOffset
 {
 private:
@@ -78,6 +97,7 @@ private:
     int     m_offsetThY;
     int     m_offsetThC;
     double  m_depthSaoRate[2][4];
+    bool    m_saoFast;
 
 public:
 
@@ -86,6 +106,8 @@ public:
     int     depth;
     int     numNoSao[2];
 
+    SaoFastStats m_fastStats;
+
     TEncSampleAdaptiveOffset();
     virtual ~TEncSampleAdaptiveOffset();
 
@@ -100,7 +122,9 @@ public:
     void disablePartTree(SAOQTPart *psQTPart, int partIdx);
     void getSaoStats(SAOQTPart *psQTPart, int yCbCr);
     void calcSaoStatsCu(int addr, int partIdx, int yCbCr);
-    void calcSaoStatsRowCus_BeforeDblk(TComPic* pic, int idxY);
+    void addSaoStats(int typeIdx, pixel* fenc, pixel* rec, int stride, int x, int y, int width, int height, int64_t* stats, int64_t* count, bool bSubsample = false);
+    void addSaoStatsOutside(int typeIdx, pixel* fenc, pixel* rec, int stride, int x0, int x1, int y0, int y1, int startX, int startY, int64_t* stats, int64_t* count);
+    void calcSaoStatsCu_BeforeDblk(TComPic* pic, int idxX, int idxY);
     void destroyEncBuffer();
     void createEncBuffer();
     void assignSaoUnitSyntax(SaoLcuParam* saoLcuParam,  SAOQTPart* saoPart, bool &oneUnitFlag);
@@ -109,14 +133,19 @@ public:
     void sao2ChromaParamDist(int allowMergeLeft, int allowMergeUp, SAOParam *saoParam, int addr, int addrUp, int addrLeft, double lambda, SaoLcuParam *crSaoParam, SaoLcuParam *cbSaoParam, double *distortion);
     inline int64_t estSaoDist(int64_t count, int64_t offset, int64_t offsetOrg, int shift);
     inline int64_t estIterOffset(int typeIdx, int classIdx, double lambda, int64_t offsetInput, int64_t count, int64_t offsetOrg, int shift, int bitIncrease, int32_t *currentDistortionTableBo, double *currentRdCostTableBo, int offsetTh);
-    inline int64_t estSaoTypeDist(int compIdx, int typeIdx, int shift, double lambda, int32_t *currentDistortionTableBo, double *currentRdCostTableBo);
+    inline int64_t estSaoTypeDist(int compIdx, int typeIdx, int shift, double lambda, int32_t *currentDistortionTableBo, double *currentRdCostTableBo, int bandStart = -1);
+    int64_t estMergeDist(int compIdx, const SaoLcuParam* neighbour, int shift);
+    double  estSaoGainBound(int compIdx, int typeIdx, int shift, int* bandStart);
+    double  estBestGainBound(int compIdx, int numComp, int shift);
+    int     fastMergeDecision(SAOParam *saoParam, int allowMergeLeft, int allowMergeUp, int addrUp, int addrLeft);
+    void setSaoFast(bool bFast) { m_saoFast = bFast; }
     void setMaxNumOffsetsPerPic(int val) { m_maxNumOffsetsPerPic = val; }
 
     int  getMaxNumOffsetsPerPic() { return m_maxNumOffsetsPerPic; }
 
     void rdoSaoUnitRowInit(SAOParam *saoParam);
     void rdoSaoUnitRowEnd(SAOParam *saoParam, int numlcus);
-    void rdoSaoUnitRow(SAOParam *saoParam, int idxY);
+    void rdoSaoUnitCU(SAOParam *saoParam, int idxX, int idxY);
 };
 }
 //! \}
@@ -37,6 +37,7 @@
 
 #include "TEncSbac.h"
 #include "primitives.h"
+#include "threading.h"
 
 namespace x265 {
 //! \ingroup TLibEncoder
@@ -120,7 +121,6 @@ static void initBuffer(ContextModel* contextModel, SliceType sliceType, int qp,
     for (int n = 0; n < size; n++)
     {
         contextModel[n].m_state = sbacInit(qp, ctxModel[n]);
-        contextModel[n].bBinsCoded = 0;
     }
 }
 
@@ -151,7 +151,7 @@ static uint32_t calcCost(ContextModel *contextModel, SliceType sliceType, int qp
             prob0 = 1.0 - prob1;
         }
 
-        if (contextModel[n].bBinsCoded > 0)
+        if (sbacBinsCoded(contextModel[n].m_state))
         {
             cost += (uint32_t)(prob0 * sbacGetEntropyBits(tmpContextModel.m_state, 0) + prob1 * sbacGetEntropyBits(tmpContextModel.m_state, 1));
         }
@@ -164,12 +164,19 @@ static uint32_t calcCost(ContextModel *contextModel, SliceType sliceType, int qp
 // Constructor / destructor / create / destroy
 // ====================================================================================================================
 
+namespace {
+/* each coder tags its contexts from its own range of values */
+int32_t g_sbacCoderCount;
+}
+
 TEncSbac::TEncSbac()
 // new structure here
     : m_slice(NULL)
     , m_binIf(NULL)
 {
     memset(m_contextModels, 0, sizeof(m_contextModels));
+    m_lastTag = (uint64_t)ATOMIC_INC(&g_sbacCoderCount) << 40;
+    markContexts();
 }
 
 TEncSbac::~TEncSbac()
@@ -181,6 +188,8 @@ TEncSbac::~TEncSbac()
 
 void TEncSbac::resetEntropy()
 {
+    markContexts();
+
     int  qp              = m_slice->getSliceQp();
     SliceType sliceType  = m_slice->getSliceType();
 
@@ -1404,8 +1413,19 @@ void TEncSbac::xWriteCoefRemainExGolomb(uint32_t codeNumber, const uint32_t absG
         }
         codeNumber = (codeNumber << absGoRice) + codeRemain;
 
-        m_binIf->encodeBinsEP((1 << (COEF_REMAIN_BIN_REDUCTION + length + 1)) - 2, COEF_REMAIN_BIN_REDUCTION + length + 1);
-        m_binIf->encodeBinsEP(codeNumber, length + absGoRice);
+        uint32_t prefixLength = COEF_REMAIN_BIN_REDUCTION + length + 1;
+        uint32_t prefix = (1 << prefixLength) - 2;
+        uint32_t suffixLength = length + absGoRice;
+
+        /* prefix and suffix are emitted as one batch of bypass bins when
+         * they fit the 32 bits of binValues */
+        if (prefixLength + suffixLength <= 32)
+            m_binIf->encodeBinsEP((uint32_t)(((uint64_t)prefix << suffixLength) + codeNumber), prefixLength + suffixLength);
+        else
+        {
+            m_binIf->encodeBinsEP(prefix, prefixLength);
+            m_binIf->encodeBinsEP(codeNumber, suffixLength);
+        }
     }
 }
 
@@ -1428,6 +1448,7 @@ void  TEncSbac::loadIntraDirModeLuma(TEncSbac* src)
     m_binIf->copyState(src->m_binIf);
 
     ::memcpy(&this->m_contextModels[OFF_ADI_CTX], &src->m_contextModels[OFF_ADI_CTX], sizeof(ContextModel) * NUM_ADI_CTX);
+    markContexts();
 }
 
 void  TEncSbac::store(TEncSbac* pDest)
@@ -1439,16 +1460,18 @@ void TEncSbac::xCopyFrom(TEncSbac* src)
 {
     m_binIf->copyState(src->m_binIf);
 
-    memcpy(m_contextModels, src->m_contextModels, MAX_OFF_CTX_MOD * sizeof(ContextModel));
+    xCopyContextsFrom(src);
 }
 
 void TEncSbac::codeMVPIdx(uint32_t symbol)
 {
+    markContexts();
     m_binIf->encodeBin(symbol, m_contextModels[OFF_MVP_IDX_CTX]);
 }
 
 void TEncSbac::codePartSize(TComDataCU* cu, uint32_t absPartIdx, uint32_t depth)
 {
+    markContexts();
     PartSize partSize = cu->getPartitionSize(absPartIdx);
 
     if (cu->isIntra(absPartIdx))
@@ -1522,6 +1545,7 @@ void TEncSbac::codePartSize(TComDataCU* cu, uint32_t absPartIdx, uint32_t depth)
  */
 void TEncSbac::codePredMode(TComDataCU* cu, uint32_t absPartIdx)
 {
+    markContexts();
     // get context function is here
     int predMode = cu->getPredictionMode(absPartIdx);
 
@@ -1530,6 +1554,7 @@ void TEncSbac::codePredMode(TComDataCU* cu, uint32_t absPartIdx)
 
 void TEncSbac::codeCUTransquantBypassFlag(TComDataCU* cu, uint32_t absPartIdx)
 {
+    markContexts();
     uint32_t symbol = cu->getCUTransquantBypass(absPartIdx);
 
     m_binIf->encodeBin(symbol, m_contextModels[OFF_CU_TRANSQUANT_BYPASS_FLAG_CTX]);
@@ -1542,6 +1567,7 @@ void TEncSbac::codeCUTransquantBypassFlag(TComDataCU* cu, uint32_t absPartIdx)
  */
 void TEncSbac::codeSkipFlag(TComDataCU* cu, uint32_t absPartIdx)
 {
+    markContexts();
     // get context function is here
     uint32_t symbol = cu->isSkipped(absPartIdx) ? 1 : 0;
     uint32_t ctxSkip = cu->getCtxSkipFlag(absPartIdx);
@@ -1563,6 +1589,7 @@ void TEncSbac::codeSkipFlag(TComDataCU* cu, uint32_t absPartIdx)
  */
 void TEncSbac::codeMergeFlag(TComDataCU* cu, uint32_t absPartIdx)
 {
+    markContexts();
     const uint32_t symbol = cu->getMergeFlag(absPartIdx) ? 1 : 0;
 
     m_binIf->encodeBin(symbol, m_contextModels[OFF_MERGE_FLAG_EXT_CTX]);
@@ -1584,6 +1611,7 @@ void TEncSbac::codeMergeFlag(TComDataCU* cu, uint32_t absPartIdx)
  */
 void TEncSbac::codeMergeIndex(TComDataCU* cu, uint32_t absPartIdx)
 {
+    markContexts();
     uint32_t numCand = cu->getSlice()->getMaxNumMergeCand();
 
     if (numCand > 1)
@@ -1609,6 +1637,7 @@ void TEncSbac::codeMergeIndex(TComDataCU* cu, uint32_t absPartIdx)
 
 void TEncSbac::codeSplitFlag(TComDataCU* cu, uint32_t absPartIdx, uint32_t depth)
 {
+    markContexts();
     if (depth == g_maxCUDepth - g_addCUDepth)
         return;
 
@@ -1623,6 +1652,7 @@ void TEncSbac::codeSplitFlag(TComDataCU* cu, uint32_t absPartIdx, uint32_t depth
 
 void TEncSbac::codeTransformSubdivFlag(uint32_t symbol, uint32_t ctx)
 {
+    markContexts();
     m_binIf->encodeBin(symbol, m_contextModels[OFF_TRANS_SUBDIV_FLAG_CTX + ctx]);
     DTRACE_CABAC_VL(g_nSymbolCounter++)
     DTRACE_CABAC_T("\tparseTransformSubdivFlag()")
@@ -1635,6 +1665,7 @@ void TEncSbac::codeTransformSubdivFlag(uint32_t symbol, uint32_t ctx)
 
 void TEncSbac::codeIntraDirLumaAng(TComDataCU* cu, uint32_t absPartIdx, bool isMultiple)
 {
+    markContexts();
     uint32_t dir[4], j;
     uint32_t preds[4][3];
     int predIdx[4];
@@ -1695,6 +1726,7 @@ void TEncSbac::codeIntraDirLumaAng(TComDataCU* cu, uint32_t absPartIdx, bool isM
 
 void TEncSbac::codeIntraDirChroma(TComDataCU* cu, uint32_t absPartIdx)
 {
+    markContexts();
     uint32_t intraDirChroma = cu->getChromaIntraDir(absPartIdx);
 
     if (intraDirChroma == DM_CHROMA_IDX)
@@ -1723,6 +1755,7 @@ void TEncSbac::codeIntraDirChroma(TComDataCU* cu, uint32_t absPartIdx)
 
 void TEncSbac::codeInterDir(TComDataCU* cu, uint32_t absPartIdx)
 {
+    markContexts();
     const uint32_t interDir = cu->getInterDir(absPartIdx) - 1;
     const uint32_t ctx      = cu->getCtxInterDir(absPartIdx);
 
@@ -1738,6 +1771,7 @@ void TEncSbac::codeInterDir(TComDataCU* cu, uint32_t absPartIdx)
 
 void TEncSbac::codeRefFrmIdx(TComDataCU* cu, uint32_t absPartIdx, int list)
 {
+    markContexts();
     int refFrame = cu->getCUMvField(list)->getRefIdx(absPartIdx);
 
     m_binIf->encodeBin(refFrame > 0, m_contextModels[OFF_REF_NO_CTX]);
@@ -1762,6 +1796,7 @@ void TEncSbac::codeRefFrmIdx(TComDataCU* cu, uint32_t absPartIdx, int list)
 
 void TEncSbac::codeMvd(TComDataCU* cu, uint32_t absPartIdx, int list)
 {
+    markContexts();
     if (list == REF_PIC_LIST_1 && cu->getSlice()->getMvdL1ZeroFlag() && cu->getInterDir(absPartIdx) == 3)
     {
         return;
@@ -1812,6 +1847,7 @@ void TEncSbac::codeMvd(TComDataCU* cu, uint32_t absPartIdx, int list)
 
 void TEncSbac::codeDeltaQP(TComDataCU* cu, uint32_t absPartIdx)
 {
+    markContexts();
     int dqp = cu->getQP(absPartIdx) - cu->getRefQP(absPartIdx);
 
     int qpBdOffsetY = QP_BD_OFFSET;
@@ -1835,6 +1871,7 @@ void TEncSbac::codeDeltaQP(TComDataCU* cu, uint32_t absPartIdx)
 
 void TEncSbac::codeQtCbf(TComDataCU* cu, uint32_t absPartIdx, TextType ttype, uint32_t trDepth, uint32_t absPartIdxStep, uint32_t width, uint32_t height, bool lowestLevel)
 {
+    markContexts();
     uint32_t ctx = cu->getCtxQtCbf(ttype, trDepth);
 
     bool canQuadSplit       = (width >= (MIN_TU_SIZE * 2)) && (height >= (MIN_TU_SIZE * 2));
@@ -1888,6 +1925,7 @@ void TEncSbac::codeQtCbf(TComDataCU* cu, uint32_t absPartIdx, TextType ttype, ui
 
 void TEncSbac::codeTransformSkipFlags(TComDataCU* cu, uint32_t absPartIdx, uint32_t trSize, TextType ttype)
 {
+    markContexts();
     if (cu->getCUTransquantBypass(absPartIdx))
     {
         return;
@@ -1990,6 +2028,7 @@ void TEncSbac::codeIPCMInfo(TComDataCU* cu, uint32_t absPartIdx)
 
 void TEncSbac::codeQtRootCbf(TComDataCU* cu, uint32_t absPartIdx)
 {
+    markContexts();
     uint32_t cbf = cu->getQtRootCbf(absPartIdx);
     uint32_t ctx = 0;
 
@@ -2007,6 +2046,7 @@ void TEncSbac::codeQtRootCbf(TComDataCU* cu, uint32_t absPartIdx)
 
 void TEncSbac::codeQtCbfZero(TComDataCU* cu, TextType ttype, uint32_t trDepth)
 {
+    markContexts();
     // this function is only used to estimate the bits when cbf is 0
     // and will never be called when writing the bistream. do not need to write log
     uint32_t cbf = 0;
@@ -2017,6 +2057,7 @@ void TEncSbac::codeQtCbfZero(TComDataCU* cu, TextType ttype, uint32_t trDepth)
 
 void TEncSbac::codeQtRootCbfZero(TComDataCU*)
 {
+    markContexts();
     // this function is only used to estimate the bits when cbf is 0
     // and will never be called when writing the bistream. do not need to write log
     uint32_t cbf = 0;
@@ -2036,6 +2077,7 @@ void TEncSbac::codeQtRootCbfZero(TComDataCU*)
  */
 void TEncSbac::codeLastSignificantXY(uint32_t posx, uint32_t posy, uint32_t log2TrSize, TextType ttype, uint32_t scanIdx)
 {
+    markContexts();
     X265_CHECK((ttype == TEXT_LUMA) || (ttype == TEXT_CHROMA), "invalid texture type\n");
     // swap
     if (scanIdx == SCAN_VER)
@@ -2090,6 +2132,7 @@ void TEncSbac::codeLastSignificantXY(uint32_t posx, uint32_t posy, uint32_t log2
 
 void TEncSbac::codeCoeffNxN(TComDataCU* cu, coeff_t* coeff, uint32_t absPartIdx, uint32_t trSize, TextType ttype)
 {
+    markContexts();
 #if ENC_DEC_TRACE
     DTRACE_CABAC_VL(g_nSymbolCounter++)
     DTRACE_CABAC_T("\tparseCoeffNxN()\teType=")
@@ -2147,28 +2190,20 @@ void TEncSbac::codeCoeffNxN(TComDataCU* cu, coeff_t* coeff, uint32_t absPartIdx,
 
     //----- encode significance map -----
 
-    // Find position of last coefficient
-    int scanPosLast = -1;
-    int posLast;
+    // Find position of last coefficient and the significance of each coefficient group
+    uint16_t coeffFlag[MLS_GRP_NUM];
+    uint16_t coeffSign[MLS_GRP_NUM];
+    uint8_t coeffNum[MLS_GRP_NUM];
+    const int scanPosLast = primitives.scan_poslast(coeff, codingParameters.scan, log2TrSize, coeffFlag, coeffSign, coeffNum, numSig);
+    const int posLast = codingParameters.scan[scanPosLast];
+    const int lastScanSet = scanPosLast >> MLS_CG_SIZE;
+
     uint64_t sigCoeffGroupFlag64 = 0;
-    const uint32_t maskPosXY = (1 << (log2TrSize - MLS_CG_LOG2_SIZE)) - 1;
-    do
+    for (int subSet = 0; subSet <= lastScanSet; subSet++)
     {
-        posLast = codingParameters.scan[++scanPosLast];
-        if (coeff[posLast] != 0)
-        {
-            // get L1 sig map
-            // NOTE: the new algorithm is complicated, so I keep reference code here
-            //uint32_t posy   = posLast >> log2TrSize;
-            //uint32_t posx   = posLast - (posy << log2TrSize);
-            //uint32_t blkIdx0 = ((posy >> MLS_CG_LOG2_SIZE) << codingParameters.log2TrSizeCG) + (posx >> MLS_CG_LOG2_SIZE);
-            uint32_t blkIdx = ((posLast >> (2 * MLS_CG_LOG2_SIZE)) & ~maskPosXY) + ((posLast >> MLS_CG_LOG2_SIZE) & maskPosXY);
-            sigCoeffGroupFlag64 |= ((uint64_t)1 << blkIdx);
-
-            numSig--;
-        }
+        if (coeffFlag[subSet])
+            sigCoeffGroupFlag64 |= ((uint64_t)1 << codingParameters.scanCG[subSet]);
     }
-    while (numSig > 0);
 
     // Code position of last coefficient
     int posLastY = posLast >> log2TrSize;
@@ -2177,29 +2212,15 @@ void TEncSbac::codeCoeffNxN(TComDataCU* cu, coeff_t* coeff, uint32_t absPartIdx,
     //===== code significance flag =====
     ContextModel * const baseCoeffGroupCtx = &m_contextModels[OFF_SIG_CG_FLAG_CTX + (ttype ? NUM_SIG_CG_FLAG_CTX : 0)];
     ContextModel * const baseCtx = (ttype == TEXT_LUMA) ? &m_contextModels[OFF_SIG_FLAG_CTX] : &m_contextModels[OFF_SIG_FLAG_CTX + NUM_SIG_FLAG_CTX_LUMA];
-    const int lastScanSet = scanPosLast >> MLS_CG_SIZE;
     uint32_t c1 = 1;
     uint32_t goRiceParam  = 0;
-    int  scanPosSig       = scanPosLast;
 
     for (int subSet = lastScanSet; subSet >= 0; subSet--)
     {
-        int numNonZero = 0;
-        int subPos     = subSet << MLS_CG_SIZE;
+        const int subPos = subSet << MLS_CG_SIZE;
+        const uint32_t sigFlags = coeffFlag[subSet];
         goRiceParam    = 0;
-        int absCoeff[1 << MLS_CG_SIZE];
-        uint32_t coeffSigns = 0;
-        int lastNZPosInCG = -1;
-        int firstNZPosInCG = 1 << MLS_CG_SIZE;
-        if (scanPosSig == scanPosLast)
-        {
-            absCoeff[0] = int(abs(coeff[posLast]));
-            coeffSigns    = (coeff[posLast] < 0);
-            numNonZero    = 1;
-            lastNZPosInCG  = scanPosSig;
-            firstNZPosInCG = scanPosSig;
-            scanPosSig--;
-        }
+
         // encode significant_coeffgroup_flag
         const int cgBlkPos = codingParameters.scanCG[subSet];
         const int cgPosY   = cgBlkPos >> codingParameters.log2TrSizeCG;
@@ -2216,41 +2237,49 @@ void TEncSbac::codeCoeffNxN(TComDataCU* cu, coeff_t* coeff, uint32_t absPartIdx,
             uint32_t ctxSig = TComTrQuant::getSigCoeffGroupCtxInc(sigCoeffGroupFlag64, cgPosX, cgPosY, codingParameters.log2TrSizeCG);
             m_binIf->encodeBin(sigCoeffGroup, baseCoeffGroupCtx[ctxSig]);
         }
-        // encode significant_coeff_flag
+        // encode significant_coeff_flag, the last coefficient is implied by its position
         if (sigCoeffGroupFlag64 & cgBlkPosMask)
         {
             const int patternSigCtx = TComTrQuant::calcPatternSigCtx(sigCoeffGroupFlag64, cgPosX, cgPosY, codingParameters.log2TrSizeCG);
-            uint32_t blkPos, sig, ctxSig;
-            for (; scanPosSig >= subPos; scanPosSig--)
+            const int lastPosInCG = (subSet == lastScanSet) ? (scanPosLast & 15) - 1 : 15;
+            for (int pos = lastPosInCG; pos >= 0; pos--)
             {
-                blkPos  = codingParameters.scan[scanPosSig];
-                sig     = (coeff[blkPos] != 0);
-                if (scanPosSig > subPos || subSet == 0 || numNonZero)
+                uint32_t sig = (sigFlags >> pos) & 1;
+
+                // the flag of the first position is implied when no other in the group was set
+                if (pos || subSet == 0 || (sigFlags >> 1))
                 {
-                    ctxSig  = TComTrQuant::getSigCtxInc(patternSigCtx, log2TrSize, trSize, blkPos, ttype, codingParameters.firstSignificanceMapContext);
+                    uint32_t blkPos = codingParameters.scan[subPos + pos];
+                    uint32_t ctxSig = TComTrQuant::getSigCtxInc(patternSigCtx, log2TrSize, trSize, blkPos, ttype, codingParameters.firstSignificanceMapContext);
                     m_binIf->encodeBin(sig, baseCtx[ctxSig]);
                 }
-                if (sig)
-                {
-                    absCoeff[numNonZero] = int(abs(coeff[blkPos]));
-                    coeffSigns = 2 * coeffSigns + ((uint32_t)coeff[blkPos] >> 31);
-                    numNonZero++;
-                    if (lastNZPosInCG < 0)
-                    {
-                        lastNZPosInCG = scanPosSig;
-                    }
-                    firstNZPosInCG = scanPosSig;
-                }
             }
         }
-        else
+
+        // gather the levels and signs of the significant coefficients, from the last to the first
+        const int numNonZero = coeffNum[subSet];
+        int absCoeff[1 << MLS_CG_SIZE];
+        uint32_t coeffSigns = 0;
+        unsigned long lastNZPosInCG = 0, firstNZPosInCG = 0;
+        if (numNonZero > 0)
         {
-            scanPosSig = subPos - 1;
+            CLZ32(lastNZPosInCG, sigFlags);
+            CTZ64(firstNZPosInCG, (uint64_t)sigFlags);
+
+            uint32_t flags = sigFlags;
+            for (int idx = 0; idx < numNonZero; idx++)
+            {
+                unsigned long pos;
+                CLZ32(pos, flags);
+                flags ^= 1 << pos;
+                absCoeff[idx] = int(abs(coeff[codingParameters.scan[subPos + pos]]));
+                coeffSigns = 2 * coeffSigns + ((coeffSign[subSet] >> pos) & 1);
+            }
         }
 
         if (numNonZero > 0)
         {
-            bool signHidden = (lastNZPosInCG - firstNZPosInCG >= SBH_THRESHOLD);
+            bool signHidden = (int)(lastNZPosInCG - firstNZPosInCG) >= SBH_THRESHOLD;
             uint32_t ctxSet = (subSet > 0 && ttype == TEXT_LUMA) ? 2 : 0;
 
             if (c1 == 0)
@@ -2358,6 +2387,7 @@ void TEncSbac::codeSaoUflc(uint32_t length, uint32_t code)
  */
 void TEncSbac::codeSaoMerge(uint32_t code)
 {
+    markContexts();
     X265_CHECK((code == 0) || (code == 1), "SAO code out of range\n");
     m_binIf->encodeBin(code, m_contextModels[OFF_SAO_MERGE_FLAG_CTX]);
 }
@@ -2367,6 +2397,7 @@ void TEncSbac::codeSaoMerge(uint32_t code)
  */
 void TEncSbac::codeSaoTypeIdx(uint32_t code)
 {
+    markContexts();
     m_binIf->encodeBin((code == 0) ? 0 : 1, m_contextModels[OFF_SAO_TYPE_IDX_CTX]);
     if (code != 0)
     {
@@ -2570,7 +2601,11 @@ void TEncSbac::estSignificantCoefficientsBit(estBitsSbacStruct* estBitsSbac, Tex
  */
 void TEncSbac::xCopyContextsFrom(TEncSbac* src)
 {
-    memcpy(m_contextModels, src->m_contextModels, MAX_OFF_CTX_MOD * sizeof(m_contextModels[0]));
+    if (m_ctxTag != src->m_ctxTag)
+    {
+        memcpy(m_contextModels, src->m_contextModels, MAX_OFF_CTX_MOD * sizeof(m_contextModels[0]));
+        m_ctxTag = src->m_ctxTag;
+    }
 }
 
 void  TEncSbac::loadContexts(TEncSbac* src)
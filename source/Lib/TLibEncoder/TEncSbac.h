@@ -59,8 +59,14 @@ class TEncSbac : public SyntaxElementWriter, public TEncEntropyIf
 {
 public:
 
+    /* RDO snapshots carry a tag naming the contents of the context models; a
+     * copy moves the tag with the contexts, and coding any syntax element gives
+     * the coder a fresh tag. Coders holding the same tag thus hold identical
+     * contexts, and load() or store() between them copy nothing */
     uint64_t pad;
     ContextModel m_contextModels[MAX_OFF_CTX_MOD];
+    uint64_t     m_ctxTag;
+    uint64_t     m_lastTag;
 
     TComSlice*    m_slice;
     TEncBinCABAC* m_binIf;
@@ -87,6 +93,8 @@ public:
     void store(TEncSbac* dest);
     void loadContexts(TEncSbac* src);
 
+    void markContexts()               { m_ctxTag = ++m_lastTag; }
+
     void codeVPS(TComVPS* vps);
     void codeSPS(TComSPS* sps);
     void codePPS(TComPPS* pps);
@@ -72,6 +72,7 @@ TEncSearch::TEncSearch()
     m_entropyCoder = NULL;
     m_rdSbacCoders    = NULL;
     m_rdGoOnSbacCoder = NULL;
+    m_meMap = NULL;
 }
 
 TEncSearch::~TEncSearch()
@@ -1535,6 +1536,109 @@ void TEncSearch::residualQTIntrachroma(TComDataCU* cu,
     }
 }
 
+/** rough intra mode analysis of one luma PU
+ * \param fenc source block of the PU
+ * \param preds most probable modes of the PU
+ * \param modeDist sa8d distortion of each of the 35 modes
+ * \param modeBits mode signalling bits of each mode
+ * \param modeCosts SAD based RD cost of each mode
+ *
+ * The reference samples must have been prepared by initAdiPattern (ALL_IDX)
+ * into m_refAbove, m_refLeft and their filtered versions. DC and planar are
+ * predicted on their own, the 33 angular modes in one intra_pred_allangs pass,
+ * and all 35 predictions are scored back to back, horizontal modes against
+ * the transposed source. 64x64 PUs are analysed at 32x32 with scaled costs
+ */
+void TEncSearch::estIntraModeCosts(TComDataCU* cu, uint32_t partOffset, uint32_t depth, pixel* fenc, uint32_t stride, uint32_t tuSize,
+                                   uint32_t preds[3], uint32_t* modeDist, uint32_t* modeBits, uint64_t* modeCosts)
+{
+    pixel *above         = m_refAbove    + tuSize - 1;
+    pixel *aboveFiltered = m_refAboveFlt + tuSize - 1;
+    pixel *left          = m_refLeft     + tuSize - 1;
+    pixel *leftFiltered  = m_refLeftFlt  + tuSize - 1;
+
+    // 33 Angle modes once
+    ALIGN_VAR_32(pixel, buf_trans[32 * 32]);
+    ALIGN_VAR_32(pixel, tmp[33 * 32 * 32]);
+    ALIGN_VAR_32(pixel, bufScale[32 * 32]);
+    pixel _above[4 * 32 + 1];
+    pixel _left[4 * 32 + 1];
+    int scaleTuSize = tuSize;
+    int scaleStride = stride;
+    int costShift = 0;
+
+    if (tuSize > 32)
+    {
+        pixel *aboveScale  = _above + 2 * 32;
+        pixel *leftScale   = _left + 2 * 32;
+
+        // origin is 64x64, we scale to 32x32 and setup required parameters
+        primitives.scale2D_64to32(bufScale, fenc, stride);
+        fenc = bufScale;
+
+        // reserve space in case primitives need to store data in above
+        // or left buffers
+        aboveScale[0] = leftScale[0] = above[0];
+        primitives.scale1D_128to64(aboveScale + 1, above + 1, 0);
+        primitives.scale1D_128to64(leftScale + 1, left + 1, 0);
+
+        scaleTuSize = 32;
+        scaleStride = 32;
+        costShift = 2;
+
+        // Filtered and Unfiltered refAbove and refLeft pointing to above and left.
+        above         = aboveScale;
+        left          = leftScale;
+        aboveFiltered = aboveScale;
+        leftFiltered  = leftScale;
+    }
+
+    int sizeIdx = g_convertToBit[scaleTuSize];
+    pixelcmp_t sa8d = primitives.sa8d[sizeIdx];
+
+    // DC
+    primitives.intra_pred[sizeIdx][DC_IDX](tmp, scaleStride, left, above, 0, (scaleTuSize <= 16));
+    modeDist[DC_IDX] = sa8d(fenc, scaleStride, tmp, scaleStride) << costShift;
+
+    pixel *abovePlanar   = above;
+    pixel *leftPlanar    = left;
+
+    if (tuSize >= 8 && tuSize <= 32)
+    {
+        abovePlanar = aboveFiltered;
+        leftPlanar  = leftFiltered;
+    }
+
+    // PLANAR
+    primitives.intra_pred[sizeIdx][PLANAR_IDX](tmp, scaleStride, leftPlanar, abovePlanar, 0, 0);
+    modeDist[PLANAR_IDX] = sa8d(fenc, scaleStride, tmp, scaleStride) << costShift;
+
+    // Transpose NxN
+    primitives.transpose[sizeIdx](buf_trans, fenc, scaleStride);
+
+    primitives.intra_pred_allangs[sizeIdx](tmp, above, left, aboveFiltered, leftFiltered, (scaleTuSize <= 16));
+
+    const int predSize = scaleTuSize * scaleTuSize;
+    for (uint32_t mode = 2; mode < 18; mode++)
+    {
+        modeDist[mode] = sa8d(buf_trans, scaleTuSize, &tmp[(mode - 2) * predSize], scaleTuSize) << costShift;
+    }
+
+    for (uint32_t mode = 18; mode < 35; mode++)
+    {
+        modeDist[mode] = sa8d(fenc, scaleStride, &tmp[(mode - 2) * predSize], scaleTuSize) << costShift;
+    }
+
+    uint64_t mpms;
+    uint32_t rbits = xModeBitsRemIntra(cu, partOffset, depth, preds, mpms);
+
+    for (uint32_t mode = 0; mode < 35; mode++)
+    {
+        modeBits[mode] = !(mpms & ((uint64_t)1 << mode)) ? rbits : xModeBitsIntra(cu, mode, partOffset, depth);
+        modeCosts[mode] = m_rdCost->calcRdSADCost(modeDist[mode], modeBits[mode]);
+    }
+}
+
 void TEncSearch::estIntraPredQT(TComDataCU* cu, TComYuv* fencYuv, TComYuv* predYuv, ShortYuv* resiYuv, TComYuv* reconYuv)
 {
     uint32_t depth        = cu->getDepth(0);
@@ -1575,95 +1679,18 @@ void TEncSearch::estIntraPredQT(TComDataCU* cu, TComYuv* fencYuv, TComYuv* predY
             }
 
             candNum = 0;
-            uint32_t modeCosts[35];
-
-            pixel *above         = m_refAbove    + tuSize - 1;
-            pixel *aboveFiltered = m_refAboveFlt + tuSize - 1;
-            pixel *left          = m_refLeft     + tuSize - 1;
-            pixel *leftFiltered  = m_refLeftFlt  + tuSize - 1;
-
-            // 33 Angle modes once
-            ALIGN_VAR_32(pixel, buf_trans[32 * 32]);
-            ALIGN_VAR_32(pixel, tmp[33 * 32 * 32]);
-            ALIGN_VAR_32(pixel, bufScale[32 * 32]);
-            pixel _above[4 * 32 + 1];
-            pixel _left[4 * 32 + 1];
-            int scaleTuSize = tuSize;
-            int scaleStride = stride;
-            int costShift = 0;
-
-            if (tuSize > 32)
-            {
-                pixel *aboveScale  = _above + 2 * 32;
-                pixel *leftScale   = _left + 2 * 32;
-
-                // origin is 64x64, we scale to 32x32 and setup required parameters
-                primitives.scale2D_64to32(bufScale, fenc, stride);
-                fenc = bufScale;
-
-                // reserve space in case primitives need to store data in above
-                // or left buffers
-                aboveScale[0] = leftScale[0] = above[0];
-                primitives.scale1D_128to64(aboveScale + 1, above + 1, 0);
-                primitives.scale1D_128to64(leftScale + 1, left + 1, 0);
-
-                scaleTuSize = 32;
-                scaleStride = 32;
-                costShift = 2;
-                sizeIdx = 5 - 2; // g_convertToBit[scaleTuSize];
-
-                // Filtered and Unfiltered refAbove and refLeft pointing to above and left.
-                above         = aboveScale;
-                left          = leftScale;
-                aboveFiltered = aboveScale;
-                leftFiltered  = leftScale;
-            }
-
-            pixelcmp_t sa8d = primitives.sa8d[sizeIdx];
-
-            // DC
-            primitives.intra_pred[sizeIdx][DC_IDX](tmp, scaleStride, left, above, 0, (scaleTuSize <= 16));
-            modeCosts[DC_IDX] = sa8d(fenc, scaleStride, tmp, scaleStride) << costShift;
-
-            pixel *abovePlanar   = above;
-            pixel *leftPlanar    = left;
-
-            if (tuSize >= 8 && tuSize <= 32)
-            {
-                abovePlanar = aboveFiltered;
-                leftPlanar  = leftFiltered;
-            }
-
-            // PLANAR
-            primitives.intra_pred[sizeIdx][PLANAR_IDX](tmp, scaleStride, leftPlanar, abovePlanar, 0, 0);
-            modeCosts[PLANAR_IDX] = sa8d(fenc, scaleStride, tmp, scaleStride) << costShift;
-
-            // Transpose NxN
-            primitives.transpose[sizeIdx](buf_trans, fenc, scaleStride);
-
-            primitives.intra_pred_allangs[sizeIdx](tmp, above, left, aboveFiltered, leftFiltered, (scaleTuSize <= 16));
-
-            for (uint32_t mode = 2; mode < numModesAvailable; mode++)
-            {
-                bool modeHor = (mode < 18);
-                pixel *cmp = (modeHor ? buf_trans : fenc);
-                intptr_t srcStride = (modeHor ? scaleTuSize : scaleStride);
-                modeCosts[mode] = sa8d(cmp, srcStride, &tmp[(mode - 2) * (scaleTuSize * scaleTuSize)], scaleTuSize) << costShift;
-            }
 
             uint32_t preds[3];
             int numCand = cu->getIntraDirLumaPredictor(partOffset, preds);
 
-            uint64_t mpms;
-            uint32_t rbits = xModeBitsRemIntra(cu, partOffset, depth, preds, mpms);
+            uint32_t modeDist[35], modeBits[35];
+            uint64_t modeCosts[35];
+            estIntraModeCosts(cu, partOffset, depth, fenc, stride, tuSize, preds, modeDist, modeBits, modeCosts);
 
             // Find N least cost modes. N = numModesForFullRD
             for (uint32_t mode = 0; mode < numModesAvailable; mode++)
             {
-                uint32_t sad = modeCosts[mode];
-                uint32_t bits = !(mpms & ((uint64_t)1 << mode)) ? rbits : xModeBitsIntra(cu, mode, partOffset, depth);
-                uint64_t cost = m_rdCost->calcRdSADCost(sad, bits);
-                candNum += xUpdateCandList(mode, cost, numModesForFullRD, rdModeList, candCostList);
+                candNum += xUpdateCandList(mode, modeCosts[mode], numModesForFullRD, rdModeList, candCostList);
             }
 
             for (int j = 0; j < numCand; j++)
@@ -2249,6 +2276,10 @@ bool TEncSearch::predInterSearch(TComDataCU* cu, TComYuv* predYuv, bool bMergeOn
 
     memset(&merge, 0, sizeof(merge));
 
+    /* attribute this CU's motion searches to its depth */
+    if (m_cfg->m_param->bEnableMEStats)
+        m_me.setStats(&m_meStats[cu->getDepth(0)]);
+
     for (int partIdx = 0; partIdx < numPart; partIdx++)
     {
         uint32_t partAddr;
@@ -2339,6 +2370,14 @@ bool TEncSearch::predInterSearch(TComDataCU* cu, TComYuv* predYuv, bool bMergeOn
                 xSetSearchRange(cu, mvp, merange, mvmin, mvmax);
                 int satdCost = m_me.motionEstimate(m_mref[l][ref], mvmin, mvmax, mvp, numMvc, mvc, merange, outmv);
 
+                if (m_meMap)
+                {
+                    MotionMapEntry& entry = m_meMap[cu->getAddr()];
+                    entry.searches++;
+                    entry.mvLength += abs(outmv.x) + abs(outmv.y);
+                    entry.cost += satdCost;
+                }
+
                 /* Get total cost of partition, but only include MV bit cost once */
                 bits += m_me.bitcost(outmv);
                 uint32_t cost = (satdCost - m_me.mvcost(outmv)) + m_rdCost->getCost(bits);
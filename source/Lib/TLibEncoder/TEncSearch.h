@@ -108,6 +108,11 @@ public:
     MotionEstimate   m_me;
     MotionReference* m_mref[2][MAX_NUM_REF + 1];
 
+    /* motion search statistics, indexed by CU depth, and the optional per-CTU
+     * motion map of the current frame (NULL unless --me-map is in use) */
+    MotionEstimateStats m_meStats[MAX_CU_DEPTH];
+    MotionMapEntry*  m_meMap;
+
     TEncSbac***     m_rdSbacCoders;
     TEncSbac*       m_rdGoOnSbacCoder;
 
@@ -153,6 +158,8 @@ public:
     uint32_t xModeBitsRemIntra(TComDataCU * cu, uint32_t partOffset, uint32_t depth, uint32_t preds[3], uint64_t & mpms);
     uint32_t xUpdateCandList(uint32_t mode, uint64_t cost, uint32_t fastCandNum, uint32_t* CandModeList, uint64_t* CandCostList);
 
+    void estIntraModeCosts(TComDataCU* cu, uint32_t partOffset, uint32_t depth, pixel* fenc, uint32_t stride, uint32_t tuSize,
+                           uint32_t preds[3], uint32_t* modeDist, uint32_t* modeBits, uint64_t* modeCosts);
     void estIntraPredQT(TComDataCU* cu, TComYuv* fencYuv, TComYuv* predYuv, ShortYuv* resiYuv, TComYuv* reconYuv);
 
     void getBestIntraModeChroma(TComDataCU* cu, TComYuv* fencYuv, TComYuv* predYuv);
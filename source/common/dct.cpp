@@ -718,6 +718,50 @@ void idct32_c(int32_t *src, int16_t *dst, intptr_t stride)
     }
 }
 
+/* inverse transform of a block whose non-zero coefficients all lie within
+ * its top-left KxK corner. Only the K non-zero columns go through the first
+ * pass and the second pass sums K terms per output. The integer sums are
+ * exact, so the result matches the full butterflies bit for bit */
+template<int N, int K>
+void idct_corner_c(int32_t *src, int16_t *dst, intptr_t stride)
+{
+    const int shift_1st = 7;
+    const int shift_2nd = 12 - (X265_DEPTH - 8);
+    const int add_1st = 1 << (shift_1st - 1);
+    const int add_2nd = 1 << (shift_2nd - 1);
+    const int16_t *t = N == 8 ? &g_t8[0][0] : N == 16 ? &g_t16[0][0] : &g_t32[0][0];
+
+    int16_t coef[K][N];
+
+    for (int j = 0; j < K; j++)
+    {
+        for (int n = 0; n < N; n++)
+        {
+            int sum = 0;
+            for (int k = 0; k < K; k++)
+            {
+                sum += t[k * N + n] * (int16_t)src[k * N + j];
+            }
+
+            coef[j][n] = (int16_t)Clip3(-32768, 32767, (sum + add_1st) >> shift_1st);
+        }
+    }
+
+    for (int n = 0; n < N; n++)
+    {
+        for (int m = 0; m < N; m++)
+        {
+            int sum = 0;
+            for (int j = 0; j < K; j++)
+            {
+                sum += t[j * N + m] * coef[j][n];
+            }
+
+            dst[n * stride + m] = (int16_t)Clip3(-32768, 32767, (sum + add_2nd) >> shift_2nd);
+        }
+    }
+}
+
 void dequant_normal_c(const int32_t* quantCoef, int32_t* coef, int num, int scale, int shift)
 {
 #if !HIGH_BIT_DEPTH
@@ -798,6 +842,27 @@ uint32_t quant_c(int32_t* coef, int32_t* quantCoeff, int32_t* deltaU, int32_t* q
     return acSum;
 }
 
+/* RDOQ setup: the scaled level, the rounded quantized level and the distortion
+ * of coding it as zero of each coefficient. Returns the number of coefficients
+ * whose rounded level is non-zero */
+uint32_t rdoq_levels_c(const int32_t *coef, const int32_t *quantCoeff, const double *errScale, int32_t *levelDouble, int32_t *absLevel, double *costUncoded, int qBits, int numCoeff)
+{
+    const int add = 1 << (qBits - 1);
+    uint32_t numSig = 0;
+
+    for (int blockpos = 0; blockpos < numCoeff; blockpos++)
+    {
+        int level = (int)X265_MIN((int64_t)abs(coef[blockpos]) * quantCoeff[blockpos], (int64_t)(MAX_INT - add));
+
+        levelDouble[blockpos] = level;
+        absLevel[blockpos] = (level + add) >> qBits;
+        costUncoded[blockpos] = ((uint64_t)level * level) * errScale[blockpos];
+        numSig += absLevel[blockpos] != 0;
+    }
+
+    return numSig;
+}
+
 int  count_nonzero_c(const int32_t *quantCoeff, int numCoeff)
 {
     X265_CHECK(((intptr_t)quantCoeff & 15) == 0, "quant buffer not aligned\n");
@@ -812,6 +877,44 @@ int  count_nonzero_c(const int32_t *quantCoeff, int numCoeff)
 
     return count;
 }
+
+/* walk the coefficients in scan order up to the last of the numSig non-zero
+ * ones, recording for each 4x4 coefficient group a mask of its significant
+ * coefficients and of their signs (bit n for scan position n of the group) and
+ * their count. Returns the scan position of the last non-zero coefficient */
+int scan_poslast_c(const int32_t *coeff, const uint16_t *scan, int, uint16_t *coeffFlag, uint16_t *coeffSign, uint8_t *coeffNum, int numSig)
+{
+    X265_CHECK(numSig > 0, "no significant coefficients\n");
+
+    int scanPos = -1;
+
+    do
+    {
+        scanPos++;
+
+        int cg = scanPos >> 4;
+        if (!(scanPos & 15))
+        {
+            coeffFlag[cg] = 0;
+            coeffSign[cg] = 0;
+            coeffNum[cg] = 0;
+        }
+
+        int32_t level = coeff[scan[scanPos]];
+        if (level)
+        {
+            uint16_t bit = (uint16_t)(1 << (scanPos & 15));
+            coeffFlag[cg] |= bit;
+            if (level < 0)
+                coeffSign[cg] |= bit;
+            coeffNum[cg]++;
+            numSig--;
+        }
+    }
+    while (numSig > 0);
+
+    return scanPos;
+}
 }  // closing - anonymous file-static namespace
 
 namespace x265 {
@@ -832,6 +935,13 @@ void Setup_C_DCTPrimitives(EncoderPrimitives& p)
     p.idct[IDCT_8x8] = idct8_c;
     p.idct[IDCT_16x16] = idct16_c;
     p.idct[IDCT_32x32] = idct32_c;
+    p.idct_corner4[IDCT_8x8] = idct_corner_c<8, 4>;
+    p.idct_corner4[IDCT_16x16] = idct_corner_c<16, 4>;
+    p.idct_corner4[IDCT_32x32] = idct_corner_c<32, 4>;
+    p.idct_corner8[IDCT_16x16] = idct_corner_c<16, 8>;
+    p.idct_corner8[IDCT_32x32] = idct_corner_c<32, 8>;
     p.count_nonzero = count_nonzero_c;
+    p.scan_poslast = scan_poslast_c;
+    p.rdoq_levels = rdoq_levels_c;
 }
 }
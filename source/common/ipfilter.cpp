@@ -359,6 +359,39 @@ void filterVertical_sp_c(int16_t *src, intptr_t srcStride, pixel *dst, intptr_t
     }
 }
 
+template<int dirs, int width, int height>
+void interp_subpel_cmp_c(pixel *fenc, pixel *fref, intptr_t frefStride, int qmvx, int qmvy, int step, pixelcmp_t cmp, int32_t *res)
+{
+    ALIGN_VAR_32(pixel, subpelbuf[64 * 64]);
+    ALIGN_VAR_32(int16_t, immed[64 * (64 + 8)]);
+
+    for (int i = 0; i < dirs; i++)
+    {
+        int mx = qmvx + g_subpelNeighbours[i][0] * step;
+        int my = qmvy + g_subpelNeighbours[i][1] * step;
+        int xFrac = mx & 3;
+        int yFrac = my & 3;
+        pixel *src = fref + (mx >> 2) + (my >> 2) * frefStride;
+
+        if (!(xFrac | yFrac))
+        {
+            res[i] = cmp(fenc, FENC_STRIDE, src, frefStride);
+            continue;
+        }
+
+        if (!yFrac)
+            interp_horiz_pp_c<8, width, height>(src, frefStride, subpelbuf, FENC_STRIDE, xFrac);
+        else if (!xFrac)
+            interp_vert_pp_c<8, width, height>(src, frefStride, subpelbuf, FENC_STRIDE, yFrac);
+        else
+        {
+            interp_horiz_ps_c<8, width, height>(src, frefStride, immed, width, xFrac, 1);
+            filterVertical_sp_c<8>(immed + 3 * width, width, subpelbuf, FENC_STRIDE, width, height, yFrac);
+        }
+        res[i] = cmp(fenc, FENC_STRIDE, subpelbuf, FENC_STRIDE);
+    }
+}
+
 template<int N, int width, int height>
 void interp_hv_pp_c(pixel *src, intptr_t srcStride, pixel *dst, intptr_t dstStride, int idxX, int idxY)
 {
@@ -372,6 +405,11 @@ void interp_hv_pp_c(pixel *src, intptr_t srcStride, pixel *dst, intptr_t dstStri
 namespace x265 {
 // x265 private namespace
 
+extern const int8_t g_subpelNeighbours[8][2] =
+{
+    { 0, -1 }, { 0, 1 }, { -1, 0 }, { 1, 0 }, { -1, -1 }, { -1, 1 }, { 1, -1 }, { 1, 1 }
+};
+
 #define CHROMA_420(W, H) \
     p.chroma[X265_CSP_I420].filter_hpp[CHROMA_ ## W ## x ## H] = interp_horiz_pp_c<4, W, H>; \
     p.chroma[X265_CSP_I420].filter_hps[CHROMA_ ## W ## x ## H] = interp_horiz_ps_c<4, W, H>; \
@@ -403,7 +441,9 @@ namespace x265 {
     p.luma_vps[LUMA_ ## W ## x ## H]     = interp_vert_ps_c<8, W, H>;  \
     p.luma_vsp[LUMA_ ## W ## x ## H]     = interp_vert_sp_c<8, W, H>;  \
     p.luma_vss[LUMA_ ## W ## x ## H]     = interp_vert_ss_c<8, W, H>;  \
-    p.luma_hvpp[LUMA_ ## W ## x ## H]    = interp_hv_pp_c<8, W, H>;
+    p.luma_hvpp[LUMA_ ## W ## x ## H]    = interp_hv_pp_c<8, W, H>; \
+    p.luma_subpel_x4[LUMA_ ## W ## x ## H] = interp_subpel_cmp_c<4, W, H>; \
+    p.luma_subpel_x8[LUMA_ ## W ## x ## H] = interp_subpel_cmp_c<8, W, H>;
 
 void Setup_C_IPFilterPrimitives(EncoderPrimitives& p)
 {
@@ -22,6 +22,7 @@
 *****************************************************************************/
 
 #include "TLibCommon/TypeDef.h"
+#include "common.h"
 #include "primitives.h"
 
 #define PIXEL_MIN 0
@@ -44,9 +45,277 @@ void processSaoCUE0(pixel * rec, int8_t * offsetEo, int lcuWidth, int8_t signLef
     }
 }
 
+namespace {
+inline int signOf(int x)
+{
+    return (x >> 31) | ((int)((((uint32_t)-x)) >> 31));
+}
+
+/* SAO 90 degree edge offset of one row. upBuff1 holds the signs against the
+ * row above, and is updated with the signs of the row below against this row */
+void processSaoCUE1(pixel* rec, int8_t* upBuff1, int8_t* offsetEo, intptr_t stride, int width)
+{
+    for (int x = 0; x < width; x++)
+    {
+        int signDown = signOf(rec[x] - rec[x + stride]);
+        int edgeType = signDown + upBuff1[x] + 2;
+        upBuff1[x] = (int8_t)-signDown;
+        rec[x] = (pixel)Clip3(PIXEL_MIN, PIXEL_MAX, rec[x] + offsetEo[edgeType]);
+    }
+}
+
+/* SAO 135 degree edge offset of one row. buff1 holds the signs against the up
+ * left neighbours, the signs of the row below are written to bufft shifted by
+ * one; its first entry is left to the caller */
+void processSaoCUE2(pixel* rec, int8_t* bufft, int8_t* buff1, int8_t* offsetEo, int width, intptr_t stride)
+{
+    for (int x = 0; x < width; x++)
+    {
+        int signDown = signOf(rec[x] - rec[x + stride + 1]);
+        int edgeType = signDown + buff1[x] + 2;
+        bufft[x + 1] = (int8_t)-signDown;
+        rec[x] = (pixel)Clip3(PIXEL_MIN, PIXEL_MAX, rec[x] + offsetEo[edgeType]);
+    }
+}
+
+/* SAO 45 degree edge offset of [startX, endX) of one row. upBuff1 holds the
+ * signs against the up right neighbours and is updated in place, shifted by
+ * one, for the row below; its last entry is left to the caller */
+void processSaoCUE3(pixel* rec, int8_t* upBuff1, int8_t* offsetEo, intptr_t stride, int startX, int endX)
+{
+    for (int x = startX; x < endX; x++)
+    {
+        int signDown = signOf(rec[x] - rec[x + stride - 1]);
+        int edgeType = signDown + upBuff1[x] + 2;
+        upBuff1[x - 1] = (int8_t)-signDown;
+        rec[x] = (pixel)Clip3(PIXEL_MIN, PIXEL_MAX, rec[x] + offsetEo[edgeType]);
+    }
+}
+
+/* SAO band offset of a block, offsetBo holds the offset of each of the 32
+ * bands */
+void processSaoCUB0(pixel* rec, const int8_t* offsetBo, int width, int height, intptr_t stride)
+{
+    const int shift = X265_DEPTH - 5;
+
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            rec[x] = (pixel)Clip3(PIXEL_MIN, PIXEL_MAX, rec[x] + offsetBo[rec[x] >> shift]);
+        }
+
+        rec += stride;
+    }
+}
+
+/* Edge offset statistics of a width x height block: difference between
+ * source and reconstruction, and number of samples, for each of the five
+ * edge types (sign of the two neighbour differences plus 2). The neighbours
+ * of direction 0 to 3 are horizontal, vertical, 135 and 45 degrees, and must
+ * be readable around the block */
+template<int dir>
+void saoStatsEO_c(const pixel* fenc, const pixel* rec, intptr_t stride, int width, int height, int32_t* sum, int32_t* count)
+{
+    const intptr_t offset = dir == 0 ? 1 : dir == 1 ? stride : dir == 2 ? stride + 1 : stride - 1;
+
+    for (int i = 0; i < 5; i++)
+    {
+        sum[i] = count[i] = 0;
+    }
+
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            int edgeType = signOf(rec[x] - rec[x - offset]) + signOf(rec[x] - rec[x + offset]) + 2;
+            sum[edgeType] += fenc[x] - rec[x];
+            count[edgeType]++;
+        }
+
+        fenc += stride;
+        rec += stride;
+    }
+}
+
+/* Band offset statistics of a block, for each of the 32 bands of the
+ * reconstructed sample values */
+void saoStatsBO_c(const pixel* fenc, const pixel* rec, intptr_t stride, int width, int height, int32_t* sum, int32_t* count)
+{
+    const int shift = X265_DEPTH - 5;
+
+    for (int i = 0; i < 32; i++)
+    {
+        sum[i] = count[i] = 0;
+    }
+
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            int band = rec[x] >> shift;
+            sum[band] += fenc[x] - rec[x];
+            count[band]++;
+        }
+
+        fenc += stride;
+        rec += stride;
+    }
+}
+
+inline int calcDP(pixel* src, intptr_t offset)
+{
+    return abs(static_cast<int>(src[-offset * 3]) - 2 * src[-offset * 2] + src[-offset]);
+}
+
+inline int calcDQ(pixel* src, intptr_t offset)
+{
+    return abs(static_cast<int>(src[0]) - 2 * src[offset] + src[offset * 2]);
+}
+
+/* decision between strong and weak filter for one line */
+inline bool useStrongFiltering(pixel* src, intptr_t offset, int d, int beta, int tc)
+{
+    int16_t m4  = (int16_t)src[0];
+    int16_t m3  = (int16_t)src[-offset];
+    int16_t m7  = (int16_t)src[offset * 3];
+    int16_t m0  = (int16_t)src[-offset * 4];
+
+    int d_strong = abs(m0 - m3) + abs(m7 - m4);
+
+    return (d_strong < (beta >> 3)) && (d < (beta >> 2)) && (abs(m3 - m4) < ((tc * 5 + 1) >> 1));
+}
+
+/* strong or weak filter of one luma line */
+inline void pelFilterLuma(pixel* src, intptr_t offset, int tc, bool sw, int thrCut, bool bFilterSecondP, bool bFilterSecondQ)
+{
+    int16_t m4  = (int16_t)src[0];
+    int16_t m3  = (int16_t)src[-offset];
+    int16_t m5  = (int16_t)src[offset];
+    int16_t m2  = (int16_t)src[-offset * 2];
+    int16_t m6  = (int16_t)src[offset * 2];
+    int16_t m1  = (int16_t)src[-offset * 3];
+    int16_t m7  = (int16_t)src[offset * 3];
+    int16_t m0  = (int16_t)src[-offset * 4];
+
+    if (sw)
+    {
+        src[-offset]     = (pixel)Clip3(m3 - 2 * tc, m3 + 2 * tc, ((m1 + 2 * m2 + 2 * m3 + 2 * m4 + m5 + 4) >> 3));
+        src[0]           = (pixel)Clip3(m4 - 2 * tc, m4 + 2 * tc, ((m2 + 2 * m3 + 2 * m4 + 2 * m5 + m6 + 4) >> 3));
+        src[-offset * 2] = (pixel)Clip3(m2 - 2 * tc, m2 + 2 * tc, ((m1 + m2 + m3 + m4 + 2) >> 2));
+        src[offset]      = (pixel)Clip3(m5 - 2 * tc, m5 + 2 * tc, ((m3 + m4 + m5 + m6 + 2) >> 2));
+        src[-offset * 3] = (pixel)Clip3(m1 - 2 * tc, m1 + 2 * tc, ((2 * m0 + 3 * m1 + m2 + m3 + m4 + 4) >> 3));
+        src[offset * 2]  = (pixel)Clip3(m6 - 2 * tc, m6 + 2 * tc, ((m3 + m4 + m5 + 3 * m6 + 2 * m7 + 4) >> 3));
+    }
+    else
+    {
+        /* Weak filter */
+        int delta = (9 * (m4 - m3) - 3 * (m5 - m2) + 8) >> 4;
+
+        if (abs(delta) < thrCut)
+        {
+            delta = Clip3(-tc, tc, delta);
+            src[-offset] = Clip(m3 + delta);
+            src[0] = Clip(m4 - delta);
+
+            int tc2 = tc >> 1;
+            if (bFilterSecondP)
+            {
+                int delta1 = Clip3(-tc2, tc2, ((((m1 + m3 + 1) >> 1) - m2 + delta) >> 1));
+                src[-offset * 2] = Clip(m2 + delta1);
+            }
+            if (bFilterSecondQ)
+            {
+                int delta2 = Clip3(-tc2, tc2, ((((m6 + m4 + 1) >> 1) - m5 - delta) >> 1));
+                src[offset] = Clip(m5 + delta2);
+            }
+        }
+    }
+}
+
+/* Deblock a luma edge made of numSeg segments of 4 lines. For vertical edges
+ * (dir 0) the lines are picture rows, for horizontal edges they are columns.
+ * src points at the first Q sample of the first line; tc[] and beta[] are the
+ * bit depth scaled thresholds of each segment, a segment with tc 0 is left
+ * untouched */
+template<int dir>
+void deblockLuma_c(pixel* src, intptr_t stride, const int32_t* tc, const int32_t* beta, int numSeg)
+{
+    const intptr_t offset = dir == 0 ? 1 : stride; // across the edge
+    const intptr_t srcStep = dir == 0 ? stride : 1; // along the edge
+
+    for (int seg = 0; seg < numSeg; seg++, src += 4 * srcStep)
+    {
+        if (!tc[seg])
+            continue;
+
+        int dp0 = calcDP(src, offset);
+        int dq0 = calcDQ(src, offset);
+        int dp3 = calcDP(src + 3 * srcStep, offset);
+        int dq3 = calcDQ(src + 3 * srcStep, offset);
+        int d0 = dp0 + dq0;
+        int d3 = dp3 + dq3;
+
+        if (d0 + d3 < beta[seg])
+        {
+            int sideThreshold = (beta[seg] + (beta[seg] >> 1)) >> 3;
+            bool bFilterP = (dp0 + dp3 < sideThreshold);
+            bool bFilterQ = (dq0 + dq3 < sideThreshold);
+
+            bool sw = useStrongFiltering(src, offset, 2 * d0, beta[seg], tc[seg])
+                && useStrongFiltering(src + 3 * srcStep, offset, 2 * d3, beta[seg], tc[seg]);
+
+            for (int i = 0; i < 4; i++)
+            {
+                pelFilterLuma(src + i * srcStep, offset, tc[seg], sw, tc[seg] * 10, bFilterP, bFilterQ);
+            }
+        }
+    }
+}
+
+/* Deblock a chroma edge made of numSeg segments of segLen lines, laid out as
+ * for deblockLuma_c. Only the P0 and Q0 samples of a line change */
+template<int dir>
+void deblockChroma_c(pixel* src, intptr_t stride, const int32_t* tc, int segLen, int numSeg)
+{
+    const intptr_t offset = dir == 0 ? 1 : stride;
+    const intptr_t srcStep = dir == 0 ? stride : 1;
+
+    for (int seg = 0; seg < numSeg; seg++)
+    {
+        for (int i = 0; i < segLen; i++, src += srcStep)
+        {
+            int16_t m4  = (int16_t)src[0];
+            int16_t m3  = (int16_t)src[-offset];
+            int16_t m5  = (int16_t)src[offset];
+            int16_t m2  = (int16_t)src[-offset * 2];
+
+            int delta = Clip3(-tc[seg], tc[seg], ((((m4 - m3) << 2) + m2 - m5 + 4) >> 3));
+            src[-offset] = Clip(m3 + delta);
+            src[0] = Clip(m4 - delta);
+        }
+    }
+}
+}
+
 namespace x265 {
 void Setup_C_LoopFilterPrimitives(EncoderPrimitives &p)
 {
     p.saoCuOrgE0 = processSaoCUE0;
+    p.saoCuOrgE1 = processSaoCUE1;
+    p.saoCuOrgE2 = processSaoCUE2;
+    p.saoCuOrgE3 = processSaoCUE3;
+    p.saoCuOrgB0 = processSaoCUB0;
+
+    p.deblock_luma[0] = deblockLuma_c<0>;
+    p.deblock_luma[1] = deblockLuma_c<1>;
+    p.deblock_chroma[0] = deblockChroma_c<0>;
+    p.deblock_chroma[1] = deblockChroma_c<1>;
+
+    p.sao_stats_eo[0] = saoStatsEO_c<0>;
+    p.sao_stats_eo[1] = saoStatsEO_c<1>;
+    p.sao_stats_eo[2] = saoStatsEO_c<2>;
+    p.sao_stats_eo[3] = saoStatsEO_c<3>;
+    p.sao_stats_bo = saoStatsBO_c;
 }
 }
@@ -103,6 +103,9 @@ void x265_param_default(x265_param *param)
     param->frameNumThreads = 0;
     param->poolNumThreads = 0;
     param->csvfn = NULL;
+    param->bEnableMEStats = 0;
+    param->meMapFn = NULL;
+    param->qualityMapFn = NULL;
 
     /* Source specifications */
     param->internalBitDepth = x265_max_bit_depth;
@@ -137,6 +140,9 @@ void x265_param_default(x265_param *param)
     param->bEnableWeightedBiPred = 0;
     param->bEnableEarlySkip = 0;
     param->bEnableCbfFastMode = 0;
+    param->fastDecision = 0;
+    param->bEnableStaticSkip = 0;
+    param->staticThreshold = 0;
     param->bEnableAMP = 0;
     param->bEnableRectInter = 0;
     param->rdLevel = 3;
@@ -152,6 +158,7 @@ void x265_param_default(x265_param *param)
     param->bEnableSAO = 1;
     param->saoLcuBoundary = 0;
     param->saoLcuBasedOptimization = 1;
+    param->bEnableSAOFast = 0;
 
     /* Coding Quality */
     param->cbQpOffset = 0;
@@ -180,6 +187,12 @@ void x265_param_default(x265_param *param)
     param->rc.cuTree = 1;
     param->rc.rfConstantMax = 0;
     param->rc.rfConstantMin = 0;
+    param->rc.bStatWrite = 0;
+    param->rc.bStatRead = 0;
+    param->rc.statFileName = "x265_2pass.log";
+    param->rc.bEnableSlowFirstPass = 0;
+    param->rc.complexityBlur = 20;
+    param->rc.qblur = 0.5;
 
     /* Quality Measurement Metrics */
     param->bEnablePsnr = 0;
@@ -288,6 +301,7 @@ int x265_param_default_preset(x265_param *param, const char *preset, const char
             param->rc.aqStrength = 0.0;
             param->rc.aqMode = X265_AQ_NONE;
             param->rc.cuTree = 0;
+            param->bEnableSAOFast = 1;
         }
         else if (!strcmp(preset, "veryfast"))
         {
@@ -300,6 +314,7 @@ int x265_param_default_preset(x265_param *param, const char *preset, const char
             param->rdLevel = 2;
             param->maxNumReferences = 1;
             param->rc.cuTree = 0;
+            param->bEnableSAOFast = 1;
         }
         else if (!strcmp(preset, "faster"))
         {
@@ -310,11 +325,13 @@ int x265_param_default_preset(x265_param *param, const char *preset, const char
             param->rdLevel = 2;
             param->maxNumReferences = 1;
             param->rc.cuTree = 0;
+            param->bEnableSAOFast = 1;
         }
         else if (!strcmp(preset, "fast"))
         {
             param->lookaheadDepth = 15;
             param->rdLevel = 2;
+            param->bEnableSAOFast = 1;
         }
         else if (!strcmp(preset, "medium"))
         {
@@ -533,6 +550,9 @@ int x265_param_parse(x265_param *p, const char *name, const char *value)
         }
     }
     OPT("csv") p->csvfn = value;
+    OPT("me-stats") p->bEnableMEStats = atobool(value);
+    OPT("me-map") p->meMapFn = value;
+    OPT("quality-map") p->qualityMapFn = value;
     OPT("threads") p->poolNumThreads = atoi(value);
     OPT("frame-threads") p->frameNumThreads = atoi(value);
     OPT2("level-idc", "level")
@@ -564,6 +584,9 @@ int x265_param_parse(x265_param *p, const char *name, const char *value)
     OPT("max-merge") p->maxNumMergeCand = (uint32_t)atoi(value);
     OPT("early-skip") p->bEnableEarlySkip = atobool(value);
     OPT("fast-cbf") p->bEnableCbfFastMode = atobool(value);
+    OPT("fast-decision") p->fastDecision = atoi(value);
+    OPT("static-skip") p->bEnableStaticSkip = atobool(value);
+    OPT("static-thresh") p->staticThreshold = atoi(value);
     OPT("rdpenalty") p->rdPenalty = atoi(value);
     OPT("tskip") p->bEnableTransformSkip = atobool(value);
     OPT("no-tskip-fast") p->bEnableTSkipFast = atobool(value);
@@ -618,6 +641,7 @@ int x265_param_parse(x265_param *p, const char *name, const char *value)
     OPT("sao") p->bEnableSAO = atobool(value);
     OPT("sao-lcu-bounds") p->saoLcuBoundary = atoi(value);
     OPT("sao-lcu-opt") p->saoLcuBasedOptimization = atoi(value);
+    OPT("sao-fast") p->bEnableSAOFast = atobool(value);
     OPT("ssim") p->bEnableSsim = atobool(value);
     OPT("psnr") p->bEnablePsnr = atobool(value);
     OPT("hash") p->decodedPictureHashSEI = atoi(value);
@@ -649,6 +673,16 @@ int x265_param_parse(x265_param *p, const char *name, const char *value)
     OPT("input-csp") p->internalCsp = parseName(value, x265_source_csp_names, bError);
     OPT("me")        p->searchMethod = parseName(value, x265_motion_est_names, bError);
     OPT("cutree")    p->rc.cuTree = atobool(value);
+    OPT("pass")
+    {
+        int pass = Clip3(0, 3, atoi(value));
+        p->rc.bStatWrite = pass & 1;
+        p->rc.bStatRead = pass & 2;
+    }
+    OPT("stats")          p->rc.statFileName = value;
+    OPT("slow-firstpass") p->rc.bEnableSlowFirstPass = atobool(value);
+    OPT("cplxblur")       p->rc.complexityBlur = atof(value);
+    OPT("qblur")          p->rc.qblur = atof(value);
     OPT("sar")
     {
         p->vui.aspectRatioIdc = parseName(value, x265_sar_names, bError);
@@ -964,6 +998,10 @@ int x265_check_params(x265_param *param)
           "Rate control mode is out of range");
     CHECK(param->rdLevel < 0 || param->rdLevel > 6,
           "RD Level is out of range");
+    CHECK(param->fastDecision < 0 || param->fastDecision > 2,
+          "Fast decision level is out of range");
+    CHECK(param->staticThreshold < 0,
+          "Static threshold must be non-negative");
     CHECK(param->bframes > param->lookaheadDepth,
           "Lookahead depth must be greater than the max consecutive bframe count");
     CHECK(param->bframes < 0,
@@ -1041,6 +1079,12 @@ int x265_check_params(x265_param *param)
           "Valid initial VBV buffer occupancy must be a fraction 0 - 1, or size in kbits");
     CHECK(param->rc.bitrate < 0,
           "Target bitrate can not be less than zero");
+    CHECK((param->rc.bStatRead || param->rc.bStatWrite) && !param->rc.statFileName,
+          "Multi-pass rate control requires a stats filename");
+    CHECK(param->rc.bStatRead && param->rc.rateControlMode != X265_RC_ABR,
+          "Multi-pass rate control requires a target bitrate");
+    CHECK(param->rc.complexityBlur < 0 || param->rc.qblur < 0,
+          "Multi-pass complexity and quantizer blur must be 0 or greater");
     CHECK(param->bFrameBias < 0, "Bias towards B frame decisions must be 0 or greater");
     if (param->noiseReduction)
         CHECK(100 > param->noiseReduction || param->noiseReduction > 1000, "Valid noise reduction range 100 - 1000");
@@ -1143,6 +1187,12 @@ void x265_print_params(x265_param *param)
         break;
     }
 
+    if (param->rc.bStatWrite || param->rc.bStatRead)
+    {
+        x265_log(param, X265_LOG_INFO, "Multi-pass stats read / write       : %d / %d\n",
+                 param->rc.bStatRead, param->rc.bStatWrite);
+    }
+
     if (param->rc.vbvBufferSize)
     {
         x265_log(param, X265_LOG_INFO, "VBV/HRD buffer / max-rate / init    : %d / %d / %.3f\n",
@@ -1156,6 +1206,10 @@ void x265_print_params(x265_param *param)
     TOOLOPT(param->bEnableCbfFastMode, "cfm");
     TOOLOPT(param->bEnableConstrainedIntra, "cip");
     TOOLOPT(param->bEnableEarlySkip, "esd");
+    if (param->fastDecision && param->rdLevel < 5)
+        fprintf(stderr, "fast-decision=%d ", param->fastDecision);
+    if (param->bEnableStaticSkip)
+        fprintf(stderr, "static-skip=%d ", param->staticThreshold);
     fprintf(stderr, "rd=%d ", param->rdLevel);
     if (param->psyRd > 0.)
         fprintf(stderr, "psy-rd=%.1lf ", param->psyRd);
@@ -1164,7 +1218,7 @@ void x265_print_params(x265_param *param)
     if (param->bEnableSAO)
     {
         if (param->saoLcuBasedOptimization)
-            fprintf(stderr, "sao-lcu ");
+            fprintf(stderr, param->bEnableSAOFast ? "sao-lcu(fast) " : "sao-lcu ");
         else
             fprintf(stderr, "sao-frame ");
     }
@@ -1205,6 +1259,9 @@ char *x265_param2string(x265_param *p)
     s += sprintf(s, " max-merge=%d", p->maxNumMergeCand);
     BOOL(p->bEnableEarlySkip, "early-skip");
     BOOL(p->bEnableCbfFastMode, "fast-cbf");
+    s += sprintf(s, " fast-decision=%d", p->fastDecision);
+    BOOL(p->bEnableStaticSkip, "static-skip");
+    s += sprintf(s, " static-thresh=%d", p->staticThreshold);
     s += sprintf(s, " rdpenalty=%d", p->rdPenalty);
     BOOL(p->bEnableTransformSkip, "tskip");
     BOOL(p->bEnableTSkipFast, "tskip-fast");
@@ -1236,6 +1293,7 @@ char *x265_param2string(x265_param *p)
     BOOL(p->bEnableSAO, "sao");
     s += sprintf(s, " sao-lcu-bounds=%d", p->saoLcuBoundary);
     s += sprintf(s, " sao-lcu-opt=%d", p->saoLcuBasedOptimization);
+    BOOL(p->bEnableSAOFast, "sao-fast");
     s += sprintf(s, " b-pyramid=%d", p->bBPyramid);
     BOOL(p->rc.cuTree, "cutree");
 #undef BOOL
@@ -710,6 +710,13 @@ uint64_t pixel_var(pixel *pix, intptr_t i_stride)
     return sum + ((uint64_t)sqr << 32);
 }
 
+template<int size>
+void pixel_var_row(pixel *pix, intptr_t i_stride, int numBlocks, uint64_t *res)
+{
+    for (int i = 0; i < numBlocks; i++)
+        res[i] = pixel_var<size>(pix + i * size, i_stride);
+}
+
 void plane_copy_deinterleave_chroma(pixel *dstu, intptr_t dstuStride, pixel *dstv, intptr_t dstvStride,
                                     pixel *src,  intptr_t srcStride, int w, int h)
 {
@@ -1172,6 +1179,10 @@ void Setup_C_PixelPrimitives(EncoderPrimitives &p)
     p.var[BLOCK_16x16] = pixel_var<16>;
     p.var[BLOCK_32x32] = pixel_var<32>;
     p.var[BLOCK_64x64] = pixel_var<64>;
+    p.var_row[BLOCK_8x8] = pixel_var_row<8>;
+    p.var_row[BLOCK_16x16] = pixel_var_row<16>;
+    p.var_row[BLOCK_32x32] = pixel_var_row<32>;
+    p.var_row[BLOCK_64x64] = pixel_var_row<64>;
     p.plane_copy_deinterleave_c = plane_copy_deinterleave_chroma;
     p.planecopy_cp = planecopy_cp_c;
     p.planecopy_sp = planecopy_sp_c;
@@ -150,6 +150,8 @@ typedef uint32_t (*quant_t)(int32_t *coef, int32_t *quantCoeff, int32_t *deltaU,
 typedef void (*dequant_scaling_t)(const int32_t* src, const int32_t *dequantCoef, int32_t* dst, int num, int mcqp_miper, int shift);
 typedef void (*dequant_normal_t)(const int32_t* quantCoef, int32_t* coef, int num, int scale, int shift);
 typedef int  (*count_nonzero_t)(const int32_t *quantCoeff, int numCoeff);
+typedef uint32_t (*rdoq_levels_t)(const int32_t *coef, const int32_t *quantCoeff, const double *errScale, int32_t *levelDouble, int32_t *absLevel, double *costUncoded, int qBits, int numCoeff);
+typedef int  (*scan_poslast_t)(const int32_t *coeff, const uint16_t *scan, int log2TrSize, uint16_t *coeffFlag, uint16_t *coeffSign, uint8_t *coeffNum, int numSig);
 
 typedef void (*weightp_pp_t)(pixel *src, pixel *dst, intptr_t srcStride, intptr_t dstStride, int width, int height, int w0, int round, int shift, int offset);
 typedef void (*weightp_sp_t)(int16_t *src, pixel *dst, intptr_t srcStride, intptr_t dstStride, int width, int height, int w0, int round, int shift, int offset);
@@ -160,6 +162,8 @@ typedef void (*extendCURowBorder_t)(pixel* txt, intptr_t stride, int width, int
 typedef void (*ssim_4x4x2_core_t)(const pixel *pix1, intptr_t stride1, const pixel *pix2, intptr_t stride2, int sums[2][4]);
 typedef float (*ssim_end4_t)(int sum0[5][4], int sum1[5][4], int width);
 typedef uint64_t (*var_t)(pixel *pix, intptr_t stride);
+/* var_t of numBlocks horizontally adjacent square blocks starting at pix */
+typedef void (*var_row_t)(pixel *pix, intptr_t stride, int numBlocks, uint64_t *res);
 typedef void (*plane_copy_deinterleave_t)(pixel *dstu, intptr_t dstuStride, pixel *dstv, intptr_t dstvStride, pixel *src, intptr_t srcStride, int w, int h);
 
 typedef void (*filter_pp_t) (pixel *src, intptr_t srcStride, pixel *dst, intptr_t dstStride, int coeffIdx);
@@ -170,6 +174,12 @@ typedef void (*filter_ss_t) (int16_t *src, intptr_t srcStride, int16_t *dst, int
 typedef void (*filter_hv_pp_t) (pixel *src, intptr_t srcStride, pixel *dst, intptr_t dstStride, int idxX, int idxY);
 typedef void (*filter_p2s_t)(pixel *src, intptr_t srcStride, int16_t *dst, int width, int height);
 
+/* Interpolate and score the subpel neighbours of qpel position (qmvx, qmvy)
+ * relative to fref, step quarter-pels away (step must be 1 or 2).  fenc has
+ * FENC_STRIDE.  The x4 variant returns costs for the four cross neighbours,
+ * the x8 variant adds the four diagonals, both in g_subpelNeighbours order */
+typedef void (*subpelcmp_t)(pixel *fenc, pixel *fref, intptr_t frefStride, int qmvx, int qmvy, int step, pixelcmp_t cmp, int32_t *res);
+
 typedef void (*copy_pp_t)(pixel *dst, intptr_t dstride, pixel *src, intptr_t sstride); // dst is aligned
 typedef void (*copy_sp_t)(pixel *dst, intptr_t dstStride, int16_t *src, intptr_t srcStride);
 typedef void (*copy_ps_t)(int16_t *dst, intptr_t dstStride, pixel *src, intptr_t srcStride);
@@ -180,6 +190,13 @@ typedef void (*pixel_add_ps_t)(pixel *a, intptr_t dstride, pixel *b0, int16_t *b
 typedef void (*addAvg_t)(int16_t* src0, int16_t* src1, pixel* dst, intptr_t src0Stride, intptr_t src1Stride, intptr_t dstStride);
 
 typedef void (*saoCuOrgE0_t)(pixel * rec, int8_t * offsetEo, int lcuWidth, int8_t signLeft);
+typedef void (*saoCuOrgE1_t)(pixel* rec, int8_t* upBuff1, int8_t* offsetEo, intptr_t stride, int width);
+typedef void (*saoCuOrgE2_t)(pixel* rec, int8_t* bufft, int8_t* buff1, int8_t* offsetEo, int width, intptr_t stride);
+typedef void (*saoCuOrgE3_t)(pixel* rec, int8_t* upBuff1, int8_t* offsetEo, intptr_t stride, int startX, int endX);
+typedef void (*saoCuOrgB0_t)(pixel* rec, const int8_t* offsetBo, int width, int height, intptr_t stride);
+typedef void (*deblock_luma_t)(pixel* src, intptr_t stride, const int32_t* tc, const int32_t* beta, int numSeg);
+typedef void (*deblock_chroma_t)(pixel* src, intptr_t stride, const int32_t* tc, int segLen, int numSeg);
+typedef void (*sao_stats_t)(const pixel* fenc, const pixel* rec, intptr_t stride, int width, int height, int32_t* sum, int32_t* count);
 typedef void (*planecopy_cp_t) (uint8_t *src, intptr_t srcStride, pixel *dst, intptr_t dstStride, int width, int height, int shift);
 typedef void (*planecopy_sp_t) (uint16_t *src, intptr_t srcStride, pixel *dst, intptr_t dstStride, int width, int height, int shift, uint16_t mask);
 
@@ -226,6 +243,8 @@ struct EncoderPrimitives
     filter_ss_t     luma_vss[NUM_LUMA_PARTITIONS];
     filter_hv_pp_t  luma_hvpp[NUM_LUMA_PARTITIONS];
     filter_p2s_t    luma_p2s;
+    subpelcmp_t     luma_subpel_x4[NUM_LUMA_PARTITIONS];
+    subpelcmp_t     luma_subpel_x8[NUM_LUMA_PARTITIONS];
     filter_p2s_t    chroma_p2s[X265_CSP_COUNT];
 
     weightp_sp_t    weight_sp;
@@ -241,24 +260,38 @@ struct EncoderPrimitives
 
     dct_t           dct[NUM_DCTS];
     idct_t          idct[NUM_IDCTS];
+    idct_t          idct_corner4[NUM_IDCTS];       // coeffs only in the top-left 4x4, 8x8 and larger
+    idct_t          idct_corner8[NUM_IDCTS];       // coeffs only in the top-left 8x8, 16x16 and larger
     quant_t         quant;
     dequant_scaling_t dequant_scaling;
     dequant_normal_t dequant_normal;
     count_nonzero_t count_nonzero;
+    scan_poslast_t  scan_poslast;
+    rdoq_levels_t   rdoq_levels;
 
     calcresidual_t  calcresidual[NUM_SQUARE_BLOCKS];
     calcrecon_t     calcrecon[NUM_SQUARE_BLOCKS];
     transpose_t     transpose[NUM_SQUARE_BLOCKS];
 
     var_t           var[NUM_SQUARE_BLOCKS];
+    var_row_t       var_row[NUM_SQUARE_BLOCKS];
     ssim_4x4x2_core_t ssim_4x4x2_core;
     ssim_end4_t     ssim_end_4;
 
     downscale_t     frame_init_lowres_core;
     plane_copy_deinterleave_t plane_copy_deinterleave_c;
     extendCURowBorder_t extendRowBorder;
+    // deblocking primitives, [0] vertical edges, [1] horizontal edges
+    deblock_luma_t    deblock_luma[2];     // runs of 4 line segments
+    deblock_chroma_t  deblock_chroma[2];
     // sao primitives
     saoCuOrgE0_t      saoCuOrgE0;
+    saoCuOrgE1_t      saoCuOrgE1;
+    saoCuOrgE2_t      saoCuOrgE2;
+    saoCuOrgE3_t      saoCuOrgE3;
+    saoCuOrgB0_t      saoCuOrgB0;
+    sao_stats_t       sao_stats_eo[4];     // per edge type, [SAO_EO_0..SAO_EO_3]
+    sao_stats_t       sao_stats_bo;        // per band
     planecopy_cp_t    planecopy_cp;
     planecopy_sp_t    planecopy_sp;
 
@@ -282,6 +315,10 @@ struct EncoderPrimitives
     } chroma[4]; // X265_CSP_COUNT - do not want to include x265.h here
 };
 
+/* neighbour offsets (x, y) of the subpel_x4/x8 primitives, in the same order as
+ * the square1[] search pattern of the motion search */
+extern const int8_t g_subpelNeighbours[8][2];
+
 void extendPicBorder(pixel* recon, int stride, int width, int height, int marginX, int marginY);
 
 /* This copy of the table is what gets used by the encoder.
@@ -0,0 +1,283 @@
+/*****************************************************************************
+ * Copyright (C) 2013 x265 project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "primitives.h"
+#include "TLibCommon/TComRom.h"
+#include "threading.h" // CLZ32
+#include <immintrin.h> // AVX2
+
+using namespace x265;
+
+namespace {
+/* all kernels process eight coefficients per step; every block size is a
+ * multiple of sixteen coefficients. Clipping is done with min/max since the
+ * AVX2 packs work within 128 bit lanes */
+
+uint32_t quant(int32_t* coef, int32_t* quantCoeff, int32_t* deltaU, int32_t* qCoef, int qBits, int add, int numCoeff, int32_t* lastPos)
+{
+    const __m256i vadd = _mm256_set1_epi32(add);
+    const __m128i shift = _mm_cvtsi32_si128(qBits);
+    const __m128i shift8 = _mm_cvtsi32_si128(qBits - 8);
+    const __m256i vmin = _mm256_set1_epi32(-32768);
+    const __m256i vmax = _mm256_set1_epi32(32767);
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i sum = zero;
+    int last = -1;
+
+    for (int n = 0; n < numCoeff; n += 8)
+    {
+        __m256i c = _mm256_loadu_si256((__m256i*)(coef + n));
+        __m256i tmplevel = _mm256_mullo_epi32(_mm256_abs_epi32(c), _mm256_loadu_si256((__m256i*)(quantCoeff + n)));
+        __m256i level = _mm256_sra_epi32(_mm256_add_epi32(tmplevel, vadd), shift);
+
+        __m256i delta = _mm256_sra_epi32(_mm256_sub_epi32(tmplevel, _mm256_sll_epi32(level, shift)), shift8);
+        _mm256_storeu_si256((__m256i*)(deltaU + n), delta);
+
+        sum = _mm256_add_epi32(sum, level);
+
+        uint32_t nz = ~_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(level, zero))) & 0xff;
+        if (nz)
+        {
+            unsigned long idx;
+            CLZ32(idx, nz);
+            last = n + (int)idx;
+        }
+
+        __m256i sign = _mm256_srai_epi32(c, 31);
+        level = _mm256_sub_epi32(_mm256_xor_si256(level, sign), sign);
+        level = _mm256_max_epi32(_mm256_min_epi32(level, vmax), vmin);
+        _mm256_storeu_si256((__m256i*)(qCoef + n), level);
+    }
+
+    if (last >= 0)
+        *lastPos = last;
+
+    __m128i sum4 = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    sum4 = _mm_add_epi32(sum4, _mm_shuffle_epi32(sum4, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum4 = _mm_add_epi32(sum4, _mm_shuffle_epi32(sum4, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    return (uint32_t)_mm_cvtsi128_si32(sum4);
+}
+
+void dequant_normal(const int32_t* quantCoef, int32_t* coef, int num, int scale, int shift)
+{
+    X265_CHECK(num <= 32 * 32, "dequant num %d too large\n", num);
+    X265_CHECK((num % 8) == 0, "dequant num %d not multiple of 8\n", num);
+
+    const __m256i vscale = _mm256_set1_epi32(scale);
+    const __m256i vadd = _mm256_set1_epi32(1 << (shift - 1));
+    const __m128i vshift = _mm_cvtsi32_si128(shift);
+    const __m256i vmin = _mm256_set1_epi32(-32768);
+    const __m256i vmax = _mm256_set1_epi32(32767);
+
+    for (int n = 0; n < num; n += 8)
+    {
+        __m256i q = _mm256_loadu_si256((__m256i*)(quantCoef + n));
+        q = _mm256_max_epi32(_mm256_min_epi32(q, vmax), vmin);
+        q = _mm256_sra_epi32(_mm256_add_epi32(_mm256_mullo_epi32(q, vscale), vadd), vshift);
+        q = _mm256_max_epi32(_mm256_min_epi32(q, vmax), vmin);
+        _mm256_storeu_si256((__m256i*)(coef + n), q);
+    }
+}
+
+void dequant_scaling(const int32_t* quantCoef, const int32_t *deQuantCoef, int32_t* coef, int num, int per, int shift)
+{
+    X265_CHECK(num <= 32 * 32, "dequant num %d too large\n", num);
+
+    const __m256i vmin = _mm256_set1_epi32(-32768);
+    const __m256i vmax = _mm256_set1_epi32(32767);
+
+    shift += 4;
+
+    if (shift > per)
+    {
+        const __m256i vadd = _mm256_set1_epi32(1 << (shift - per - 1));
+        const __m128i vshift = _mm_cvtsi32_si128(shift - per);
+
+        for (int n = 0; n < num; n += 8)
+        {
+            __m256i q = _mm256_loadu_si256((__m256i*)(quantCoef + n));
+            q = _mm256_max_epi32(_mm256_min_epi32(q, vmax), vmin);
+            q = _mm256_mullo_epi32(q, _mm256_loadu_si256((__m256i*)(deQuantCoef + n)));
+            q = _mm256_sra_epi32(_mm256_add_epi32(q, vadd), vshift);
+            q = _mm256_max_epi32(_mm256_min_epi32(q, vmax), vmin);
+            _mm256_storeu_si256((__m256i*)(coef + n), q);
+        }
+    }
+    else
+    {
+        const __m128i vshift = _mm_cvtsi32_si128(per - shift);
+
+        for (int n = 0; n < num; n += 8)
+        {
+            __m256i q = _mm256_loadu_si256((__m256i*)(quantCoef + n));
+            q = _mm256_max_epi32(_mm256_min_epi32(q, vmax), vmin);
+            q = _mm256_mullo_epi32(q, _mm256_loadu_si256((__m256i*)(deQuantCoef + n)));
+            q = _mm256_max_epi32(_mm256_min_epi32(q, vmax), vmin);
+            q = _mm256_sll_epi32(q, vshift);
+            q = _mm256_max_epi32(_mm256_min_epi32(q, vmax), vmin);
+            _mm256_storeu_si256((__m256i*)(coef + n), q);
+        }
+    }
+}
+
+int count_nonzero(const int32_t *quantCoeff, int numCoeff)
+{
+    X265_CHECK(((intptr_t)quantCoeff & 15) == 0, "quant buffer not aligned\n");
+    X265_CHECK(numCoeff > 0 && (numCoeff & 15) == 0, "numCoeff invalid %d\n", numCoeff);
+
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i zeros = zero;
+
+    /* each compare yields -1 for a zero coefficient */
+    for (int n = 0; n < numCoeff; n += 16)
+    {
+        __m256i c0 = _mm256_cmpeq_epi32(_mm256_loadu_si256((__m256i*)(quantCoeff + n)), zero);
+        __m256i c1 = _mm256_cmpeq_epi32(_mm256_loadu_si256((__m256i*)(quantCoeff + n + 8)), zero);
+        zeros = _mm256_add_epi32(zeros, _mm256_add_epi32(c0, c1));
+    }
+
+    __m128i sum4 = _mm_add_epi32(_mm256_castsi256_si128(zeros), _mm256_extracti128_si256(zeros, 1));
+    sum4 = _mm_add_epi32(sum4, _mm_shuffle_epi32(sum4, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum4 = _mm_add_epi32(sum4, _mm_shuffle_epi32(sum4, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    return numCoeff + _mm_cvtsi128_si32(sum4);
+}
+
+#if !HIGH_BIT_DEPTH
+/* first pass basis, entry [x / 2][k] holds T[k][x] and T[k][x + 1] so one
+ * broadcast pair of residuals is multiplied into eight k at once. Filled in
+ * from g_t16/g_t32 by the primitive setup */
+ALIGN_VAR_32(static int16_t, tab_dct16_pairs[8][16][2]);
+ALIGN_VAR_32(static int16_t, tab_dct32_pairs[16][32][2]);
+
+/* forward transforms as two matrix products of pmaddwd over pairs of inputs.
+ * The first pass writes the transposed intermediate so the second one can
+ * interleave two of its rows and produce sixteen outputs of a row per step */
+template<int N>
+void dct(int16_t *src, int32_t *dst, intptr_t stride)
+{
+    const int shift_1st = N == 16 ? 3 : 4;
+    const int shift_2nd = N == 16 ? 10 : 11;
+    const int16_t *t = N == 16 ? &g_t16[0][0] : &g_t32[0][0];
+    const __m256i *pairs = (const __m256i*)(N == 16 ? &tab_dct16_pairs[0][0][0] : &tab_dct32_pairs[0][0][0]);
+    const __m256i add1 = _mm256_set1_epi32(1 << (shift_1st - 1));
+    const __m256i add2 = _mm256_set1_epi32(1 << (shift_2nd - 1));
+
+    ALIGN_VAR_32(int16_t, tmp[N][N]);
+    __m256i cols[N / 2][N / 8];
+
+    for (int y = 0; y < N; y++)
+    {
+        __m256i acc[N / 8];
+        for (int g = 0; g < N / 8; g++)
+        {
+            acc[g] = add1;
+        }
+
+        for (int x = 0; x < N; x += 2)
+        {
+            __m256i r = _mm256_set1_epi32(*(int32_t*)(src + y * stride + x));
+            for (int g = 0; g < N / 8; g++)
+            {
+                acc[g] = _mm256_add_epi32(acc[g], _mm256_madd_epi16(pairs[(x >> 1) * (N / 8) + g], r));
+            }
+        }
+
+        /* packs works within 128 bit lanes, the qword permute restores k order */
+        for (int g = 0; g < N / 8; g += 2)
+        {
+            __m256i lo = _mm256_srai_epi32(acc[g], shift_1st);
+            __m256i hi = _mm256_srai_epi32(acc[g + 1], shift_1st);
+            _mm256_store_si256((__m256i*)&tmp[y][g * 8], _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xD8));
+        }
+    }
+
+    /* rows y and y + 1 interleaved, columns 0-3 and 8-11 in the low unpack
+     * and 4-7 and 12-15 in the high one */
+    for (int y = 0; y < N; y += 2)
+    {
+        for (int j = 0; j < N; j += 16)
+        {
+            __m256i r0 = _mm256_load_si256((__m256i*)&tmp[y][j]);
+            __m256i r1 = _mm256_load_si256((__m256i*)&tmp[y + 1][j]);
+            cols[y >> 1][j >> 3] = _mm256_unpacklo_epi16(r0, r1);
+            cols[y >> 1][(j >> 3) + 1] = _mm256_unpackhi_epi16(r0, r1);
+        }
+    }
+
+    for (int k = 0; k < N; k++)
+    {
+        __m256i acc[N / 8];
+        for (int g = 0; g < N / 8; g++)
+        {
+            acc[g] = add2;
+        }
+
+        for (int y = 0; y < N; y += 2)
+        {
+            __m256i c = _mm256_set1_epi32(*(int32_t*)(t + k * N + y));
+            for (int g = 0; g < N / 8; g++)
+            {
+                acc[g] = _mm256_add_epi32(acc[g], _mm256_madd_epi16(cols[y >> 1][g], c));
+            }
+        }
+
+        for (int g = 0; g < N / 8; g += 2)
+        {
+            __m256i lo = _mm256_srai_epi32(acc[g], shift_2nd);
+            __m256i hi = _mm256_srai_epi32(acc[g + 1], shift_2nd);
+            _mm256_storeu_si256((__m256i*)(dst + k * N + g * 8), _mm256_permute2x128_si256(lo, hi, 0x20));
+            _mm256_storeu_si256((__m256i*)(dst + k * N + g * 8 + 8), _mm256_permute2x128_si256(lo, hi, 0x31));
+        }
+    }
+}
+
+template<int N>
+void initDctPairs(int16_t (*pairs)[N][2], const int16_t *t)
+{
+    for (int x = 0; x < N; x += 2)
+    {
+        for (int k = 0; k < N; k++)
+        {
+            pairs[x >> 1][k][0] = t[k * N + x];
+            pairs[x >> 1][k][1] = t[k * N + x + 1];
+        }
+    }
+}
+#endif // if !HIGH_BIT_DEPTH
+}
+
+namespace x265 {
+void Setup_Vec_DCTPrimitives_avx2(EncoderPrimitives &p)
+{
+    p.quant = quant;
+    p.dequant_normal = dequant_normal;
+    p.dequant_scaling = dequant_scaling;
+    p.count_nonzero = count_nonzero;
+#if !HIGH_BIT_DEPTH
+    initDctPairs<16>(tab_dct16_pairs, &g_t16[0][0]);
+    initDctPairs<32>(tab_dct32_pairs, &g_t32[0][0]);
+    p.dct[DCT_16x16] = dct<16>;
+    p.dct[DCT_32x32] = dct<32>;
+#endif
+}
+}
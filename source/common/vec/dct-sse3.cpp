@@ -1554,6 +1554,85 @@ void idct32(int32_t *src, int16_t *dst, intptr_t stride)
     }
 }
 
+/* one line of N outputs of a top-left corner inverse transform, the sums of
+ * K terms taken as K / 2 pmaddwd of interleaved basis rows and input pairs */
+template<int N, int K>
+inline void cornerLine(const __m128i (*basis)[N / 4], const __m128i *pair, __m128i add, int shift, int16_t *out)
+{
+    for (int n = 0; n < N; n += 8)
+    {
+        __m128i lo = add;
+        __m128i hi = add;
+        for (int k = 0; k < K / 2; k++)
+        {
+            lo = _mm_add_epi32(lo, _mm_madd_epi16(basis[k][n >> 2], pair[k]));
+            hi = _mm_add_epi32(hi, _mm_madd_epi16(basis[k][(n >> 2) + 1], pair[k]));
+        }
+
+        lo = _mm_srai_epi32(lo, shift);
+        hi = _mm_srai_epi32(hi, shift);
+        _mm_storeu_si128((__m128i*)(out + n), _mm_packs_epi32(lo, hi));
+    }
+}
+
+/* inverse transform of a block whose non-zero coefficients all lie within its
+ * top-left KxK corner, only K columns and K terms per output are computed */
+template<int N, int K>
+void idct_corner(int32_t *src, int16_t *dst, intptr_t stride)
+{
+    const int16_t *t = N == 8 ? &g_t8[0][0] : N == 16 ? &g_t16[0][0] : &g_t32[0][0];
+    const __m128i add1 = _mm_set1_epi32(1 << 6);
+    const __m128i add2 = _mm_set1_epi32(1 << 11);
+
+    __m128i basis[K / 2][N / 4];
+    ALIGN_VAR_16(int16_t, coef[K][N]);
+
+    for (int k = 0; k < K; k += 2)
+    {
+        for (int n = 0; n < N; n += 8)
+        {
+            __m128i r0 = _mm_loadu_si128((__m128i*)(t + k * N + n));
+            __m128i r1 = _mm_loadu_si128((__m128i*)(t + (k + 1) * N + n));
+            basis[k >> 1][n >> 2] = _mm_unpacklo_epi16(r0, r1);
+            basis[k >> 1][(n >> 2) + 1] = _mm_unpackhi_epi16(r0, r1);
+        }
+    }
+
+    /* first pass, one line of coef per non-zero column of src */
+    for (int j = 0; j < K; j++)
+    {
+        __m128i pair[K / 2];
+        for (int k = 0; k < K; k += 2)
+        {
+            pair[k >> 1] = _mm_set1_epi32((int)((uint16_t)src[k * N + j] | ((uint32_t)(uint16_t)src[(k + 1) * N + j] << 16)));
+        }
+
+        cornerLine<N, K>(basis, pair, add1, 7, coef[j]);
+    }
+
+    /* second pass, four output rows per step sharing their interleaved inputs */
+    for (int n = 0; n < N; n += 4)
+    {
+        __m128i col[K / 2];
+        for (int j = 0; j < K; j += 2)
+        {
+            col[j >> 1] = _mm_unpacklo_epi16(_mm_loadl_epi64((__m128i*)&coef[j][n]), _mm_loadl_epi64((__m128i*)&coef[j + 1][n]));
+        }
+
+        for (int r = 0; r < 4; r++)
+        {
+            __m128i pair[K / 2];
+            for (int j = 0; j < K / 2; j++)
+            {
+                pair[j] = _mm_shuffle_epi32(col[j], 0);
+                col[j] = _mm_srli_si128(col[j], 4);
+            }
+
+            cornerLine<N, K>(basis, pair, add2, 12, dst + (n + r) * stride);
+        }
+    }
+}
+
 #endif // if !HIGH_BIT_DEPTH
 }
 
@@ -1564,6 +1643,11 @@ void Setup_Vec_DCTPrimitives_sse3(EncoderPrimitives &p)
     p.idct[IDCT_8x8] = idct8;
     p.idct[IDCT_16x16] = idct16;
     p.idct[IDCT_32x32] = idct32;
+    p.idct_corner4[IDCT_8x8] = idct_corner<8, 4>;
+    p.idct_corner4[IDCT_16x16] = idct_corner<16, 4>;
+    p.idct_corner4[IDCT_32x32] = idct_corner<32, 4>;
+    p.idct_corner8[IDCT_16x16] = idct_corner<16, 8>;
+    p.idct_corner8[IDCT_32x32] = idct_corner<32, 8>;
 #endif
 }
 }
@@ -30,6 +30,7 @@
 
 #include "primitives.h"
 #include "TLibCommon/TComRom.h"
+#include "threading.h" // CLZ32
 #include <xmmintrin.h> // SSE
 #include <pmmintrin.h> // SSE3
 #include <tmmintrin.h> // SSSE3
@@ -1094,6 +1095,98 @@ void dct32(int16_t *src, int32_t *dst, intptr_t stride)
 }
 #endif // if !HIGH_BIT_DEPTH
 
+namespace {
+int scan_poslast(const int32_t *coeff, const uint16_t *scan, int log2TrSize, uint16_t *coeffFlag, uint16_t *coeffSign, uint8_t *coeffNum, int numSig)
+{
+    const int trSize = 1 << log2TrSize;
+
+    /* every 4x4 group of a TU is scanned in the same order, so one shuffle
+     * takes a group's coefficients from raster order to scan order */
+    ALIGN_VAR_16(uint8_t, perm[16]);
+    for (int i = 0; i < 16; i++)
+    {
+        int blkPos = scan[i];
+        perm[i] = (uint8_t)(((blkPos >> log2TrSize) << 2) + (blkPos & (trSize - 1)));
+    }
+
+    const __m128i vperm = _mm_load_si128((__m128i*)perm);
+    const __m128i zero = _mm_setzero_si128();
+    int cg = 0;
+
+    do
+    {
+        /* the first coefficient of a group in scan order is its top left */
+        const int32_t *src = coeff + scan[cg << 4];
+        __m128i r0 = _mm_loadu_si128((__m128i*)(src));
+        __m128i r1 = _mm_loadu_si128((__m128i*)(src + trSize));
+        __m128i r2 = _mm_loadu_si128((__m128i*)(src + 2 * trSize));
+        __m128i r3 = _mm_loadu_si128((__m128i*)(src + 3 * trSize));
+
+        /* saturating packs keep both the sign and non-zero-ness of each level */
+        __m128i levels = _mm_packs_epi16(_mm_packs_epi32(r0, r1), _mm_packs_epi32(r2, r3));
+        levels = _mm_shuffle_epi8(levels, vperm);
+
+        uint32_t flag = ~_mm_movemask_epi8(_mm_cmpeq_epi8(levels, zero)) & 0xffff;
+        uint32_t sign = _mm_movemask_epi8(levels);
+
+        uint32_t num = flag - ((flag >> 1) & 0x5555);
+        num = (num & 0x3333) + ((num >> 2) & 0x3333);
+        num = (num + (num >> 4)) & 0x0f0f;
+        num = (num + (num >> 8)) & 0x1f;
+
+        coeffFlag[cg] = (uint16_t)flag;
+        coeffSign[cg] = (uint16_t)sign;
+        coeffNum[cg] = (uint8_t)num;
+        numSig -= num;
+        cg++;
+    }
+    while (numSig > 0);
+
+    cg--;
+    unsigned long idx;
+    CLZ32(idx, coeffFlag[cg]);
+
+    return (cg << 4) + (int)idx;
+}
+
+uint32_t rdoq_levels(const int32_t *coef, const int32_t *quantCoeff, const double *errScale, int32_t *levelDouble, int32_t *absLevel, double *costUncoded, int qBits, int numCoeff)
+{
+    const int add = 1 << (qBits - 1);
+    const __m128d maxLevel = _mm_set1_pd((double)(MAX_INT - add));
+    const __m128i vadd = _mm_set1_epi32(add);
+    const __m128i shift = _mm_cvtsi32_si128(qBits);
+    const __m128i zero = _mm_setzero_si128();
+    uint32_t numSig = 0;
+
+    for (int i = 0; i < numCoeff; i += 4)
+    {
+        __m128i c = _mm_abs_epi32(_mm_loadu_si128((__m128i*)(coef + i)));
+        __m128i q = _mm_loadu_si128((__m128i*)(quantCoeff + i));
+
+        /* products of levels and quant scales are exact in doubles; squaring
+         * the clamped level in double rounds once, just as converting the 64
+         * bit integer square does, so the costs match the C reference */
+        __m128d l0 = _mm_mul_pd(_mm_cvtepi32_pd(c), _mm_cvtepi32_pd(q));
+        __m128d l1 = _mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(c, 8)), _mm_cvtepi32_pd(_mm_srli_si128(q, 8)));
+        l0 = _mm_min_pd(l0, maxLevel);
+        l1 = _mm_min_pd(l1, maxLevel);
+
+        __m128i level = _mm_unpacklo_epi64(_mm_cvttpd_epi32(l0), _mm_cvttpd_epi32(l1));
+        __m128i absl = _mm_sra_epi32(_mm_add_epi32(level, vadd), shift);
+        _mm_storeu_si128((__m128i*)(levelDouble + i), level);
+        _mm_storeu_si128((__m128i*)(absLevel + i), absl);
+
+        _mm_storeu_pd(costUncoded + i, _mm_mul_pd(_mm_mul_pd(l0, l0), _mm_loadu_pd(errScale + i)));
+        _mm_storeu_pd(costUncoded + i + 2, _mm_mul_pd(_mm_mul_pd(l1, l1), _mm_loadu_pd(errScale + i + 2)));
+
+        int zeroMask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(absl, zero)));
+        numSig += 4 - ((zeroMask & 1) + ((zeroMask >> 1) & 1) + ((zeroMask >> 2) & 1) + (zeroMask >> 3));
+    }
+
+    return numSig;
+}
+}
+
 namespace x265 {
 void Setup_Vec_DCTPrimitives_ssse3(EncoderPrimitives &p)
 {
@@ -1101,5 +1194,7 @@ void Setup_Vec_DCTPrimitives_ssse3(EncoderPrimitives &p)
     p.dct[DCT_16x16] = dct16;
     p.dct[DCT_32x32] = dct32;
 #endif
+    p.scan_poslast = scan_poslast;
+    p.rdoq_levels = rdoq_levels;
 }
 }
@@ -0,0 +1,415 @@
+/*****************************************************************************
+ * Copyright (C) 2013 x265 project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "TLibCommon/TComRom.h"
+#include "primitives.h"
+#include <xmmintrin.h> // SSE
+#include <pmmintrin.h> // SSE3
+#include <tmmintrin.h> // SSSE3
+#include <smmintrin.h> // SSE4.1
+
+namespace x265 {
+extern unsigned char IntraFilterType[][35];
+}
+
+using namespace x265;
+
+namespace {
+#if !HIGH_BIT_DEPTH
+/* store the low 'width' bytes of v, width is 4, 8 or 16 */
+template<int width>
+inline void storeRow(pixel *dst, __m128i v)
+{
+    if (width == 4)
+        *(uint32_t*)dst = (uint32_t)_mm_cvtsi128_si32(v);
+    else if (width == 8)
+        _mm_storel_epi64((__m128i*)dst, v);
+    else
+        _mm_storeu_si128((__m128i*)dst, v);
+}
+
+template<int width>
+void intra_pred_dc(pixel* dst, intptr_t dstStride, pixel* left, pixel* above, int /*dirMode*/, int bFilter)
+{
+    above += 1;
+    left += 1;
+
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sum;
+
+    if (width == 4)
+    {
+        __m128i v = _mm_unpacklo_epi32(_mm_cvtsi32_si128(*(int32_t*)above), _mm_cvtsi32_si128(*(int32_t*)left));
+        sum = _mm_sad_epu8(v, zero);
+    }
+    else if (width == 8)
+    {
+        __m128i v = _mm_unpacklo_epi64(_mm_loadl_epi64((__m128i*)above), _mm_loadl_epi64((__m128i*)left));
+        sum = _mm_sad_epu8(v, zero);
+    }
+    else
+    {
+        sum = zero;
+        for (int i = 0; i < width; i += 16)
+        {
+            sum = _mm_add_epi64(sum, _mm_sad_epu8(_mm_loadu_si128((__m128i*)(above + i)), zero));
+            sum = _mm_add_epi64(sum, _mm_sad_epu8(_mm_loadu_si128((__m128i*)(left + i)), zero));
+        }
+    }
+
+    sum = _mm_add_epi64(sum, _mm_unpackhi_epi64(sum, sum));
+    pixel dcval = (pixel)((_mm_cvtsi128_si32(sum) + width) / (width + width));
+
+    const __m128i dc = _mm_set1_epi8((char)dcval);
+    for (int k = 0; k < width; k++)
+    {
+        for (int l = 0; l < width; l += 16)
+        {
+            storeRow<width < 16 ? width : 16>(dst + k * dstStride + l, dc);
+        }
+    }
+
+    if (bFilter)
+    {
+        // boundary pixels processing
+        dst[0] = (pixel)((above[0] + left[0] + 2 * dst[0] + 2) >> 2);
+
+        for (int x = 1; x < width; x++)
+        {
+            dst[x] = (pixel)((above[x] +  3 * dcval + 2) >> 2);
+        }
+
+        for (int y = 1; y < width; y++)
+        {
+            dst[y * dstStride] = (pixel)((left[y] + 3 * dcval + 2) >> 2);
+        }
+    }
+}
+
+/* every sample is ((w - 1 - x) * left[y] + (x + 1) * topRight +
+ * (w - 1 - y) * above[x] + (y + 1) * bottomLeft + w) >> (log2(w) + 1), which
+ * is what the incremental form in planad_pred_c sums to. Eight samples of a
+ * row per step in 16 bit lanes */
+template<int width>
+void intra_pred_planar(pixel* dst, intptr_t dstStride, pixel* left, pixel* above, int /*dirMode*/, int /*bFilter*/)
+{
+    above += 1;
+    left += 1;
+
+    const int shift = g_convertToBit[width] + 3;
+    const int step = width < 8 ? width : 8;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i topRight = _mm_set1_epi16(above[width]);
+    const __m128i bottomLeft = _mm_set1_epi16(left[width]);
+
+    __m128i aboveRow[width / step];
+    __m128i colConst[width / step];
+    __m128i leftWeight[width / step];
+
+    for (int l = 0; l < width; l += step)
+    {
+        __m128i x1 = _mm_add_epi16(_mm_set_epi16(8, 7, 6, 5, 4, 3, 2, 1), _mm_set1_epi16((int16_t)l));
+        aboveRow[l / step] = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)(above + l)), zero);
+        colConst[l / step] = _mm_add_epi16(_mm_mullo_epi16(x1, topRight), _mm_set1_epi16(width));
+        leftWeight[l / step] = _mm_sub_epi16(_mm_set1_epi16(width), x1);
+    }
+
+    for (int k = 0; k < width; k++)
+    {
+        const __m128i leftK = _mm_set1_epi16(left[k]);
+        const __m128i rowConst = _mm_mullo_epi16(_mm_set1_epi16((int16_t)(k + 1)), bottomLeft);
+        const __m128i aboveWeight = _mm_set1_epi16((int16_t)(width - 1 - k));
+
+        for (int l = 0; l < width; l += step)
+        {
+            __m128i v = _mm_add_epi16(colConst[l / step], rowConst);
+            v = _mm_add_epi16(v, _mm_mullo_epi16(leftWeight[l / step], leftK));
+            v = _mm_add_epi16(v, _mm_mullo_epi16(aboveRow[l / step], aboveWeight));
+            v = _mm_srli_epi16(v, shift);
+            storeRow<width < 8 ? width : 8>(dst + k * dstStride + l, _mm_packus_epi16(v, v));
+        }
+    }
+}
+
+/* rows of an angular prediction before the flip of horizontal modes; refMain
+ * must be readable 16 bytes past the last sample of each row */
+template<int width>
+void predAngRows(pixel* dst, intptr_t dstStride, const pixel* refMain, int intraPredAngle)
+{
+    if (width == 4)
+    {
+        /* all four rows in one register, an integer position is the weight pair (32, 0) */
+        __m128i pairs[4], coef[4];
+        int deltaPos = 0;
+        for (int k = 0; k < 4; k++)
+        {
+            deltaPos += intraPredAngle;
+            const int deltaFract = deltaPos & (32 - 1);
+            __m128i v = _mm_loadl_epi64((__m128i*)(refMain + (deltaPos >> 5) + 1));
+            pairs[k] = _mm_unpacklo_epi8(v, _mm_srli_si128(v, 1));
+            coef[k] = _mm_set1_epi16((int16_t)((deltaFract << 8) | (32 - deltaFract)));
+        }
+
+        const __m128i rnd = _mm_set1_epi16(16);
+        __m128i lo = _mm_maddubs_epi16(_mm_unpacklo_epi64(pairs[0], pairs[1]), _mm_unpacklo_epi64(coef[0], coef[1]));
+        __m128i hi = _mm_maddubs_epi16(_mm_unpacklo_epi64(pairs[2], pairs[3]), _mm_unpacklo_epi64(coef[2], coef[3]));
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, rnd), 5);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, rnd), 5);
+        __m128i out = _mm_packus_epi16(lo, hi);
+
+        *(uint32_t*)(dst) = (uint32_t)_mm_cvtsi128_si32(out);
+        *(uint32_t*)(dst + dstStride) = (uint32_t)_mm_extract_epi32(out, 1);
+        *(uint32_t*)(dst + 2 * dstStride) = (uint32_t)_mm_extract_epi32(out, 2);
+        *(uint32_t*)(dst + 3 * dstStride) = (uint32_t)_mm_extract_epi32(out, 3);
+        return;
+    }
+
+    const int step = width < 16 ? width : 16;
+    const __m128i rnd = _mm_set1_epi16(16);
+    int deltaPos = 0;
+
+    for (int k = 0; k < width; k++)
+    {
+        deltaPos += intraPredAngle;
+        const pixel* ref = refMain + (deltaPos >> 5) + 1;
+        const int deltaFract = deltaPos & (32 - 1);
+        pixel* row = dst + k * dstStride;
+
+        if (deltaFract)
+        {
+            // weights (32 - f, f) against each interleaved pair ref[l], ref[l + 1]
+            const __m128i coef = _mm_set1_epi16((int16_t)((deltaFract << 8) | (32 - deltaFract)));
+            for (int l = 0; l < width; l += step)
+            {
+                __m128i a = _mm_loadu_si128((__m128i*)(ref + l));
+                __m128i b = _mm_loadu_si128((__m128i*)(ref + l + 1));
+                __m128i lo = _mm_maddubs_epi16(_mm_unpacklo_epi8(a, b), coef);
+                __m128i hi = _mm_maddubs_epi16(_mm_unpackhi_epi8(a, b), coef);
+                lo = _mm_srli_epi16(_mm_add_epi16(lo, rnd), 5);
+                hi = _mm_srli_epi16(_mm_add_epi16(hi, rnd), 5);
+                storeRow<step>(row + l, _mm_packus_epi16(lo, hi));
+            }
+        }
+        else
+        {
+            for (int l = 0; l < width; l += step)
+            {
+                storeRow<step>(row + l, _mm_loadu_si128((__m128i*)(ref + l)));
+            }
+        }
+    }
+}
+
+/* builds the main reference of the mode in refBuf, including the projection
+ * of the side reference for negative angles, and predicts the block unflipped.
+ * Unlike intra_pred_ang_c the caller's reference buffers are left untouched */
+template<int width>
+void predAngUnflipped(pixel* dst, intptr_t dstStride, pixel *refLeft, pixel *refAbove, int dirMode, int bFilter)
+{
+    static const int angTable[9]    = { 0,    2,    5,   9,  13,  17,  21,  26,  32 };
+    static const int invAngTable[9] = { 0, 4096, 1638, 910, 630, 482, 390, 315, 256 }; // (256 * 32) / Angle
+
+    const bool modeHor = (dirMode < 18);
+    int intraPredAngle = modeHor ? HOR_IDX - dirMode : dirMode - VER_IDX;
+    const int absAng   = abs(intraPredAngle);
+    const int invAngle = invAngTable[absAng];
+    intraPredAngle = intraPredAngle < 0 ? -angTable[absAng] : angTable[absAng];
+
+    const pixel* refMain = modeHor ? refLeft : refAbove;
+    const pixel* refSide = modeHor ? refAbove : refLeft;
+
+    if (intraPredAngle)
+    {
+        ALIGN_VAR_16(pixel, refBuf[32 + 2 * 32 + 1 + 32]);
+        pixel* ref = refBuf + 32;
+
+        memcpy(ref, refMain, 2 * width + 1);
+        memset(ref + 2 * width + 1, ref[2 * width], 32 - 1);
+
+        if (intraPredAngle < 0)
+        {
+            int invAngleSum = 128; // rounding for (shift by 8)
+            for (int k = -1; k > width * intraPredAngle >> 5; k--)
+            {
+                invAngleSum += invAngle;
+                ref[k] = refSide[invAngleSum >> 8];
+            }
+        }
+
+        predAngRows<width>(dst, dstStride, ref, intraPredAngle);
+    }
+    else
+    {
+        // pure vertical rows only read refMain[1..width]
+        predAngRows<width>(dst, dstStride, refMain, 0);
+    }
+
+    if (intraPredAngle == 0 && bFilter)
+    {
+        for (int k = 0; k < width; k++)
+        {
+            dst[k * dstStride] = (pixel)Clip3((int16_t)0, (int16_t)((1 << X265_DEPTH) - 1), static_cast<int16_t>((dst[k * dstStride]) + ((refSide[k + 1] - refSide[0]) >> 1)));
+        }
+    }
+}
+
+/* 16x16 byte transpose in four rounds of unpacks of doubling width. After the
+ * last round vector v holds the column whose index is v bit reversed */
+void transpose16x16(pixel* dst, intptr_t dstStride, const pixel* src, intptr_t srcStride)
+{
+    static const int bitrev[16] = { 0, 8, 4, 12, 2, 10, 6, 14, 1, 9, 5, 13, 3, 11, 7, 15 };
+    __m128i a[16], b[16];
+
+    for (int i = 0; i < 16; i++)
+    {
+        a[i] = _mm_loadu_si128((__m128i*)(src + i * srcStride));
+    }
+
+    for (int i = 0; i < 8; i++)
+    {
+        b[i]     = _mm_unpacklo_epi8(a[2 * i], a[2 * i + 1]);
+        b[i + 8] = _mm_unpackhi_epi8(a[2 * i], a[2 * i + 1]);
+    }
+
+    for (int i = 0; i < 8; i++)
+    {
+        a[i]     = _mm_unpacklo_epi16(b[2 * i], b[2 * i + 1]);
+        a[i + 8] = _mm_unpackhi_epi16(b[2 * i], b[2 * i + 1]);
+    }
+
+    for (int i = 0; i < 8; i++)
+    {
+        b[i]     = _mm_unpacklo_epi32(a[2 * i], a[2 * i + 1]);
+        b[i + 8] = _mm_unpackhi_epi32(a[2 * i], a[2 * i + 1]);
+    }
+
+    for (int i = 0; i < 8; i++)
+    {
+        a[i]     = _mm_unpacklo_epi64(b[2 * i], b[2 * i + 1]);
+        a[i + 8] = _mm_unpackhi_epi64(b[2 * i], b[2 * i + 1]);
+    }
+
+    for (int i = 0; i < 16; i++)
+    {
+        _mm_storeu_si128((__m128i*)(dst + bitrev[i] * dstStride), a[i]);
+    }
+}
+
+template<int width>
+void transposeBlock(pixel* dst, intptr_t dstStride, const pixel* src, intptr_t srcStride)
+{
+    if (width < 16)
+    {
+        for (int k = 0; k < width; k++)
+        {
+            for (int l = 0; l < width; l++)
+            {
+                dst[l * dstStride + k] = src[k * srcStride + l];
+            }
+        }
+    }
+    else
+    {
+        for (int y = 0; y < width; y += 16)
+        {
+            for (int x = 0; x < width; x += 16)
+            {
+                transpose16x16(dst + x * dstStride + y, dstStride, src + y * srcStride + x, srcStride);
+            }
+        }
+    }
+}
+
+template<int width>
+void intra_pred_ang(pixel* dst, intptr_t dstStride, pixel *refLeft, pixel *refAbove, int dirMode, int bFilter)
+{
+    if (dirMode == HOR_IDX)
+    {
+        for (int k = 0; k < width; k++)
+        {
+            memset(dst + k * dstStride, refLeft[k + 1], width);
+        }
+
+        if (bFilter)
+        {
+            for (int l = 0; l < width; l++)
+            {
+                dst[l] = (pixel)Clip3((int16_t)0, (int16_t)((1 << X265_DEPTH) - 1), static_cast<int16_t>(dst[l] + ((refAbove[l + 1] - refAbove[0]) >> 1)));
+            }
+        }
+    }
+    else if (dirMode < 18)
+    {
+        ALIGN_VAR_16(pixel, tmp[width * width]);
+        predAngUnflipped<width>(tmp, width, refLeft, refAbove, dirMode, bFilter);
+        transposeBlock<width>(dst, dstStride, tmp, width);
+    }
+    else
+    {
+        predAngUnflipped<width>(dst, dstStride, refLeft, refAbove, dirMode, bFilter);
+    }
+}
+
+template<int size>
+void all_angs_pred(pixel *dest, pixel *above0, pixel *left0, pixel *above1, pixel *left1, int bLuma)
+{
+    for (int mode = 2; mode <= 34; mode++)
+    {
+        bool bFiltered = IntraFilterType[(int)g_convertToBit[size]][mode] != 0;
+        pixel *left = bFiltered ? left1 : left0;
+        pixel *above = bFiltered ? above1 : above0;
+
+        // horizontal modes are left transposed, as all_angs_pred_c does
+        predAngUnflipped<size>(dest + (mode - 2) * (size * size), size, left, above, mode, bLuma);
+    }
+}
+#endif // if !HIGH_BIT_DEPTH
+}
+
+namespace x265 {
+void Setup_Vec_IPredPrimitives_sse41(EncoderPrimitives& p)
+{
+#if !HIGH_BIT_DEPTH
+    p.intra_pred[BLOCK_4x4][0] = intra_pred_planar<4>;
+    p.intra_pred[BLOCK_8x8][0] = intra_pred_planar<8>;
+    p.intra_pred[BLOCK_16x16][0] = intra_pred_planar<16>;
+    p.intra_pred[BLOCK_32x32][0] = intra_pred_planar<32>;
+
+    p.intra_pred[BLOCK_4x4][1] = intra_pred_dc<4>;
+    p.intra_pred[BLOCK_8x8][1] = intra_pred_dc<8>;
+    p.intra_pred[BLOCK_16x16][1] = intra_pred_dc<16>;
+    p.intra_pred[BLOCK_32x32][1] = intra_pred_dc<32>;
+
+    for (int i = 2; i < NUM_INTRA_MODE; i++)
+    {
+        p.intra_pred[BLOCK_4x4][i] = intra_pred_ang<4>;
+        p.intra_pred[BLOCK_8x8][i] = intra_pred_ang<8>;
+        p.intra_pred[BLOCK_16x16][i] = intra_pred_ang<16>;
+        p.intra_pred[BLOCK_32x32][i] = intra_pred_ang<32>;
+    }
+
+    p.intra_pred_allangs[BLOCK_4x4] = all_angs_pred<4>;
+    p.intra_pred_allangs[BLOCK_8x8] = all_angs_pred<8>;
+    p.intra_pred_allangs[BLOCK_16x16] = all_angs_pred<16>;
+    p.intra_pred_allangs[BLOCK_32x32] = all_angs_pred<32>;
+#endif
+}
+}
@@ -0,0 +1,286 @@
+/*****************************************************************************
+ * Copyright (C) 2013 x265 project
+ *
+ * Authors: Steve Borho <steve@borho.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "primitives.h"
+#include "TLibCommon/TComRom.h"
+#include <xmmintrin.h> // SSE
+#include <smmintrin.h> // SSE4.1
+
+using namespace x265;
+
+namespace {
+#if !HIGH_BIT_DEPTH
+
+/* Horizontal 8-tap luma filter of 'rows' rows into 16bit intermediates, the
+ * same values as interp_horiz_ps_c.  Sums of 8bit pixels and luma taps fit
+ * in 16 bits, so the whole filter runs in 16bit lanes */
+template<int width>
+void filterRowsHorizontal(pixel *src, intptr_t srcStride, int16_t *dst, int rows, int coeffIdx)
+{
+    const __m128i offset = _mm_set1_epi16(-IF_INTERNAL_OFFS);
+
+    if (!coeffIdx)
+    {
+        for (int row = 0; row < rows; row++)
+        {
+            int x = 0;
+            for (; x + 8 <= width; x += 8)
+            {
+                __m128i v = _mm_cvtepu8_epi16(_mm_loadl_epi64((__m128i const*)(src + x)));
+                v = _mm_add_epi16(_mm_slli_epi16(v, IF_INTERNAL_PREC - X265_DEPTH), offset);
+                _mm_storeu_si128((__m128i*)(dst + x), v);
+            }
+
+            if (width & 4)
+            {
+                __m128i v = _mm_cvtepu8_epi16(_mm_cvtsi32_si128(*(int32_t*)(src + x)));
+                v = _mm_add_epi16(_mm_slli_epi16(v, IF_INTERNAL_PREC - X265_DEPTH), offset);
+                _mm_storel_epi64((__m128i*)(dst + x), v);
+            }
+
+            src += srcStride;
+            dst += width;
+        }
+
+        return;
+    }
+
+    const int16_t *coeff = g_lumaFilter[coeffIdx];
+    const __m128i c0 = _mm_set1_epi16(coeff[0]);
+    const __m128i c1 = _mm_set1_epi16(coeff[1]);
+    const __m128i c2 = _mm_set1_epi16(coeff[2]);
+    const __m128i c3 = _mm_set1_epi16(coeff[3]);
+    const __m128i c4 = _mm_set1_epi16(coeff[4]);
+    const __m128i c5 = _mm_set1_epi16(coeff[5]);
+    const __m128i c6 = _mm_set1_epi16(coeff[6]);
+    const __m128i c7 = _mm_set1_epi16(coeff[7]);
+
+#define TAP(k, ck) _mm_mullo_epi16(_mm_cvtepu8_epi16(_mm_loadl_epi64((__m128i const*)(s + k))), ck)
+
+    src -= NTAPS_LUMA / 2 - 1;
+    for (int row = 0; row < rows; row++)
+    {
+        for (int x = 0; x < width; x += 8)
+        {
+            pixel *s = src + x;
+            __m128i sum = _mm_add_epi16(TAP(0, c0), TAP(1, c1));
+            sum = _mm_add_epi16(sum, _mm_add_epi16(TAP(2, c2), TAP(3, c3)));
+            sum = _mm_add_epi16(sum, _mm_add_epi16(TAP(4, c4), TAP(5, c5)));
+            sum = _mm_add_epi16(sum, _mm_add_epi16(TAP(6, c6), TAP(7, c7)));
+            sum = _mm_add_epi16(sum, offset);
+
+            if (x + 8 <= width)
+                _mm_storeu_si128((__m128i*)(dst + x), sum);
+            else
+                _mm_storel_epi64((__m128i*)(dst + x), sum);
+        }
+
+        src += srcStride;
+        dst += width;
+    }
+
+#undef TAP
+}
+
+/* Vertical 8-tap luma filter of 16bit intermediates back to pixels, the same
+ * values as interp_vert_sp_c.  For yFrac == 0 the filter degenerates to a
+ * rounding shift */
+template<int width, int height>
+void filterVertical_sp(int16_t *src, pixel *dst, int coeffIdx)
+{
+    if (!coeffIdx)
+    {
+        const __m128i round = _mm_set1_epi16(IF_INTERNAL_OFFS + (1 << (IF_INTERNAL_PREC - X265_DEPTH - 1)));
+
+        for (int row = 0; row < height; row++)
+        {
+            int x = 0;
+            for (; x + 8 <= width; x += 8)
+            {
+                __m128i v = _mm_loadu_si128((__m128i const*)(src + x));
+                v = _mm_srai_epi16(_mm_add_epi16(v, round), IF_INTERNAL_PREC - X265_DEPTH);
+                _mm_storel_epi64((__m128i*)(dst + x), _mm_packus_epi16(v, v));
+            }
+
+            if (width & 4)
+            {
+                __m128i v = _mm_loadl_epi64((__m128i const*)(src + x));
+                v = _mm_srai_epi16(_mm_add_epi16(v, round), IF_INTERNAL_PREC - X265_DEPTH);
+                *(int32_t*)(dst + x) = _mm_cvtsi128_si32(_mm_packus_epi16(v, v));
+            }
+
+            src += width;
+            dst += FENC_STRIDE;
+        }
+
+        return;
+    }
+
+    const int16_t *coeff = g_lumaFilter[coeffIdx];
+    const int shift = IF_FILTER_PREC + IF_INTERNAL_PREC - X265_DEPTH;
+    const __m128i offset = _mm_set1_epi32((1 << (shift - 1)) + (IF_INTERNAL_OFFS << IF_FILTER_PREC));
+    const __m128i c01 = _mm_set1_epi32((coeff[1] << 16) | (uint16_t)coeff[0]);
+    const __m128i c23 = _mm_set1_epi32((coeff[3] << 16) | (uint16_t)coeff[2]);
+    const __m128i c45 = _mm_set1_epi32((coeff[5] << 16) | (uint16_t)coeff[4]);
+    const __m128i c67 = _mm_set1_epi32((coeff[7] << 16) | (uint16_t)coeff[6]);
+
+    src -= (NTAPS_LUMA / 2 - 1) * width;
+    for (int row = 0; row < height; row++)
+    {
+        for (int x = 0; x < width; x += 8)
+        {
+            int16_t *s = src + x;
+            __m128i r0 = _mm_loadu_si128((__m128i const*)(s + 0 * width));
+            __m128i r1 = _mm_loadu_si128((__m128i const*)(s + 1 * width));
+            __m128i r2 = _mm_loadu_si128((__m128i const*)(s + 2 * width));
+            __m128i r3 = _mm_loadu_si128((__m128i const*)(s + 3 * width));
+            __m128i r4 = _mm_loadu_si128((__m128i const*)(s + 4 * width));
+            __m128i r5 = _mm_loadu_si128((__m128i const*)(s + 5 * width));
+            __m128i r6 = _mm_loadu_si128((__m128i const*)(s + 6 * width));
+            __m128i r7 = _mm_loadu_si128((__m128i const*)(s + 7 * width));
+
+            __m128i lo = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(r0, r1), c01),
+                                       _mm_madd_epi16(_mm_unpacklo_epi16(r2, r3), c23));
+            lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(r4, r5), c45));
+            lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(r6, r7), c67));
+            lo = _mm_srai_epi32(_mm_add_epi32(lo, offset), shift);
+
+            __m128i hi = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(r0, r1), c01),
+                                       _mm_madd_epi16(_mm_unpackhi_epi16(r2, r3), c23));
+            hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(r4, r5), c45));
+            hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(r6, r7), c67));
+            hi = _mm_srai_epi32(_mm_add_epi32(hi, offset), shift);
+
+            __m128i v = _mm_packs_epi32(lo, hi);
+            v = _mm_packus_epi16(v, v);
+
+            if (x + 8 <= width)
+                _mm_storel_epi64((__m128i*)(dst + x), v);
+            else
+                *(int32_t*)(dst + x) = _mm_cvtsi128_si32(v);
+        }
+
+        src += width;
+        dst += FENC_STRIDE;
+    }
+}
+
+/* Candidates are grouped by their horizontal qpel offset so that each column
+ * is filtered horizontally once, covering the rows of every candidate in the
+ * column, and each candidate then only needs its own vertical pass */
+template<int dirs, int width, int height>
+void subpel_cmp(pixel *fenc, pixel *fref, intptr_t frefStride, int qmvx, int qmvy, int step, pixelcmp_t cmp, int32_t *res)
+{
+    X265_CHECK(step == 1 || step == 2, "subpel_cmp step out of range\n");
+
+    ALIGN_VAR_32(int16_t, immed[64 * (64 + NTAPS_LUMA)]);
+    ALIGN_VAR_32(pixel, subpelbuf[64 * 64]);
+
+    for (int col = -1; col <= 1; col++)
+    {
+        int mx = qmvx + col * step;
+        int xFrac = mx & 3;
+        int rowLo = INT_MAX, rowHi = INT_MIN;
+        bool bNeedFilter = false;
+
+        for (int i = 0; i < dirs; i++)
+        {
+            if (g_subpelNeighbours[i][0] != col)
+                continue;
+
+            int my = qmvy + g_subpelNeighbours[i][1] * step;
+            rowLo = X265_MIN(rowLo, my >> 2);
+            rowHi = X265_MAX(rowHi, my >> 2);
+            bNeedFilter |= !!(xFrac | (my & 3));
+        }
+
+        if (rowLo > rowHi)
+            continue;
+
+        pixel *src = fref + (mx >> 2);
+        rowLo -= NTAPS_LUMA / 2 - 1;
+        if (bNeedFilter)
+            filterRowsHorizontal<width>(src + rowLo * frefStride, frefStride, immed,
+                                        rowHi - rowLo + height + NTAPS_LUMA / 2, xFrac);
+
+        for (int i = 0; i < dirs; i++)
+        {
+            if (g_subpelNeighbours[i][0] != col)
+                continue;
+
+            int my = qmvy + g_subpelNeighbours[i][1] * step;
+            int yFrac = my & 3;
+
+            if (!(xFrac | yFrac))
+                res[i] = cmp(fenc, FENC_STRIDE, src + (my >> 2) * frefStride, frefStride);
+            else
+            {
+                filterVertical_sp<width, height>(immed + ((my >> 2) - rowLo) * width, subpelbuf, yFrac);
+                res[i] = cmp(fenc, FENC_STRIDE, subpelbuf, FENC_STRIDE);
+            }
+        }
+    }
+}
+
+#endif // if !HIGH_BIT_DEPTH
+}
+
+namespace x265 {
+void Setup_Vec_IPFilterPrimitives_sse41(EncoderPrimitives& p)
+{
+#if HIGH_BIT_DEPTH
+    (void)p;
+#else
+#define SETUP_SUBPEL(W, H) \
+    p.luma_subpel_x4[LUMA_ ## W ## x ## H] = subpel_cmp<4, W, H>; \
+    p.luma_subpel_x8[LUMA_ ## W ## x ## H] = subpel_cmp<8, W, H>;
+
+    SETUP_SUBPEL(4, 4);
+    SETUP_SUBPEL(8, 8);
+    SETUP_SUBPEL(8, 4);
+    SETUP_SUBPEL(4, 8);
+    SETUP_SUBPEL(16, 16);
+    SETUP_SUBPEL(16, 8);
+    SETUP_SUBPEL(8, 16);
+    SETUP_SUBPEL(16, 12);
+    SETUP_SUBPEL(12, 16);
+    SETUP_SUBPEL(16, 4);
+    SETUP_SUBPEL(4, 16);
+    SETUP_SUBPEL(32, 32);
+    SETUP_SUBPEL(32, 16);
+    SETUP_SUBPEL(16, 32);
+    SETUP_SUBPEL(32, 24);
+    SETUP_SUBPEL(24, 32);
+    SETUP_SUBPEL(32, 8);
+    SETUP_SUBPEL(8, 32);
+    SETUP_SUBPEL(64, 64);
+    SETUP_SUBPEL(64, 32);
+    SETUP_SUBPEL(32, 64);
+    SETUP_SUBPEL(64, 48);
+    SETUP_SUBPEL(48, 64);
+    SETUP_SUBPEL(64, 16);
+    SETUP_SUBPEL(16, 64);
+#undef SETUP_SUBPEL
+#endif // if HIGH_BIT_DEPTH
+}
+}
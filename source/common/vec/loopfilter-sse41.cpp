@@ -0,0 +1,571 @@
+/*****************************************************************************
+ * Copyright (C) 2013 x265 project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "primitives.h"
+#include <string.h>
+#include <xmmintrin.h> // SSE
+#include <pmmintrin.h> // SSE3
+#include <tmmintrin.h> // SSSE3
+#include <smmintrin.h> // SSE4.1
+
+using namespace x265;
+
+namespace {
+#if !HIGH_BIT_DEPTH
+inline __m128i clamp(__m128i v, __m128i lo, __m128i hi)
+{
+    return _mm_min_epi16(_mm_max_epi16(v, lo), hi);
+}
+
+/* value of the first and last line of each 4 line segment, broadcast to the
+ * lines of the segment */
+inline __m128i firstLine(__m128i v)
+{
+    return _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0x00), 0x00);
+}
+
+inline __m128i lastLine(__m128i v)
+{
+    return _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xFF), 0xFF);
+}
+
+inline __m128i avgRound(__m128i a, __m128i b, __m128i one)
+{
+    return _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(a, b), one), 1);
+}
+
+inline void transpose8x8(__m128i *d)
+{
+    __m128i a0 = _mm_unpacklo_epi16(d[0], d[1]);
+    __m128i a1 = _mm_unpackhi_epi16(d[0], d[1]);
+    __m128i a2 = _mm_unpacklo_epi16(d[2], d[3]);
+    __m128i a3 = _mm_unpackhi_epi16(d[2], d[3]);
+    __m128i a4 = _mm_unpacklo_epi16(d[4], d[5]);
+    __m128i a5 = _mm_unpackhi_epi16(d[4], d[5]);
+    __m128i a6 = _mm_unpacklo_epi16(d[6], d[7]);
+    __m128i a7 = _mm_unpackhi_epi16(d[6], d[7]);
+
+    __m128i b0 = _mm_unpacklo_epi32(a0, a2);
+    __m128i b1 = _mm_unpackhi_epi32(a0, a2);
+    __m128i b2 = _mm_unpacklo_epi32(a1, a3);
+    __m128i b3 = _mm_unpackhi_epi32(a1, a3);
+    __m128i b4 = _mm_unpacklo_epi32(a4, a6);
+    __m128i b5 = _mm_unpackhi_epi32(a4, a6);
+    __m128i b6 = _mm_unpacklo_epi32(a5, a7);
+    __m128i b7 = _mm_unpackhi_epi32(a5, a7);
+
+    d[0] = _mm_unpacklo_epi64(b0, b4);
+    d[1] = _mm_unpackhi_epi64(b0, b4);
+    d[2] = _mm_unpacklo_epi64(b1, b5);
+    d[3] = _mm_unpackhi_epi64(b1, b5);
+    d[4] = _mm_unpacklo_epi64(b2, b6);
+    d[5] = _mm_unpackhi_epi64(b2, b6);
+    d[6] = _mm_unpacklo_epi64(b3, b7);
+    d[7] = _mm_unpackhi_epi64(b3, b7);
+}
+
+/* Luma filter of two 4 line segments, one line per 16 bit lane. m[0..7] hold
+ * P3 P2 P1 P0 Q0 Q1 Q2 Q3, m[1..6] are filtered in place. Decisions of
+ * deblockLuma_c: on/off and strong/weak per segment from its first and last
+ * lines, the weak filter threshold per line */
+inline void filterLuma8(__m128i *m, __m128i tc, __m128i beta)
+{
+    const __m128i p3 = m[0], p2 = m[1], p1 = m[2], p0 = m[3];
+    const __m128i q0 = m[4], q1 = m[5], q2 = m[6], q3 = m[7];
+
+    __m128i dp = _mm_abs_epi16(_mm_add_epi16(_mm_sub_epi16(p2, _mm_add_epi16(p1, p1)), p0));
+    __m128i dq = _mm_abs_epi16(_mm_add_epi16(_mm_sub_epi16(q2, _mm_add_epi16(q1, q1)), q0));
+    __m128i dpSeg = _mm_add_epi16(firstLine(dp), lastLine(dp));
+    __m128i dqSeg = _mm_add_epi16(firstLine(dq), lastLine(dq));
+
+    __m128i filterOn = _mm_cmpgt_epi16(beta, _mm_add_epi16(dpSeg, dqSeg));
+    if (_mm_testz_si128(filterOn, filterOn))
+        return;
+
+    __m128i sideThreshold = _mm_srai_epi16(_mm_add_epi16(beta, _mm_srai_epi16(beta, 1)), 3);
+    __m128i filterP = _mm_cmpgt_epi16(sideThreshold, dpSeg);
+    __m128i filterQ = _mm_cmpgt_epi16(sideThreshold, dqSeg);
+
+    /* strong filter decision of each line, then of each segment */
+    __m128i dStrong = _mm_add_epi16(_mm_abs_epi16(_mm_sub_epi16(p3, p0)), _mm_abs_epi16(_mm_sub_epi16(q3, q0)));
+    __m128i dLine = _mm_add_epi16(dp, dq);
+    __m128i strong = _mm_cmpgt_epi16(_mm_srai_epi16(beta, 3), dStrong);
+    strong = _mm_and_si128(strong, _mm_cmpgt_epi16(_mm_srai_epi16(beta, 2), _mm_add_epi16(dLine, dLine)));
+    __m128i tc5 = _mm_srai_epi16(_mm_add_epi16(_mm_mullo_epi16(tc, _mm_set1_epi16(5)), _mm_set1_epi16(1)), 1);
+    strong = _mm_and_si128(strong, _mm_cmpgt_epi16(tc5, _mm_abs_epi16(_mm_sub_epi16(p0, q0))));
+    strong = _mm_and_si128(firstLine(strong), lastLine(strong));
+
+    const __m128i maskS = _mm_and_si128(filterOn, strong);
+    const __m128i four = _mm_set1_epi16(4);
+    const __m128i two = _mm_set1_epi16(2);
+
+    /* strong filter */
+    __m128i tc2 = _mm_add_epi16(tc, tc);
+    __m128i sumP = _mm_add_epi16(_mm_add_epi16(p1, p0), q0);
+    __m128i sumQ = _mm_add_epi16(_mm_add_epi16(q1, q0), p0);
+    __m128i p0s = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(_mm_add_epi16(sumP, sumP), _mm_add_epi16(p2, q1)), four), 3);
+    __m128i q0s = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(_mm_add_epi16(sumQ, sumQ), _mm_add_epi16(q2, p1)), four), 3);
+    __m128i p1s = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(sumP, p2), two), 2);
+    __m128i q1s = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(sumQ, q2), two), 2);
+    __m128i p2s = _mm_add_epi16(_mm_add_epi16(p3, p3), _mm_add_epi16(_mm_add_epi16(p2, p2), p2));
+    p2s = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(p2s, _mm_add_epi16(p1, p0)), _mm_add_epi16(q0, four)), 3);
+    __m128i q2s = _mm_add_epi16(_mm_add_epi16(q3, q3), _mm_add_epi16(_mm_add_epi16(q2, q2), q2));
+    q2s = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(q2s, _mm_add_epi16(q1, q0)), _mm_add_epi16(p0, four)), 3);
+
+    p0s = clamp(p0s, _mm_sub_epi16(p0, tc2), _mm_add_epi16(p0, tc2));
+    q0s = clamp(q0s, _mm_sub_epi16(q0, tc2), _mm_add_epi16(q0, tc2));
+    p1s = clamp(p1s, _mm_sub_epi16(p1, tc2), _mm_add_epi16(p1, tc2));
+    q1s = clamp(q1s, _mm_sub_epi16(q1, tc2), _mm_add_epi16(q1, tc2));
+    p2s = clamp(p2s, _mm_sub_epi16(p2, tc2), _mm_add_epi16(p2, tc2));
+    q2s = clamp(q2s, _mm_sub_epi16(q2, tc2), _mm_add_epi16(q2, tc2));
+
+    /* weak filter, results are clipped to the pixel range when packed */
+    __m128i delta = _mm_sub_epi16(_mm_mullo_epi16(_mm_sub_epi16(q0, p0), _mm_set1_epi16(9)),
+                                  _mm_mullo_epi16(_mm_sub_epi16(q1, p1), _mm_set1_epi16(3)));
+    delta = _mm_srai_epi16(_mm_add_epi16(delta, _mm_set1_epi16(8)), 4);
+    __m128i tc10 = _mm_mullo_epi16(tc, _mm_set1_epi16(10));
+    __m128i maskW = _mm_andnot_si128(strong, _mm_and_si128(filterOn, _mm_cmpgt_epi16(tc10, _mm_abs_epi16(delta))));
+
+    delta = clamp(delta, _mm_sub_epi16(_mm_setzero_si128(), tc), tc);
+    __m128i tcHalf = _mm_srai_epi16(tc, 1);
+    __m128i tcHalfNeg = _mm_sub_epi16(_mm_setzero_si128(), tcHalf);
+    const __m128i one = _mm_set1_epi16(1);
+
+    __m128i p0w = _mm_add_epi16(p0, delta);
+    __m128i q0w = _mm_sub_epi16(q0, delta);
+    __m128i delta1 = _mm_srai_epi16(_mm_add_epi16(avgRound(p2, p0, one), _mm_sub_epi16(delta, p1)), 1);
+    __m128i delta2 = _mm_srai_epi16(_mm_sub_epi16(_mm_sub_epi16(avgRound(q2, q0, one), q1), delta), 1);
+    __m128i p1w = _mm_add_epi16(p1, clamp(delta1, tcHalfNeg, tcHalf));
+    __m128i q1w = _mm_add_epi16(q1, clamp(delta2, tcHalfNeg, tcHalf));
+
+    m[1] = _mm_blendv_epi8(p2, p2s, maskS);
+    m[2] = _mm_blendv_epi8(_mm_blendv_epi8(p1, p1s, maskS), p1w, _mm_and_si128(maskW, filterP));
+    m[3] = _mm_blendv_epi8(_mm_blendv_epi8(p0, p0s, maskS), p0w, maskW);
+    m[4] = _mm_blendv_epi8(_mm_blendv_epi8(q0, q0s, maskS), q0w, maskW);
+    m[5] = _mm_blendv_epi8(_mm_blendv_epi8(q1, q1s, maskS), q1w, _mm_and_si128(maskW, filterQ));
+    m[6] = _mm_blendv_epi8(q2, q2s, maskS);
+}
+
+/* tc and beta of two segments, one per four lanes */
+inline __m128i segmentPair(const int32_t* v, int numSeg)
+{
+    return _mm_unpacklo_epi64(_mm_set1_epi16((int16_t)v[0]), _mm_set1_epi16((int16_t)(numSeg > 1 ? v[1] : 0)));
+}
+
+/* vertical edge: lines are rows, a transposed 8x8 block per pair of segments */
+void deblockLumaVer(pixel* src, intptr_t stride, const int32_t* tc, const int32_t* beta, int numSeg)
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    for (int seg = 0; seg < numSeg; seg += 2, src += 8 * stride)
+    {
+        if (!(tc[seg] | (seg + 1 < numSeg ? tc[seg + 1] : 0)))
+            continue;
+
+        const int lines = seg + 1 < numSeg ? 8 : 4;
+        __m128i m[8];
+        for (int i = 0; i < 8; i++)
+        {
+            m[i] = i < lines ? _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)(src + i * stride - 4)), zero) : zero;
+        }
+
+        transpose8x8(m);
+        filterLuma8(m, segmentPair(tc + seg, numSeg - seg), segmentPair(beta + seg, numSeg - seg));
+        transpose8x8(m);
+
+        for (int i = 0; i < lines; i++)
+        {
+            _mm_storel_epi64((__m128i*)(src + i * stride - 4), _mm_packus_epi16(m[i], m[i]));
+        }
+    }
+}
+
+/* horizontal edge: lines are columns, eight of them side by side */
+void deblockLumaHor(pixel* src, intptr_t stride, const int32_t* tc, const int32_t* beta, int numSeg)
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    for (int seg = 0; seg < numSeg; seg += 2, src += 8)
+    {
+        if (!(tc[seg] | (seg + 1 < numSeg ? tc[seg + 1] : 0)))
+            continue;
+
+        const bool bPair = seg + 1 < numSeg;
+        __m128i m[8];
+        for (int i = 0; i < 8; i++)
+        {
+            pixel* row = src + (i - 4) * stride;
+            __m128i v = bPair ? _mm_loadl_epi64((__m128i*)row) : _mm_cvtsi32_si128(*(int32_t*)row);
+            m[i] = _mm_unpacklo_epi8(v, zero);
+        }
+
+        filterLuma8(m, segmentPair(tc + seg, numSeg - seg), segmentPair(beta + seg, numSeg - seg));
+
+        for (int i = 1; i < 7; i++)
+        {
+            pixel* row = src + (i - 4) * stride;
+            __m128i v = _mm_packus_epi16(m[i], m[i]);
+            if (bPair)
+                _mm_storel_epi64((__m128i*)row, v);
+            else
+                *(int32_t*)row = _mm_cvtsi128_si32(v);
+        }
+    }
+}
+
+/* chroma filter of up to eight lines, one per 16 bit lane */
+inline void filterChroma8(__m128i& p1, __m128i& p0, __m128i& q0, __m128i& q1, __m128i tc)
+{
+    __m128i delta = _mm_add_epi16(_mm_slli_epi16(_mm_sub_epi16(q0, p0), 2), _mm_sub_epi16(p1, q1));
+    delta = _mm_srai_epi16(_mm_add_epi16(delta, _mm_set1_epi16(4)), 3);
+    delta = clamp(delta, _mm_sub_epi16(_mm_setzero_si128(), tc), tc);
+    p0 = _mm_add_epi16(p0, delta);
+    q0 = _mm_sub_epi16(q0, delta);
+}
+
+/* tc of the next eight lines of a chroma edge */
+inline __m128i chromaTc(const int32_t* tc, int segLen, int line)
+{
+    ALIGN_VAR_16(int16_t, tcLine[8]);
+    for (int i = 0; i < 8; i++)
+    {
+        tcLine[i] = (int16_t)tc[(line + i) / segLen];
+    }
+
+    return _mm_load_si128((__m128i*)tcLine);
+}
+
+void deblockChromaVer(pixel* src, intptr_t stride, const int32_t* tc, int segLen, int numSeg)
+{
+    /* gathers P1 P0 Q0 Q1 of four rows into four groups of four bytes */
+    const __m128i gather = _mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+    const __m128i zero = _mm_setzero_si128();
+    const int numLines = segLen * numSeg;
+
+    for (int line = 0; line < numLines; line += 8, src += 8 * stride)
+    {
+        const int lines = numLines - line < 8 ? numLines - line : 8;
+        int32_t row[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+        for (int i = 0; i < lines; i++)
+        {
+            memcpy(&row[i], src + i * stride - 2, 4);
+        }
+
+        __m128i lo = _mm_shuffle_epi8(_mm_setr_epi32(row[0], row[1], row[2], row[3]), gather);
+        __m128i hi = _mm_shuffle_epi8(_mm_setr_epi32(row[4], row[5], row[6], row[7]), gather);
+        __m128i pp = _mm_unpacklo_epi32(lo, hi); // P1 of rows 0-7, P0 of rows 0-7
+        __m128i qq = _mm_unpackhi_epi32(lo, hi); // Q0, Q1
+        __m128i p1 = _mm_unpacklo_epi8(pp, zero);
+        __m128i p0 = _mm_unpackhi_epi8(pp, zero);
+        __m128i q0 = _mm_unpacklo_epi8(qq, zero);
+        __m128i q1 = _mm_unpackhi_epi8(qq, zero);
+
+        filterChroma8(p1, p0, q0, q1, chromaTc(tc, segLen, line));
+
+        __m128i out = _mm_unpacklo_epi8(_mm_packus_epi16(p0, p0), _mm_packus_epi16(q0, q0));
+        ALIGN_VAR_16(uint16_t, pairs[8]);
+        _mm_store_si128((__m128i*)pairs, out);
+        for (int i = 0; i < lines; i++)
+        {
+            memcpy(src + i * stride - 1, &pairs[i], 2);
+        }
+    }
+}
+
+void deblockChromaHor(pixel* src, intptr_t stride, const int32_t* tc, int segLen, int numSeg)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const int numLines = segLen * numSeg;
+
+    for (int line = 0; line < numLines; line += 8, src += 8)
+    {
+        const int lines = numLines - line < 8 ? numLines - line : 8;
+        __m128i v[4];
+        for (int i = 0; i < 4; i++)
+        {
+            if (lines == 8)
+                v[i] = _mm_loadl_epi64((__m128i*)(src + (i - 2) * stride));
+            else
+            {
+                int64_t tmp = 0;
+                memcpy(&tmp, src + (i - 2) * stride, lines);
+                v[i] = _mm_cvtsi64_si128(tmp);
+            }
+            v[i] = _mm_unpacklo_epi8(v[i], zero);
+        }
+
+        filterChroma8(v[0], v[1], v[2], v[3], chromaTc(tc, segLen, line));
+
+        __m128i p0 = _mm_packus_epi16(v[1], v[1]);
+        __m128i q0 = _mm_packus_epi16(v[2], v[2]);
+        if (lines == 8)
+        {
+            _mm_storel_epi64((__m128i*)(src - stride), p0);
+            _mm_storel_epi64((__m128i*)src, q0);
+        }
+        else
+        {
+            int64_t tmp = _mm_cvtsi128_si64(p0);
+            memcpy(src - stride, &tmp, lines);
+            tmp = _mm_cvtsi128_si64(q0);
+            memcpy(src, &tmp, lines);
+        }
+    }
+}
+inline int32_t sumEpi32(__m128i v)
+{
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(v);
+}
+
+/* SAO edge offset statistics, 16 samples at a time. Rows are read in whole
+ * 16 byte chunks, lanes past the width are forced to the "none" class with
+ * no difference. Edge types 0, 1, 3 and 4 are masked and accumulated, type 2
+ * is what is left of the total */
+template<int dir>
+void saoStatsEO(const pixel* fenc, const pixel* rec, intptr_t stride, int width, int height, int32_t* sum, int32_t* count)
+{
+    const intptr_t offset = dir == 0 ? 1 : dir == 1 ? stride : dir == 2 ? stride + 1 : stride - 1;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi16(1);
+    const __m128i bias = _mm_set1_epi8((char)0x80);
+    const __m128i tail = _mm_cmpgt_epi8(_mm_set1_epi8((char)(((width - 1) & 15) + 1)),
+                                        _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+    const __m128i edge[4] = { _mm_set1_epi8(-2), _mm_set1_epi8(-1), _mm_set1_epi8(1), _mm_set1_epi8(2) };
+
+    __m128i total = zero;
+    __m128i sums[4] = { zero, zero, zero, zero };
+    __m128i counts[4] = { zero, zero, zero, zero };
+
+    for (int y = 0; y < height; y++)
+    {
+        __m128i rowCount[4] = { zero, zero, zero, zero };
+
+        for (int x = 0; x < width; x += 16)
+        {
+            __m128i r = _mm_loadu_si128((__m128i const*)(rec + x));
+            __m128i f = _mm_loadu_si128((__m128i const*)(fenc + x));
+            __m128i a = _mm_xor_si128(_mm_loadu_si128((__m128i const*)(rec + x - offset)), bias);
+            __m128i b = _mm_xor_si128(_mm_loadu_si128((__m128i const*)(rec + x + offset)), bias);
+            __m128i rs = _mm_xor_si128(r, bias);
+
+            /* edge type - 2, in [-2, 2] */
+            __m128i type = _mm_add_epi8(_mm_sub_epi8(_mm_cmpgt_epi8(a, rs), _mm_cmpgt_epi8(rs, a)),
+                                        _mm_sub_epi8(_mm_cmpgt_epi8(b, rs), _mm_cmpgt_epi8(rs, b)));
+            if (width - x < 16)
+            {
+                type = _mm_and_si128(type, tail);
+                f = _mm_blendv_epi8(r, f, tail);
+            }
+
+            __m128i diffLo = _mm_sub_epi16(_mm_unpacklo_epi8(f, zero), _mm_unpacklo_epi8(r, zero));
+            __m128i diffHi = _mm_sub_epi16(_mm_unpackhi_epi8(f, zero), _mm_unpackhi_epi8(r, zero));
+            total = _mm_add_epi32(total, _mm_add_epi32(_mm_madd_epi16(diffLo, one), _mm_madd_epi16(diffHi, one)));
+
+            for (int i = 0; i < 4; i++)
+            {
+                __m128i mask = _mm_cmpeq_epi8(type, edge[i]);
+                __m128i maskedLo = _mm_and_si128(diffLo, _mm_unpacklo_epi8(mask, mask));
+                __m128i maskedHi = _mm_and_si128(diffHi, _mm_unpackhi_epi8(mask, mask));
+
+                rowCount[i] = _mm_sub_epi8(rowCount[i], mask);
+                sums[i] = _mm_add_epi32(sums[i], _mm_add_epi32(_mm_madd_epi16(maskedLo, one), _mm_madd_epi16(maskedHi, one)));
+            }
+        }
+
+        /* the byte counters hold at most width / 16 per row */
+        for (int i = 0; i < 4; i++)
+        {
+            counts[i] = _mm_add_epi32(counts[i], _mm_sad_epu8(rowCount[i], zero));
+        }
+
+        fenc += stride;
+        rec += stride;
+    }
+
+    static const int type[4] = { 0, 1, 3, 4 };
+    sum[2] = sumEpi32(total);
+    count[2] = width * height;
+    for (int i = 0; i < 4; i++)
+    {
+        sum[type[i]] = sumEpi32(sums[i]);
+        count[type[i]] = sumEpi32(counts[i]);
+        sum[2] -= sum[type[i]];
+        count[2] -= count[type[i]];
+    }
+}
+/* sign of a - b for unsigned bytes */
+inline __m128i signOf8(__m128i a, __m128i b)
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    return _mm_sub_epi8(_mm_cmpeq_epi8(_mm_subs_epu8(a, b), zero), _mm_cmpeq_epi8(_mm_subs_epu8(b, a), zero));
+}
+
+/* rec plus the signed byte offsets, clipped to the pixel range */
+inline __m128i addOffset(__m128i rec, __m128i offset)
+{
+    __m128i lo = _mm_add_epi16(_mm_cvtepu8_epi16(rec), _mm_cvtepi8_epi16(offset));
+    __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(rec, _mm_setzero_si128()), _mm_srai_epi16(_mm_unpackhi_epi8(offset, offset), 8));
+
+    return _mm_packus_epi16(lo, hi);
+}
+
+/* store the first n < 16 bytes of v, the bytes past the block may belong to
+ * the next CTU */
+inline void storePartial(pixel* dst, __m128i v, int n)
+{
+    ALIGN_VAR_16(pixel, tmp[16]);
+
+    _mm_store_si128((__m128i*)tmp, v);
+    memcpy(dst, tmp, n);
+}
+
+inline void storeRow(pixel* dst, __m128i v, int n)
+{
+    if (n >= 16)
+        _mm_storeu_si128((__m128i*)dst, v);
+    else
+        storePartial(dst, v, n);
+}
+
+/* same contract as the assembly version, lcuWidth is a multiple of 16 */
+void saoCuOrgE0(pixel* rec, int8_t* offsetEo, int lcuWidth, int8_t signLeft)
+{
+    const __m128i two = _mm_set1_epi8(2);
+    const __m128i table = _mm_loadl_epi64((__m128i const*)offsetEo);
+    __m128i left = _mm_slli_si128(_mm_cvtsi32_si128(signLeft), 15);
+
+    for (int x = 0; x < lcuWidth; x += 16)
+    {
+        __m128i r = _mm_loadu_si128((__m128i const*)(rec + x));
+        __m128i signRight = signOf8(r, _mm_loadu_si128((__m128i const*)(rec + x + 1)));
+        __m128i negRight = _mm_sub_epi8(_mm_setzero_si128(), signRight);
+        __m128i signL = _mm_alignr_epi8(negRight, left, 15);
+        __m128i type = _mm_add_epi8(_mm_add_epi8(signRight, signL), two);
+
+        left = negRight;
+        _mm_storeu_si128((__m128i*)(rec + x), addOffset(r, _mm_shuffle_epi8(table, type)));
+    }
+}
+
+void saoCuOrgE1(pixel* rec, int8_t* upBuff1, int8_t* offsetEo, intptr_t stride, int width)
+{
+    const __m128i two = _mm_set1_epi8(2);
+    const __m128i table = _mm_loadl_epi64((__m128i const*)offsetEo);
+
+    for (int x = 0; x < width; x += 16)
+    {
+        __m128i r = _mm_loadu_si128((__m128i const*)(rec + x));
+        __m128i signDown = signOf8(r, _mm_loadu_si128((__m128i const*)(rec + x + stride)));
+        __m128i up = _mm_loadu_si128((__m128i const*)(upBuff1 + x));
+        __m128i type = _mm_add_epi8(_mm_add_epi8(signDown, up), two);
+
+        _mm_storeu_si128((__m128i*)(upBuff1 + x), _mm_sub_epi8(_mm_setzero_si128(), signDown));
+        storeRow(rec + x, addOffset(r, _mm_shuffle_epi8(table, type)), width - x);
+    }
+}
+
+void saoCuOrgE2(pixel* rec, int8_t* bufft, int8_t* buff1, int8_t* offsetEo, int width, intptr_t stride)
+{
+    const __m128i two = _mm_set1_epi8(2);
+    const __m128i table = _mm_loadl_epi64((__m128i const*)offsetEo);
+
+    for (int x = 0; x < width; x += 16)
+    {
+        __m128i r = _mm_loadu_si128((__m128i const*)(rec + x));
+        __m128i signDown = signOf8(r, _mm_loadu_si128((__m128i const*)(rec + x + stride + 1)));
+        __m128i up = _mm_loadu_si128((__m128i const*)(buff1 + x));
+        __m128i type = _mm_add_epi8(_mm_add_epi8(signDown, up), two);
+
+        _mm_storeu_si128((__m128i*)(bufft + x + 1), _mm_sub_epi8(_mm_setzero_si128(), signDown));
+        storeRow(rec + x, addOffset(r, _mm_shuffle_epi8(table, type)), width - x);
+    }
+}
+
+/* the signs of a chunk are loaded before its shifted store, which does not
+ * reach the next chunk */
+void saoCuOrgE3(pixel* rec, int8_t* upBuff1, int8_t* offsetEo, intptr_t stride, int startX, int endX)
+{
+    const __m128i two = _mm_set1_epi8(2);
+    const __m128i table = _mm_loadl_epi64((__m128i const*)offsetEo);
+
+    for (int x = startX; x < endX; x += 16)
+    {
+        __m128i r = _mm_loadu_si128((__m128i const*)(rec + x));
+        __m128i signDown = signOf8(r, _mm_loadu_si128((__m128i const*)(rec + x + stride - 1)));
+        __m128i up = _mm_loadu_si128((__m128i const*)(upBuff1 + x));
+        __m128i type = _mm_add_epi8(_mm_add_epi8(signDown, up), two);
+
+        _mm_storeu_si128((__m128i*)(upBuff1 + x - 1), _mm_sub_epi8(_mm_setzero_si128(), signDown));
+        storeRow(rec + x, addOffset(r, _mm_shuffle_epi8(table, type)), endX - x);
+    }
+}
+
+/* the 32 band offsets are looked up as two 16 entry tables */
+void saoCuOrgB0(pixel* rec, const int8_t* offsetBo, int width, int height, intptr_t stride)
+{
+    const __m128i tableLo = _mm_loadu_si128((__m128i const*)offsetBo);
+    const __m128i tableHi = _mm_loadu_si128((__m128i const*)(offsetBo + 16));
+    const __m128i bandMask = _mm_set1_epi8(31);
+    const __m128i fifteen = _mm_set1_epi8(15);
+
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x += 16)
+        {
+            __m128i r = _mm_loadu_si128((__m128i const*)(rec + x));
+            __m128i band = _mm_and_si128(_mm_srli_epi16(r, 3), bandMask);
+            __m128i offset = _mm_blendv_epi8(_mm_shuffle_epi8(tableLo, band), _mm_shuffle_epi8(tableHi, band),
+                                             _mm_cmpgt_epi8(band, fifteen));
+
+            storeRow(rec + x, addOffset(r, offset), width - x);
+        }
+
+        rec += stride;
+    }
+}
+#endif // if !HIGH_BIT_DEPTH
+}
+
+namespace x265 {
+void Setup_Vec_LoopFilterPrimitives_sse41(EncoderPrimitives &p)
+{
+#if !HIGH_BIT_DEPTH
+    p.deblock_luma[0] = deblockLumaVer;
+    p.deblock_luma[1] = deblockLumaHor;
+    p.deblock_chroma[0] = deblockChromaVer;
+    p.deblock_chroma[1] = deblockChromaHor;
+
+    p.sao_stats_eo[0] = saoStatsEO<0>;
+    p.sao_stats_eo[1] = saoStatsEO<1>;
+    p.sao_stats_eo[2] = saoStatsEO<2>;
+    p.sao_stats_eo[3] = saoStatsEO<3>;
+
+    p.saoCuOrgE0 = saoCuOrgE0;
+    p.saoCuOrgE1 = saoCuOrgE1;
+    p.saoCuOrgE2 = saoCuOrgE2;
+    p.saoCuOrgE3 = saoCuOrgE3;
+    p.saoCuOrgB0 = saoCuOrgB0;
+#endif
+}
+}
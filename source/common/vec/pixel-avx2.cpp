@@ -0,0 +1,193 @@
+/*****************************************************************************
+ * Copyright (C) 2013 x265 project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "primitives.h"
+#include <immintrin.h> // AVX2
+
+using namespace x265;
+
+namespace {
+#if !HIGH_BIT_DEPTH
+/* sum of squared differences of a block whose width is a multiple of 16,
+ * sixteen pixels per step. A 64x64 block sums to less than 2^28 so the
+ * 32 bit lanes cannot overflow */
+template<int lx, int ly>
+int sse_pp(pixel *pix1, intptr_t stride_pix1, pixel *pix2, intptr_t stride_pix2)
+{
+    __m256i sum = _mm256_setzero_si256();
+
+    for (int y = 0; y < ly; y++)
+    {
+        for (int x = 0; x < lx; x += 16)
+        {
+            __m256i a = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i*)(pix1 + x)));
+            __m256i b = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i*)(pix2 + x)));
+            __m256i d = _mm256_sub_epi16(a, b);
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(d, d));
+        }
+
+        pix1 += stride_pix1;
+        pix2 += stride_pix2;
+    }
+
+    __m128i sum4 = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    sum4 = _mm_add_epi32(sum4, _mm_shuffle_epi32(sum4, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum4 = _mm_add_epi32(sum4, _mm_shuffle_epi32(sum4, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    return _mm_cvtsi128_si32(sum4);
+}
+
+inline uint32_t hsum32(__m128i v)
+{
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return (uint32_t)_mm_cvtsi128_si32(v);
+}
+
+/* single block of a row that does not fill a full 32 byte load */
+template<int size>
+uint64_t var_block(pixel *pix, intptr_t stride)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i sum = _mm_setzero_si128();
+    __m128i sqr = _mm_setzero_si128();
+
+    for (int y = 0; y < size; y++, pix += stride)
+    {
+        for (int x = 0; x < size; x += 8)
+        {
+            __m128i p = _mm_loadl_epi64((__m128i*)(pix + x));
+            __m128i w = _mm_cvtepu8_epi16(p);
+            sum = _mm_add_epi32(sum, _mm_sad_epu8(p, zero));
+            sqr = _mm_add_epi32(sqr, _mm_madd_epi16(w, w));
+        }
+    }
+
+    return (uint32_t)_mm_cvtsi128_si32(sum) + ((uint64_t)hsum32(sqr) << 32);
+}
+
+/* two adjacent 16x16 blocks per load. Unpacking within the 128 bit lanes
+ * keeps block A in the low lane and block B in the high lane throughout */
+void var_row16(pixel *pix, intptr_t stride, int numBlocks, uint64_t *res)
+{
+    __m256i zero = _mm256_setzero_si256();
+    int i = 0;
+
+    for (; i + 2 <= numBlocks; i += 2)
+    {
+        pixel *src = pix + i * 16;
+        __m256i sum = _mm256_setzero_si256();
+        __m256i sqr = _mm256_setzero_si256();
+
+        for (int y = 0; y < 16; y++, src += stride)
+        {
+            __m256i p = _mm256_loadu_si256((__m256i*)src);
+            __m256i lo = _mm256_unpacklo_epi8(p, zero);
+            __m256i hi = _mm256_unpackhi_epi8(p, zero);
+            sum = _mm256_add_epi32(sum, _mm256_sad_epu8(p, zero));
+            sqr = _mm256_add_epi32(sqr, _mm256_madd_epi16(lo, lo));
+            sqr = _mm256_add_epi32(sqr, _mm256_madd_epi16(hi, hi));
+        }
+
+        sum = _mm256_add_epi32(sum, _mm256_srli_si256(sum, 8));
+        sqr = _mm256_add_epi32(sqr, _mm256_shuffle_epi32(sqr, _MM_SHUFFLE(1, 0, 3, 2)));
+        sqr = _mm256_add_epi32(sqr, _mm256_shuffle_epi32(sqr, _MM_SHUFFLE(2, 3, 0, 1)));
+        __m128i sumB = _mm256_extracti128_si256(sum, 1);
+        __m128i sqrB = _mm256_extracti128_si256(sqr, 1);
+        res[i] = (uint32_t)_mm_cvtsi128_si32(_mm256_castsi256_si128(sum)) +
+            ((uint64_t)(uint32_t)_mm_cvtsi128_si32(_mm256_castsi256_si128(sqr)) << 32);
+        res[i + 1] = (uint32_t)_mm_cvtsi128_si32(sumB) + ((uint64_t)(uint32_t)_mm_cvtsi128_si32(sqrB) << 32);
+    }
+
+    if (i < numBlocks)
+        res[i] = var_block<16>(pix + i * 16, stride);
+}
+
+/* four adjacent 8x8 blocks per load, one per 64 bit sad lane. The low
+ * unpack holds blocks 0 and 2, the high unpack blocks 1 and 3 */
+void var_row8(pixel *pix, intptr_t stride, int numBlocks, uint64_t *res)
+{
+    __m256i zero = _mm256_setzero_si256();
+    int i = 0;
+
+    for (; i + 4 <= numBlocks; i += 4)
+    {
+        pixel *src = pix + i * 8;
+        __m256i sum = _mm256_setzero_si256();
+        __m256i sqrLo = _mm256_setzero_si256();
+        __m256i sqrHi = _mm256_setzero_si256();
+
+        for (int y = 0; y < 8; y++, src += stride)
+        {
+            __m256i p = _mm256_loadu_si256((__m256i*)src);
+            __m256i lo = _mm256_unpacklo_epi8(p, zero);
+            __m256i hi = _mm256_unpackhi_epi8(p, zero);
+            sum = _mm256_add_epi32(sum, _mm256_sad_epu8(p, zero));
+            sqrLo = _mm256_add_epi32(sqrLo, _mm256_madd_epi16(lo, lo));
+            sqrHi = _mm256_add_epi32(sqrHi, _mm256_madd_epi16(hi, hi));
+        }
+
+        /* per lane: { lo, hi, lo, hi } totals */
+        __m256i sqr = _mm256_hadd_epi32(sqrLo, sqrHi);
+        sqr = _mm256_hadd_epi32(sqr, sqr);
+
+        ALIGN_VAR_32(uint64_t, sums[4]);
+        ALIGN_VAR_32(uint32_t, sqrs[8]);
+        _mm256_store_si256((__m256i*)sums, sum);
+        _mm256_store_si256((__m256i*)sqrs, sqr);
+        res[i + 0] = sums[0] + ((uint64_t)sqrs[0] << 32);
+        res[i + 1] = sums[1] + ((uint64_t)sqrs[1] << 32);
+        res[i + 2] = sums[2] + ((uint64_t)sqrs[4] << 32);
+        res[i + 3] = sums[3] + ((uint64_t)sqrs[5] << 32);
+    }
+
+    for (; i < numBlocks; i++)
+        res[i] = var_block<8>(pix + i * 8, stride);
+}
+#endif // if !HIGH_BIT_DEPTH
+}
+
+namespace x265 {
+void Setup_Vec_PixelPrimitives_avx2(EncoderPrimitives &p)
+{
+#if !HIGH_BIT_DEPTH
+    p.sse_pp[LUMA_16x16] = sse_pp<16, 16>;
+    p.sse_pp[LUMA_16x8]  = sse_pp<16, 8>;
+    p.sse_pp[LUMA_16x12] = sse_pp<16, 12>;
+    p.sse_pp[LUMA_16x4]  = sse_pp<16, 4>;
+    p.sse_pp[LUMA_32x32] = sse_pp<32, 32>;
+    p.sse_pp[LUMA_32x16] = sse_pp<32, 16>;
+    p.sse_pp[LUMA_16x32] = sse_pp<16, 32>;
+    p.sse_pp[LUMA_32x24] = sse_pp<32, 24>;
+    p.sse_pp[LUMA_32x8]  = sse_pp<32, 8>;
+    p.sse_pp[LUMA_64x64] = sse_pp<64, 64>;
+    p.sse_pp[LUMA_64x32] = sse_pp<64, 32>;
+    p.sse_pp[LUMA_32x64] = sse_pp<32, 64>;
+    p.sse_pp[LUMA_64x48] = sse_pp<64, 48>;
+    p.sse_pp[LUMA_48x64] = sse_pp<48, 64>;
+    p.sse_pp[LUMA_64x16] = sse_pp<64, 16>;
+    p.sse_pp[LUMA_16x64] = sse_pp<16, 64>;
+
+    p.var_row[BLOCK_8x8]   = var_row8;
+    p.var_row[BLOCK_16x16] = var_row16;
+#endif
+}
+}
@@ -0,0 +1,287 @@
+/*****************************************************************************
+ * Copyright (C) 2013 x265 project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "primitives.h"
+#include <xmmintrin.h> // SSE
+#include <pmmintrin.h> // SSE3
+#include <tmmintrin.h> // SSSE3
+
+using namespace x265;
+
+namespace {
+#if !HIGH_BIT_DEPTH
+inline void butterfly(__m128i& a, __m128i& b)
+{
+    __m128i t = a;
+
+    a = _mm_add_epi16(t, b);
+    b = _mm_sub_epi16(t, b);
+}
+
+/* first two stages of an 8 point Hadamard across the rows held in d[] */
+inline void hadamard8_partial(__m128i *d)
+{
+    butterfly(d[0], d[1]);
+    butterfly(d[2], d[3]);
+    butterfly(d[4], d[5]);
+    butterfly(d[6], d[7]);
+    butterfly(d[0], d[2]);
+    butterfly(d[1], d[3]);
+    butterfly(d[4], d[6]);
+    butterfly(d[5], d[7]);
+}
+
+inline void transpose8x8(__m128i *d)
+{
+    __m128i a0 = _mm_unpacklo_epi16(d[0], d[1]);
+    __m128i a1 = _mm_unpackhi_epi16(d[0], d[1]);
+    __m128i a2 = _mm_unpacklo_epi16(d[2], d[3]);
+    __m128i a3 = _mm_unpackhi_epi16(d[2], d[3]);
+    __m128i a4 = _mm_unpacklo_epi16(d[4], d[5]);
+    __m128i a5 = _mm_unpackhi_epi16(d[4], d[5]);
+    __m128i a6 = _mm_unpacklo_epi16(d[6], d[7]);
+    __m128i a7 = _mm_unpackhi_epi16(d[6], d[7]);
+
+    __m128i b0 = _mm_unpacklo_epi32(a0, a2);
+    __m128i b1 = _mm_unpackhi_epi32(a0, a2);
+    __m128i b2 = _mm_unpacklo_epi32(a1, a3);
+    __m128i b3 = _mm_unpackhi_epi32(a1, a3);
+    __m128i b4 = _mm_unpacklo_epi32(a4, a6);
+    __m128i b5 = _mm_unpackhi_epi32(a4, a6);
+    __m128i b6 = _mm_unpacklo_epi32(a5, a7);
+    __m128i b7 = _mm_unpackhi_epi32(a5, a7);
+
+    d[0] = _mm_unpacklo_epi64(b0, b4);
+    d[1] = _mm_unpackhi_epi64(b0, b4);
+    d[2] = _mm_unpacklo_epi64(b1, b5);
+    d[3] = _mm_unpackhi_epi64(b1, b5);
+    d[4] = _mm_unpacklo_epi64(b2, b6);
+    d[5] = _mm_unpackhi_epi64(b2, b6);
+    d[6] = _mm_unpacklo_epi64(b3, b7);
+    d[7] = _mm_unpackhi_epi64(b3, b7);
+}
+
+/* unrounded sum of absolute 8x8 Hadamard coefficients, as _sa8d_8x8 in
+ * pixel.cpp. Coefficients reach 64 * 255 and fit in 16 bits. The last
+ * butterfly of the second pass is folded into the sum through
+ * |a + b| + |a - b| = 2 * max(|a|, |b|) */
+inline int sa8d_8x8_raw(pixel *pix1, intptr_t i_pix1, pixel *pix2, intptr_t i_pix2)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i d[8];
+
+    for (int i = 0; i < 8; i++)
+    {
+        __m128i a = _mm_loadl_epi64((__m128i*)(pix1 + i * i_pix1));
+        __m128i b = _mm_loadl_epi64((__m128i*)(pix2 + i * i_pix2));
+        d[i] = _mm_sub_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+    }
+
+    hadamard8_partial(d);
+    butterfly(d[0], d[4]);
+    butterfly(d[1], d[5]);
+    butterfly(d[2], d[6]);
+    butterfly(d[3], d[7]);
+    transpose8x8(d);
+    hadamard8_partial(d);
+
+    __m128i m0 = _mm_max_epi16(_mm_abs_epi16(d[0]), _mm_abs_epi16(d[4]));
+    __m128i m1 = _mm_max_epi16(_mm_abs_epi16(d[1]), _mm_abs_epi16(d[5]));
+    __m128i m2 = _mm_max_epi16(_mm_abs_epi16(d[2]), _mm_abs_epi16(d[6]));
+    __m128i m3 = _mm_max_epi16(_mm_abs_epi16(d[3]), _mm_abs_epi16(d[7]));
+
+    /* pairwise sums stay below 2 * 16320 */
+    const __m128i one = _mm_set1_epi16(1);
+    __m128i sum = _mm_add_epi32(_mm_madd_epi16(_mm_add_epi16(m0, m1), one), _mm_madd_epi16(_mm_add_epi16(m2, m3), one));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    return _mm_cvtsi128_si32(sum) * 2;
+}
+
+int sa8d_8x8(pixel *pix1, intptr_t i_pix1, pixel *pix2, intptr_t i_pix2)
+{
+    return (sa8d_8x8_raw(pix1, i_pix1, pix2, i_pix2) + 2) >> 2;
+}
+
+int sa8d_16x16(pixel *pix1, intptr_t i_pix1, pixel *pix2, intptr_t i_pix2)
+{
+    int sum = sa8d_8x8_raw(pix1, i_pix1, pix2, i_pix2)
+        + sa8d_8x8_raw(pix1 + 8, i_pix1, pix2 + 8, i_pix2)
+        + sa8d_8x8_raw(pix1 + 8 * i_pix1, i_pix1, pix2 + 8 * i_pix2, i_pix2)
+        + sa8d_8x8_raw(pix1 + 8 + 8 * i_pix1, i_pix1, pix2 + 8 + 8 * i_pix2, i_pix2);
+
+    return (sum + 2) >> 2;
+}
+
+template<int w, int h>
+// Calculate sa8d in blocks of 8x8
+int sa8d8(pixel *pix1, intptr_t i_pix1, pixel *pix2, intptr_t i_pix2)
+{
+    int cost = 0;
+
+    for (int y = 0; y < h; y += 8)
+    {
+        for (int x = 0; x < w; x += 8)
+        {
+            cost += sa8d_8x8(pix1 + i_pix1 * y + x, i_pix1, pix2 + i_pix2 * y + x, i_pix2);
+        }
+    }
+
+    return cost;
+}
+
+template<int w, int h>
+// Calculate sa8d in blocks of 16x16
+int sa8d16(pixel *pix1, intptr_t i_pix1, pixel *pix2, intptr_t i_pix2)
+{
+    int cost = 0;
+
+    for (int y = 0; y < h; y += 16)
+    {
+        for (int x = 0; x < w; x += 16)
+        {
+            cost += sa8d_16x16(pix1 + i_pix1 * y + x, i_pix1, pix2 + i_pix2 * y + x, i_pix2);
+        }
+    }
+
+    return cost;
+}
+inline uint32_t hsum32(__m128i v)
+{
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return (uint32_t)_mm_cvtsi128_si32(v);
+}
+
+/* sums from _mm_sad_epu8 against zero, squares from _mm_madd_epi16 of the
+ * widened pixels; a 16x16 block of squares stays below 2^24 */
+uint64_t var16(pixel *pix, intptr_t stride)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i sum = _mm_setzero_si128();
+    __m128i sqr = _mm_setzero_si128();
+
+    for (int y = 0; y < 16; y++, pix += stride)
+    {
+        __m128i p = _mm_loadu_si128((__m128i*)pix);
+        __m128i lo = _mm_unpacklo_epi8(p, zero);
+        __m128i hi = _mm_unpackhi_epi8(p, zero);
+        sum = _mm_add_epi32(sum, _mm_sad_epu8(p, zero));
+        sqr = _mm_add_epi32(sqr, _mm_madd_epi16(lo, lo));
+        sqr = _mm_add_epi32(sqr, _mm_madd_epi16(hi, hi));
+    }
+
+    sum = _mm_add_epi32(sum, _mm_srli_si128(sum, 8));
+    return (uint32_t)_mm_cvtsi128_si32(sum) + ((uint64_t)hsum32(sqr) << 32);
+}
+
+/* two adjacent 8x8 blocks per load: the two sad lanes and the low/high
+ * halves of the widened pixels each belong to one block */
+void var8_pair(pixel *pix, intptr_t stride, uint64_t *res)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i sum = _mm_setzero_si128();
+    __m128i sqr0 = _mm_setzero_si128();
+    __m128i sqr1 = _mm_setzero_si128();
+
+    for (int y = 0; y < 8; y++, pix += stride)
+    {
+        __m128i p = _mm_loadu_si128((__m128i*)pix);
+        __m128i lo = _mm_unpacklo_epi8(p, zero);
+        __m128i hi = _mm_unpackhi_epi8(p, zero);
+        sum = _mm_add_epi32(sum, _mm_sad_epu8(p, zero));
+        sqr0 = _mm_add_epi32(sqr0, _mm_madd_epi16(lo, lo));
+        sqr1 = _mm_add_epi32(sqr1, _mm_madd_epi16(hi, hi));
+    }
+
+    res[0] = (uint32_t)_mm_cvtsi128_si32(sum) + ((uint64_t)hsum32(sqr0) << 32);
+    res[1] = (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(sum, 8)) + ((uint64_t)hsum32(sqr1) << 32);
+}
+
+uint64_t var8(pixel *pix, intptr_t stride)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i sum = _mm_setzero_si128();
+    __m128i sqr = _mm_setzero_si128();
+
+    for (int y = 0; y < 8; y++, pix += stride)
+    {
+        __m128i p = _mm_loadl_epi64((__m128i*)pix);
+        __m128i lo = _mm_unpacklo_epi8(p, zero);
+        sum = _mm_add_epi32(sum, _mm_sad_epu8(p, zero));
+        sqr = _mm_add_epi32(sqr, _mm_madd_epi16(lo, lo));
+    }
+
+    return (uint32_t)_mm_cvtsi128_si32(sum) + ((uint64_t)hsum32(sqr) << 32);
+}
+
+void var_row16(pixel *pix, intptr_t stride, int numBlocks, uint64_t *res)
+{
+    for (int i = 0; i < numBlocks; i++)
+        res[i] = var16(pix + i * 16, stride);
+}
+
+void var_row8(pixel *pix, intptr_t stride, int numBlocks, uint64_t *res)
+{
+    int i = 0;
+
+    for (; i + 2 <= numBlocks; i += 2)
+        var8_pair(pix + i * 8, stride, res + i);
+    if (i < numBlocks)
+        res[i] = var8(pix + i * 8, stride);
+}
+#endif // if !HIGH_BIT_DEPTH
+}
+
+namespace x265 {
+void Setup_Vec_PixelPrimitives_ssse3(EncoderPrimitives &p)
+{
+#if !HIGH_BIT_DEPTH
+    p.sa8d_inter[LUMA_8x8]   = sa8d_8x8;
+    p.sa8d_inter[LUMA_16x16] = sa8d_16x16;
+    p.sa8d_inter[LUMA_16x8]  = sa8d8<16, 8>;
+    p.sa8d_inter[LUMA_8x16]  = sa8d8<8, 16>;
+    p.sa8d_inter[LUMA_32x32] = sa8d16<32, 32>;
+    p.sa8d_inter[LUMA_32x16] = sa8d16<32, 16>;
+    p.sa8d_inter[LUMA_16x32] = sa8d16<16, 32>;
+    p.sa8d_inter[LUMA_32x24] = sa8d8<32, 24>;
+    p.sa8d_inter[LUMA_24x32] = sa8d8<24, 32>;
+    p.sa8d_inter[LUMA_32x8]  = sa8d8<32, 8>;
+    p.sa8d_inter[LUMA_8x32]  = sa8d8<8, 32>;
+    p.sa8d_inter[LUMA_64x64] = sa8d16<64, 64>;
+    p.sa8d_inter[LUMA_64x32] = sa8d16<64, 32>;
+    p.sa8d_inter[LUMA_32x64] = sa8d16<32, 64>;
+    p.sa8d_inter[LUMA_64x48] = sa8d16<64, 48>;
+    p.sa8d_inter[LUMA_48x64] = sa8d16<48, 64>;
+    p.sa8d_inter[LUMA_64x16] = sa8d16<64, 16>;
+    p.sa8d_inter[LUMA_16x64] = sa8d16<16, 64>;
+
+    p.sa8d[BLOCK_8x8]   = sa8d_8x8;
+    p.sa8d[BLOCK_16x16] = sa8d_16x16;
+    p.sa8d[BLOCK_32x32] = sa8d16<32, 32>;
+    p.sa8d[BLOCK_64x64] = sa8d16<64, 64>;
+
+    p.var_row[BLOCK_8x8]   = var_row8;
+    p.var_row[BLOCK_16x16] = var_row16;
+#endif
+}
+}
@@ -32,12 +32,12 @@
 #define HAVE_SSE4
 #define HAVE_AVX2
 #elif defined(__GNUC__)
-#if __clang__ || (__GNUC__ >= 4 && __GNUC_MINOR__ >= 3)
+#if __clang__ || (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 3))
 #define HAVE_SSE3
 #define HAVE_SSSE3
 #define HAVE_SSE4
 #endif
-#if __clang__ || (__GNUC__ >= 4 && __GNUC_MINOR__ >= 7)
+#if __clang__ || (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7))
 #define HAVE_AVX2
 #endif
 #elif defined(_MSC_VER)
@@ -59,6 +59,15 @@ void Setup_Vec_DCTPrimitives_sse3(EncoderPrimitives&);
 void Setup_Vec_DCTPrimitives_ssse3(EncoderPrimitives&);
 void Setup_Vec_DCTPrimitives_sse41(EncoderPrimitives&);
 
+void Setup_Vec_PixelPrimitives_ssse3(EncoderPrimitives&);
+
+void Setup_Vec_IPFilterPrimitives_sse41(EncoderPrimitives&);
+void Setup_Vec_IPredPrimitives_sse41(EncoderPrimitives&);
+void Setup_Vec_LoopFilterPrimitives_sse41(EncoderPrimitives&);
+
+void Setup_Vec_DCTPrimitives_avx2(EncoderPrimitives&);
+void Setup_Vec_PixelPrimitives_avx2(EncoderPrimitives&);
+
 /* Use primitives for the best available vector architecture */
 void Setup_Instrinsic_Primitives(EncoderPrimitives &p, int cpuMask)
 {
@@ -73,12 +82,23 @@ void Setup_Instrinsic_Primitives(EncoderPrimitives &p, int cpuMask)
     if (cpuMask & X265_CPU_SSSE3)
     {
         Setup_Vec_DCTPrimitives_ssse3(p);
+        Setup_Vec_PixelPrimitives_ssse3(p);
     }
 #endif
 #ifdef HAVE_SSE4
     if (cpuMask & X265_CPU_SSE4)
     {
         Setup_Vec_DCTPrimitives_sse41(p);
+        Setup_Vec_IPFilterPrimitives_sse41(p);
+        Setup_Vec_IPredPrimitives_sse41(p);
+        Setup_Vec_LoopFilterPrimitives_sse41(p);
+    }
+#endif
+#ifdef HAVE_AVX2
+    if (cpuMask & X265_CPU_AVX2)
+    {
+        Setup_Vec_DCTPrimitives_avx2(p);
+        Setup_Vec_PixelPrimitives_avx2(p);
     }
 #endif
     (void)p;
@@ -26,6 +26,7 @@
 #include "TLibEncoder/TEncCu.h"
 #include "rdcost.h"
 #include "encoder.h"
+#include "slicetype.h"
 
 /* Lambda Partition Select adjusts the threshold value for Early Exit in No-RDO flow */
 #define LAMBDA_PARTITION_SELECT     0.9
@@ -95,96 +96,25 @@ void TEncCu::xComputeCostIntraInInter(TComDataCU* cu, PartSize partSize)
     pixel* fenc     = m_origYuv[depth]->getLumaAddr();
     uint32_t stride = m_modePredYuv[5][depth]->getStride();
 
-    pixel *above         = m_search->m_refAbove    + tuSize - 1;
-    pixel *aboveFiltered = m_search->m_refAboveFlt + tuSize - 1;
-    pixel *left          = m_search->m_refLeft     + tuSize - 1;
-    pixel *leftFiltered  = m_search->m_refLeftFlt  + tuSize - 1;
-    int sad, bsad;
-    uint32_t bits, bbits, mode, bmode;
-    uint64_t cost, bcost;
-
-    // 33 Angle modes once
-    ALIGN_VAR_32(pixel, buf_trans[32 * 32]);
-    ALIGN_VAR_32(pixel, tmp[33 * 32 * 32]);
-    int scaleTuSize = tuSize;
-    int scaleStride = stride;
-    int costMultiplier = 1;
-
-    if (tuSize > 32)
-    {
-        // origin is 64x64, we scale to 32x32 and setup required parameters
-        ALIGN_VAR_32(pixel, bufScale[32 * 32]);
-        primitives.scale2D_64to32(bufScale, fenc, stride);
-        fenc = bufScale;
-
-        // reserve space in case primitives need to store data in above
-        // or left buffers
-        pixel _above[4 * 32 + 1];
-        pixel _left[4 * 32 + 1];
-        pixel *aboveScale  = _above + 2 * 32;
-        pixel *leftScale   = _left + 2 * 32;
-        aboveScale[0] = leftScale[0] = above[0];
-        primitives.scale1D_128to64(aboveScale + 1, above + 1, 0);
-        primitives.scale1D_128to64(leftScale + 1, left + 1, 0);
-
-        scaleTuSize = 32;
-        scaleStride = 32;
-        costMultiplier = 4;
-
-        // Filtered and Unfiltered refAbove and refLeft pointing to above and left.
-        above         = aboveScale;
-        left          = leftScale;
-        aboveFiltered = aboveScale;
-        leftFiltered  = leftScale;
-    }
-
-    int sizeIdx = g_convertToBit[scaleTuSize];
-    pixelcmp_t sa8d = primitives.sa8d[sizeIdx];
-
     uint32_t preds[3];
     cu->getIntraDirLumaPredictor(partOffset, preds);
 
-    uint64_t mpms;
-    uint32_t rbits = m_search->xModeBitsRemIntra(cu, partOffset, depth, preds, mpms);
-
-    // DC
-    primitives.intra_pred[sizeIdx][DC_IDX](tmp, scaleStride, left, above, 0, (scaleTuSize <= 16));
-    bsad = costMultiplier * sa8d(fenc, scaleStride, tmp, scaleStride);
-    bmode = mode = DC_IDX;
-    bbits = !(mpms & ((uint64_t)1 << mode)) ? rbits : m_search->xModeBitsIntra(cu, mode, partOffset, depth);
-    bcost = m_rdCost->calcRdSADCost(bsad, bbits);
+    uint32_t modeDist[35], modeBits[35];
+    uint64_t modeCosts[35];
+    m_search->estIntraModeCosts(cu, partOffset, depth, fenc, stride, tuSize, preds, modeDist, modeBits, modeCosts);
 
-    pixel *abovePlanar   = above;
-    pixel *leftPlanar    = left;
+    // DC first, so it wins ties
+    uint32_t bmode = DC_IDX;
+    uint32_t bsad = modeDist[DC_IDX];
+    uint32_t bbits = modeBits[DC_IDX];
+    uint64_t bcost = modeCosts[DC_IDX];
 
-    if (tuSize >= 8 && tuSize <= 32)
+    for (uint32_t mode = 0; mode < 35; mode++)
     {
-        abovePlanar = aboveFiltered;
-        leftPlanar  = leftFiltered;
-    }
-
-    // PLANAR
-    primitives.intra_pred[sizeIdx][PLANAR_IDX](tmp, scaleStride, leftPlanar, abovePlanar, 0, 0);
-    sad = costMultiplier * sa8d(fenc, scaleStride, tmp, scaleStride);
-    mode = PLANAR_IDX;
-    bits = !(mpms & ((uint64_t)1 << mode)) ? rbits : m_search->xModeBitsIntra(cu, mode, partOffset, depth);
-    cost = m_rdCost->calcRdSADCost(sad, bits);
-    COPY4_IF_LT(bcost, cost, bmode, mode, bsad, sad, bbits, bits);
-
-    // Transpose NxN
-    primitives.transpose[sizeIdx](buf_trans, fenc, scaleStride);
-
-    primitives.intra_pred_allangs[sizeIdx](tmp, above, left, aboveFiltered, leftFiltered, (scaleTuSize <= 16));
-
-    for (mode = 2; mode < 35; mode++)
-    {
-        bool modeHor = (mode < 18);
-        pixel *cmp = (modeHor ? buf_trans : fenc);
-        intptr_t srcStride = (modeHor ? scaleTuSize : scaleStride);
-        sad  = costMultiplier * sa8d(cmp, srcStride, &tmp[(mode - 2) * (scaleTuSize * scaleTuSize)], scaleTuSize);
-        bits = !(mpms & ((uint64_t)1 << mode)) ? rbits : m_search->xModeBitsIntra(cu, mode, partOffset, depth);
-        cost = m_rdCost->calcRdSADCost(sad, bits);
-        COPY4_IF_LT(bcost, cost, bmode, mode, bsad, sad, bbits, bits);
+        if (mode != DC_IDX)
+        {
+            COPY4_IF_LT(bcost, modeCosts[mode], bmode, mode, bsad, modeDist[mode], bbits, modeBits[mode]);
+        }
     }
 
     cu->m_totalBits = bbits;
@@ -339,6 +269,153 @@ void TEncCu::xComputeCostMerge2Nx2N(TComDataCU*& outBestCU, TComDataCU*& outTemp
     x265_emms();
 }
 
+/* Fast CU depth decision (--fast-decision). At the start of each CTU, select
+ * the co-located CTU of the temporally nearest reference picture */
+void TEncCu::xInitFastDecision(TComDataCU* cu)
+{
+    TComSlice* slice = cu->getSlice();
+    int poc = slice->getPOC();
+    int bestDist = MAX_INT;
+    m_fdColocated = NULL;
+    for (int list = 0; list < 2; list++)
+    {
+        if (slice->getNumRefIdx(list) > 0)
+        {
+            int dist = abs(poc - slice->getRefPOC(list, 0));
+            if (dist < bestDist)
+            {
+                bestDist = dist;
+                m_fdColocated = slice->getRefPic(list, 0)->getCU(cu->getAddr());
+            }
+        }
+    }
+}
+
+/* Gather the depth range of the already coded CUs bordering the left and top
+ * edges of the current CU, inside or outside of the current CTU. Returns the
+ * number of available edges (0, 1 or 2) */
+int TEncCu::xFastEdgeDepths(TComDataCU* cu, uint8_t& minDepth, uint8_t& maxDepth)
+{
+    uint32_t absPartIdx = cu->getZorderIdxInCU();
+    uint32_t numPartInCUSize = cu->getPic()->getNumPartInCUSize();
+    uint32_t rasterIdx = g_zscanToRaster[absPartIdx];
+    uint32_t edgeParts = cu->getCUSize(0) >> 2;
+    int numEdges = 0;
+
+    minDepth = (uint8_t)g_maxCUDepth;
+    maxDepth = 0;
+    for (int edge = 0; edge < 2; edge++)
+    {
+        bool bAvailable = false;
+        for (uint32_t i = 0; i < edgeParts; i++)
+        {
+            uint32_t curPartIdx = g_rasterToZscan[rasterIdx + (edge ? i : i * numPartInCUSize)];
+            uint32_t partIdx;
+            TComDataCU* neighbour = edge ? cu->getPUAbove(partIdx, curPartIdx) : cu->getPULeft(partIdx, curPartIdx);
+            if (!neighbour)
+                break;
+
+            uint8_t d = neighbour->getDepth(partIdx);
+            minDepth = X265_MIN(minDepth, d);
+            maxDepth = X265_MAX(maxDepth, d);
+            bAvailable = true;
+        }
+
+        numEdges += bAvailable;
+    }
+
+    return numEdges;
+}
+
+/* Returns true if the analysis of the current depth may be skipped, going
+ * straight to split. Both the co-located area in the nearest reference and
+ * the neighbour CUs along the left and top edges must have been coded only at
+ * deeper depths. Level 1 needs both edges, level 2 is satisfied by either */
+bool TEncCu::xFastSkipDepth(TComDataCU* cu, uint32_t depth)
+{
+    if (!m_fdColocated)
+        return false;
+
+    uint8_t minDepth, maxDepth;
+    int minEdges = m_param->fastDecision > 1 ? 1 : 2;
+    if (xFastEdgeDepths(cu, minDepth, maxDepth) < minEdges || minDepth <= depth)
+        return false;
+
+    uint32_t absPartIdx = cu->getZorderIdxInCU();
+    uint32_t numPart = cu->getTotalNumPart();
+    for (uint32_t i = 0; i < numPart; i += 4)
+    {
+        if (m_fdColocated->getDepth(absPartIdx + i) <= depth)
+            return false;
+    }
+
+    m_fdStats.skipDepth++;
+    return true;
+}
+
+/* Returns true if splitting of the current CU should not be analyzed. At level
+ * 1 the co-located area and the neighbour CUs along both the left and top
+ * edges must all have stopped at this depth or above and the best mode must be
+ * an inter CU. Level 2 is satisfied by either edge and any best mode, and
+ * additionally stops splitting 32x32 and larger CUs whose lookahead inter
+ * costs are uniform */
+bool TEncCu::xFastStopSplit(TComDataCU* cu, TComDataCU* bestCU, uint32_t depth)
+{
+    if (!bestCU)
+        return false;
+
+    uint8_t minDepth, maxDepth;
+    int minEdges = m_param->fastDecision > 1 ? 1 : 2;
+    if (m_fdColocated && (m_param->fastDecision > 1 || bestCU->getPredictionMode(0) == MODE_INTER) &&
+        xFastEdgeDepths(cu, minDepth, maxDepth) >= minEdges && maxDepth <= depth)
+    {
+        uint32_t absPartIdx = cu->getZorderIdxInCU();
+        uint32_t numPart = cu->getTotalNumPart();
+        uint32_t i;
+        for (i = 0; i < numPart; i += 4)
+        {
+            if (m_fdColocated->getDepth(absPartIdx + i) > depth)
+                break;
+        }
+
+        if (i >= numPart)
+        {
+            m_fdStats.stopSplitNeighbour++;
+            return true;
+        }
+    }
+
+    uint32_t cuSize = cu->getCUSize(0);
+    if (m_param->fastDecision > 1 && m_lowresCosts && cuSize >= 32)
+    {
+        /* lowres blocks are 8x8, covering 16x16 full resolution pixels */
+        int bx0 = cu->getCUPelX() >> 4, by0 = cu->getCUPelY() >> 4;
+        int bx1 = X265_MIN(bx0 + (int)(cuSize >> 4), m_lowresWidth);
+        int by1 = X265_MIN(by0 + (int)(cuSize >> 4), m_lowresHeight);
+        uint32_t minCost = MAX_UINT, maxCost = 0, sum = 0, cnt = 0;
+
+        for (int by = by0; by < by1; by++)
+        {
+            for (int bx = bx0; bx < bx1; bx++)
+            {
+                uint32_t cost = m_lowresCosts[by * m_lowresWidth + bx] & LOWRES_COST_MASK;
+                minCost = X265_MIN(minCost, cost);
+                maxCost = X265_MAX(maxCost, cost);
+                sum += cost;
+                cnt++;
+            }
+        }
+
+        if (cnt > 1 && (maxCost - minCost) * 8 * cnt <= sum)
+        {
+            m_fdStats.stopSplitLookahead++;
+            return true;
+        }
+    }
+
+    return false;
+}
+
 void TEncCu::xCompressInterCU(TComDataCU*& outBestCU, TComDataCU*& outTempCU, TComDataCU*& cu, uint32_t depth, bool bInsidePicture, uint32_t PartitionIndex, uint8_t minDepth)
 {
     TComPic* pic = outTempCU->getPic();
@@ -375,6 +452,8 @@ void TEncCu::xCompressInterCU(TComDataCU*& outBestCU, TComDataCU*& outTempCU, TC
     }
     // We need to split, so don't try these modes.
     TComYuv* tempYuv = NULL;
+    if (depth == 0 && m_param->fastDecision)
+        xInitFastDecision(outTempCU);
 #if TOPSKIP
     if (depth == 0)
     {
@@ -411,7 +490,15 @@ void TEncCu::xCompressInterCU(TComDataCU*& outBestCU, TComDataCU*& outTempCU, TC
     if (!(depth < minDepth)) //topskip
 #endif // if TOPSKIP
     {
-        if (bInsidePicture)
+        bool bFastSkipDepth = false;
+        if (m_param->fastDecision && bInsidePicture)
+        {
+            m_fdStats.cuCount++;
+            if (depth < g_maxCUDepth - g_addCUDepth)
+                bFastSkipDepth = xFastSkipDepth(outTempCU, depth);
+        }
+
+        if (bInsidePicture && !bFastSkipDepth)
         {
             /* Initialise all Mode-CUs based on parentCU */
             if (depth == 0)
@@ -620,6 +707,9 @@ void TEncCu::xCompressInterCU(TComDataCU*& outBestCU, TComDataCU*& outTempCU, TC
             else
                 bSubBranch = true;
 
+            if (bSubBranch && m_param->fastDecision && depth < g_maxCUDepth - g_addCUDepth)
+                bSubBranch = !xFastStopSplit(outTempCU, outBestCU, depth);
+
             if (m_param->rdLevel > 1)
             {
                 m_entropyCoder->resetBits();
@@ -89,7 +89,8 @@ public:
 
     /* Threading variables */
 
-    /* This lock must be acquired when reading or writing m_active or m_busy */
+    /* This lock must be acquired when reading or writing m_active, m_busy or
+     * m_filterActive */
     Lock                m_lock;
 
     /* row is ready to run, has no neighbor dependencies. The row may have
@@ -103,8 +104,26 @@ public:
      * flag is used to detect multiple possible wavefront problems. */
     volatile bool       m_busy;
 
-    /* count of completed CUs in this row */
+    /* the encoder thread has left this row after coding its last CU. The
+     * filter holds back the last CU of the row until then */
+    volatile bool       m_done;
+
+    /* count of completed CUs in this row. Under VBV a CU is counted after
+     * the diagonal restart decision it may trigger */
     volatile uint32_t   m_completed;
+
+    /* the loop filter of this row is queued or being processed by a worker
+     * thread. Set by whichever encoder row makes more of its CUs ready */
+    volatile bool       m_filterActive;
+
+    /* count of CUs in this row which have been deblocked and SAO analyzed */
+    volatile uint32_t   m_filtered;
+
+    /* motion search statistics and static CTU count of this row's coder when
+     * the row last started its first CU, restored if a VBV restart re-encodes
+     * the row */
+    MotionEstimateStats m_meStatsAtStart[MAX_CU_DEPTH];
+    uint64_t            m_numStaticCTUsAtStart;
 };
 }
 
@@ -42,6 +42,30 @@
 
 using namespace x265;
 
+static const char *meStatsHeader = "ME Searches, ME Predictors, ME Fullpel Cands, ME Subpel Cands, ME Subpel Iters, ME Early Out %, ME Avg Dist";
+
+/* write the motion search statistics summed over all CU depths as CSV
+ * columns. Candidate and iteration counts are averaged per search, distances
+ * are reported in full pels */
+static void writeMEStatsCSV(FILE *csv, const MotionEstimateStats *perDepth)
+{
+    MotionEstimateStats total;
+
+    for (int depth = 0; depth < MAX_CU_DEPTH; depth++)
+        total.add(perDepth[depth]);
+
+    if (total.searches)
+    {
+        double searches = (double)total.searches;
+        fprintf(csv, ", %.0lf, %.2lf, %.2lf, %.2lf, %.2lf, %.2lf, %.2lf", searches,
+                total.predictorCands / searches, total.fullpelCands / searches,
+                total.subpelCands / searches, total.subpelIters / searches,
+                100.0 * total.earlyOuts / searches, total.searchDistance / (4.0 * searches));
+    }
+    else
+        fprintf(csv, ", 0, -, -, -, -, -, -");
+}
+
 Encoder::Encoder()
 {
     m_aborted = false;
@@ -63,6 +87,8 @@ Encoder::Encoder()
     m_packetData = NULL;
     m_outputCount = 0;
     m_csvfpt = NULL;
+    m_meMapFile = NULL;
+    m_qualityMapFile = NULL;
     m_param = NULL;
 
 #if ENC_DEC_TRACE
@@ -98,7 +124,7 @@ void Encoder::create()
     }
     m_lookahead = new Lookahead(this, m_threadPool);
     m_dpb = new DPB(this);
-    m_rateControl = new RateControl(m_param);
+    m_rateControl = new RateControl(m_param, m_threadPool);
 
     /* Try to open CSV file handle */
     if (m_param->csvfn)
@@ -121,13 +147,30 @@ void Encoder::create()
                     fprintf(m_csvfpt, "Encode Order, Type, POC, QP, Bits, ");
                     if (m_param->rc.rateControlMode == X265_RC_CRF)
                         fprintf(m_csvfpt, "RateFactor, ");
-                    fprintf(m_csvfpt, "Y PSNR, U PSNR, V PSNR, YUV PSNR, SSIM, SSIM (dB), Encoding time, Elapsed time, List 0, List 1\n");
+                    fprintf(m_csvfpt, "Y PSNR, U PSNR, V PSNR, YUV PSNR, SSIM, SSIM (dB), Encoding time, Elapsed time, List 0, List 1");
                 }
                 else
-                    fprintf(m_csvfpt, "Command, Date/Time, Elapsed Time, FPS, Bitrate, Y PSNR, U PSNR, V PSNR, Global PSNR, SSIM, SSIM (dB), Version\n");
+                    fprintf(m_csvfpt, "Command, Date/Time, Elapsed Time, FPS, Bitrate, Y PSNR, U PSNR, V PSNR, Global PSNR, SSIM, SSIM (dB), Version");
+                if (m_param->bEnableMEStats)
+                    fprintf(m_csvfpt, ", %s", meStatsHeader);
+                fputc('\n', m_csvfpt);
             }
         }
     }
+
+    if (m_param->meMapFn)
+    {
+        m_meMapFile = fopen(m_param->meMapFn, "wb");
+        if (!m_meMapFile)
+            x265_log(m_param, X265_LOG_ERROR, "unable to open ME map file <%s>\n", m_param->meMapFn);
+    }
+
+    if (m_param->qualityMapFn)
+    {
+        m_qualityMapFile = fopen(m_param->qualityMapFn, "wb");
+        if (!m_qualityMapFile)
+            x265_log(m_param, X265_LOG_ERROR, "unable to open quality map file <%s>\n", m_param->qualityMapFn);
+    }
 }
 
 void Encoder::destroy()
@@ -169,6 +212,10 @@ void Encoder::destroy()
     X265_FREE(m_param);
     if (m_csvfpt)
         fclose(m_csvfpt);
+    if (m_meMapFile)
+        fclose(m_meMapFile);
+    if (m_qualityMapFile)
+        fclose(m_qualityMapFile);
 }
 
 void Encoder::init()
@@ -186,6 +233,9 @@ void Encoder::init()
             }
         }
     }
+    /* multi-pass planning runs before init(), which resets the ABR state it uses */
+    if (!m_rateControl->initStats())
+        m_aborted = true;
     m_rateControl->init(&m_frameEncoder[0].m_sps);
     m_lookahead->init();
     m_encodeStartTime = x265_mdate();
@@ -320,7 +370,15 @@ int Encoder::encode(bool flush, const x265_picture* pic_in, x265_picture *pic_ou
         bool bEnableWP = m_param->bEnableWeightedPred || m_param->bEnableWeightedBiPred;
         if (m_param->rc.aqMode || bEnableWP)
             m_rateControl->calcAdaptiveQuantFrame(pic);
-        m_lookahead->addPicture(pic, pic_in->sliceType);
+        int sliceType = pic_in->sliceType;
+        if (m_param->rc.bStatRead && sliceType == X265_TYPE_AUTO)
+        {
+            /* use the slice decisions of the previous pass */
+            sliceType = m_rateControl->getPass2SliceType(m_pocLast);
+            if (m_pocLast == m_rateControl->m_numEntries)
+                x265_log(m_param, X265_LOG_WARNING, "more input frames than in the previous pass\n");
+        }
+        m_lookahead->addPicture(pic, sliceType);
     }
 
     if (flush)
@@ -429,7 +487,7 @@ int Encoder::encode(bool flush, const x265_picture* pic_in, x265_picture *pic_ou
          *  - any AnnexB contributions (start_code_prefix, zero_byte, etc.,)
          *  - SEI NAL units
          */
-        uint32_t numRBSPBytes = 0;
+        uint32_t numRBSPBytes = 0, numHeaderBytes = 0;
         for (int count = 0; nalunits[count] != NULL; count++)
         {
             uint32_t numRBSPBytes_nal = nalunits[count]->m_packetSize;
@@ -440,9 +498,14 @@ int Encoder::encode(bool flush, const x265_picture* pic_in, x265_picture *pic_ou
             {
                 numRBSPBytes += numRBSPBytes_nal;
             }
+            if (nalunits[count]->m_nalUnitType >= NAL_UNIT_VPS && nalunits[count]->m_nalUnitType <= NAL_UNIT_PPS)
+            {
+                numHeaderBytes += numRBSPBytes_nal;
+            }
         }
 
         uint64_t bits = numRBSPBytes * 8;
+        curEncoder->m_rce.miscBits = numHeaderBytes * 8;
         m_rateControl->rateControlEnd(out, bits, &curEncoder->m_rce);
         finishFrameStats(out, curEncoder, bits);
 
@@ -694,6 +757,50 @@ void Encoder::printSummary()
             x265_log(m_param, X265_LOG_INFO, "frame B: %s\n", statsString(m_analyzeB, buffer));
         if (m_analyzeAll.m_numPics)
             x265_log(m_param, X265_LOG_INFO, "global : %s\n", statsString(m_analyzeAll, buffer));
+        if (m_param->bEnableMEStats)
+        {
+            for (int depth = 0; depth < MAX_CU_DEPTH; depth++)
+            {
+                const MotionEstimateStats& me = m_meStats[depth];
+                if (!me.searches)
+                    continue;
+                double searches = (double)me.searches;
+                x265_log(m_param, X265_LOG_INFO, "ME %2dx%-2d: searches %.0lf  cands/search: pred %.1lf fpel %.1lf spel %.1lf"
+                         "  subpel iters %.2lf  early-out %.1f%%  avg dist %.2lf  avg |mv| %.2lf\n",
+                         g_maxCUSize >> depth, g_maxCUSize >> depth, searches,
+                         me.predictorCands / searches, me.fullpelCands / searches, me.subpelCands / searches,
+                         me.subpelIters / searches, 100.0 * me.earlyOuts / searches,
+                         me.searchDistance / (4.0 * searches), me.mvLength / (4.0 * searches));
+            }
+        }
+        if (m_param->fastDecision && m_param->rdLevel < 5)
+        {
+            FastDecisionStats fd;
+            for (int i = 0; i < m_totalFrameThreads; i++)
+                for (int row = 0; row < m_frameEncoder[i].m_numRows; row++)
+                    fd.add(m_frameEncoder[i].m_rows[row].m_cuCoder.m_fdStats);
+            if (fd.cuCount)
+                x265_log(m_param, X265_LOG_INFO, "fast-decision: CUs " X265_LL "  depth skips %.1f%%  split stops: neighbour %.1f%% lookahead %.1f%%\n",
+                         fd.cuCount, 100.0 * fd.skipDepth / fd.cuCount,
+                         100.0 * fd.stopSplitNeighbour / fd.cuCount, 100.0 * fd.stopSplitLookahead / fd.cuCount);
+        }
+        if (m_param->bEnableSAO && m_param->bEnableSAOFast && m_param->saoLcuBasedOptimization)
+        {
+            SaoFastStats sf;
+            for (int i = 0; i < m_totalFrameThreads; i++)
+                sf.add(m_frameEncoder[i].getSAO()->m_fastStats);
+            if (sf.ctuCount)
+                x265_log(m_param, X265_LOG_INFO, "sao-fast: CTUs " X265_LL "  merge reuse %.1f%%  chroma skip %.1f%%  band offset windows " X265_LL "\n",
+                         sf.ctuCount, 100.0 * sf.mergeReuse / sf.ctuCount, 100.0 * sf.chromaSkip / sf.ctuCount, sf.boWindows);
+        }
+        if (m_param->bEnableStaticSkip)
+        {
+            uint64_t numStatic = 0;
+            for (int i = 0; i < m_totalFrameThreads; i++)
+                for (int row = 0; row < m_frameEncoder[i].m_numRows; row++)
+                    numStatic += m_frameEncoder[i].m_rows[row].m_cuCoder.m_numStaticCTUs;
+            x265_log(m_param, X265_LOG_INFO, "static-skip: " X265_LL " CTUs coded as static\n", numStatic);
+        }
         if (m_param->bEnableWeightedPred && m_analyzeP.m_numPics)
         {
             x265_log(m_param, X265_LOG_INFO, "Weighted P-Frames: Y:%.1f%% UV:%.1f%%\n",
@@ -762,6 +869,19 @@ void Encoder::fetchStats(x265_stats *stats, size_t statsSizeBytes)
     /* If new statistics are added to x265_stats, we must check here whether the
      * structure provided by the user is the new structure or an older one (for
      * future safety) */
+    if (statsSizeBytes >= sizeof(x265_stats))
+    {
+        MotionEstimateStats total;
+        for (int depth = 0; depth < MAX_CU_DEPTH; depth++)
+            total.add(m_meStats[depth]);
+
+        stats->meSearches = total.searches;
+        stats->meFullpelCands = total.fullpelCands;
+        stats->meSubpelCands = total.subpelCands;
+        stats->meSubpelIters = total.subpelIters;
+        stats->meEarlyOuts = total.earlyOuts;
+        stats->meAvgSearchDistance = total.searches ? total.searchDistance / (4.0 * total.searches) : 0;
+    }
 }
 
 void Encoder::writeLog(int argc, char **argv)
@@ -771,7 +891,10 @@ void Encoder::writeLog(int argc, char **argv)
         if (m_param->logLevel >= X265_LOG_DEBUG)
         {
             fprintf(m_csvfpt, "Summary\n");
-            fprintf(m_csvfpt, "Command, Date/Time, Elapsed Time, FPS, Bitrate, Y PSNR, U PSNR, V PSNR, Global PSNR, SSIM, SSIM (dB), Version\n");
+            fprintf(m_csvfpt, "Command, Date/Time, Elapsed Time, FPS, Bitrate, Y PSNR, U PSNR, V PSNR, Global PSNR, SSIM, SSIM (dB), Version");
+            if (m_param->bEnableMEStats)
+                fprintf(m_csvfpt, ", %s", meStatsHeader);
+            fputc('\n', m_csvfpt);
         }
         // CLI arguments or other
         for (int i = 1; i < argc; i++)
@@ -807,7 +930,10 @@ void Encoder::writeLog(int argc, char **argv)
         else
             fprintf(m_csvfpt, " -, -,");
 
-        fprintf(m_csvfpt, " %s\n", x265_version_str);
+        fprintf(m_csvfpt, " %s", x265_version_str);
+        if (m_param->bEnableMEStats)
+            writeMEStatsCSV(m_csvfpt, m_meStats);
+        fputc('\n', m_csvfpt);
     }
 }
 
@@ -861,6 +987,36 @@ void Encoder::finishFrameStats(TComPic* pic, FrameEncoder *curEncoder, uint64_t
 
     TComSlice*  slice = pic->getSlice();
 
+    if (m_param->bEnableMEStats)
+    {
+        for (int depth = 0; depth < MAX_CU_DEPTH; depth++)
+            m_meStats[depth].add(curEncoder->m_meStats[depth]);
+    }
+
+    if (m_meMapFile && curEncoder->m_meMap)
+    {
+        /* per-CTU motion map record: POC, width and height in CTUs, followed
+         * by one MotionMapEntry per CTU in raster order */
+        int32_t header[3];
+        header[0] = slice->getPOC();
+        header[1] = pic->getPicSym()->getFrameWidthInCU();
+        header[2] = pic->getPicSym()->getFrameHeightInCU();
+        fwrite(header, sizeof(header), 1, m_meMapFile);
+        fwrite(curEncoder->m_meMap, sizeof(MotionMapEntry), curEncoder->m_numCUsInFrame, m_meMapFile);
+    }
+
+    if (m_qualityMapFile && curEncoder->m_qualityMap)
+    {
+        /* per-CTU quality map record, same header as the motion map followed
+         * by one QualityMapEntry per CTU in raster order */
+        int32_t header[3];
+        header[0] = slice->getPOC();
+        header[1] = pic->getPicSym()->getFrameWidthInCU();
+        header[2] = pic->getPicSym()->getFrameHeightInCU();
+        fwrite(header, sizeof(header), 1, m_qualityMapFile);
+        fwrite(curEncoder->m_qualityMap, sizeof(QualityMapEntry), curEncoder->m_numCUsInFrame, m_qualityMapFile);
+    }
+
     //===== add bits, psnr and ssim =====
     m_analyzeAll.addBits(bits);
     m_analyzeAll.addQP(pic->m_avgQpAq);
@@ -921,6 +1077,15 @@ void Encoder::finishFrameStats(TComPic* pic, FrameEncoder *curEncoder, uint64_t
             p += sprintf(buf + p, " [Y:%6.2lf U:%6.2lf V:%6.2lf]", psnrY, psnrU, psnrV);
         if (m_param->bEnableSsim)
             p += sprintf(buf + p, " [SSIM: %.3lfdB]", x265_ssim2dB(ssim));
+        if (m_param->bEnableMEStats && !slice->isIntra())
+        {
+            MotionEstimateStats total;
+            for (int depth = 0; depth < MAX_CU_DEPTH; depth++)
+                total.add(curEncoder->m_meStats[depth]);
+            if (total.searches)
+                p += sprintf(buf + p, " [ME: %d searches, %.1lf fpel %.1lf spel/search]", (int)total.searches,
+                             (double)total.fullpelCands / total.searches, (double)total.subpelCands / total.searches);
+        }
 
         if (!slice->isIntra())
         {
@@ -972,6 +1137,8 @@ void Encoder::finishFrameStats(TComPic* pic, FrameEncoder *curEncoder, uint64_t
             }
             else
                 fprintf(m_csvfpt, ", -, -");
+            if (m_param->bEnableMEStats)
+                writeMEStatsCSV(m_csvfpt, curEncoder->m_meStats);
             fprintf(m_csvfpt, "\n");
         }
 
@@ -1275,6 +1442,19 @@ void Encoder::configure(x265_param *p)
     {
         p->bBPyramid = 0;
     }
+    if (p->rc.bStatWrite && !p->rc.bStatRead && !p->rc.bEnableSlowFirstPass)
+    {
+        /* the first pass only needs the relative cost of each frame */
+        p->maxNumReferences = 1;
+        p->maxNumMergeCand = X265_MIN(p->maxNumMergeCand, 2u);
+        p->bEnableRectInter = 0;
+        p->bEnableAMP = 0;
+        p->searchMethod = X265_DIA_SEARCH;
+        p->subpelRefine = X265_MIN(2, p->subpelRefine);
+        p->bEnableEarlySkip = 1;
+        p->bEnableTransformSkip = 0;
+        p->rdLevel = X265_MIN(2, p->rdLevel);
+    }
 
     m_bEnableRDOQ = p->rdLevel >= 4;
 
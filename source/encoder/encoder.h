@@ -29,6 +29,7 @@
 #include "TLibCommon/TComSlice.h"
 
 #include "piclist.h"
+#include "motion.h"
 
 struct x265_encoder {};
 
@@ -99,6 +100,11 @@ private:
     FILE*              m_csvfpt;
     int64_t            m_encodeStartTime;
 
+    /* motion search statistics per CU depth, and the --me-map output file */
+    MotionEstimateStats m_meStats[MAX_CU_DEPTH];
+    FILE*              m_meMapFile;
+    FILE*              m_qualityMapFile;
+
     // quality control
     TComScalingList    m_scalingList;      ///< quantization matrix information
 
@@ -46,6 +46,8 @@ FrameEncoder::FrameEncoder()
     : WaveFront(NULL)
     , m_threadActive(true)
     , m_rows(NULL)
+    , m_meMap(NULL)
+    , m_qualityMap(NULL)
     , m_top(NULL)
     , m_cfg(NULL)
     , m_pic(NULL)
@@ -86,6 +88,9 @@ void FrameEncoder::destroy()
         delete[] m_rows;
     }
 
+    X265_FREE(m_meMap);
+    X265_FREE(m_qualityMap);
+
     m_frameFilter.destroy();
     // wait for worker thread to exit
     stop();
@@ -98,12 +103,26 @@ bool FrameEncoder::init(Encoder *top, int numRows)
     m_top = top;
     m_cfg = top;
     m_numRows = numRows;
-    m_filterRowDelay = (m_cfg->m_param->saoLcuBasedOptimization && m_cfg->m_param->saoLcuBoundary) ?
-        2 : (m_cfg->m_param->bEnableSAO || m_cfg->m_param->bEnableLoopFilter ? 1 : 0);
+    m_filterRowDelay = (m_cfg->m_param->bEnableSAO || m_cfg->m_param->bEnableLoopFilter) ? 1 : 0;
+
+    uint32_t widthInCU = (m_cfg->m_param->sourceWidth + g_maxCUSize - 1) / g_maxCUSize;
+    m_numCUsInFrame = widthInCU * numRows;
+    if (m_cfg->m_param->meMapFn)
+    {
+        m_meMap = X265_MALLOC(MotionMapEntry, m_numCUsInFrame);
+        ok &= !!m_meMap;
+    }
+    if (m_cfg->m_param->qualityMapFn)
+    {
+        m_qualityMap = X265_MALLOC(QualityMapEntry, m_numCUsInFrame);
+        ok &= !!m_qualityMap;
+        m_frameFilter.m_qualityMap = m_qualityMap;
+    }
 
     m_rows = new CTURow[m_numRows];
     for (int i = 0; i < m_numRows; ++i)
     {
+        m_rows[i].m_search.m_meMap = m_meMap;
         ok &= m_rows[i].create(top);
 
         for (int list = 0; list <= 1; list++)
@@ -516,11 +535,55 @@ void FrameEncoder::compressFrame()
         }
     }
 
+    if (m_cfg->m_param->bEnableMEStats)
+    {
+        for (int i = 0; i < m_numRows; i++)
+            for (int depth = 0; depth < MAX_CU_DEPTH; depth++)
+                m_rows[i].m_search.m_meStats[depth].clear();
+    }
+    if (m_meMap)
+        memset(m_meMap, 0, sizeof(MotionMapEntry) * m_numCUsInFrame);
+    if (m_qualityMap)
+        memset(m_qualityMap, 0, sizeof(QualityMapEntry) * m_numCUsInFrame);
+
+    if (m_cfg->m_param->fastDecision)
+    {
+        /* find the lookahead's inter costs of this picture against its nearest
+         * references, if the lookahead estimated that combination */
+        Lowres& lowres = m_pic->m_lowres;
+        uint16_t* lowresCosts = NULL;
+        if (slice->getSliceType() != I_SLICE)
+        {
+            int poc = slice->getPOC();
+            int b = poc - slice->getRefPOC(REF_PIC_LIST_0, 0);
+            int p1 = slice->getSliceType() == B_SLICE ? b + slice->getRefPOC(REF_PIC_LIST_1, 0) - poc : b;
+            if (b > 0 && b <= lowres.bframes + 1 && p1 - b >= 0 && p1 - b <= lowres.bframes + 1 &&
+                lowres.costEst[b][p1 - b] >= 0)
+                lowresCosts = lowres.lowresCosts[b][p1 - b];
+        }
+        for (int i = 0; i < m_numRows; i++)
+        {
+            m_rows[i].m_cuCoder.m_lowresCosts = lowresCosts;
+            m_rows[i].m_cuCoder.m_lowresWidth = lowres.width >> X265_LOWRES_CU_BITS;
+            m_rows[i].m_cuCoder.m_lowresHeight = lowres.lines >> X265_LOWRES_CU_BITS;
+        }
+    }
+
     // Analyze CTU rows, most of the hard work is done here
     // frame is compressed in a wave-front pattern if WPP is enabled. Loop filter runs as a
     // wave-front behind the CU compression and reconstruction
     compressCTURows();
 
+    if (m_cfg->m_param->bEnableMEStats)
+    {
+        for (int depth = 0; depth < MAX_CU_DEPTH; depth++)
+        {
+            m_meStats[depth].clear();
+            for (int i = 0; i < m_numRows; i++)
+                m_meStats[depth].add(m_rows[i].m_search.m_meStats[depth]);
+        }
+    }
+
     if (m_cfg->m_param->bEnableWavefront)
     {
         slice->setNextSlice(true);
@@ -792,30 +855,9 @@ void FrameEncoder::compressFrame()
     /* write decoded picture hash SEI messages */
     if (m_cfg->m_param->decodedPictureHashSEI)
     {
-        if (m_cfg->m_param->decodedPictureHashSEI == 1)
-        {
-            m_seiReconPictureDigest.method = SEIDecodedPictureHash::MD5;
-            for (int i = 0; i < 3; i++)
-            {
-                MD5Final(&(m_pic->m_state[i]), m_seiReconPictureDigest.digest[i]);
-            }
-        }
-        else if (m_cfg->m_param->decodedPictureHashSEI == 2)
-        {
-            m_seiReconPictureDigest.method = SEIDecodedPictureHash::CRC;
-            for (int i = 0; i < 3; i++)
-            {
-                crcFinish((m_pic->m_crc[i]), m_seiReconPictureDigest.digest[i]);
-            }
-        }
-        else if (m_cfg->m_param->decodedPictureHashSEI == 3)
-        {
-            m_seiReconPictureDigest.method = SEIDecodedPictureHash::CHECKSUM;
-            for (int i = 0; i < 3; i++)
-            {
-                checksumFinish(m_pic->m_checksum[i], m_seiReconPictureDigest.digest[i]);
-            }
-        }
+        // the hasher thread consumes the reconstructed rows as they are filtered
+        m_frameFilter.m_hasher.getDigest(m_seiReconPictureDigest);
+
         m_nalList[m_nalCount] = new NALUnit;
         if (m_nalList[m_nalCount])
         {
@@ -1053,6 +1095,9 @@ void FrameEncoder::compressCTURows()
         m_rows[i].m_rdGoOnBinCodersCABAC.m_fracBits = 0;
         m_rows[i].m_completed = 0;
         m_rows[i].m_busy = false;
+        m_rows[i].m_done = false;
+        m_rows[i].m_filterActive = false;
+        m_rows[i].m_filtered = 0;
     }
 
     bool bUseWeightP = slice->getPPS()->getUseWP() && slice->getSliceType() == P_SLICE;
@@ -1076,6 +1121,9 @@ void FrameEncoder::compressCTURows()
         WaveFront::clearEnabledRowMask();
         WaveFront::enqueue();
 
+        // filter rows run in order, each is enabled when the one above completes
+        enableRowFilter(0);
+
         for (int row = 0; row < m_numRows; row++)
         {
             // block until all reference frames have reconstructed the rows we need
@@ -1188,6 +1236,14 @@ void FrameEncoder::processRowEncoder(int row, const int /* threadId */)
     {
         int col = curRow.m_completed;
         const uint32_t cuAddr = lineStartCUAddr + col;
+        if (!col)
+        {
+            if (m_cfg->m_param->bEnableMEStats)
+                for (int depth = 0; depth < MAX_CU_DEPTH; depth++)
+                    curRow.m_meStatsAtStart[depth] = codeRow.m_search.m_meStats[depth];
+            curRow.m_numStaticCTUsAtStart = codeRow.m_cuCoder.m_numStaticCTUs;
+        }
+
         curRow.m_trQuant.m_nr = &m_nr;
         TComDataCU* cu = m_pic->getCU(cuAddr);
         cu->initCU(m_pic, cuAddr);
@@ -1223,8 +1279,10 @@ void FrameEncoder::processRowEncoder(int row, const int /* threadId */)
         codeRow.m_entropyCoder.setEntropyCoder(&m_sbacCoder, m_pic->getSlice());
         codeRow.m_entropyCoder.resetEntropy();
         codeRow.processCU(cu, m_pic->getSlice(), bufSbac, m_cfg->m_param->bEnableWavefront && col == 1);
-        // Completed CU processing
-        curRow.m_completed++;
+        // Completed CU processing, counted in m_completed only once a VBV
+        // restart can no longer discard it: the loop filter of the row above
+        // deblocks against the completed CUs of this row
+        bool bRestarted = false;
 
         if (bIsVbv)
         {
@@ -1287,6 +1345,18 @@ void FrameEncoder::processRowEncoder(int row, const int /* threadId */)
                             while (bRowBusy);
                         }
 
+                        /* forget the motion searches and static CTUs of the CUs which will be coded again */
+                        if (stopRow.m_completed)
+                        {
+                            CTURow& statsRow = m_rows[m_cfg->m_param->bEnableWavefront ? r : 0];
+                            if (m_cfg->m_param->bEnableMEStats)
+                                for (int depth = 0; depth < MAX_CU_DEPTH; depth++)
+                                    statsRow.m_search.m_meStats[depth] = stopRow.m_meStatsAtStart[depth];
+                            statsRow.m_cuCoder.m_numStaticCTUs = stopRow.m_numStaticCTUsAtStart;
+                        }
+                        if (m_meMap)
+                            memset(m_meMap + r * numCols, 0, sizeof(MotionMapEntry) * numCols);
+
                         stopRow.m_completed = 0;
                         if (m_pic->m_qpaAq)
                             m_pic->m_qpaAq[r] = 0;
@@ -1298,9 +1368,17 @@ void FrameEncoder::processRowEncoder(int row, const int /* threadId */)
                     }
 
                     m_bAllRowsStop = false;
+                    bRestarted = true;
                 }
             }
         }
+        if (!bRestarted)
+            curRow.m_completed++;
+
+        // the last CU of the row triggers the filters once this row exits
+        if (curRow.m_completed < numCols)
+            kickRowFilters(row);
+
         if (curRow.m_completed >= 2 && row < m_numRows - 1)
         {
             ScopedLock below(m_rows[row + 1].m_lock);
@@ -1326,24 +1404,104 @@ void FrameEncoder::processRowEncoder(int row, const int /* threadId */)
 
     // this row of CTUs has been encoded
 
-    // trigger row-wise loop filters
-    if (row >= m_filterRowDelay)
-    {
-        enableRowFilter(row - m_filterRowDelay);
+    m_totalTime += x265_mdate() - startTime;
+    curRow.m_busy = false;
+    curRow.m_done = true;
+    kickRowFilters(row);
+}
+
+/* Returns the number of CUs of the given row which may be deblocked. Filtering
+ * a CU changes its bottom pixels, which the CUs below it (including the one
+ * below-right) predict from, and the SAO statistics of a CU read one pixel
+ * into its right and lower neighbours. So the row below must have coded two
+ * CUs beyond it; the last row only waits for its own right neighbour */
+uint32_t FrameEncoder::getFilterReadyCols(int row)
+{
+    const uint32_t numCols = m_pic->getPicSym()->getFrameWidthInCU();
+
+    // the last CU of a row is only filtered once the encoder thread has left
+    // the row, since finishing the last filter row completes the frame
+    if (!m_filterRowDelay)
+        return m_rows[row].m_done ? numCols : 0;
+
+    const int below = X265_MIN(row + 1, m_numRows - 1);
+    const uint32_t completed = m_rows[below].m_completed;
+    if (completed == numCols)
+        return m_rows[row].m_done ? numCols : numCols - 1;
+
+    // a VBV restart re-encodes every row below the row which triggered it, so
+    // wait for the row below to pass its own diagonal restart checkpoint
+    bool bIsVbv = m_cfg->m_param->rc.vbvBufferSize > 0 && m_cfg->m_param->rc.vbvMaxBitrate > 0;
+    if (bIsVbv && completed <= X265_MIN((uint32_t)below, numCols - 1))
+        return 0;
+
+    // SAO of row 0 starts from the CABAC state of the finished row 0 coder
+    if (!row && m_cfg->m_param->bEnableSAO && m_rows[0].m_completed < numCols)
+        return 0;
+
+    return completed > 1 ? completed - 1 : 0;
+}
+
+/* Queue the filters which may progress after more CUs of this row are coded:
+ * the row above, and the row itself once it is the last row or done */
+void FrameEncoder::kickRowFilters(int row)
+{
+    if (!m_pool || !m_cfg->m_param->bEnableWavefront)
+        return;
+
+    if (row > 0)
+        kickRowFilter(row - 1);
+    if (row == m_numRows - 1 || m_rows[row].m_done)
+        kickRowFilter(row);
+}
 
-        // NOTE: Active Filter to first row (row 0)
-        if (row == m_filterRowDelay)
-            enqueueRowFilter(0);
+/* Queue the filter of this row if it is idle and more of its CUs are ready */
+void FrameEncoder::kickRowFilter(int row)
+{
+    CTURow& filterRow = m_rows[row];
+    ScopedLock self(filterRow.m_lock);
+
+    if (!filterRow.m_filterActive && getFilterReadyCols(row) > filterRow.m_filtered)
+    {
+        filterRow.m_filterActive = true;
+        enqueueRowFilter(row);
     }
-    if (row == m_numRows - 1)
+}
+
+void FrameEncoder::processRowFilter(int row)
+{
+    CTURow& curRow = m_rows[row];
+    const uint32_t numCols = m_pic->getPicSym()->getFrameWidthInCU();
+
+    while (curRow.m_filtered < numCols)
     {
-        for (int i = m_numRows - m_filterRowDelay; i < m_numRows; i++)
+        uint32_t ready = getFilterReadyCols(row);
+        if (ready > curRow.m_filtered)
         {
-            enableRowFilter(i);
+            m_frameFilter.processRow(row, curRow.m_filtered, ready, m_cfg);
+            curRow.m_filtered = ready;
+            continue;
+        }
+
+        // the encoder rows will queue this row again once more CUs are ready
+        ScopedLock self(curRow.m_lock);
+        if (getFilterReadyCols(row) == curRow.m_filtered)
+        {
+            curRow.m_filterActive = false;
+            return;
         }
     }
-    m_totalTime += x265_mdate() - startTime;
-    curRow.m_busy = false;
+
+    if (!m_pool || !m_cfg->m_param->bEnableWavefront)
+        return;
+
+    if (row < m_numRows - 1)
+    {
+        enableRowFilter(row + 1);
+        kickRowFilter(row + 1);
+    }
+    else
+        m_completionEvent.trigger();
 }
 
 int FrameEncoder::calcQpForCu(uint32_t cuAddr, double baseQp)
@@ -66,10 +66,13 @@ public:
 
     void processRowEncoder(int row, const int threadId);
 
-    void processRowFilter(int row)
-    {
-        m_frameFilter.processRow(row, m_cfg);
-    }
+    void processRowFilter(int row);
+
+    uint32_t getFilterReadyCols(int row);
+
+    void kickRowFilter(int row);
+
+    void kickRowFilters(int row);
 
     void enqueueRowEncoder(int row)
     {
@@ -104,12 +107,6 @@ public:
         else
         {
             processRowFilter(realRow);
-
-            // NOTE: Active next row
-            if (realRow != m_numRows - 1)
-                enqueueRowFilter(realRow + 1);
-            else
-                m_completionEvent.trigger();
         }
     }
 
@@ -167,6 +164,13 @@ public:
     RateControlEntry         m_rce;
     SEIDecodedPictureHash    m_seiReconPictureDigest;
 
+    /* motion search statistics of the last compressed frame, per CU depth, and
+     * its per-CTU motion map (allocated only when --me-map is in use) */
+    MotionEstimateStats      m_meStats[MAX_CU_DEPTH];
+    MotionMapEntry*          m_meMap;
+    QualityMapEntry*         m_qualityMap;  // per-CTU quality of the frame (--quality-map)
+    uint32_t                 m_numCUsInFrame;
+
     volatile bool            m_bAllRowsStop;
     volatile int             m_vbvResetTriggerRow;
 
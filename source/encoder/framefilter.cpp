@@ -30,7 +30,7 @@
 using namespace x265;
 
 static uint64_t computeSSD(pixel *fenc, pixel *rec, int stride, int width, int height);
-static float calculateSSIM(pixel *pix1, intptr_t stride1, pixel *pix2, intptr_t stride2, int width, int height, void *buf, int32_t *cnt);
+static float calculateSSIM(pixel *pix1, intptr_t stride1, pixel *pix2, intptr_t stride2, int width, int height, void *buf, int32_t *cnt, QualityMapEntry *ctuMap);
 
 // **************************************************************************
 // * LoopFilter
@@ -39,6 +39,7 @@ FrameFilter::FrameFilter()
     : m_param(NULL)
     , m_rdGoOnBinCodersCABAC(true)
     , m_ssimBuf(NULL)
+    , m_qualityMap(NULL)
 {
 }
 
@@ -56,6 +57,7 @@ void FrameFilter::destroy()
         m_sao.destroyEncBuffer();
     }
     X265_FREE(m_ssimBuf);
+    m_hasher.destroy();
 }
 
 void FrameFilter::init(Encoder *top, int numRows, TEncSbac* rdGoOnSbacCoder)
@@ -64,6 +66,7 @@ void FrameFilter::init(Encoder *top, int numRows, TEncSbac* rdGoOnSbacCoder)
     m_numRows = numRows;
     m_hChromaShift = CHROMA_H_SHIFT(m_param->internalCsp);
     m_vChromaShift = CHROMA_V_SHIFT(m_param->internalCsp);
+    m_hasher.init(m_param, numRows);
 
     // NOTE: for sao only, I write this code because I want to exact match with HM's bug bitstream
     m_rdGoOnSbacCoderRow0 = rdGoOnSbacCoder;
@@ -77,18 +80,20 @@ void FrameFilter::init(Encoder *top, int numRows, TEncSbac* rdGoOnSbacCoder)
     {
         m_sao.setSaoLcuBoundary(top->m_param->saoLcuBoundary);
         m_sao.setSaoLcuBasedOptimization(top->m_param->saoLcuBasedOptimization);
+        m_sao.setSaoFast(top->m_param->bEnableSAOFast && top->m_param->saoLcuBasedOptimization);
         m_sao.setMaxNumOffsetsPerPic(top->m_maxNumOffsetsPerPic);
         m_sao.create(top->m_param->sourceWidth, top->m_param->sourceHeight, g_maxCUSize, g_maxCUSize, m_param->internalCsp);
         m_sao.createEncBuffer();
     }
 
-    if (m_param->bEnableSsim)
+    if (m_param->bEnableSsim || m_qualityMap)
         m_ssimBuf = (int*)x265_malloc(sizeof(int) * 8 * (m_param->sourceWidth / 4 + 3));
 }
 
 void FrameFilter::start(TComPic *pic)
 {
     m_pic = pic;
+    m_hasher.startFrame(pic);
 
     m_saoRowDelay = m_param->bEnableLoopFilter ? 1 : 0;
     m_loopFilter.setCfg(pic->getSlice()->getPPS()->getLoopFilterAcrossTilesEnabledFlag());
@@ -120,41 +125,44 @@ void FrameFilter::end()
 {
 }
 
-void FrameFilter::processRow(int row, Encoder* cfg)
+void FrameFilter::processRow(int row, uint32_t startCol, uint32_t endCol, Encoder* cfg)
 {
     PPAScopeEvent(Thread_filterCU);
 
+    const uint32_t numCols = m_pic->getPicSym()->getFrameWidthInCU();
+
     if (!m_param->bEnableLoopFilter && !m_param->bEnableSAO)
     {
-        processRowPost(row, cfg);
+        if (endCol == numCols)
+            processRowPost(row, cfg);
         return;
     }
 
     // NOTE: We are here only active both of loopfilter and sao, the row 0 always finished, so we can safe to copy row[0]'s data
-    if (row == 0 && m_param->bEnableSAO)
+    if (row == 0 && startCol == 0 && m_param->bEnableSAO)
     {
         // NOTE: not need, seems HM's bug, I want to keep output exact matched.
         m_rdGoOnBinCodersCABAC.m_fracBits = ((TEncBinCABAC*)((TEncSbac*)m_rdGoOnSbacCoderRow0->m_binIf))->m_fracBits;
         m_sao.startSaoEnc(m_pic, &m_entropyCoder, &m_rdGoOnSbacCoder);
     }
 
-    const uint32_t numCols = m_pic->getPicSym()->getFrameWidthInCU();
     const uint32_t lineStartCUAddr = row * numCols;
+    SAOParam* saoParam = m_pic->getPicSym()->getSaoParam();
+    const bool bSaoUnitRdo = m_param->bEnableSAO && m_sao.getSaoLcuBasedOptimization();
 
-    // SAO parameter estimation using non-deblocked pixels for LCU bottom and right boundary areas
-    if (m_param->bEnableSAO && m_param->saoLcuBasedOptimization && m_param->saoLcuBoundary)
+    for (uint32_t col = startCol; col < endCol; col++)
     {
-        m_sao.calcSaoStatsRowCus_BeforeDblk(m_pic, row);
-    }
+        const uint32_t cuAddr = lineStartCUAddr + col;
 
-    if (m_param->bEnableLoopFilter)
-    {
-        for (uint32_t col = 0; col < numCols; col++)
+        // SAO parameter estimation using non-deblocked pixels for LCU bottom and right boundary areas
+        if (m_param->bEnableSAO && m_param->saoLcuBasedOptimization && m_param->saoLcuBoundary)
         {
-            const uint32_t cuAddr = lineStartCUAddr + col;
-            TComDataCU* cu = m_pic->getCU(cuAddr);
+            m_sao.calcSaoStatsCu_BeforeDblk(m_pic, col, row);
+        }
 
-            m_loopFilter.loopFilterCU(cu, EDGE_VER);
+        if (m_param->bEnableLoopFilter)
+        {
+            m_loopFilter.loopFilterCU(m_pic->getCU(cuAddr), EDGE_VER);
 
             if (col > 0)
             {
@@ -163,17 +171,29 @@ void FrameFilter::processRow(int row, Encoder* cfg)
             }
         }
 
+        // the horizontal edges of the CTU to its right are now filtered
+        if (bSaoUnitRdo && col > 1)
         {
-            TComDataCU* cu_prev = m_pic->getCU(lineStartCUAddr + numCols - 1);
-            m_loopFilter.loopFilterCU(cu_prev, EDGE_HOR);
+            m_sao.rdoSaoUnitCU(saoParam, col - 2, row);
         }
     }
 
+    if (endCol < numCols)
+        return;
+
+    if (m_param->bEnableLoopFilter)
+    {
+        TComDataCU* cu_prev = m_pic->getCU(lineStartCUAddr + numCols - 1);
+        m_loopFilter.loopFilterCU(cu_prev, EDGE_HOR);
+    }
+
     // SAO
-    SAOParam* saoParam = m_pic->getPicSym()->getSaoParam();
-    if (m_param->bEnableSAO && m_sao.getSaoLcuBasedOptimization())
+    if (bSaoUnitRdo)
     {
-        m_sao.rdoSaoUnitRow(saoParam, row);
+        for (uint32_t col = numCols > 1 ? numCols - 2 : 0; col < numCols; col++)
+        {
+            m_sao.rdoSaoUnitCU(saoParam, col, row);
+        }
 
         // NOTE: Delay a row because SAO decide need top row pixels at next row, is it HM's bug?
         if (row >= m_saoRowDelay)
@@ -265,33 +285,10 @@ void FrameFilter::processRowPost(int row, Encoder* cfg)
     // Notify other FrameEncoders that this row of reconstructed pixels is available
     m_pic->m_reconRowCount.incr();
 
-    int cuAddr = lineStartCUAddr;
-    if (m_param->bEnablePsnr)
-    {
-        TComPicYuv* orig  = m_pic->getPicYuvOrg();
-
-        int stride = recon->getStride();
-        int width  = recon->getWidth() - cfg->m_pad[0];
-        int height;
-
-        if (row == m_numRows - 1)
-            height = ((recon->getHeight() % g_maxCUSize) ? (recon->getHeight() % g_maxCUSize) : g_maxCUSize);
-        else
-            height = g_maxCUSize;
-
-        uint64_t ssdY = computeSSD(orig->getLumaAddr(cuAddr), recon->getLumaAddr(cuAddr), stride, width, height);
-        height >>= m_vChromaShift;
-        width  >>= m_hChromaShift;
-        stride = recon->getCStride();
+    if (m_param->bEnablePsnr || m_qualityMap)
+        processPsnr(row, realH, cfg);
 
-        uint64_t ssdU = computeSSD(orig->getCbAddr(cuAddr), recon->getCbAddr(cuAddr), stride, width, height);
-        uint64_t ssdV = computeSSD(orig->getCrAddr(cuAddr), recon->getCrAddr(cuAddr), stride, width, height);
-
-        m_pic->m_SSDY += ssdY;
-        m_pic->m_SSDU += ssdU;
-        m_pic->m_SSDV += ssdV;
-    }
-    if (m_param->bEnableSsim && m_ssimBuf)
+    if ((m_param->bEnableSsim || m_qualityMap) && m_ssimBuf)
     {
         pixel *rec = (pixel*)m_pic->getPicYuvRec()->getLumaAddr();
         pixel *org = (pixel*)m_pic->getPicYuvOrg()->getLumaAddr();
@@ -308,15 +305,149 @@ void FrameFilter::processRowPost(int row, Encoder* cfg)
         * to avoid alignment of ssim blocks with DCT blocks. */
         minPixY += bStart ? 2 : -6;
         m_pic->m_ssim += calculateSSIM(rec + 2 + minPixY * stride1, stride1, org + 2 + minPixY * stride2, stride2,
-                                       m_param->sourceWidth - 2, maxPixY - minPixY, m_ssimBuf, &ssim_cnt);
+                                       m_param->sourceWidth - 2, maxPixY - minPixY, m_ssimBuf, &ssim_cnt,
+                                       m_qualityMap ? m_qualityMap + lineStartCUAddr : NULL);
         m_pic->m_ssimCnt += ssim_cnt;
     }
-    if (m_param->decodedPictureHashSEI == 1)
+}
+
+/* SSD of a CTU row of the given luma height, for all three planes, also
+ * accumulated per CTU when a quality map is gathered */
+void FrameFilter::processPsnr(int row, int height, Encoder* cfg)
+{
+    TComPicYuv *recon = m_pic->getPicYuvRec();
+    TComPicYuv *orig  = m_pic->getPicYuvOrg();
+    const uint32_t numCols = m_pic->getPicSym()->getFrameWidthInCU();
+    const uint32_t cuAddr = row * numCols;
+    const int stride = recon->getStride();
+    const int strideC = recon->getCStride();
+    const int heightC = height >> m_vChromaShift;
+    const int width  = recon->getWidth() - cfg->m_pad[0];
+    const int widthC = width >> m_hChromaShift;
+
+    pixel *recY = recon->getLumaAddr(cuAddr);
+    pixel *recU = recon->getCbAddr(cuAddr);
+    pixel *recV = recon->getCrAddr(cuAddr);
+    pixel *orgY = orig->getLumaAddr(cuAddr);
+    pixel *orgU = orig->getCbAddr(cuAddr);
+    pixel *orgV = orig->getCrAddr(cuAddr);
+
+    if (!m_qualityMap)
+    {
+        m_pic->m_SSDY += computeSSD(orgY, recY, stride, width, height);
+        m_pic->m_SSDU += computeSSD(orgU, recU, strideC, widthC, heightC);
+        m_pic->m_SSDV += computeSSD(orgV, recV, strideC, widthC, heightC);
+        return;
+    }
+
+    QualityMapEntry *map = m_qualityMap + cuAddr;
+    const int ctuWidthC = g_maxCUSize >> m_hChromaShift;
+
+    for (uint32_t col = 0; col < numCols; col++)
+    {
+        const int x = col * g_maxCUSize;
+        const int xC = col * ctuWidthC;
+        const int w = X265_MIN((int)g_maxCUSize, width - x);
+        const int wC = X265_MIN(ctuWidthC, widthC - xC);
+        if (w <= 0)
+            break;
+
+        uint64_t ssdY = computeSSD(orgY + x, recY + x, stride, w, height);
+        uint64_t ssdU = computeSSD(orgU + xC, recU + xC, strideC, wC, heightC);
+        uint64_t ssdV = computeSSD(orgV + xC, recV + xC, strideC, wC, heightC);
+
+        m_pic->m_SSDY += ssdY;
+        m_pic->m_SSDU += ssdU;
+        m_pic->m_SSDV += ssdV;
+        map[col].ssd[0] += ssdY;
+        map[col].ssd[1] += ssdU;
+        map[col].ssd[2] += ssdV;
+        map[col].pixels += w * height;
+    }
+}
+
+// **************************************************************************
+// * PictureHasher
+// **************************************************************************
+PictureHasher::PictureHasher()
+    : m_param(NULL)
+    , m_pic(NULL)
+    , m_numRows(0)
+    , m_threadActive(true)
+{
+}
+
+void PictureHasher::init(x265_param *param, int numRows)
+{
+    m_param = param;
+    m_numRows = numRows;
+    m_hChromaShift = CHROMA_H_SHIFT(param->internalCsp);
+    m_vChromaShift = CHROMA_V_SHIFT(param->internalCsp);
+
+    if (m_param->decodedPictureHashSEI)
+        start();
+}
+
+void PictureHasher::destroy()
+{
+    m_threadActive = false;
+    m_enable.trigger();
+    // wait for worker thread to exit
+    stop();
+}
+
+void PictureHasher::startFrame(TComPic *pic)
+{
+    if (!m_param->decodedPictureHashSEI)
+        return;
+
+    m_pic = pic;
+    m_enable.trigger();
+}
+
+void PictureHasher::threadMain()
+{
+    do
     {
-        uint32_t width = recon->getWidth();
-        uint32_t height = recon->getCUHeight(row);
-        uint32_t stride = recon->getStride();
+        m_enable.wait(); // FrameFilter::start() triggers this event
+        if (m_threadActive)
+        {
+            // rows are published in order by FrameFilter::processRowPost()
+            int hashed = 0;
+            while (hashed < m_numRows)
+            {
+                int available = m_pic->m_reconRowCount.get();
+                while (available == hashed)
+                {
+                    available = m_pic->m_reconRowCount.waitForChange(available);
+                }
+
+                for (; hashed < available; hashed++)
+                {
+                    hashRow(hashed);
+                }
+            }
+
+            m_done.trigger(); // PictureHasher::getDigest() blocks for this event
+        }
+    }
+    while (m_threadActive);
+}
+
+void PictureHasher::hashRow(int row)
+{
+    TComPicYuv *recon = m_pic->getPicYuvRec();
+    const uint32_t cuAddr = row * m_pic->getPicSym()->getFrameWidthInCU();
+    const int lastH = ((recon->getHeight() % g_maxCUSize) ? (recon->getHeight() % g_maxCUSize) : g_maxCUSize);
+    const uint32_t height = (row != m_numRows - 1) ? g_maxCUSize : lastH;
+    const uint32_t heightC = height >> m_vChromaShift;
+    const uint32_t width = recon->getWidth();
+    const uint32_t widthC = width >> m_hChromaShift;
+    const uint32_t stride = recon->getStride();
+    const uint32_t strideC = recon->getCStride();
 
+    if (m_param->decodedPictureHashSEI == 1)
+    {
         if (row == 0)
         {
             for (int i = 0; i < 3; i++)
@@ -326,48 +457,60 @@ void FrameFilter::processRowPost(int row, Encoder* cfg)
         }
 
         updateMD5Plane(m_pic->m_state[0], recon->getLumaAddr(cuAddr), width, height, stride);
-        width  >>= m_hChromaShift;
-        height >>= m_vChromaShift;
-        stride = recon->getCStride();
-
-        updateMD5Plane(m_pic->m_state[1], recon->getCbAddr(cuAddr), width, height, stride);
-
-        updateMD5Plane(m_pic->m_state[2], recon->getCrAddr(cuAddr), width, height, stride);
+        updateMD5Plane(m_pic->m_state[1], recon->getCbAddr(cuAddr), widthC, heightC, strideC);
+        updateMD5Plane(m_pic->m_state[2], recon->getCrAddr(cuAddr), widthC, heightC, strideC);
     }
     else if (m_param->decodedPictureHashSEI == 2)
     {
-        uint32_t width = recon->getWidth();
-        uint32_t height = recon->getCUHeight(row);
-        uint32_t stride = recon->getStride();
         if (row == 0)
         {
             m_pic->m_crc[0] = m_pic->m_crc[1] = m_pic->m_crc[2] = 0xffff;
         }
-        updateCRC(recon->getLumaAddr(cuAddr), m_pic->m_crc[0], height, width, stride);
-        width  >>= m_hChromaShift;
-        height >>= m_vChromaShift;
-        stride = recon->getCStride();
 
-        updateCRC(recon->getCbAddr(cuAddr), m_pic->m_crc[1], height, width, stride);
-        updateCRC(recon->getCrAddr(cuAddr), m_pic->m_crc[2], height, width, stride);
+        updateCRC(recon->getLumaAddr(cuAddr), m_pic->m_crc[0], height, width, stride);
+        updateCRC(recon->getCbAddr(cuAddr), m_pic->m_crc[1], heightC, widthC, strideC);
+        updateCRC(recon->getCrAddr(cuAddr), m_pic->m_crc[2], heightC, widthC, strideC);
     }
     else if (m_param->decodedPictureHashSEI == 3)
     {
-        uint32_t width = recon->getWidth();
-        uint32_t height = recon->getCUHeight(row);
-        uint32_t stride = recon->getStride();
-        uint32_t cuHeight = g_maxCUSize;
         if (row == 0)
         {
             m_pic->m_checksum[0] = m_pic->m_checksum[1] = m_pic->m_checksum[2] = 0;
         }
-        updateChecksum(recon->getLumaAddr(), m_pic->m_checksum[0], height, width, stride, row, cuHeight);
-        width  >>= m_hChromaShift;
-        height >>= m_vChromaShift;
-        stride = recon->getCStride();
-        cuHeight >>= m_vChromaShift;
-        updateChecksum(recon->getCbAddr(), m_pic->m_checksum[1], height, width, stride, row, cuHeight);
-        updateChecksum(recon->getCrAddr(), m_pic->m_checksum[2], height, width, stride, row, cuHeight);
+
+        updateChecksum(recon->getLumaAddr(), m_pic->m_checksum[0], height, width, stride, row, g_maxCUSize);
+        updateChecksum(recon->getCbAddr(), m_pic->m_checksum[1], heightC, widthC, strideC, row, g_maxCUSize >> m_vChromaShift);
+        updateChecksum(recon->getCrAddr(), m_pic->m_checksum[2], heightC, widthC, strideC, row, g_maxCUSize >> m_vChromaShift);
+    }
+}
+
+void PictureHasher::getDigest(SEIDecodedPictureHash& digest)
+{
+    m_done.wait();
+
+    if (m_param->decodedPictureHashSEI == 1)
+    {
+        digest.method = SEIDecodedPictureHash::MD5;
+        for (int i = 0; i < 3; i++)
+        {
+            MD5Final(&(m_pic->m_state[i]), digest.digest[i]);
+        }
+    }
+    else if (m_param->decodedPictureHashSEI == 2)
+    {
+        digest.method = SEIDecodedPictureHash::CRC;
+        for (int i = 0; i < 3; i++)
+        {
+            crcFinish((m_pic->m_crc[i]), digest.digest[i]);
+        }
+    }
+    else if (m_param->decodedPictureHashSEI == 3)
+    {
+        digest.method = SEIDecodedPictureHash::CHECKSUM;
+        for (int i = 0; i < 3; i++)
+        {
+            checksumFinish(m_pic->m_checksum[i], digest.digest[i]);
+        }
     }
 }
 
@@ -472,8 +615,11 @@ static uint64_t computeSSD(pixel *fenc, pixel *rec, int stride, int width, int h
     return ssd;
 }
 
-/* Function to calculate SSIM for each row */
-static float calculateSSIM(pixel *pix1, intptr_t stride1, pixel *pix2, intptr_t stride2, int width, int height, void *buf, int32_t* cnt)
+/* Function to calculate SSIM for each row. If ctuMap is not NULL each 8x8
+ * window is also attributed to the CTU of the row holding its centre, so a
+ * last CTU narrower than 16 pixels still gets the windows reaching into it,
+ * and the mean SSIM of those windows is stored for each CTU */
+static float calculateSSIM(pixel *pix1, intptr_t stride1, pixel *pix2, intptr_t stride2, int width, int height, void *buf, int32_t* cnt, QualityMapEntry *ctuMap)
 {
     int z = 0;
     float ssim = 0.0;
@@ -498,7 +644,25 @@ static float calculateSSIM(pixel *pix1, intptr_t stride1, pixel *pix2, intptr_t
 
         for (int x = 0; x < width - 1; x += 4)
         {
-            ssim += primitives.ssim_end_4(sum0 + x, sum1 + x, X265_MIN(4, width - x - 1));
+            float s = primitives.ssim_end_4(sum0 + x, sum1 + x, X265_MIN(4, width - x - 1));
+            ssim += s;
+            if (ctuMap)
+            {
+                // the centre of window x is 4 * x + 6 pixels from the left edge of the picture
+                for (int i = x; i < X265_MIN(x + 4, width - 1); i++)
+                    ctuMap[(4 * i + 6) / g_maxCUSize].ssim += primitives.ssim_end_4(sum0 + i, sum1 + i, 1);
+            }
+        }
+    }
+
+    if (ctuMap && height > 1)
+    {
+        // first is the first window centred in CTU column col
+        for (int col = 0, first = 0; first < width - 1; col++)
+        {
+            int next = X265_MIN(((col + 1) * (int)g_maxCUSize - 3) >> 2, width - 1);
+            ctuMap[col].ssim /= (float)((height - 1) * (next - first));
+            first = next;
         }
     }
 
@@ -27,6 +27,7 @@
 
 #include "TLibCommon/TComPic.h"
 #include "TLibCommon/TComLoopFilter.h"
+#include "TLibCommon/SEI.h"
 #include "TLibEncoder/TEncSampleAdaptiveOffset.h"
 
 namespace x265 {
@@ -34,6 +35,49 @@ namespace x265 {
 
 class Encoder;
 
+/* one CTU of the --quality-map file */
+struct QualityMapEntry
+{
+    uint64_t ssd[3];    // sums of squared differences of Y, U and V
+    uint32_t pixels;    // number of luma samples
+    float    ssim;      // mean SSIM of the luma 8x8 windows attributed to the CTU
+};
+
+// Computes the decoded picture hash of a frame on its own thread, consuming
+// reconstructed rows in order as the filter publishes them
+class PictureHasher : public Thread
+{
+public:
+
+    PictureHasher();
+
+    virtual ~PictureHasher() {}
+
+    void init(x265_param *param, int numRows);
+
+    void destroy();
+
+    void startFrame(TComPic *pic);
+
+    // blocks until every row of the frame has been hashed
+    void getDigest(SEIDecodedPictureHash& digest);
+
+protected:
+
+    void threadMain();
+    void hashRow(int row);
+
+    x265_param*                 m_param;
+    TComPic*                    m_pic;
+    int                         m_numRows;
+    int                         m_hChromaShift;
+    int                         m_vChromaShift;
+
+    Event                       m_enable;
+    Event                       m_done;
+    volatile bool               m_threadActive;
+};
+
 // Manages the processing of a single frame loopfilter
 class FrameFilter
 {
@@ -50,8 +94,11 @@ public:
     void start(TComPic *pic);
     void end();
 
-    void processRow(int row, Encoder* cfg);
+    /* deblock and analyze CTUs [startCol, endCol) of the row; the rest of
+     * the row work runs once endCol reaches the frame width */
+    void processRow(int row, uint32_t startCol, uint32_t endCol, Encoder* cfg);
     void processRowPost(int row, Encoder* cfg);
+    void processPsnr(int row, int height, Encoder* cfg);
     void processSao(int row);
 
 protected:
@@ -68,6 +115,8 @@ public:
     int                         m_numRows;
     int                         m_saoRowDelay;
 
+    PictureHasher               m_hasher;
+
     // SAO
     TEncEntropy                 m_entropyCoder;
     TEncSbac                    m_rdGoOnSbacCoder;
@@ -76,6 +125,8 @@ public:
     TEncSbac*                   m_rdGoOnSbacCoderRow0;  // for bitstream exact only, depends on HM's bug
     /* Temp storage for ssim computation that doesn't need repeated malloc */
     void*                       m_ssimBuf;
+    /* per-CTU quality of the frame, owned by the FrameEncoder (--quality-map) */
+    QualityMapEntry*            m_qualityMap;
 };
 }
 
@@ -95,6 +95,8 @@ static void init_scales(void)
 MotionEstimate::MotionEstimate()
     : searchMethod(3)
     , subpelRefine(5)
+    , stats(NULL)
+    , fpelCands(0)
 {
     if (size_scale[0] == 0)
         init_scales();
@@ -167,6 +169,7 @@ static inline int x265_predictor_difference(const MV *mvc, intptr_t numCandidate
     { \
         MV tmv(mx, my); \
         int cost = sad(fenc, FENC_STRIDE, fref + mx + my * stride, stride); \
+        fpelCands++; \
         cost += mvcost(tmv << 2); \
         if (cost < bcost) { \
             bcost = cost; \
@@ -181,6 +184,7 @@ static inline int x265_predictor_difference(const MV *mvc, intptr_t numCandidate
     { \
         int cost = sad(fenc, FENC_STRIDE, fref + (mx) + (my) * stride, stride); \
         cost += mvcost(MV(mx, my) << 2); \
+        fpelCands++; \
         COPY2_IF_LT(bcost, cost, bmv, MV(mx, my)); \
     } while (0)
 
@@ -192,6 +196,7 @@ static inline int x265_predictor_difference(const MV *mvc, intptr_t numCandidate
                pix_base + (m1x) + (m1y) * stride, \
                pix_base + (m2x) + (m2y) * stride, \
                stride, costs); \
+        fpelCands += 3; \
         (costs)[0] += mvcost((bmv + MV(m0x, m0y)) << 2); \
         (costs)[1] += mvcost((bmv + MV(m1x, m1y)) << 2); \
         (costs)[2] += mvcost((bmv + MV(m2x, m2y)) << 2); \
@@ -205,6 +210,7 @@ static inline int x265_predictor_difference(const MV *mvc, intptr_t numCandidate
                fref + (m2x) + (m2y) * stride, \
                fref + (m3x) + (m3y) * stride, \
                stride, costs); \
+        fpelCands += 4; \
         costs[0] += mvcost(MV(m0x, m0y) << 2); \
         costs[1] += mvcost(MV(m1x, m1y) << 2); \
         costs[2] += mvcost(MV(m2x, m2y) << 2); \
@@ -224,6 +230,7 @@ static inline int x265_predictor_difference(const MV *mvc, intptr_t numCandidate
                pix_base + (m2x) + (m2y) * stride, \
                pix_base + (m3x) + (m3y) * stride, \
                stride, costs); \
+        fpelCands += 4; \
         costs[0] += mvcost((omv + MV(m0x, m0y)) << 2); \
         costs[1] += mvcost((omv + MV(m1x, m1y)) << 2); \
         costs[2] += mvcost((omv + MV(m2x, m2y)) << 2); \
@@ -243,6 +250,7 @@ static inline int x265_predictor_difference(const MV *mvc, intptr_t numCandidate
                pix_base + (m2x) + (m2y) * stride, \
                pix_base + (m3x) + (m3y) * stride, \
                stride, costs); \
+        fpelCands += 4; \
         (costs)[0] += mvcost((bmv + MV(m0x, m0y)) << 2); \
         (costs)[1] += mvcost((bmv + MV(m1x, m1y)) << 2); \
         (costs)[2] += mvcost((bmv + MV(m2x, m2y)) << 2); \
@@ -537,6 +545,7 @@ int MotionEstimate::motionEstimate(ReferencePlanes *ref,
     pixel *fref = ref->fpelPlane + blockOffset;
 
     setMVP(qmvp);
+    fpelCands = 0;
 
     MV qmvmin = mvmin.toQPel();
     MV qmvmax = mvmax.toQPel();
@@ -557,6 +566,7 @@ int MotionEstimate::motionEstimate(ReferencePlanes *ref,
         bprecost = ref->lowresQPelCost(fenc, blockOffset, pmv, sad);
     else
         bprecost = subpelCompare(ref, pmv, sad);
+    int numPredictors = 1;
 
     /* re-measure full pel rounded MVP with SAD as search start point */
     MV bmv = pmv.roundToFPel();
@@ -564,12 +574,14 @@ int MotionEstimate::motionEstimate(ReferencePlanes *ref,
     if (pmv.isSubpel())
     {
         bcost = sad(fenc, FENC_STRIDE, fref + bmv.x + bmv.y * stride, stride) + mvcost(bmv << 2);
+        numPredictors++;
     }
 
     // measure SAD cost at MV(0) if MVP is not zero
     if (pmv.notZero())
     {
         int cost = sad(fenc, FENC_STRIDE, fref, stride) + mvcost(MV(0, 0));
+        numPredictors++;
         if (cost < bcost)
         {
             bcost = cost;
@@ -588,6 +600,7 @@ int MotionEstimate::motionEstimate(ReferencePlanes *ref,
                 cost = ref->lowresQPelCost(fenc, blockOffset, m, sad) + mvcost(m);
             else
                 cost = subpelCompare(ref, m, sad) + mvcost(m);
+            numPredictors++;
 
             if (cost < bprecost)
             {
@@ -828,6 +841,7 @@ me_hex2:
            fref_base x2 * i + (y2 - 2 * k + 4) * dy, \
            fref_base x3 * i + (y3 - 2 * k + 4) * dy, \
            stride, costs + 4 * k); \
+    fpelCands += 4; \
     fref_base += 2 * dy;
 #define ADD_MVCOST(k, x, y) costs[k] += p_cost_omvx[x * 4 * i] + p_cost_omvy[y * 4 * i]
 #define MIN_MV(k, x, y)     COPY2_IF_LT(bcost, costs[k], dir, x * 16 + (y & 15))
@@ -939,6 +953,7 @@ me_hex2:
                                pix_base + RasterDistance * 2,
                                pix_base + RasterDistance * 3,
                                stride, costs);
+                        fpelCands += 4;
                         costs[0] += mvcost(tmv << 2);
                         COPY2_IF_LT(bcost, costs[0], bmv, tmv);
                         tmv.x += RasterDistance;
@@ -1011,6 +1026,7 @@ me_hex2:
                            pix_base + 2,
                            pix_base + 3,
                            stride, costs);
+                    fpelCands += 4;
                     costs[0] += mvcost(tmv << 2);
                     COPY2_IF_LT(bcost, costs[0], bmv, tmv);
                     tmv.x++;
@@ -1045,8 +1061,10 @@ me_hex2:
         bmv = bmv.toQPel(); // promote search bmv to qpel
 
     SubpelWorkload& wl = workload[this->subpelRefine];
+    int subpelCands = 0, subpelIters = 0;
+    bool bSkipSubpel = !bcost;
 
-    if (!bcost)
+    if (bSkipSubpel)
     {
         /* if there was zero residual at the clipped MVP, we can skip subpel
          * refine, but we do need to include the mvcost in the returned cost */
@@ -1083,6 +1101,7 @@ me_hex2:
         {
             bcost = subpelCompare(ref, bmv, satd) + mvcost(bmv);
             hpelcomp = satd;
+            subpelCands++;
         }
         else
             hpelcomp = sad;
@@ -1090,10 +1109,13 @@ me_hex2:
         for (int iter = 0; iter < wl.hpel_iters; iter++)
         {
             int bdir = 0, cost;
+            int32_t subpelCosts[8];
+            subpelCompareNeighbours(ref, bmv, 2, wl.hpel_dirs, hpelcomp, subpelCosts);
+            subpelCands += wl.hpel_dirs;
             for (int i = 1; i <= wl.hpel_dirs; i++)
             {
                 MV qmv = bmv + square1[i] * 2;
-                cost = subpelCompare(ref, qmv, hpelcomp) + mvcost(qmv);
+                cost = subpelCosts[i - 1] + mvcost(qmv);
                 COPY2_IF_LT(bcost, cost, bdir, i);
             }
 
@@ -1102,27 +1124,62 @@ me_hex2:
 
         /* if HPEL search used SAD, remeasure with SATD before QPEL */
         if (!wl.hpel_satd)
+        {
             bcost = subpelCompare(ref, bmv, satd) + mvcost(bmv);
+            subpelCands++;
+        }
 
         for (int iter = 0; iter < wl.qpel_iters; iter++)
         {
             int bdir = 0, cost;
+            int32_t subpelCosts[8];
+            subpelCompareNeighbours(ref, bmv, 1, wl.qpel_dirs, satd, subpelCosts);
+            subpelCands += wl.qpel_dirs;
             for (int i = 1; i <= wl.qpel_dirs; i++)
             {
                 MV qmv = bmv + square1[i];
-                cost = subpelCompare(ref, qmv, satd) + mvcost(qmv);
+                cost = subpelCosts[i - 1] + mvcost(qmv);
                 COPY2_IF_LT(bcost, cost, bdir, i);
             }
 
             bmv += square1[bdir];
         }
+
+        subpelIters = wl.hpel_iters + wl.qpel_iters;
     }
 
     x265_emms();
+
+    if (stats)
+    {
+        stats->searches++;
+        stats->predictorCands += numPredictors;
+        stats->fullpelCands += fpelCands;
+        stats->subpelCands += subpelCands;
+        stats->subpelIters += subpelIters;
+        stats->earlyOuts += bSkipSubpel;
+        stats->searchDistance += abs(bmv.x - qmvp.x) + abs(bmv.y - qmvp.y);
+        stats->mvLength += abs(bmv.x) + abs(bmv.y);
+        stats->cost += bcost;
+    }
+
     outQMv = bmv;
     return bcost;
 }
 
+void MotionEstimate::subpelCompareNeighbours(ReferencePlanes *ref, const MV& qmv, int step, int dirs, pixelcmp_t cmp, int32_t *costs)
+{
+    /* the batched primitives interpolate each column of neighbours once and
+     * score every candidate in a single call */
+    pixel *fref = ref->fpelPlane + blockOffset;
+
+    X265_CHECK(dirs == 4 || dirs == 8, "unsupported subpel neighbour count\n");
+    if (dirs == 8)
+        primitives.luma_subpel_x8[partEnum](fenc, fref, ref->lumaStride, qmv.x, qmv.y, step, cmp, costs);
+    else
+        primitives.luma_subpel_x4[partEnum](fenc, fref, ref->lumaStride, qmv.x, qmv.y, step, cmp, costs);
+}
+
 int MotionEstimate::subpelCompare(ReferencePlanes *ref, const MV& qmv, pixelcmp_t cmp)
 {
     int xFrac = qmv.x & 0x3;
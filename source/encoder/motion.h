@@ -32,6 +32,47 @@
 namespace x265 {
 // private x265 namespace
 
+/* Work counters of the motion search. A MotionEstimate only maintains these
+ * when it has been handed a structure by setStats(), so they cost nothing when
+ * ME statistics are disabled */
+struct MotionEstimateStats
+{
+    uint64_t searches;        // number of motionEstimate() calls
+    uint64_t predictorCands;  // MVP, zero and neighbour predictors measured
+    uint64_t fullpelCands;    // integer pel candidates measured by the search method
+    uint64_t subpelCands;     // half and quarter pel candidates measured
+    uint64_t subpelIters;     // half and quarter pel refinement iterations
+    uint64_t earlyOuts;       // searches which skipped subpel refine (zero residual)
+    uint64_t searchDistance;  // sum of qpel L1 distances between MVP and final MV
+    uint64_t mvLength;        // sum of qpel L1 lengths of the final MVs
+    uint64_t cost;            // sum of returned search costs
+
+    MotionEstimateStats()     { clear(); }
+
+    void clear()              { memset(this, 0, sizeof(*this)); }
+
+    void add(const MotionEstimateStats& other)
+    {
+        searches += other.searches;
+        predictorCands += other.predictorCands;
+        fullpelCands += other.fullpelCands;
+        subpelCands += other.subpelCands;
+        subpelIters += other.subpelIters;
+        earlyOuts += other.earlyOuts;
+        searchDistance += other.searchDistance;
+        mvLength += other.mvLength;
+        cost += other.cost;
+    }
+};
+
+/* one entry of the per-CTU motion map written by --me-map */
+struct MotionMapEntry
+{
+    uint32_t searches;        // motion searches performed within the CTU
+    uint32_t mvLength;        // sum of qpel L1 lengths of the final MVs
+    uint32_t cost;            // sum of returned search costs
+};
+
 class MotionEstimate : public BitCost
 {
 protected:
@@ -51,6 +92,11 @@ protected:
     int searchMethod;
     int subpelRefine;
 
+    /* statistics gathering, stats is NULL unless enabled. fpelCands counts the
+     * integer candidates measured by the current search */
+    MotionEstimateStats *stats;
+    int fpelCands;
+
     /* subpel generation buffers */
     int blockwidth;
     int blockheight;
@@ -71,6 +117,8 @@ public:
 
     void setSubpelRefine(int i) { subpelRefine = i; }
 
+    void setStats(MotionEstimateStats *s) { stats = s; }
+
     /* Methods called at slice setup */
 
     void setSourcePlane(pixel *Y, intptr_t luma)
@@ -94,6 +142,8 @@ public:
 
     int subpelCompare(ReferencePlanes * ref, const MV &qmv, pixelcmp_t);
 
+    void subpelCompareNeighbours(ReferencePlanes * ref, const MV &qmv, int step, int dirs, pixelcmp_t, int32_t *costs);
+
 protected:
 
     inline void StarPatternSearch(ReferencePlanes *ref,
@@ -81,49 +81,179 @@ inline void reduceFraction(int* n, int* d)
     *n /= b;
     *d /= b;
 }
+
+const char     statsMagic[4] = { 'x', '2', 'p', 's' };
+const uint32_t statsVersion  = 1;
+
+/* name of the stats file while a pass is writing it; freed by the caller */
+char* statTempName(const char* fileName)
+{
+    char* tempName = X265_MALLOC(char, strlen(fileName) + 6);
+    if (tempName)
+        sprintf(tempName, "%s.temp", fileName);
+    return tempName;
+}
+
+/* estimated size of a frame of the previous pass when coded with qScale */
+inline double qScale2Bits(RateControlEntry* rce, double qScale)
+{
+    return (rce->texBits + .1) * pow(rce->qScale / qScale, 1.1) + rce->miscBits;
+}
 }  // end anonymous namespace
 /* Compute variance to derive AC energy of each block */
-static inline uint32_t acEnergyVar(TComPic *pic, uint64_t sum_ssd, int shift, int i)
+static inline uint32_t acEnergyVar(uint64_t sum_ssd, int shift, uint64_t* wpSum, uint64_t* wpSsd)
 {
     uint32_t sum = (uint32_t)sum_ssd;
     uint32_t ssd = (uint32_t)(sum_ssd >> 32);
 
-    pic->m_lowres.wp_sum[i] += sum;
-    pic->m_lowres.wp_ssd[i] += ssd;
+    *wpSum += sum;
+    *wpSsd += ssd;
     return ssd - ((uint64_t)sum * sum >> shift);
 }
 
-/* Find the energy of each block in Y/Cb/Cr plane */
-static inline uint32_t acEnergyPlane(TComPic *pic, pixel* src, int srcStride, int bChroma, int colorFormat)
+AQAnalysis::AQAnalysis(ThreadPool *p)
+    : WaveFront(p)
 {
-    if ((colorFormat != X265_CSP_I444) && bChroma)
+    m_param = NULL;
+    m_pic = NULL;
+    m_aqMode = X265_AQ_NONE;
+    m_strength = 0;
+    m_widthInBlocks = m_heightInBlocks = 0;
+    m_rowWpSum = m_rowWpSsd = NULL;
+    m_completedRows = 0;
+    m_bFrameCompleted = false;
+}
+
+AQAnalysis::~AQAnalysis()
+{
+    X265_FREE(m_rowWpSum);
+    X265_FREE(m_rowWpSsd);
+}
+
+bool AQAnalysis::init(x265_param *param)
+{
+    m_param = param;
+    m_widthInBlocks = (m_param->sourceWidth + 15) >> 4;
+    m_heightInBlocks = (m_param->sourceHeight + 15) >> 4;
+    m_rowWpSum = X265_MALLOC(uint64_t, m_heightInBlocks * 3);
+    m_rowWpSsd = X265_MALLOC(uint64_t, m_heightInBlocks * 3);
+    if (!m_rowWpSum || !m_rowWpSsd)
+        return false;
+
+    if (!WaveFront::init(m_heightInBlocks))
+        m_pool = NULL;
+    else
+        WaveFront::enableAllRows();
+    return true;
+}
+
+void AQAnalysis::analyse(TComPic *pic, int aqMode, double strength)
+{
+    m_pic = pic;
+    m_aqMode = aqMode;
+    m_strength = strength;
+
+    if (m_pool)
     {
-        ALIGN_VAR_8(pixel, pix[8 * 8]);
-        primitives.luma_copy_pp[LUMA_8x8](pix, 8, src, srcStride);
-        return acEnergyVar(pic, primitives.var[BLOCK_8x8](pix, 8), 6, bChroma);
+        m_completedRows = 0;
+        m_bFrameCompleted = false;
+
+        WaveFront::enqueue();
+        for (int row = 0; row < m_heightInBlocks; row++)
+            WaveFront::enqueueRow(row);
+
+        // enableAllRows() was called in init, the caller works alongside
+        // the pool threads until the last row is finished
+        while (!m_bFrameCompleted)
+            WaveFront::findJob(-1);
+
+        WaveFront::dequeue();
     }
     else
-        return acEnergyVar(pic, primitives.var[BLOCK_16x16](src, srcStride), 8, bChroma);
+    {
+        for (int row = 0; row < m_heightInBlocks; row++)
+            processRow(row, -1);
+    }
+
+    for (int i = 0; i < 3; i++)
+    {
+        uint64_t sum = 0, ssd = 0;
+        for (int row = 0; row < m_heightInBlocks; row++)
+        {
+            sum += m_rowWpSum[row * 3 + i];
+            ssd += m_rowWpSsd[row * 3 + i];
+        }
+
+        pic->m_lowres.wp_sum[i] = sum;
+        pic->m_lowres.wp_ssd[i] = ssd;
+    }
 }
 
-/* Find the total AC energy of each block in all planes */
-uint32_t RateControl::acEnergyCu(TComPic* pic, uint32_t block_x, uint32_t block_y)
+/* Find the energy of each 16x16 block of one row in all three planes. The
+ * chroma of 4:2:0 and 4:2:2 is measured in 8x8 blocks */
+void AQAnalysis::processRow(int row, int)
 {
-    int stride = pic->getPicYuvOrg()->getStride();
-    int cStride = pic->getPicYuvOrg()->getCStride();
-    uint32_t blockOffsetLuma = block_x + (block_y * stride);
+    /* blocks measured per batch of the var_row primitive */
+    enum { BATCH = 64 };
+
+    TComPicYuv *orig = m_pic->getPicYuvOrg();
+    Lowres &lowres = m_pic->m_lowres;
+    intptr_t stride = orig->getStride();
+    intptr_t cStride = orig->getCStride();
     int colorFormat = m_param->internalCsp;
     int hShift = CHROMA_H_SHIFT(colorFormat);
     int vShift = CHROMA_V_SHIFT(colorFormat);
-    uint32_t blockOffsetChroma = (block_x >> hShift) + ((block_y >> vShift) * cStride);
+    int chromaBlock = colorFormat == X265_CSP_I444 ? BLOCK_16x16 : BLOCK_8x8;
+    int chromaShift = colorFormat == X265_CSP_I444 ? 8 : 6;
+    int block_y = row << 4;
+
+    pixel *luma = orig->getLumaAddr() + block_y * stride;
+    pixel *cb = orig->getCbAddr() + (block_y >> vShift) * cStride;
+    pixel *cr = orig->getCrAddr() + (block_y >> vShift) * cStride;
+
+    uint64_t *wpSum = m_rowWpSum + row * 3;
+    uint64_t *wpSsd = m_rowWpSsd + row * 3;
+    for (int i = 0; i < 3; i++)
+        wpSum[i] = wpSsd[i] = 0;
+
+    uint64_t var[3][BATCH];
+    int block_xy = row * m_widthInBlocks;
+
+    for (int bx = 0; bx < m_widthInBlocks; bx += BATCH)
+    {
+        int numBlocks = X265_MIN(BATCH, m_widthInBlocks - bx);
+        int block_x = bx << 4;
 
-    uint32_t var;
+        primitives.var_row[BLOCK_16x16](luma + block_x, stride, numBlocks, var[0]);
+        primitives.var_row[chromaBlock](cb + (block_x >> hShift), cStride, numBlocks, var[1]);
+        primitives.var_row[chromaBlock](cr + (block_x >> hShift), cStride, numBlocks, var[2]);
+
+        for (int i = 0; i < numBlocks; i++, block_xy++)
+        {
+            uint32_t energy;
+            energy  = acEnergyVar(var[0][i], 8, &wpSum[0], &wpSsd[0]);
+            energy += acEnergyVar(var[1][i], chromaShift, &wpSum[1], &wpSsd[1]);
+            energy += acEnergyVar(var[2][i], chromaShift, &wpSum[2], &wpSsd[2]);
+
+            if (m_aqMode == X265_AQ_AUTO_VARIANCE)
+            {
+                /* the frame average is taken once every row is done */
+                lowres.qpCuTreeOffset[block_xy] = pow(energy + 1, 0.1);
+            }
+            else if (m_aqMode == X265_AQ_VARIANCE)
+            {
+                double qp_adj = m_strength * (X265_LOG2(X265_MAX(energy, 1)) - (14.427f + 2 * (X265_DEPTH - 8)));
+                lowres.qpAqOffset[block_xy] = qp_adj;
+                lowres.qpCuTreeOffset[block_xy] = qp_adj;
+                lowres.invQscaleFactor[block_xy] = x265_exp2fix8(qp_adj);
+            }
+        }
+    }
 
-    var  = acEnergyPlane(pic, pic->getPicYuvOrg()->getLumaAddr() + blockOffsetLuma, stride, 0, colorFormat);
-    var += acEnergyPlane(pic, pic->getPicYuvOrg()->getCbAddr() + blockOffsetChroma, cStride, 1, colorFormat);
-    var += acEnergyPlane(pic, pic->getPicYuvOrg()->getCrAddr() + blockOffsetChroma, cStride, 2, colorFormat);
     x265_emms();
-    return var;
+
+    if (ATOMIC_INC(&m_completedRows) == m_heightInBlocks)
+        m_bFrameCompleted = true;
 }
 
 void RateControl::calcAdaptiveQuantFrame(TComPic *pic)
@@ -131,6 +261,7 @@ void RateControl::calcAdaptiveQuantFrame(TComPic *pic)
     /* Actual adaptive quantization */
     int maxCol = pic->getPicYuvOrg()->getWidth();
     int maxRow = pic->getPicYuvOrg()->getHeight();
+    bool bEnableWP = m_param->bEnableWeightedPred || m_param->bEnableWeightedBiPred;
 
     for (int y = 0; y < 3; y++)
     {
@@ -139,8 +270,6 @@ void RateControl::calcAdaptiveQuantFrame(TComPic *pic)
     }
 
     /* Calculate Qp offset for each 16x16 block in the frame */
-    int block_xy = 0;
-    int block_x = 0, block_y = 0;
     double strength = 0.f;
     if (m_param->rc.aqMode == X265_AQ_NONE || m_param->rc.aqStrength == 0)
     {
@@ -160,69 +289,46 @@ void RateControl::calcAdaptiveQuantFrame(TComPic *pic)
         }
 
         /* Need variance data for weighted prediction */
-        if (m_param->bEnableWeightedPred || m_param->bEnableWeightedBiPred)
-        {
-            for (block_y = 0; block_y < maxRow; block_y += 16)
-            {
-                for (block_x = 0; block_x < maxCol; block_x += 16)
-                {
-                    acEnergyCu(pic, block_x, block_y);
-                }
-            }
-        }
+        if (bEnableWP)
+            m_aq.analyse(pic, X265_AQ_NONE, 0);
     }
-    else
+    else if (m_param->rc.aqMode == X265_AQ_AUTO_VARIANCE)
     {
-        block_xy = 0;
+        m_aq.analyse(pic, X265_AQ_AUTO_VARIANCE, 0);
+
+        /* the rows left pow(energy + 1, 0.1) of each block in qpCuTreeOffset,
+         * averaged here in raster order */
         double avg_adj_pow2 = 0, avg_adj = 0, qp_adj = 0;
-        if (m_param->rc.aqMode == X265_AQ_AUTO_VARIANCE)
+        double bit_depth_correction = pow(1 << (X265_DEPTH - 8), 0.5);
+        int numBlocks = ((maxCol + 15) >> 4) * ((maxRow + 15) >> 4);
+        for (int block_xy = 0; block_xy < numBlocks; block_xy++)
         {
-            double bit_depth_correction = pow(1 << (X265_DEPTH - 8), 0.5);
-            for (block_y = 0; block_y < maxRow; block_y += 16)
-            {
-                for (block_x = 0; block_x < maxCol; block_x += 16)
-                {
-                    uint32_t energy = acEnergyCu(pic, block_x, block_y);
-                    qp_adj = pow(energy + 1, 0.1);
-                    pic->m_lowres.qpCuTreeOffset[block_xy] = qp_adj;
-                    avg_adj += qp_adj;
-                    avg_adj_pow2 += qp_adj * qp_adj;
-                    block_xy++;
-                }
-            }
-
-            avg_adj /= m_ncu;
-            avg_adj_pow2 /= m_ncu;
-            strength = m_param->rc.aqStrength * avg_adj / bit_depth_correction;
-            avg_adj = avg_adj - 0.5f * (avg_adj_pow2 - (11.f * bit_depth_correction)) / avg_adj;
+            qp_adj = pic->m_lowres.qpCuTreeOffset[block_xy];
+            avg_adj += qp_adj;
+            avg_adj_pow2 += qp_adj * qp_adj;
         }
-        else
-            strength = m_param->rc.aqStrength * 1.0397f;
 
-        block_xy = 0;
-        for (block_y = 0; block_y < maxRow; block_y += 16)
+        avg_adj /= m_ncu;
+        avg_adj_pow2 /= m_ncu;
+        strength = m_param->rc.aqStrength * avg_adj / bit_depth_correction;
+        avg_adj = avg_adj - 0.5f * (avg_adj_pow2 - (11.f * bit_depth_correction)) / avg_adj;
+
+        for (int block_xy = 0; block_xy < numBlocks; block_xy++)
         {
-            for (block_x = 0; block_x < maxCol; block_x += 16)
-            {
-                if (m_param->rc.aqMode == X265_AQ_AUTO_VARIANCE)
-                {
-                    qp_adj = pic->m_lowres.qpCuTreeOffset[block_xy];
-                    qp_adj = strength * (qp_adj - avg_adj);
-                }
-                else
-                {
-                    uint32_t energy = acEnergyCu(pic, block_x, block_y);
-                    qp_adj = strength * (X265_LOG2(X265_MAX(energy, 1)) - (14.427f + 2 * (X265_DEPTH - 8)));
-                }
-                pic->m_lowres.qpAqOffset[block_xy] = qp_adj;
-                pic->m_lowres.qpCuTreeOffset[block_xy] = qp_adj;
-                pic->m_lowres.invQscaleFactor[block_xy] = x265_exp2fix8(qp_adj);
-                block_xy++;
-            }
+            qp_adj = pic->m_lowres.qpCuTreeOffset[block_xy];
+            qp_adj = strength * (qp_adj - avg_adj);
+            pic->m_lowres.qpAqOffset[block_xy] = qp_adj;
+            pic->m_lowres.qpCuTreeOffset[block_xy] = qp_adj;
+            pic->m_lowres.invQscaleFactor[block_xy] = x265_exp2fix8(qp_adj);
         }
     }
+    else
+    {
+        strength = m_param->rc.aqStrength * 1.0397f;
+        m_aq.analyse(pic, X265_AQ_VARIANCE, strength);
+    }
 
-    if (m_param->bEnableWeightedPred || m_param->bEnableWeightedBiPred)
+    if (bEnableWP)
     {
         int hShift = CHROMA_H_SHIFT(m_param->internalCsp);
         int vShift = CHROMA_V_SHIFT(m_param->internalCsp);
@@ -241,7 +347,8 @@ void RateControl::calcAdaptiveQuantFrame(TComPic *pic)
     }
 }
 
-RateControl::RateControl(x265_param *p)
+RateControl::RateControl(x265_param *p, ThreadPool *pool)
+    : m_aq(pool)
 {
     m_param = p;
     int lowresCuWidth = ((m_param->sourceWidth / 2) + X265_LOWRES_CU_SIZE - 1) >> X265_LOWRES_CU_BITS;
@@ -363,6 +470,44 @@ RateControl::RateControl(x265_param *p)
 
     /* qstep - value set as encoder specific */
     m_lstep = pow(2, m_param->rc.qpStep / 6.0);
+
+    m_statFileOut = NULL;
+    m_statsIn = NULL;
+    m_rce2Pass = NULL;
+    m_encodeOrder = NULL;
+    m_numEntries = 0;
+    m_interBitsSum = 0;
+    m_expectedBitsSum = 0;
+    m_numInterFrames = 0;
+    m_lastAccumPNorm = 1;
+}
+
+RateControl::~RateControl()
+{
+    if (m_statFileOut)
+    {
+        /* patch the frame count into the header, then replace the stats of
+         * the previous pass */
+        long size = ftell(m_statFileOut);
+        uint32_t numFrames = (uint32_t)((size - sizeof(RateControlStatsHeader)) / sizeof(RateControlStats));
+        fseek(m_statFileOut, offsetof(RateControlStatsHeader, numFrames), SEEK_SET);
+        fwrite(&numFrames, sizeof(numFrames), 1, m_statFileOut);
+        fclose(m_statFileOut);
+
+        char* tempName = statTempName(m_param->rc.statFileName);
+        if (tempName)
+        {
+            remove(m_param->rc.statFileName);
+            if (rename(tempName, m_param->rc.statFileName))
+                x265_log(m_param, X265_LOG_ERROR, "unable to rename stats file <%s> to <%s>\n",
+                         tempName, m_param->rc.statFileName);
+            X265_FREE(tempName);
+        }
+    }
+
+    X265_FREE(m_statsIn);
+    X265_FREE(m_rce2Pass);
+    X265_FREE(m_encodeOrder);
 }
 
 void RateControl::init(TComSPS *sps)
@@ -465,6 +610,335 @@ void RateControl::initHRD(TComSPS *sps)
     #undef MAX_DURATION
 }
 
+bool RateControl::initStats()
+{
+    if (!m_aq.init(m_param))
+    {
+        x265_log(m_param, X265_LOG_ERROR, "unable to allocate adaptive quant analysis buffers\n");
+        return false;
+    }
+
+    if (m_param->rc.bStatRead)
+    {
+        FILE* statFileIn = fopen(m_param->rc.statFileName, "rb");
+        if (!statFileIn)
+        {
+            x265_log(m_param, X265_LOG_ERROR, "unable to open stats file <%s>\n", m_param->rc.statFileName);
+            return false;
+        }
+
+        RateControlStatsHeader header;
+        if (fread(&header, sizeof(header), 1, statFileIn) != 1 ||
+            memcmp(header.magic, statsMagic, sizeof(statsMagic)) || header.version != statsVersion)
+        {
+            x265_log(m_param, X265_LOG_ERROR, "<%s> is not a stats file of this encoder version\n", m_param->rc.statFileName);
+            fclose(statFileIn);
+            return false;
+        }
+        if (header.width != (uint32_t)m_param->sourceWidth || header.height != (uint32_t)m_param->sourceHeight ||
+            header.fpsNum != (uint32_t)m_param->fpsNum || header.fpsDenom != (uint32_t)m_param->fpsDenom ||
+            header.numCUs != (uint32_t)m_ncu)
+        {
+            x265_log(m_param, X265_LOG_ERROR, "stats file was written with a different resolution or frame rate (%dx%d %d/%d)\n",
+                     header.width, header.height, header.fpsNum, header.fpsDenom);
+            fclose(statFileIn);
+            return false;
+        }
+
+        m_numEntries = header.numFrames;
+        m_statsIn = X265_MALLOC(RateControlStats, m_numEntries);
+        m_rce2Pass = X265_MALLOC(RateControlEntry, m_numEntries);
+        m_encodeOrder = X265_MALLOC(int, m_numEntries);
+        if (!m_numEntries || !m_statsIn || !m_rce2Pass || !m_encodeOrder ||
+            fread(m_statsIn, sizeof(RateControlStats), m_numEntries, statFileIn) != (size_t)m_numEntries)
+        {
+            x265_log(m_param, X265_LOG_ERROR, "stats file <%s> is empty or truncated\n", m_param->rc.statFileName);
+            fclose(statFileIn);
+            m_numEntries = 0;
+            return false;
+        }
+        fclose(statFileIn);
+
+        memset(m_rce2Pass, 0, m_numEntries * sizeof(RateControlEntry));
+        for (int i = 0; i < m_numEntries; i++)
+            m_encodeOrder[i] = -1;
+
+        for (int i = 0; i < m_numEntries; i++)
+        {
+            RateControlStats* stats = &m_statsIn[i];
+            if (stats->poc < 0 || stats->poc >= m_numEntries || m_encodeOrder[stats->poc] >= 0)
+            {
+                x265_log(m_param, X265_LOG_ERROR, "stats file <%s> is corrupt, bad POC %d\n", m_param->rc.statFileName, stats->poc);
+                m_numEntries = 0;
+                return false;
+            }
+            m_encodeOrder[stats->poc] = i;
+
+            RateControlEntry* rce = &m_rce2Pass[i];
+            rce->poc = stats->poc;
+            rce->sliceType = IS_X265_TYPE_I(stats->sliceType) ? I_SLICE : IS_X265_TYPE_B(stats->sliceType) ? B_SLICE : P_SLICE;
+            rce->keptAsRef = stats->sliceType != X265_TYPE_B;
+            rce->intraCount = stats->intraCount;
+            rce->miscBits = stats->miscBits;
+            rce->texBits = stats->texBits;
+            rce->qScale = stats->qScale;
+        }
+
+        if (!initPass2())
+        {
+            m_numEntries = 0;
+            return false;
+        }
+    }
+
+    if (m_param->rc.bStatWrite)
+    {
+        /* the stats are written to a temporary file, so an N-pass encode can
+         * read and rewrite the same stats file */
+        char* tempName = statTempName(m_param->rc.statFileName);
+        m_statFileOut = tempName ? fopen(tempName, "wb") : NULL;
+        if (!m_statFileOut)
+        {
+            x265_log(m_param, X265_LOG_ERROR, "unable to open stats file <%s>\n", tempName ? tempName : m_param->rc.statFileName);
+            X265_FREE(tempName);
+            return false;
+        }
+        X265_FREE(tempName);
+
+        RateControlStatsHeader header;
+        memcpy(header.magic, statsMagic, sizeof(statsMagic));
+        header.version = statsVersion;
+        header.width = m_param->sourceWidth;
+        header.height = m_param->sourceHeight;
+        header.fpsNum = m_param->fpsNum;
+        header.fpsDenom = m_param->fpsDenom;
+        header.numCUs = m_ncu;
+        header.numFrames = 0; /* patched when the file is closed */
+        fwrite(&header, sizeof(header), 1, m_statFileOut);
+    }
+
+    return true;
+}
+
+RateControlEntry* RateControl::getPass2Entry(int poc) const
+{
+    if (poc < 0 || poc >= m_numEntries)
+        return NULL;
+    return &m_rce2Pass[m_encodeOrder[poc]];
+}
+
+int RateControl::getPass2SliceType(int poc) const
+{
+    if (poc < 0 || poc >= m_numEntries)
+        return X265_TYPE_AUTO;
+    return m_statsIn[m_encodeOrder[poc]].sliceType;
+}
+
+bool RateControl::initPass2()
+{
+    double allConstBits = 0;
+    double allAvailableBits = m_bitrate * m_numEntries * m_frameDuration;
+    for (int i = 0; i < m_numEntries; i++)
+        allConstBits += m_rce2Pass[i].miscBits;
+
+    if (allAvailableBits < allConstBits)
+    {
+        x265_log(m_param, X265_LOG_ERROR, "requested bitrate is too low, estimated minimum is %d kbps\n",
+                 (int)(allConstBits / (m_numEntries * m_frameDuration * 1000.) + 1));
+        return false;
+    }
+
+    /* Blur complexities, to reduce local fluctuation of QP. The complexities
+     * rather than the QPs are blurred, so a very simple frame can not drag
+     * down the QP of a complex neighbour. Frames beyond a mostly intra frame
+     * (a scene cut) get little weight */
+    double cplxBlur = m_param->rc.complexityBlur;
+    for (int i = 0; i < m_numEntries; i++)
+    {
+        double weightSum = 0, cplxSum = 0, weight = 1.0, gaussianWeight;
+
+        /* weighted average of the complexity of future frames */
+        for (int j = 1; j < cplxBlur * 2 && j < m_numEntries - i; j++)
+        {
+            RateControlEntry* rcj = &m_rce2Pass[i + j];
+            weight *= 1 - pow((double)rcj->intraCount / m_ncu, 2);
+            if (weight < .0001)
+                break;
+            gaussianWeight = weight * exp(-j * j / 200.0);
+            weightSum += gaussianWeight;
+            cplxSum += gaussianWeight * (qScale2Bits(rcj, 1) - rcj->miscBits);
+        }
+
+        /* weighted average of the complexity of past frames */
+        weight = 1.0;
+        for (int j = 0; j <= cplxBlur * 2 && j <= i; j++)
+        {
+            RateControlEntry* rcj = &m_rce2Pass[i - j];
+            gaussianWeight = weight * exp(-j * j / 200.0);
+            weightSum += gaussianWeight;
+            cplxSum += gaussianWeight * (qScale2Bits(rcj, 1) - rcj->miscBits);
+            weight *= 1 - pow((double)rcj->intraCount / m_ncu, 2);
+            if (weight < .0001)
+                break;
+        }
+
+        m_rce2Pass[i].blurredComplexity = cplxSum / weightSum;
+    }
+
+    double* qScale = X265_MALLOC(double, m_numEntries);
+    double* blurredQScale = X265_MALLOC(double, m_numEntries);
+    if (!qScale || !blurredQScale)
+    {
+        X265_FREE(qScale);
+        X265_FREE(blurredQScale);
+        return false;
+    }
+
+    /* bisect the rate factor whose quantizer curve spends the available bits */
+    double expectedBits = planQScale(1.0, qScale, blurredQScale);
+    double stepMult = allAvailableBits / expectedBits;
+    double rateFactor = 0;
+    for (double step = 1E4 * stepMult; step > 1E-7 * stepMult; step *= 0.5)
+    {
+        rateFactor += step;
+        expectedBits = planQScale(rateFactor, qScale, blurredQScale);
+        if (expectedBits > allAvailableBits)
+            rateFactor -= step;
+    }
+
+    expectedBits = planQScale(rateFactor, qScale, blurredQScale);
+
+    X265_FREE(qScale);
+    X265_FREE(blurredQScale);
+
+    if (expectedBits > allAvailableBits * 1.01 || expectedBits < allAvailableBits * 0.99)
+    {
+        double avgQp = 0;
+        for (int i = 0; i < m_numEntries; i++)
+            avgQp += x265_qScale2qp(m_rce2Pass[i].newQScale);
+        avgQp /= m_numEntries;
+        x265_log(m_param, X265_LOG_WARNING, "multi-pass curve failed to converge, target %.0f kbps, expected %.0f kbps, avg QP %.2f\n",
+                 allAvailableBits / (m_numEntries * m_frameDuration * 1000.),
+                 expectedBits / (m_numEntries * m_frameDuration * 1000.), avgQp);
+    }
+
+    /* the planning reused the 1-pass quantizer state */
+    for (int i = 0; i < 3; i++)
+        m_lastQScaleFor[i] = x265_qp2qScale(ABR_INIT_QP_MIN);
+    m_lastNonBPictType = I_SLICE;
+
+    return true;
+}
+
+/* Compute the quantizer curve for one rate factor. Each frame gets the
+ * planned qscale and the bits expected before it; returns the expected size
+ * of the whole stream */
+double RateControl::planQScale(double rateFactor, double* qScale, double* blurredQScale)
+{
+    m_lastNonBPictType = I_SLICE;
+    m_lastAccumPNorm = 1;
+    m_accumPNorm = 0;
+    m_accumPQp = 0;
+
+    for (int i = 0; i < m_numEntries; i++)
+    {
+        qScale[i] = getQScale(&m_rce2Pass[i], rateFactor);
+        m_lastQScaleFor[m_rce2Pass[i].sliceType] = qScale[i];
+    }
+
+    /* fixed I/B qscale relative to P */
+    for (int i = m_numEntries - 1; i >= 0; i--)
+        qScale[i] = getDiffLimitedQScale(&m_rce2Pass[i], qScale[i]);
+
+    /* smooth the curve between frames of the same type */
+    double qblur = m_param->rc.qblur;
+    int filterSize = (int)(qblur * 4) | 1;
+    for (int i = 0; i < m_numEntries; i++)
+    {
+        double q = 0.0, sum = 0.0;
+        for (int j = 0; j < filterSize; j++)
+        {
+            int idx = i + j - filterSize / 2;
+            if (idx < 0 || idx >= m_numEntries || m_rce2Pass[i].sliceType != m_rce2Pass[idx].sliceType)
+                continue;
+            double d = idx - i;
+            double coeff = qblur == 0 ? 1.0 : exp(-d * d / (qblur * qblur));
+            q += qScale[idx] * coeff;
+            sum += coeff;
+        }
+        blurredQScale[i] = q / sum;
+    }
+
+    double expectedBits = 0;
+    for (int i = 0; i < m_numEntries; i++)
+    {
+        RateControlEntry* rce = &m_rce2Pass[i];
+        rce->newQScale = Clip3(MIN_QPSCALE, MAX_MAX_QPSCALE, blurredQScale[i]);
+        rce->expectedBits = expectedBits;
+        expectedBits += qScale2Bits(rce, rce->newQScale);
+    }
+
+    return expectedBits;
+}
+
+/* Derive I and B frame quantizers from the P frames around them, and limit
+ * the change of quantizer between frames of the same type */
+double RateControl::getDiffLimitedQScale(RateControlEntry* rce, double q)
+{
+    int sliceType = rce->sliceType;
+
+    if (sliceType == I_SLICE)
+    {
+        double iq = q;
+        double pq = x265_qp2qScale(m_accumPQp / m_accumPNorm);
+        double ipFactor = fabs(m_param->rc.ipFactor);
+
+        /* don't apply ipFactor if the following frame is also I */
+        if (m_accumPNorm <= 0)
+            q = iq;
+        else if (m_param->rc.ipFactor < 0)
+            q = iq / ipFactor;
+        else if (m_accumPNorm >= 1)
+            q = pq / ipFactor;
+        else
+            q = m_accumPNorm * pq / ipFactor + (1 - m_accumPNorm) * iq;
+    }
+    else if (sliceType == B_SLICE)
+    {
+        if (m_param->rc.pbFactor > 0)
+            q = m_lastQScaleFor[m_lastNonBPictType];
+        if (!rce->keptAsRef)
+            q *= fabs(m_param->rc.pbFactor);
+    }
+    else if (sliceType == P_SLICE && m_lastNonBPictType == P_SLICE && rce->texBits == 0)
+        q = m_lastQScaleFor[P_SLICE];
+
+    /* last qscale / qdiff stuff */
+    if (m_lastNonBPictType == sliceType && (sliceType != I_SLICE || m_lastAccumPNorm < 1))
+    {
+        double lastQ = m_lastQScaleFor[sliceType];
+        q = Clip3(lastQ / m_lstep, lastQ * m_lstep, q);
+    }
+
+    m_lastQScaleFor[sliceType] = q;
+    if (sliceType != B_SLICE)
+        m_lastNonBPictType = sliceType;
+    if (sliceType == I_SLICE)
+    {
+        m_lastAccumPNorm = m_accumPNorm;
+        m_accumPNorm = 0;
+        m_accumPQp = 0;
+    }
+    if (sliceType == P_SLICE)
+    {
+        double mask = 1 - pow((double)rce->intraCount / m_ncu, 2);
+        m_accumPQp = mask * (x265_qScale2qp(q) + m_accumPQp);
+        m_accumPNorm = mask * (1 + m_accumPNorm);
+    }
+
+    return q;
+}
+
 void RateControl::rateControlStart(TComPic* pic, Lookahead *l, RateControlEntry* rce, Encoder* enc)
 {
     m_curSlice = pic->getSlice();
@@ -602,88 +1076,127 @@ double RateControl::rateEstimateQscale(TComPic* pic, RateControlEntry *rce)
     {
         double abrBuffer = 2 * m_param->rc.rateTolerance * m_bitrate;
 
-        /* 1pass ABR */
-
-        /* Calculate the quantizer which would have produced the desired
-         * average bitrate if it had been applied to all frames so far.
-         * Then modulate that quant based on the current frame's complexity
-         * relative to the average complexity so far (using the 2pass RCEQ).
-         * Then bias the quant up or down if total size so far was far from
-         * the target.
-         * Result: Depending on the value of rate_tolerance, there is a
-         * tradeoff between quality and bitrate precision. But at large
-         * tolerances, the bit distribution approaches that of 2pass. */
-
-        double wantedBits, overflow = 1;
-        rce->movingAvgSum = m_shortTermCplxSum;
-        m_shortTermCplxSum *= 0.5;
-        m_shortTermCplxCount *= 0.5;
-        m_shortTermCplxSum += m_currentSatd / (CLIP_DURATION(m_frameDuration) / BASE_FRAME_DURATION);
-        m_shortTermCplxCount++;
-        /* texBits to be used in 2-pass */
-        rce->texBits = m_currentSatd;
-        rce->blurredComplexity = m_shortTermCplxSum / m_shortTermCplxCount;
-        rce->mvBits = 0;
-        rce->sliceType = m_sliceType;
-
-        if (m_param->rc.rateControlMode == X265_RC_CRF)
+        RateControlEntry* rce2 = getPass2Entry(m_curSlice->getPOC());
+        if (rce2)
         {
-            q = getQScale(rce, m_rateFactorConstant);
+            /* 2pass: start from the qscale planned by initPass2(), then correct
+             * for the difference between the bits written so far and the bits
+             * the plan expected at this point of the stream */
+            int64_t predictedBits = m_totalBits + (int64_t)((m_param->frameNumThreads - 1) * m_bitrate * m_frameDuration);
+            double finalBits = m_rce2Pass[m_numEntries - 1].expectedBits;
+
+            /* the closer to the end of the stream, the smaller the buffer. It
+             * never exceeds the bits the plan has left to spend, so the error
+             * can still be made up on clips of a few seconds */
+            if (finalBits > 0)
+            {
+                double videoPos = rce2->expectedBits / finalBits;
+                double scaleFactor = sqrt((1 - videoPos) * m_numEntries);
+                abrBuffer *= 0.5 * X265_MAX(scaleFactor, 0.5);
+                abrBuffer = X265_MIN(abrBuffer, X265_MAX(finalBits - rce2->expectedBits, 0.1 * finalBits));
+            }
+
+            double diff = predictedBits - rce2->expectedBits;
+            q = rce2->newQScale;
+            q /= Clip3(0.5, 2.0, (abrBuffer - diff) / abrBuffer);
+
+            if (m_numInterFrames >= 3 && m_expectedBitsSum > 0)
+            {
+                /* adjust for the error of the size model of the previous pass,
+                 * measured on the P and B frames encoded so far. The error of
+                 * the few I frames does not carry over to the others and is
+                 * left to the buffer above. Start once a few frames were
+                 * measured, so clips shorter than a second are corrected too */
+                double curTime = (double)m_framesDone / m_numEntries;
+                double w = Clip3(0.0, 1.0, curTime * 100);
+                q *= pow((double)m_interBitsSum / m_expectedBitsSum, w);
+            }
         }
         else
         {
-            checkAndResetABR(rce, false);
-            q = getQScale(rce, m_wantedBitsWindow / m_cplxrSum);
-
-            /* ABR code can potentially be counterproductive in CBR, so just
-             * don't bother.  Don't run it if the frame complexity is zero
-             * either. */
-            if (!m_isCbr && m_currentSatd)
+            /* 1pass ABR */
+
+            /* Calculate the quantizer which would have produced the desired
+             * average bitrate if it had been applied to all frames so far.
+             * Then modulate that quant based on the current frame's complexity
+             * relative to the average complexity so far (using the 2pass RCEQ).
+             * Then bias the quant up or down if total size so far was far from
+             * the target.
+             * Result: Depending on the value of rate_tolerance, there is a
+             * tradeoff between quality and bitrate precision. But at large
+             * tolerances, the bit distribution approaches that of 2pass. */
+
+            double wantedBits, overflow = 1;
+            rce->movingAvgSum = m_shortTermCplxSum;
+            m_shortTermCplxSum *= 0.5;
+            m_shortTermCplxCount *= 0.5;
+            m_shortTermCplxSum += m_currentSatd / (CLIP_DURATION(m_frameDuration) / BASE_FRAME_DURATION);
+            m_shortTermCplxCount++;
+            /* texBits to be used in 2-pass */
+            rce->texBits = m_currentSatd;
+            rce->blurredComplexity = m_shortTermCplxSum / m_shortTermCplxCount;
+            rce->mvBits = 0;
+            rce->sliceType = m_sliceType;
+
+            if (m_param->rc.rateControlMode == X265_RC_CRF)
+            {
+                q = getQScale(rce, m_rateFactorConstant);
+            }
+            else
             {
-                /* use framesDone instead of POC as poc count is not serial with bframes enabled */
-                double timeDone = (double)(m_framesDone - m_param->frameNumThreads + 1) * m_frameDuration;
-                wantedBits = timeDone * m_bitrate;
-                if (wantedBits > 0 && m_totalBits > 0 && !m_residualFrames)
+                checkAndResetABR(rce, false);
+                q = getQScale(rce, m_wantedBitsWindow / m_cplxrSum);
+
+                /* ABR code can potentially be counterproductive in CBR, so just
+                 * don't bother.  Don't run it if the frame complexity is zero
+                 * either. */
+                if (!m_isCbr && m_currentSatd)
                 {
-                    abrBuffer *= X265_MAX(1, sqrt(timeDone));
-                    overflow = Clip3(.5, 2.0, 1.0 + (m_totalBits - wantedBits) / abrBuffer);
-                    q *= overflow;
+                    /* use framesDone instead of POC as poc count is not serial with bframes enabled */
+                    double timeDone = (double)(m_framesDone - m_param->frameNumThreads + 1) * m_frameDuration;
+                    wantedBits = timeDone * m_bitrate;
+                    if (wantedBits > 0 && m_totalBits > 0 && !m_residualFrames)
+                    {
+                        abrBuffer *= X265_MAX(1, sqrt(timeDone));
+                        overflow = Clip3(.5, 2.0, 1.0 + (m_totalBits - wantedBits) / abrBuffer);
+                        q *= overflow;
+                    }
                 }
             }
-        }
 
-        if (m_sliceType == I_SLICE && m_param->keyframeMax > 1
-            && m_lastNonBPictType != I_SLICE && !m_isAbrReset)
-        {
-            q = x265_qp2qScale(m_accumPQp / m_accumPNorm);
-            q /= fabs(m_param->rc.ipFactor);
-        }
-        else if (m_framesDone > 0)
-        {
-            if (m_param->rc.rateControlMode != X265_RC_CRF)
+            if (m_sliceType == I_SLICE && m_param->keyframeMax > 1
+                && m_lastNonBPictType != I_SLICE && !m_isAbrReset)
             {
-                double lqmin = 0, lqmax = 0;
-                lqmin = m_lastQScaleFor[m_sliceType] / m_lstep;
-                lqmax = m_lastQScaleFor[m_sliceType] * m_lstep;
-                if (!m_residualFrames)
+                q = x265_qp2qScale(m_accumPQp / m_accumPNorm);
+                q /= fabs(m_param->rc.ipFactor);
+            }
+            else if (m_framesDone > 0)
+            {
+                if (m_param->rc.rateControlMode != X265_RC_CRF)
                 {
-                    if (overflow > 1.1 && m_framesDone > 3)
-                        lqmax *= m_lstep;
-                    else if (overflow < 0.9)
-                        lqmin /= m_lstep;
+                    double lqmin = 0, lqmax = 0;
+                    lqmin = m_lastQScaleFor[m_sliceType] / m_lstep;
+                    lqmax = m_lastQScaleFor[m_sliceType] * m_lstep;
+                    if (!m_residualFrames)
+                    {
+                        if (overflow > 1.1 && m_framesDone > 3)
+                            lqmax *= m_lstep;
+                        else if (overflow < 0.9)
+                            lqmin /= m_lstep;
+                    }
+                    q = Clip3(lqmin, lqmax, q);
                 }
-                q = Clip3(lqmin, lqmax, q);
             }
-        }
-        else if (m_qCompress != 1 && m_param->rc.rateControlMode == X265_RC_CRF)
-        {
-            q = x265_qp2qScale(CRF_INIT_QP) / fabs(m_param->rc.ipFactor);
-        }
-        else if (m_framesDone == 0 && !m_isVbv)
-        {
-            /* for ABR alone, clip the first I frame qp */
-            double lqmax = x265_qp2qScale(ABR_INIT_QP_MAX) * m_lstep;
-            q = X265_MIN(lqmax, q);
+            else if (m_qCompress != 1 && m_param->rc.rateControlMode == X265_RC_CRF)
+            {
+                q = x265_qp2qScale(CRF_INIT_QP) / fabs(m_param->rc.ipFactor);
+            }
+            else if (m_framesDone == 0 && !m_isVbv)
+            {
+                /* for ABR alone, clip the first I frame qp */
+                double lqmax = x265_qp2qScale(ABR_INIT_QP_MAX) * m_lstep;
+                q = X265_MIN(lqmax, q);
+            }
         }
 
         q = Clip3(MIN_QPSCALE, MAX_MAX_QPSCALE, q);
@@ -1112,6 +1625,30 @@ double RateControl::getQScale(RateControlEntry *rce, double rateFactor)
     return q;
 }
 
+void RateControl::writeStats(TComPic* pic, int64_t bits, RateControlEntry* rce)
+{
+    TComSlice* slice = pic->getSlice();
+    RateControlStats stats;
+
+    stats.poc = rce->poc;
+    stats.sliceType = pic->m_lowres.sliceType;
+    if (slice->getSliceType() == I_SLICE)
+        stats.intraCount = m_ncu;
+    else
+    {
+        /* the lookahead's intra estimate for the distance to the L0 reference */
+        int dist = Clip3(0, X265_BFRAME_MAX + 1, slice->getPOC() - slice->getRefPOC(REF_PIC_LIST_0, 0));
+        stats.intraCount = pic->m_lowres.intraMbs[dist];
+    }
+    stats.miscBits = rce->miscBits;
+    stats.qScale = x265_qp2qScale(pic->m_avgQpRc);
+    stats.texBits = bits - rce->miscBits;
+    stats.satdCost = m_isAbr ? rce->lastSatd : 0;
+
+    if (fwrite(&stats, sizeof(stats), 1, m_statFileOut) != 1)
+        x265_log(m_param, X265_LOG_WARNING, "unable to write stats of POC %d\n", rce->poc);
+}
+
 void RateControl::updatePredictor(Predictor *p, double q, double var, double bits)
 {
     if (var < 10)
@@ -1156,7 +1693,7 @@ int RateControl::rateControlEnd(TComPic* pic, int64_t bits, RateControlEntry* rc
     int64_t actualBits = bits;
     if (m_isAbr)
     {
-        if (m_param->rc.rateControlMode == X265_RC_ABR)
+        if (m_param->rc.rateControlMode == X265_RC_ABR && !m_param->rc.bStatRead)
         {
             checkAndResetABR(rce, true);
         }
@@ -1202,8 +1739,9 @@ int RateControl::rateControlEnd(TComPic* pic, int64_t bits, RateControlEntry* rc
             }
 
             /* amortize part of each I slice over the next several frames, up to
-             * keyint-max, to avoid over-compensating for the large I slice cost */
-            if (rce->sliceType == I_SLICE)
+             * keyint-max, to avoid over-compensating for the large I slice cost.
+             * The plan of a multi-pass encode already accounts for it */
+            if (rce->sliceType == I_SLICE && !m_param->rc.bStatRead)
             {
                 /* previous I still had a residual; roll it into the new loan */
                 if (m_residualFrames)
@@ -1231,9 +1769,20 @@ int RateControl::rateControlEnd(TComPic* pic, int64_t bits, RateControlEntry* rc
             }
             m_wantedBitsWindow += m_frameDuration * m_bitrate;
             m_totalBits += bits;
+
+            RateControlEntry* rce2 = getPass2Entry(rce->poc);
+            if (rce2 && rce->sliceType != I_SLICE)
+            {
+                m_interBitsSum += bits;
+                m_expectedBitsSum += qScale2Bits(rce2, x265_qp2qScale(rce->qpaRc));
+                m_numInterFrames++;
+            }
         }
     }
 
+    if (m_statFileOut)
+        writeStats(pic, actualBits, rce);
+
     if (m_isVbv)
     {
         if (rce->sliceType == B_SLICE)
@@ -26,6 +26,8 @@
 #ifndef X265_RATECONTROL_H
 #define X265_RATECONTROL_H
 
+#include "wavefront.h"
+
 namespace x265 {
 // encoder namespace
 
@@ -51,6 +53,32 @@ struct Predictor
     double offset;
 };
 
+/* Header of the multi-pass stats file. It is followed by one RateControlStats
+ * record per frame, in encode order. Both are fixed size and naturally aligned
+ * so the whole file can be read (or mapped) in one operation */
+struct RateControlStatsHeader
+{
+    char     magic[4];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t fpsNum;
+    uint32_t fpsDenom;
+    uint32_t numCUs;     /* lowres CUs per frame */
+    uint32_t numFrames;
+};
+
+struct RateControlStats
+{
+    int32_t  poc;
+    int32_t  sliceType;  /* X265_TYPE_* decided by the lookahead */
+    int32_t  intraCount; /* lowres CUs the lookahead estimated as intra */
+    int32_t  miscBits;   /* parameter set bits */
+    double   qScale;     /* average qscale of the frame */
+    int64_t  texBits;    /* all other bits of the frame */
+    int64_t  satdCost;   /* lookahead cost of the frame */
+};
+
 struct RateControlEntry
 {
     int64_t texBits;  /* Required in 2-pass rate control */
@@ -58,6 +86,12 @@ struct RateControlEntry
 
     int sliceType;
     int mvBits;
+    int miscBits;     /* parameter set bits, set by the encoder before rateControlEnd() */
+    int intraCount;   /* 2-pass: lowres CUs estimated as intra by the previous pass */
+    bool keptAsRef;   /* 2-pass: B frame used as a reference */
+    double qScale;    /* 2-pass: average qscale of the previous pass */
+    double newQScale; /* 2-pass: qscale planned by initPass2() */
+    double expectedBits; /* 2-pass: bits the plan expects to have been written before this frame */
     int bframes;
     int poc;
     int64_t leadingNoBSatd;
@@ -76,6 +110,39 @@ struct RateControlEntry
     bool isActive;
 };
 
+/* Measures the AC energy of each 16x16 block of an input picture for
+ * adaptive quant, and the plane sums used by weighted prediction. Each row
+ * of blocks is a job; with a thread pool the caller helps the workers until
+ * every row is done, without one the rows are walked in order */
+class AQAnalysis : public WaveFront
+{
+public:
+
+    AQAnalysis(ThreadPool *p);
+    ~AQAnalysis();
+    bool init(x265_param *param);
+
+    /* aqMode X265_AQ_NONE only gathers the weightp sums */
+    void analyse(TComPic *pic, int aqMode, double strength);
+
+protected:
+
+    x265_param*   m_param;
+    TComPic*      m_pic;
+    int           m_aqMode;
+    double        m_strength;
+
+    int           m_widthInBlocks;
+    int           m_heightInBlocks;
+    uint64_t*     m_rowWpSum;      /* [row * 3 + plane] */
+    uint64_t*     m_rowWpSsd;
+
+    volatile int  m_completedRows;
+    volatile bool m_bFrameCompleted;
+
+    void processRow(int row, int threadId);
+};
+
 class RateControl
 {
 public:
@@ -132,12 +199,26 @@ public:
     int64_t  m_totalBits;        /* total bits used for already encoded frames */
     int      m_framesDone;       /* # of frames passed through RateCotrol already */
 
+    /* multi-pass */
+    FILE*             m_statFileOut;
+    RateControlStats* m_statsIn;      /* stats of the previous pass, in encode order */
+    RateControlEntry* m_rce2Pass;     /* per-frame plan built from m_statsIn */
+    int*              m_encodeOrder;  /* POC -> index in m_statsIn */
+    int               m_numEntries;
+    int64_t           m_interBitsSum;    /* bits of the P and B frames encoded so far */
+    double            m_expectedBitsSum; /* their size predicted from the previous pass */
+    int               m_numInterFrames;  /* # of frames in m_interBitsSum */
+    double            m_lastAccumPNorm;
+
     /* hrd stuff */
     SEIBufferingPeriod m_sei;
     double   m_nominalRemovalTime;
     double   m_prevCpbFinalAT;
 
-    RateControl(x265_param *p);
+    AQAnalysis m_aq;
+
+    RateControl(x265_param *p, ThreadPool *pool);
+    ~RateControl();
 
     // to be called for each frame to process RateControl and set QP
     void rateControlStart(TComPic* pic, Lookahead *, RateControlEntry* rce, Encoder* enc);
@@ -149,6 +230,12 @@ public:
     void init(TComSPS* sps);
     void initHRD(TComSPS* sps);
 
+    /* allocate the AQ analysis buffers, then open the stats file(s) of a
+     * multi-pass encode and plan the second pass */
+    bool initStats();
+    /* slice type decided by the previous pass, or X265_TYPE_AUTO */
+    int  getPass2SliceType(int poc) const;
+
 protected:
 
     static const double s_amortizeFraction;
@@ -158,9 +245,13 @@ protected:
     int m_residualCost;
 
     double getQScale(RateControlEntry *rce, double rateFactor);
+    double getDiffLimitedQScale(RateControlEntry *rce, double q);
+    double planQScale(double rateFactor, double* qScale, double* blurredQScale);
+    bool   initPass2();
+    RateControlEntry* getPass2Entry(int poc) const;
+    void   writeStats(TComPic* pic, int64_t bits, RateControlEntry* rce);
     double rateEstimateQscale(TComPic* pic, RateControlEntry *rce); // main logic for calculating QP based on ABR
     void accumPQpUpdate();
-    uint32_t acEnergyCu(TComPic* pic, uint32_t block_x, uint32_t block_y);
 
     void updateVbv(int64_t bits, RateControlEntry* rce);
     void updatePredictor(Predictor *p, double q, double var, double bits);
@@ -587,7 +587,34 @@ void Lookahead::slicetypeAnalyse(Lowres **frames, bool bKeyframe)
 
     if (!framecnt)
     {
-        if (m_param->rc.cuTree)
+        if (m_param->rc.cuTree && m_param->rc.bStatRead)
+        {
+            /* the previous pass typed every frame of the lookahead; propagate
+             * over them up to the next keyframe like that pass did, before the
+             * B references of the pyramid were chosen */
+            for (; framecnt < maxSearch && frames[framecnt + 1]; framecnt++)
+            {
+                if (IS_X265_TYPE_I(frames[framecnt + 1]->sliceType))
+                    break;
+            }
+
+            bool bRef[X265_LOOKAHEAD_MAX + 1];
+            for (int j = 1; j <= framecnt; j++)
+            {
+                bRef[j] = frames[j]->sliceType == X265_TYPE_BREF;
+                if (bRef[j])
+                    frames[j]->sliceType = X265_TYPE_B;
+            }
+
+            cuTree(frames, framecnt, bKeyframe);
+
+            for (int j = 1; j <= framecnt; j++)
+            {
+                if (bRef[j])
+                    frames[j]->sliceType = X265_TYPE_BREF;
+            }
+        }
+        else if (m_param->rc.cuTree)
             cuTree(frames, 0, bKeyframe);
         return;
     }
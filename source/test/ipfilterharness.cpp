@@ -562,6 +562,39 @@ bool IPFilterHarness::check_IPFilterLumaHV_primitive(filter_hv_pp_t ref, filter_
     return true;
 }
 
+bool IPFilterHarness::check_IPFilterLuma_subpel_primitive(subpelcmp_t ref, subpelcmp_t opt, pixelcmp_t sad, pixelcmp_t satd)
+{
+    intptr_t rand_srcStride;
+
+    for (int i = 0; i < ITERS; i++)
+    {
+        int index = i % TEST_CASES;
+        int32_t ref_res[8], opt_res[8];
+
+        for (int step = 1; step <= 2; step++)
+        {
+            rand_srcStride = rand() % 100 + 80;
+            int qmvx = (rand() % 33) - 16;
+            int qmvy = (rand() % 33) - 16;
+            pixelcmp_t cmp = (rand() & 1) ? sad : satd;
+            pixel *fref = pixel_test_buff[index] + 8 * rand_srcStride + 8;
+
+            memset(ref_res, 0xCD, sizeof(ref_res));
+            memset(opt_res, 0xCD, sizeof(opt_res));
+
+            ref(pixel_buff, fref, rand_srcStride, qmvx, qmvy, step, cmp, ref_res);
+            checked(opt, pixel_buff, fref, rand_srcStride, qmvx, qmvy, step, cmp, opt_res);
+
+            if (memcmp(ref_res, opt_res, sizeof(ref_res)))
+                return false;
+
+            reportfail();
+        }
+    }
+
+    return true;
+}
+
 bool IPFilterHarness::testCorrectness(const EncoderPrimitives& ref, const EncoderPrimitives& opt)
 {
     if (opt.luma_p2s)
@@ -632,6 +665,24 @@ bool IPFilterHarness::testCorrectness(const EncoderPrimitives& ref, const Encode
                 return false;
             }
         }
+        if (opt.luma_subpel_x4[value])
+        {
+            if (!check_IPFilterLuma_subpel_primitive(ref.luma_subpel_x4[value], opt.luma_subpel_x4[value],
+                                                     ref.sad[value], ref.satd[value]))
+            {
+                printf("luma_subpel_x4[%s]", lumaPartStr[value]);
+                return false;
+            }
+        }
+        if (opt.luma_subpel_x8[value])
+        {
+            if (!check_IPFilterLuma_subpel_primitive(ref.luma_subpel_x8[value], opt.luma_subpel_x8[value],
+                                                     ref.sad[value], ref.satd[value]))
+            {
+                printf("luma_subpel_x8[%s]", lumaPartStr[value]);
+                return false;
+            }
+        }
     }
 
     for (int csp = X265_CSP_I420; csp < X265_CSP_COUNT; csp++)
@@ -770,6 +821,22 @@ void IPFilterHarness::measureSpeed(const EncoderPrimitives& ref, const EncoderPr
             REPORT_SPEEDUP(opt.luma_hvpp[value], ref.luma_hvpp[value],
                            pixel_buff + 3 * srcStride, srcStride, IPF_vec_output_p, srcStride, 1, 3);
         }
+
+        if (opt.luma_subpel_x4[value])
+        {
+            int32_t res[8];
+            printf("subpel_x4[%s]\t", lumaPartStr[value]);
+            REPORT_SPEEDUP(opt.luma_subpel_x4[value], ref.luma_subpel_x4[value],
+                           IPF_vec_output_p, pixel_buff + 8 * srcStride + 8, srcStride, 5, 6, 1, ref.satd[value], res);
+        }
+
+        if (opt.luma_subpel_x8[value])
+        {
+            int32_t res[8];
+            printf("subpel_x8[%s]\t", lumaPartStr[value]);
+            REPORT_SPEEDUP(opt.luma_subpel_x8[value], ref.luma_subpel_x8[value],
+                           IPF_vec_output_p, pixel_buff + 8 * srcStride + 8, srcStride, 4, 8, 2, ref.satd[value], res);
+        }
     }
 
     for (int csp = X265_CSP_I420; csp < X265_CSP_COUNT; csp++)
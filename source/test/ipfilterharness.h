@@ -53,6 +53,7 @@ protected:
     bool check_IPFilterLuma_sp_primitive(filter_sp_t ref, filter_sp_t opt);
     bool check_IPFilterLuma_ss_primitive(filter_ss_t ref, filter_ss_t opt);
     bool check_IPFilterLumaHV_primitive(filter_hv_pp_t ref, filter_hv_pp_t opt);
+    bool check_IPFilterLuma_subpel_primitive(subpelcmp_t ref, subpelcmp_t opt, pixelcmp_t sad, pixelcmp_t satd);
 
 public:
 
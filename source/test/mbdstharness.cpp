@@ -129,6 +129,8 @@ MBDstHarness::MBDstHarness()
     memset(mintbuf7, 0, mem_cmp_size);
     memset(mintbuf8, 0, mem_cmp_size);
 #endif // if _DEBUG
+
+    initROM(); // scan orders
     return;
 
 fail:
@@ -208,6 +210,41 @@ bool MBDstHarness::check_idct_primitive(idct_t ref, idct_t opt, intptr_t width)
     return true;
 }
 
+/* corner kernels must match the full inverse transform given any block whose
+ * non-zero coefficients lie within the top-left corner x corner */
+bool MBDstHarness::check_idct_corner_primitive(idct_t full, idct_t ref, idct_t opt, intptr_t width, int corner)
+{
+    intptr_t cmp_size = sizeof(int16_t) * width * width;
+
+    for (int i = 0; i <= 100; i++)
+    {
+        int index = rand() % TEST_CASES;
+        int *src = int_idct_test_buff[index] + (rand() % 16) * 16;
+
+        memset(mintbuf3, 0, sizeof(int) * width * width);
+        for (int y = 0; y < corner; y++)
+        {
+            for (int x = 0; x < corner; x++)
+            {
+                mintbuf3[y * width + x] = src[y * width + x];
+            }
+        }
+
+        full(mintbuf3, mbuf2, width);
+        ref(mintbuf3, mbuf3, width);
+        if (memcmp(mbuf2, mbuf3, cmp_size))
+            return false;
+
+        checked(opt, mintbuf3, mbuf3, width);
+        if (memcmp(mbuf2, mbuf3, cmp_size))
+            return false;
+
+        reportfail();
+    }
+
+    return true;
+}
+
 bool MBDstHarness::check_dequant_primitive(dequant_normal_t ref, dequant_normal_t opt)
 {
     int j = 0;
@@ -365,6 +402,106 @@ bool MBDstHarness::check_count_nonzero_primitive(count_nonzero_t ref, count_nonz
     return true;
 }
 
+bool MBDstHarness::check_scan_poslast_primitive(scan_poslast_t ref, scan_poslast_t opt)
+{
+    ALIGN_VAR_32(int32_t, qcoeff[32 * 32]);
+    uint16_t refFlag[MLS_GRP_NUM], optFlag[MLS_GRP_NUM];
+    uint16_t refSign[MLS_GRP_NUM], optSign[MLS_GRP_NUM];
+    uint8_t refNum[MLS_GRP_NUM], optNum[MLS_GRP_NUM];
+
+    for (int i = 0; i < 4; i++)
+    {
+        int log2TrSize = i + 2;
+        int num = 1 << (log2TrSize * 2);
+        int mask = num - 1;
+
+        for (int scanType = 0; scanType < SCAN_NUMBER_OF_TYPES; scanType++)
+        {
+            /* only 4x4 and 8x8 blocks use horizontal and vertical scans */
+            if (scanType != SCAN_DIAG && log2TrSize > 3)
+                continue;
+
+            const uint16_t *scan = g_scanOrder[SCAN_GROUPED_4x4][scanType][log2TrSize];
+
+            for (int n = 1; n <= num; n += 1 + (rand() & 7))
+            {
+                memset(qcoeff, 0, num * sizeof(int32_t));
+
+                for (int j = 0; j < n; j++)
+                {
+                    int k = rand() & mask;
+                    while (qcoeff[k])
+                    {
+                        k = (k + 11) & mask;
+                    }
+
+                    /* include levels beyond the range of 16 bits */
+                    qcoeff[k] = (rand() & 1) ? (rand() & 255) - 128 : rand() - RAND_MAX / 2;
+                    if (!qcoeff[k])
+                        qcoeff[k] = 1;
+                }
+
+                int refval = ref(qcoeff, scan, log2TrSize, refFlag, refSign, refNum, n);
+                int optval = (int)checked(opt, qcoeff, scan, log2TrSize, optFlag, optSign, optNum, n);
+                int numCG = (refval >> MLS_CG_SIZE) + 1;
+
+                if (refval != optval ||
+                    memcmp(refFlag, optFlag, numCG * sizeof(uint16_t)) ||
+                    memcmp(refSign, optSign, numCG * sizeof(uint16_t)) ||
+                    memcmp(refNum, optNum, numCG * sizeof(uint8_t)))
+                    return false;
+
+                reportfail();
+            }
+        }
+    }
+
+    return true;
+}
+
+bool MBDstHarness::check_rdoq_levels_primitive(rdoq_levels_t ref, rdoq_levels_t opt)
+{
+    ALIGN_VAR_32(int32_t, coef[32 * 32]);
+    ALIGN_VAR_32(int32_t, quantCoeff[32 * 32]);
+    ALIGN_VAR_32(double, errScale[32 * 32]);
+    ALIGN_VAR_32(int32_t, refLevel[32 * 32]);
+    ALIGN_VAR_32(int32_t, optLevel[32 * 32]);
+    ALIGN_VAR_32(int32_t, refAbs[32 * 32]);
+    ALIGN_VAR_32(int32_t, optAbs[32 * 32]);
+    ALIGN_VAR_32(double, refCost[32 * 32]);
+    ALIGN_VAR_32(double, optCost[32 * 32]);
+
+    for (int i = 0; i < ITERS; i++)
+    {
+        int log2TrSize = 2 + (i & 3);
+        int num = 1 << (log2TrSize * 2);
+        int qBits = 14 + (rand() % 14);
+
+        /* mostly small coefficients as after a transform at moderate QP, with
+         * large ones and flat scales large enough to hit the level clamp */
+        for (int k = 0; k < num; k++)
+        {
+            coef[k] = (rand() & 7) ? (rand() & 255) - 128 : (rand() & 0xffff) - 0x8000;
+            quantCoeff[k] = (i & 4) ? 26214 * 16 : rand() % 26215;
+            errScale[k] = (double)rand() / RAND_MAX;
+        }
+
+        uint32_t refval = ref(coef, quantCoeff, errScale, refLevel, refAbs, refCost, qBits, num);
+        uint32_t optval = (uint32_t)checked(opt, coef, quantCoeff, errScale, optLevel, optAbs, optCost, qBits, num);
+
+        /* the distortions must be bit-exact, RDOQ decisions compare them */
+        if (refval != optval ||
+            memcmp(refLevel, optLevel, num * sizeof(int32_t)) ||
+            memcmp(refAbs, optAbs, num * sizeof(int32_t)) ||
+            memcmp(refCost, optCost, num * sizeof(double)))
+            return false;
+
+        reportfail();
+    }
+
+    return true;
+}
+
 bool MBDstHarness::testCorrectness(const EncoderPrimitives& ref, const EncoderPrimitives& opt)
 {
     for (int i = 0; i < NUM_DCTS; i++)
@@ -391,6 +528,26 @@ bool MBDstHarness::testCorrectness(const EncoderPrimitives& ref, const EncoderPr
         }
     }
 
+    for (int i = 0; i < NUM_IDCTS; i++)
+    {
+        if (opt.idct_corner4[i])
+        {
+            if (!check_idct_corner_primitive(ref.idct[i], ref.idct_corner4[i], opt.idct_corner4[i], IDctConf_infos[i].width, 4))
+            {
+                printf("%s 4x4 corner failed\n", IDctConf_infos[i].name);
+                return false;
+            }
+        }
+        if (opt.idct_corner8[i])
+        {
+            if (!check_idct_corner_primitive(ref.idct[i], ref.idct_corner8[i], opt.idct_corner8[i], IDctConf_infos[i].width, 8))
+            {
+                printf("%s 8x8 corner failed\n", IDctConf_infos[i].name);
+                return false;
+            }
+        }
+    }
+
     if (opt.dequant_normal)
     {
         if (!check_dequant_primitive(ref.dequant_normal, opt.dequant_normal))
@@ -400,6 +557,15 @@ bool MBDstHarness::testCorrectness(const EncoderPrimitives& ref, const EncoderPr
         }
     }
 
+    if (opt.dequant_scaling)
+    {
+        if (!check_dequant_primitive(ref.dequant_scaling, opt.dequant_scaling))
+        {
+            printf("dequant_scaling: Failed!\n");
+            return false;
+        }
+    }
+
     if (opt.quant)
     {
         if (!check_quant_primitive(ref.quant, opt.quant))
@@ -418,6 +584,24 @@ bool MBDstHarness::testCorrectness(const EncoderPrimitives& ref, const EncoderPr
         }
     }
 
+    if (opt.rdoq_levels)
+    {
+        if (!check_rdoq_levels_primitive(ref.rdoq_levels, opt.rdoq_levels))
+        {
+            printf("rdoq_levels: Failed!\n");
+            return false;
+        }
+    }
+
+    if (opt.scan_poslast)
+    {
+        if (!check_scan_poslast_primitive(ref.scan_poslast, opt.scan_poslast))
+        {
+            printf("scan_poslast: Failed!\n");
+            return false;
+        }
+    }
+
     return true;
 }
 
@@ -441,6 +625,21 @@ void MBDstHarness::measureSpeed(const EncoderPrimitives& ref, const EncoderPrimi
         }
     }
 
+    /* corner kernels are timed against the full transform of the same table */
+    for (int value = 0; value < NUM_IDCTS; value++)
+    {
+        if (opt.idct_corner4[value])
+        {
+            printf("%s 4x4nz", IDctConf_infos[value].name);
+            REPORT_SPEEDUP(opt.idct_corner4[value], opt.idct[value], mbufidct, mbuf2, IDctConf_infos[value].width);
+        }
+        if (opt.idct_corner8[value])
+        {
+            printf("%s 8x8nz", IDctConf_infos[value].name);
+            REPORT_SPEEDUP(opt.idct_corner8[value], opt.idct[value], mbufidct, mbuf2, IDctConf_infos[value].width);
+        }
+    }
+
     if (opt.dequant_normal)
     {
         printf("dequant_normal\t");
@@ -468,4 +667,29 @@ void MBDstHarness::measureSpeed(const EncoderPrimitives& ref, const EncoderPrimi
             REPORT_SPEEDUP(opt.count_nonzero, ref.count_nonzero, mbufidct, i * i)
         }
     }
+
+    if (opt.rdoq_levels)
+    {
+        ALIGN_VAR_32(double, errScale[32 * 32]);
+        ALIGN_VAR_32(double, cost[32 * 32]);
+        for (int i = 0; i < 32 * 32; i++)
+            errScale[i] = 0.25;
+
+        printf("rdoq_levels\t");
+        REPORT_SPEEDUP(opt.rdoq_levels, ref.rdoq_levels, mintbuf1, mintbuf2, errScale, mintbuf3, mintbuf4, cost, 21, 32 * 32);
+    }
+
+    if (opt.scan_poslast)
+    {
+        uint16_t flag[MLS_GRP_NUM], sign[MLS_GRP_NUM];
+        uint8_t num[MLS_GRP_NUM];
+        for (int i = 4; i <= 32; i <<= 1)
+        {
+            int log2TrSize = g_convertToBit[i] + 2;
+            const uint16_t *scan = g_scanOrder[SCAN_GROUPED_4x4][SCAN_DIAG][log2TrSize];
+            int numSig = ref.count_nonzero(mbufidct, i * i);
+            printf("scan_poslast[%dx%d]", i, i);
+            REPORT_SPEEDUP(opt.scan_poslast, ref.scan_poslast, mbufidct, scan, log2TrSize, flag, sign, num, numSig)
+        }
+    }
 }
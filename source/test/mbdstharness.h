@@ -46,7 +46,10 @@ protected:
     bool check_quant_primitive(quant_t ref, quant_t opt);
     bool check_dct_primitive(dct_t ref, dct_t opt, intptr_t width);
     bool check_idct_primitive(idct_t ref, idct_t opt, intptr_t width);
+    bool check_idct_corner_primitive(idct_t full, idct_t ref, idct_t opt, intptr_t width, int corner);
     bool check_count_nonzero_primitive(count_nonzero_t ref, count_nonzero_t opt);
+    bool check_rdoq_levels_primitive(rdoq_levels_t ref, rdoq_levels_t opt);
+    bool check_scan_poslast_primitive(scan_poslast_t ref, scan_poslast_t opt);
 
 public:
 
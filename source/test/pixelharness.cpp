@@ -877,6 +877,33 @@ bool PixelHarness::check_pixel_var(var_t ref, var_t opt)
     return true;
 }
 
+bool PixelHarness::check_pixel_var_row(var_row_t ref, var_row_t opt, int size)
+{
+    ALIGN_VAR_16(uint64_t, vres[STRIDE / 4]);
+    ALIGN_VAR_16(uint64_t, cres[STRIDE / 4]);
+
+    int j = 0;
+
+    intptr_t stride = STRIDE;
+
+    for (int i = 0; i < ITERS; i++)
+    {
+        int index = i % TEST_CASES;
+        int numBlocks = 1 + rand() % (STRIDE / size);
+        memset(vres, 0, sizeof(vres));
+        memset(cres, 0, sizeof(cres));
+        checked(opt, pixel_test_buff[index] + j, stride, numBlocks, vres);
+        ref(pixel_test_buff[index] + j, stride, numBlocks, cres);
+        if (memcmp(vres, cres, sizeof(vres)))
+            return false;
+
+        reportfail();
+        j += INCR;
+    }
+
+    return true;
+}
+
 bool PixelHarness::check_ssim_4x4x2_core(ssim_4x4x2_core_t ref, ssim_4x4x2_core_t opt)
 {
     ALIGN_VAR_32(int, sum0[2][4]);
@@ -987,6 +1014,264 @@ bool PixelHarness::check_saoCuOrgE0_t(saoCuOrgE0_t ref, saoCuOrgE0_t opt)
     return true;
 }
 
+/* an 80x66 area of reconstructed samples, either of the full range or of a
+ * small range so that equal neighbours are common, for the SAO row
+ * functions which read around the 64 wide rows starting at SAO_BLOCK */
+#define SAO_STRIDE 80
+#define SAO_BLOCK  (SAO_STRIDE + 8)
+
+static void fillSaoBlock(pixel *dst, int8_t *signs, int numSigns)
+{
+    int range = rand() % 2 ? 4 : PIXEL_MAX + 1;
+    int base = rand() % (PIXEL_MAX + 2 - range);
+
+    for (int i = 0; i < SAO_STRIDE * 66; i++)
+    {
+        dst[i] = (pixel)(base + rand() % range);
+    }
+
+    for (int i = 0; i < numSigns; i++)
+    {
+        signs[i] = (int8_t)(rand() % 3 - 1);
+    }
+}
+
+bool PixelHarness::check_saoCuOrgE1_t(saoCuOrgE1_t ref, saoCuOrgE1_t opt)
+{
+    ALIGN_VAR_16(pixel, ref_dest[SAO_STRIDE * 66]);
+    ALIGN_VAR_16(pixel, opt_dest[SAO_STRIDE * 66]);
+    int8_t ref_up[96], opt_up[96];
+
+    int j = 0;
+
+    for (int i = 0; i < ITERS; i++)
+    {
+        int width = rand() % 64 + 1;
+
+        fillSaoBlock(ref_dest, ref_up, 96);
+        memcpy(opt_dest, ref_dest, sizeof(ref_dest));
+        memcpy(opt_up, ref_up, sizeof(ref_up));
+
+        ref(ref_dest + SAO_BLOCK, ref_up, psbuf1 + j, SAO_STRIDE, width);
+        checked(opt, opt_dest + SAO_BLOCK, opt_up, psbuf1 + j, SAO_STRIDE, width);
+
+        if (memcmp(ref_dest, opt_dest, sizeof(ref_dest)) || memcmp(ref_up, opt_up, width))
+            return false;
+
+        reportfail();
+        j += INCR;
+    }
+
+    return true;
+}
+
+bool PixelHarness::check_saoCuOrgE2_t(saoCuOrgE2_t ref, saoCuOrgE2_t opt)
+{
+    ALIGN_VAR_16(pixel, ref_dest[SAO_STRIDE * 66]);
+    ALIGN_VAR_16(pixel, opt_dest[SAO_STRIDE * 66]);
+    int8_t buff1[96], ref_bufft[96], opt_bufft[96];
+
+    int j = 0;
+
+    for (int i = 0; i < ITERS; i++)
+    {
+        int width = rand() % 64 + 1;
+
+        fillSaoBlock(ref_dest, buff1, 96);
+        memcpy(opt_dest, ref_dest, sizeof(ref_dest));
+        memset(ref_bufft, 0, sizeof(ref_bufft));
+        memset(opt_bufft, 0, sizeof(opt_bufft));
+
+        ref(ref_dest + SAO_BLOCK, ref_bufft, buff1, psbuf1 + j, width, SAO_STRIDE);
+        checked(opt, opt_dest + SAO_BLOCK, opt_bufft, buff1, psbuf1 + j, width, SAO_STRIDE);
+
+        if (memcmp(ref_dest, opt_dest, sizeof(ref_dest)) || memcmp(ref_bufft, opt_bufft, width + 1))
+            return false;
+
+        reportfail();
+        j += INCR;
+    }
+
+    return true;
+}
+
+bool PixelHarness::check_saoCuOrgE3_t(saoCuOrgE3_t ref, saoCuOrgE3_t opt)
+{
+    ALIGN_VAR_16(pixel, ref_dest[SAO_STRIDE * 66]);
+    ALIGN_VAR_16(pixel, opt_dest[SAO_STRIDE * 66]);
+    int8_t ref_up[96], opt_up[96];
+
+    int j = 0;
+
+    for (int i = 0; i < ITERS; i++)
+    {
+        int startX = rand() % 2 + 1;
+        int endX = startX + rand() % 62 + 1;
+
+        fillSaoBlock(ref_dest, ref_up, 96);
+        memcpy(opt_dest, ref_dest, sizeof(ref_dest));
+        memcpy(opt_up, ref_up, sizeof(ref_up));
+
+        ref(ref_dest + SAO_BLOCK, ref_up, psbuf1 + j, SAO_STRIDE, startX, endX);
+        checked(opt, opt_dest + SAO_BLOCK, opt_up, psbuf1 + j, SAO_STRIDE, startX, endX);
+
+        if (memcmp(ref_dest, opt_dest, sizeof(ref_dest)) || memcmp(ref_up, opt_up, endX - 1))
+            return false;
+
+        reportfail();
+        j += INCR;
+    }
+
+    return true;
+}
+
+bool PixelHarness::check_saoCuOrgB0_t(saoCuOrgB0_t ref, saoCuOrgB0_t opt)
+{
+    ALIGN_VAR_16(pixel, ref_dest[SAO_STRIDE * 66]);
+    ALIGN_VAR_16(pixel, opt_dest[SAO_STRIDE * 66]);
+    int8_t unused[1];
+
+    int j = 0;
+
+    for (int i = 0; i < ITERS; i++)
+    {
+        int width = rand() % 64 + 1;
+        int height = rand() % 64 + 1;
+
+        fillSaoBlock(ref_dest, unused, 0);
+        memcpy(opt_dest, ref_dest, sizeof(ref_dest));
+
+        ref(ref_dest + SAO_BLOCK, psbuf1 + j, width, height, SAO_STRIDE);
+        checked(opt, opt_dest + SAO_BLOCK, psbuf1 + j, width, height, SAO_STRIDE);
+
+        if (memcmp(ref_dest, opt_dest, sizeof(ref_dest)))
+            return false;
+
+        reportfail();
+        j += INCR;
+    }
+
+    return true;
+}
+
+/* a 64x64 block with an edge between columns (dir 0) or rows (dir 1) 31 and
+ * 32: a random level, a step of up to 'step' across the edge and noise of up
+ * to 'noise', so that every filter decision is exercised */
+static void fillDeblockBlock(pixel *dst, int dir, int step, int noise)
+{
+    int base = rand() & PIXEL_MAX;
+
+    for (int y = 0; y < 64; y++)
+    {
+        for (int x = 0; x < 64; x++)
+        {
+            int across = dir == 0 ? x : y;
+            int v = base + (across >= 32 ? step : 0) + (noise ? rand() % (2 * noise + 1) - noise : 0);
+            dst[y * 64 + x] = (pixel)Clip3(0, PIXEL_MAX, v);
+        }
+    }
+}
+
+bool PixelHarness::check_deblock_luma(deblock_luma_t ref, deblock_luma_t opt, int dir)
+{
+    ALIGN_VAR_16(pixel, ref_dest[64 * 64]);
+    ALIGN_VAR_16(pixel, opt_dest[64 * 64]);
+    int32_t tc[16], beta[16];
+    const int bitdepthScale = 1 << (X265_DEPTH - 8);
+    const int edge = dir == 0 ? 32 : 32 * 64;
+
+    for (int i = 0; i < ITERS; i++)
+    {
+        int numSeg = rand() % 16 + 1;
+        for (int s = 0; s < numSeg; s++)
+        {
+            tc[s] = (rand() % 4 ? rand() % 25 : 0) * bitdepthScale;
+            beta[s] = (rand() % 65) * bitdepthScale;
+        }
+
+        fillDeblockBlock(ref_dest, dir, (rand() % 64 - 32) * bitdepthScale, (rand() % 5) * bitdepthScale);
+        memcpy(opt_dest, ref_dest, sizeof(ref_dest));
+
+        ref(ref_dest + edge, 64, tc, beta, numSeg);
+        checked(opt, opt_dest + edge, 64, tc, beta, numSeg);
+
+        if (memcmp(ref_dest, opt_dest, sizeof(ref_dest)))
+            return false;
+
+        reportfail();
+    }
+
+    return true;
+}
+
+bool PixelHarness::check_deblock_chroma(deblock_chroma_t ref, deblock_chroma_t opt, int dir)
+{
+    ALIGN_VAR_16(pixel, ref_dest[64 * 64]);
+    ALIGN_VAR_16(pixel, opt_dest[64 * 64]);
+    int32_t tc[16];
+    const int bitdepthScale = 1 << (X265_DEPTH - 8);
+    const int edge = dir == 0 ? 32 : 32 * 64;
+
+    for (int i = 0; i < ITERS; i++)
+    {
+        int segLen = 1 << (rand() % 3);
+        int numSeg = rand() % 16 + 1;
+        for (int s = 0; s < numSeg; s++)
+        {
+            tc[s] = (rand() % 4 ? rand() % 25 : 0) * bitdepthScale;
+        }
+
+        fillDeblockBlock(ref_dest, dir, (rand() % 64 - 32) * bitdepthScale, (rand() % 5) * bitdepthScale);
+        memcpy(opt_dest, ref_dest, sizeof(ref_dest));
+
+        ref(ref_dest + edge, 64, tc, segLen, numSeg);
+        checked(opt, opt_dest + edge, 64, tc, segLen, numSeg);
+
+        if (memcmp(ref_dest, opt_dest, sizeof(ref_dest)))
+            return false;
+
+        reportfail();
+    }
+
+    return true;
+}
+
+bool PixelHarness::check_sao_stats(sao_stats_t ref, sao_stats_t opt, int numClasses)
+{
+    /* a 64x64 block in the middle of a 96 wide area, with a small range of
+     * reconstructed values so that equal neighbours are common */
+    ALIGN_VAR_16(pixel, fenc[96 * 80]);
+    ALIGN_VAR_16(pixel, rec[96 * 80]);
+    int32_t ref_sum[32], ref_count[32];
+    int32_t opt_sum[32], opt_count[32];
+    const int block = 8 * 96 + 16;
+
+    for (int i = 0; i < ITERS; i++)
+    {
+        int range = rand() % 2 ? 4 : PIXEL_MAX + 1;
+        int base = rand() % (PIXEL_MAX + 2 - range);
+        for (int j = 0; j < 96 * 80; j++)
+        {
+            fenc[j] = (pixel)(rand() % (PIXEL_MAX + 1));
+            rec[j] = (pixel)(base + rand() % range);
+        }
+
+        int width = rand() % 64 + 1;
+        int height = rand() % 64 + 1;
+
+        ref(fenc + block, rec + block, 96, width, height, ref_sum, ref_count);
+        checked(opt, fenc + block, rec + block, 96, width, height, opt_sum, opt_count);
+
+        if (memcmp(ref_sum, opt_sum, numClasses * sizeof(int32_t)) ||
+            memcmp(ref_count, opt_count, numClasses * sizeof(int32_t)))
+            return false;
+
+        reportfail();
+    }
+
+    return true;
+}
+
 bool PixelHarness::check_planecopy_sp(planecopy_sp_t ref, planecopy_sp_t opt)
 {
     ALIGN_VAR_16(pixel, ref_dest[64 * 64]);
@@ -1337,6 +1622,15 @@ bool PixelHarness::testCorrectness(const EncoderPrimitives& ref, const EncoderPr
                 return false;
             }
         }
+
+        if (opt.var_row[i])
+        {
+            if (!check_pixel_var_row(ref.var_row[i], opt.var_row[i], 4 << i))
+            {
+                printf("var_row[%dx%d] failed\n", 4 << i, 4 << i);
+                return false;
+            }
+        }
     }
 
     if (opt.cvt32to16_shr)
@@ -1456,6 +1750,84 @@ bool PixelHarness::testCorrectness(const EncoderPrimitives& ref, const EncoderPr
         }
     }
 
+    if (opt.saoCuOrgE1)
+    {
+        if (!check_saoCuOrgE1_t(ref.saoCuOrgE1, opt.saoCuOrgE1))
+        {
+            printf("SAO_EO_1 failed\n");
+            return false;
+        }
+    }
+
+    if (opt.saoCuOrgE2)
+    {
+        if (!check_saoCuOrgE2_t(ref.saoCuOrgE2, opt.saoCuOrgE2))
+        {
+            printf("SAO_EO_2 failed\n");
+            return false;
+        }
+    }
+
+    if (opt.saoCuOrgE3)
+    {
+        if (!check_saoCuOrgE3_t(ref.saoCuOrgE3, opt.saoCuOrgE3))
+        {
+            printf("SAO_EO_3 failed\n");
+            return false;
+        }
+    }
+
+    if (opt.saoCuOrgB0)
+    {
+        if (!check_saoCuOrgB0_t(ref.saoCuOrgB0, opt.saoCuOrgB0))
+        {
+            printf("SAO_BO failed\n");
+            return false;
+        }
+    }
+
+    for (int dir = 0; dir < 2; dir++)
+    {
+        if (opt.deblock_luma[dir])
+        {
+            if (!check_deblock_luma(ref.deblock_luma[dir], opt.deblock_luma[dir], dir))
+            {
+                printf("deblock_luma[%s] failed\n", dir ? "hor" : "ver");
+                return false;
+            }
+        }
+
+        if (opt.deblock_chroma[dir])
+        {
+            if (!check_deblock_chroma(ref.deblock_chroma[dir], opt.deblock_chroma[dir], dir))
+            {
+                printf("deblock_chroma[%s] failed\n", dir ? "hor" : "ver");
+                return false;
+            }
+        }
+    }
+
+    for (int dir = 0; dir < 4; dir++)
+    {
+        if (opt.sao_stats_eo[dir])
+        {
+            if (!check_sao_stats(ref.sao_stats_eo[dir], opt.sao_stats_eo[dir], 5))
+            {
+                printf("sao_stats_eo[%d] failed\n", dir);
+                return false;
+            }
+        }
+    }
+
+    if (opt.sao_stats_bo)
+    {
+        if (!check_sao_stats(ref.sao_stats_bo, opt.sao_stats_bo, 32))
+        {
+            printf("sao_stats_bo failed\n");
+            return false;
+        }
+    }
+
     if (opt.planecopy_sp)
     {
         if (!check_planecopy_sp(ref.planecopy_sp, opt.planecopy_sp))
@@ -1690,6 +2062,12 @@ void PixelHarness::measureSpeed(const EncoderPrimitives& ref, const EncoderPrimi
             HEADER("var[%dx%d]", 4 << i, 4 << i);
             REPORT_SPEEDUP(opt.var[i], ref.var[i], pbuf1, STRIDE);
         }
+
+        if (opt.var_row[i])
+        {
+            HEADER("var_row[%dx%d]", 4 << i, 4 << i);
+            REPORT_SPEEDUP(opt.var_row[i], ref.var_row[i], pbuf1, STRIDE, STRIDE / (4 << i), (uint64_t*)ibuf1);
+        }
     }
 
     if (opt.cvt32to16_shr)
@@ -1770,6 +2148,76 @@ void PixelHarness::measureSpeed(const EncoderPrimitives& ref, const EncoderPrimi
         REPORT_SPEEDUP(opt.saoCuOrgE0, ref.saoCuOrgE0, pbuf1, psbuf1, 64, 1);
     }
 
+    if (opt.saoCuOrgE1)
+    {
+        HEADER0("SAO_EO_1");
+        REPORT_SPEEDUP(opt.saoCuOrgE1, ref.saoCuOrgE1, pbuf1, psbuf1 + 64, psbuf1, 64, 64);
+    }
+
+    if (opt.saoCuOrgE2)
+    {
+        HEADER0("SAO_EO_2");
+        REPORT_SPEEDUP(opt.saoCuOrgE2, ref.saoCuOrgE2, pbuf1, psbuf1 + 128, psbuf1 + 64, psbuf1, 64, 64);
+    }
+
+    if (opt.saoCuOrgE3)
+    {
+        HEADER0("SAO_EO_3");
+        REPORT_SPEEDUP(opt.saoCuOrgE3, ref.saoCuOrgE3, pbuf1 + 1, psbuf1 + 64, psbuf1, 64, 1, 64);
+    }
+
+    if (opt.saoCuOrgB0)
+    {
+        HEADER0("SAO_BO 64x64");
+        REPORT_SPEEDUP(opt.saoCuOrgB0, ref.saoCuOrgB0, pbuf1, psbuf1, 64, 64, 64);
+    }
+
+    for (int dir = 0; dir < 2; dir++)
+    {
+        /* a smooth block with a small step, where most segments are filtered */
+        ALIGN_VAR_16(pixel, block[64 * 64]);
+        int32_t tc[16], beta[16];
+        for (int s = 0; s < 16; s++)
+        {
+            tc[s] = 6;
+            beta[s] = 40;
+        }
+
+        fillDeblockBlock(block, dir, 6, 1);
+        pixel *edge = block + (dir == 0 ? 32 : 32 * 64);
+
+        if (opt.deblock_luma[dir])
+        {
+            HEADER("deblock_luma[%s] x64", dir ? "hor" : "ver");
+            REPORT_SPEEDUP(opt.deblock_luma[dir], ref.deblock_luma[dir], edge, 64, tc, beta, 16);
+        }
+
+        if (opt.deblock_chroma[dir])
+        {
+            HEADER("deblock_chroma[%s] x32", dir ? "hor" : "ver");
+            REPORT_SPEEDUP(opt.deblock_chroma[dir], ref.deblock_chroma[dir], edge, 64, tc, 2, 16);
+        }
+    }
+
+    for (int dir = 0; dir < 4; dir++)
+    {
+        int32_t sum[32], count[32];
+
+        if (opt.sao_stats_eo[dir])
+        {
+            HEADER("sao_stats_eo[%d] 64x64", dir);
+            REPORT_SPEEDUP(opt.sao_stats_eo[dir], ref.sao_stats_eo[dir], pbuf1 + STRIDE + 1, pbuf2 + STRIDE + 1, STRIDE, 64, 64, sum, count);
+        }
+    }
+
+    if (opt.sao_stats_bo)
+    {
+        int32_t sum[32], count[32];
+
+        HEADER0("sao_stats_bo 64x64");
+        REPORT_SPEEDUP(opt.sao_stats_bo, ref.sao_stats_bo, pbuf1 + STRIDE + 1, pbuf2 + STRIDE + 1, STRIDE, 64, 64, sum, count);
+    }
+
     if (opt.planecopy_sp)
     {
         HEADER0("planecopy_sp");
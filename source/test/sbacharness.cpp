@@ -0,0 +1,189 @@
+/*****************************************************************************
+ * Copyright (C) 2013 x265 project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "sbacharness.h"
+#include "common.h"
+
+using namespace x265;
+
+namespace {
+/* snapshot copy as done before context tagging, the whole state is copied */
+void fullCopy(TEncSbac* dst, TEncSbac* src)
+{
+    dst->m_binIf->copyState(src->m_binIf);
+    memcpy(dst->m_contextModels, src->m_contextModels, sizeof(dst->m_contextModels));
+}
+
+void taggedCopy(TEncSbac* dst, TEncSbac* src)
+{
+    dst->load(src);
+}
+
+typedef void (*sbaccopy_t)(TEncSbac* dst, TEncSbac* src);
+
+/* snapshots of one CU mode decision: each candidate mode restores the current
+ * best state, codes its CU level syntax and saves it as temp best, and the
+ * winner is copied to next best. Every other candidate is pruned before any
+ * syntax is coded, as the fast mode decisions do, so roughly a quarter of the
+ * copies are redundant, matching what a medium preset encode sees */
+void modeDecision(TEncSbac* coder, sbaccopy_t copy)
+{
+    for (int mode = 0; mode < 4; mode++)
+    {
+        copy(&coder[3], &coder[0]);
+        if (mode & 1)
+            continue;
+        coder[3].codeTransformSubdivFlag(mode & 1, mode % 3);
+        coder[3].codeMVPIdx(mode >> 1);
+        copy(&coder[1], &coder[3]);
+        if (mode == 2)
+            copy(&coder[2], &coder[1]);
+    }
+}
+
+void modeDecisionTagged(TEncSbac* coder) { modeDecision(coder, taggedCopy); }
+void modeDecisionFull(TEncSbac* coder)   { modeDecision(coder, fullCopy); }
+}
+
+SbacHarness::SbacHarness()
+{
+    for (int set = 0; set < 2; set++)
+    {
+        for (int i = 0; i < NUM_CODERS; i++)
+        {
+            m_binIf[set][i] = new TEncBinCABAC(true);
+            m_coder[set][i].init(m_binIf[set][i]);
+            m_coder[set][i].setBitstream(&m_bitCounter);
+        }
+    }
+
+    randomContexts();
+}
+
+SbacHarness::~SbacHarness()
+{
+    for (int set = 0; set < 2; set++)
+        for (int i = 0; i < NUM_CODERS; i++)
+            delete m_binIf[set][i];
+}
+
+void SbacHarness::randomContexts()
+{
+    for (int i = 0; i < NUM_CODERS; i++)
+    {
+        for (int c = 0; c < MAX_OFF_CTX_MOD; c++)
+            m_coder[0][i].m_contextModels[c].m_state = (uint8_t)(rand() & 127);
+
+        /* direct writes bypass the tags */
+        m_coder[0][i].markContexts();
+
+        fullCopy(&m_coder[1][i], &m_coder[0][i]);
+    }
+}
+
+/* code the same syntax into coder 'coder' of both sets */
+void SbacHarness::codeRandomSyntax(int coder, int seed)
+{
+    for (int set = 0; set < 2; set++)
+    {
+        TEncSbac& sbac = m_coder[set][coder];
+        switch (seed % 5)
+        {
+        case 0:
+            sbac.codeTransformSubdivFlag(seed & 1, (seed >> 1) % 3);
+            break;
+        case 1:
+            sbac.codeMVPIdx((seed >> 3) & 1);
+            break;
+        case 2:
+            sbac.codeSaoMerge((seed >> 3) & 1);
+            sbac.codeSaoTypeIdx((seed >> 4) % 3);
+            break;
+        case 3:
+            sbac.codeLastSignificantXY((seed >> 3) & 7, (seed >> 6) & 7, 3, TEXT_LUMA, SCAN_DIAG);
+            break;
+        default:
+            sbac.codeLastSignificantXY((seed >> 3) & 3, (seed >> 5) & 3, 2, TEXT_CHROMA, SCAN_DIAG);
+            break;
+        }
+    }
+}
+
+bool SbacHarness::compareCoders()
+{
+    for (int i = 0; i < NUM_CODERS; i++)
+    {
+        if (memcmp(m_coder[0][i].m_contextModels, m_coder[1][i].m_contextModels, sizeof(m_coder[0][i].m_contextModels)))
+            return false;
+        if (m_binIf[0][i]->m_fracBits != m_binIf[1][i]->m_fracBits)
+            return false;
+    }
+
+    return true;
+}
+
+bool SbacHarness::testCorrectness(const EncoderPrimitives&, const EncoderPrimitives&)
+{
+    randomContexts();
+
+    for (int i = 0; i < 10000; i++)
+    {
+        int op = rand();
+        int dst = (op >> 4) % NUM_CODERS;
+        int src = (op >> 8) % NUM_CODERS;
+
+        switch (op & 3)
+        {
+        case 0:
+            m_coder[0][dst].load(&m_coder[0][src]);
+            fullCopy(&m_coder[1][dst], &m_coder[1][src]);
+            break;
+        case 1:
+            m_coder[0][src].store(&m_coder[0][dst]);
+            fullCopy(&m_coder[1][dst], &m_coder[1][src]);
+            break;
+        case 2:
+            m_coder[0][dst].loadIntraDirModeLuma(&m_coder[0][src]);
+            m_coder[1][dst].loadIntraDirModeLuma(&m_coder[1][src]);
+            break;
+        default:
+            codeRandomSyntax(dst, op >> 12);
+            break;
+        }
+
+        if (!compareCoders())
+        {
+            printf("tagged CABAC context snapshot failed at operation %d\n", i);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void SbacHarness::measureSpeed(const EncoderPrimitives&, const EncoderPrimitives&)
+{
+    printf("CU mode decision snapshots");
+    REPORT_SPEEDUP(modeDecisionTagged, modeDecisionFull, m_coder[0]);
+
+    printf("context snapshot load   ");
+    REPORT_SPEEDUP(taggedCopy, fullCopy, &m_coder[0][CI_TEMP], &m_coder[0][CI_CURR]);
+}
@@ -0,0 +1,60 @@
+/*****************************************************************************
+ * Copyright (C) 2013 x265 project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#ifndef _SBACHARNESS_H_1
+#define _SBACHARNESS_H_1 1
+
+#include "testharness.h"
+#include "TLibEncoder/TEncSbac.h"
+
+/* Not a primitive test; checks the tagged CABAC context snapshots used by the
+ * RD search (TEncSbac::load/store) against plain full copies, and measures
+ * the snapshot and restore cost of a typical CU mode decision */
+class SbacHarness : public TestHarness
+{
+protected:
+
+    /* CURR_BEST, TEMP_BEST, NEXT_BEST and the go-on coder, as used per depth
+     * by TEncCu, once for the tagged copies and once for full copies */
+    enum { CI_CURR, CI_TEMP, CI_NEXT, CI_GOON, NUM_CODERS };
+
+    TEncBinCABAC   *m_binIf[2][NUM_CODERS];
+    TEncSbac        m_coder[2][NUM_CODERS];
+    TComBitCounter  m_bitCounter;
+
+    void randomContexts();
+    void codeRandomSyntax(int coder, int seed);
+    bool compareCoders();
+
+public:
+
+    SbacHarness();
+
+    virtual ~SbacHarness();
+
+    const char *getName() const { return "sbac"; }
+
+    bool testCorrectness(const EncoderPrimitives& ref, const EncoderPrimitives& opt);
+
+    void measureSpeed(const EncoderPrimitives& ref, const EncoderPrimitives& opt);
+};
+
+#endif // ifndef _SBACHARNESS_H_1
@@ -29,6 +29,7 @@
 #include "mbdstharness.h"
 #include "ipfilterharness.h"
 #include "intrapredharness.h"
+#include "sbacharness.h"
 #include "param.h"
 #include "cpu.h"
 
@@ -114,6 +115,7 @@ int main(int argc, char *argv[])
     MBDstHarness  HMBDist;
     IPFilterHarness HIPFilter;
     IntraPredHarness HIPred;
+    SbacHarness HSbac;
 
     // To disable classes of tests, simply comment them out in this list
     TestHarness *harness[] =
@@ -121,7 +123,8 @@ int main(int argc, char *argv[])
         &HPixel,
         &HMBDist,
         &HIPFilter,
-        &HIPred
+        &HIPred,
+        &HSbac
     };
 
     EncoderPrimitives cprim;
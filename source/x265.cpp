@@ -71,6 +71,10 @@ static const struct option long_options[] =
     { "log-level",      required_argument, NULL, 0 },
     { "level",          required_argument, NULL, 0 },
     { "csv",            required_argument, NULL, 0 },
+    { "me-stats",             no_argument, NULL, 0 },
+    { "no-me-stats",          no_argument, NULL, 0 },
+    { "me-map",         required_argument, NULL, 0 },
+    { "quality-map",    required_argument, NULL, 0 },
     { "y4m",                  no_argument, NULL, 0 },
     { "no-progress",          no_argument, NULL, 0 },
     { "output",         required_argument, NULL, 'o' },
@@ -104,6 +108,10 @@ static const struct option long_options[] =
     { "early-skip",           no_argument, NULL, 0 },
     { "no-fast-cbf",          no_argument, NULL, 0 },
     { "fast-cbf",             no_argument, NULL, 0 },
+    { "fast-decision",  required_argument, NULL, 0 },
+    { "no-static-skip",       no_argument, NULL, 0 },
+    { "static-skip",          no_argument, NULL, 0 },
+    { "static-thresh",  required_argument, NULL, 0 },
     { "no-tskip",             no_argument, NULL, 0 },
     { "tskip",                no_argument, NULL, 0 },
     { "no-tskip-fast",        no_argument, NULL, 0 },
@@ -137,6 +145,12 @@ static const struct option long_options[] =
     { "vbv-bufsize",    required_argument, NULL, 0 },
     { "vbv-init",       required_argument, NULL, 0 },
     { "bitrate",        required_argument, NULL, 0 },
+    { "pass",           required_argument, NULL, 0 },
+    { "stats",          required_argument, NULL, 0 },
+    { "no-slow-firstpass",    no_argument, NULL, 0 },
+    { "slow-firstpass",       no_argument, NULL, 0 },
+    { "cplxblur",       required_argument, NULL, 0 },
+    { "qblur",          required_argument, NULL, 0 },
     { "qp",             required_argument, NULL, 'q' },
     { "aq-mode",        required_argument, NULL, 0 },
     { "aq-strength",    required_argument, NULL, 0 },
@@ -154,6 +168,8 @@ static const struct option long_options[] =
     { "sao",                  no_argument, NULL, 0 },
     { "sao-lcu-bounds", required_argument, NULL, 0 },
     { "sao-lcu-opt",    required_argument, NULL, 0 },
+    { "no-sao-fast",          no_argument, NULL, 0 },
+    { "sao-fast",             no_argument, NULL, 0 },
     { "no-ssim",              no_argument, NULL, 0 },
     { "ssim",                 no_argument, NULL, 0 },
     { "no-psnr",              no_argument, NULL, 0 },
@@ -341,6 +357,9 @@ void CLIOptions::showHelp(x265_param *param)
     H0("\nQuality reporting metrics:\n");
     H0("   --[no-]ssim                   Enable reporting SSIM metric scores. Default %s\n", OPT(param->bEnableSsim));
     H0("   --[no-]psnr                   Enable reporting PSNR metric scores. Default %s\n", OPT(param->bEnablePsnr));
+    H0("   --[no-]me-stats               Enable reporting motion search statistics. Default %s\n", OPT(param->bEnableMEStats));
+    H0("   --me-map <filename>           Binary per-CTU motion map (search count, MV length, cost) file\n");
+    H0("   --quality-map <filename>      Binary per-CTU quality map (Y/U/V SSD, luma SSIM) file\n");
     H0("\nQuad-Tree analysis:\n");
     H0("   --[no-]wpp                    Enable Wavefront Parallel Processing. Default %s\n", OPT(param->bEnableWavefront));
     H0("-s/--ctu <64|32|16>              Maximum CU size (default: 64x64). Default %d\n", param->maxCUSize);
@@ -355,6 +374,9 @@ void CLIOptions::showHelp(x265_param *param)
     H0("   --max-merge <1..5>            Maximum number of merge candidates. Default %d\n", param->maxNumMergeCand);
     H0("   --[no-]early-skip             Enable early SKIP detection. Default %s\n", OPT(param->bEnableEarlySkip));
     H0("   --[no-]fast-cbf               Enable Cbf fast mode. Default %s\n", OPT(param->bEnableCbfFastMode));
+    H0("   --fast-decision <0..2>        Skip unlikely CU depths using neighbour, co-located and lookahead data. Default %d\n", param->fastDecision);
+    H0("   --[no-]static-skip            Code CTUs unchanged from the reference as zero-MV skip without analysis. Default %s\n", OPT(param->bEnableStaticSkip));
+    H0("   --static-thresh <integer>     Max 8x8 block SAD for a CTU to be considered static. Default %d\n", param->staticThreshold);
     H0("\nSpatial / intra options:\n");
     H0("   --rdpenalty <0..2>            penalty for 32x32 intra TU in non-I slices. 0:disabled 1:RD-penalty 2:maximum. Default %d\n", param->rdPenalty);
     H0("   --[no-]tskip                  Enable intra transform skipping. Default %s\n", OPT(param->bEnableTransformSkip));
@@ -388,6 +410,14 @@ void CLIOptions::showHelp(x265_param *param)
     H0("   --vbv-bufsize <integer>       Set size of the VBV buffer (kbit). Default %d\n", param->rc.vbvBufferSize);
     H0("   --vbv-init <float>            Initial VBV buffer occupancy (fraction of bufsize or in kbits). Default %f\n", param->rc.vbvBufferInit);
     H0("-q/--qp <integer>                Base QP for CQP mode\n");
+    H0("   --pass <integer>              Multi-pass rate control.\n"
+       "                                   - 1 : First pass, creates stats file\n"
+       "                                   - 2 : Last pass, does not overwrite stats file\n"
+       "                                   - 3 : Nth pass, overwrites stats file\n");
+    H0("   --stats <filename>            Filename for the multi-pass stats file. Default x265_2pass.log\n");
+    H0("   --[no-]slow-firstpass         Keep the configured analysis options in the first pass. Default %s\n", OPT(param->rc.bEnableSlowFirstPass));
+    H0("   --cplxblur <float>            Reduce fluctuations in QP (before curve compression). Default %f\n", param->rc.complexityBlur);
+    H0("   --qblur <float>               Reduce fluctuations in QP (after curve compression). Default %f\n", param->rc.qblur);
     H0("   --aq-mode <integer>           Mode for Adaptive Quantization - 0:none 1:uniform AQ 2:auto variance. Default %d\n", param->rc.aqMode);
     H0("   --aq-strength <float>         Reduces blocking and blurring in flat and textured areas.(0 to 3.0). Default %f\n", param->rc.aqStrength);
     H0("   --[no-]cutree                 Enable cutree for Adaptive Quantization. Default %s\n", OPT(param->rc.cuTree));
@@ -403,6 +433,7 @@ void CLIOptions::showHelp(x265_param *param)
     H0("   --[no-]sao                    Enable Sample Adaptive Offset. Default %s\n", OPT(param->bEnableSAO));
     H0("   --sao-lcu-bounds <integer>    0: right/bottom boundary areas skipped  1: non-deblocked pixels are used. Default %d\n", param->saoLcuBoundary);
     H0("   --sao-lcu-opt <integer>       0: SAO picture-based optimization, 1: SAO LCU-based optimization. Default %d\n", param->saoLcuBasedOptimization);
+    H0("   --[no-]sao-fast               Decide LCU-based SAO parameters from reduced statistics. Default %s\n", OPT(param->bEnableSAOFast));
     H0("\nVUI options:\n");
     H0("   --sar <width:height|int>      Sample Aspect Ratio, the ratio of width to height of an individual pixel.\n");
     H0("                                 Choose from 0=undef, 1=1:1(\"square\"), 2=12:11, 3=10:11, 4=16:11,\n");
@@ -282,6 +282,14 @@ typedef struct x265_stats
     uint64_t  accBits;              /* total bits output thus far */
 
     /* new statistic member variables must be added below this line */
+
+    /* motion search statistics, only gathered if bEnableMEStats is set */
+    uint64_t  meSearches;           /* number of motion searches performed */
+    uint64_t  meFullpelCands;       /* integer pel candidates measured */
+    uint64_t  meSubpelCands;        /* half and quarter pel candidates measured */
+    uint64_t  meSubpelIters;        /* subpel refinement iterations */
+    uint64_t  meEarlyOuts;          /* searches which skipped subpel refinement */
+    double    meAvgSearchDistance;  /* average full pel distance from MVP to final MV */
 } x265_stats;
 
 /* String values accepted by x265_param_parse() (and CLI) for various parameters */
@@ -352,6 +360,33 @@ typedef struct x265_param
      * x265_encoder_log is called (presumably at the end of the encode) */
     const char *csvfn;
 
+    /* Enable the gathering of motion estimation statistics: the number of
+     * searches, the predictor, integer and sub-pel candidates measured, the
+     * sub-pel refinement iterations, early-outs and the distance between the
+     * MVP and the final MV. They are reported per CU depth in the encode
+     * summary, per frame in the CSV log and through x265_encoder_get_stats().
+     * Default is disabled */
+    int       bEnableMEStats;
+
+    /* filename of a binary per-CTU motion map. For every encoded frame the
+     * encoder writes the POC and the frame width and height in CTUs (three
+     * int32) followed by, for each CTU in raster order, the number of motion
+     * searches, the sum of the final MV lengths in quarter pels and the sum
+     * of the search costs (three uint32). Frames are written in encode order.
+     * Default is NULL, no map */
+    const char *meMapFn;
+
+    /* filename of a binary per-CTU quality map. For every encoded frame the
+     * encoder writes the POC and the frame width and height in CTUs (three
+     * int32) followed by, for each CTU in raster order, the sums of squared
+     * differences of the Y, U and V reconstructed samples (three uint64), the
+     * number of luma samples (uint32) and the mean SSIM of the luma 8x8
+     * windows centred in the CTU (float). Frames are written in encode
+     * order. The statistics are gathered by the loop filter rows as they are
+     * finished, so no second pass over the reconstructed frames is needed.
+     * Default is NULL, no map */
+    const char *qualityMapFn;
+
     /* Enable the generation of SEI messages for each encoded frame containing
      * the hashes of the three reconstructed picture planes. Most decoders will
      * validate those hashes against the reconstructed images it generates and
@@ -580,6 +615,28 @@ typedef struct x265_param
      * skip blocks. Default is disabled */
     int       bEnableEarlySkip;
 
+    /* Fast CU depth decision. Uses the depths chosen by the neighbouring CUs
+     * along the left and top edges of each CU and by the co-located CTU of the nearest reference picture, and the
+     * lookahead's per-block inter costs, to skip analysis of CU depths which
+     * are very unlikely to be chosen. Only used when rdLevel is below 5.
+     * 0 is disabled, 1 skips depths only when all sources agree, 2 is more
+     * aggressive and also stops splitting CUs whose lookahead costs are
+     * uniform. The number of times each rule fired is reported in the encode
+     * summary. Default is 0 */
+    int       fastDecision;
+
+    /* Enable the static region fast path. Each CTU of an inter picture whose
+     * source pixels are (nearly) unchanged from the source of its nearest
+     * reference picture is coded directly as a single zero-MV skip CU without
+     * any motion search, intra or RD analysis. Intended for screen capture
+     * and fixed camera content. Default disabled */
+    int       bEnableStaticSkip;
+
+    /* The largest SAD of any 8x8 luma block (or its co-sited chroma blocks)
+     * for which a CTU is still considered static by bEnableStaticSkip. 0
+     * requires the CTU to be bit-identical. Default 0 */
+    int       staticThreshold;
+
     /* Apply an optional penalty to the estimated cost of 32x32 intra blocks in
      * non-intra slices. 0 is disabled, 1 enables a small penalty, and 2 enables
      * a full penalty. This favors inter-coding and its low bitrate over
@@ -644,6 +701,16 @@ typedef struct x265_param
      * performed on LCUs in series. Default is 1 */
     int       saoLcuBasedOptimization;
 
+    /* Fast SAO parameter decision, used with the LCU-based optimization. The
+     * statistics are gathered from a subset of each CTU's lines, band offset
+     * only evaluates the bands of the window with the largest achievable gain,
+     * a left or up merge candidate is taken without searching new parameters
+     * when it reaches most of the achievable gain, and chroma SAO is not
+     * searched on CTUs whose chroma cannot gain enough to pay for its offsets.
+     * The number of times each shortcut fired is reported in the encode
+     * summary. Default is disabled */
+    int       bEnableSAOFast;
+
     /* Generally a small signed integer which offsets the QP used to quantize
      * the Cb chroma residual (delta from luma QP specified by rate-control).
      * Default is 0, which is recommended */
@@ -745,6 +812,33 @@ typedef struct x265_param
 
         /* In CRF mode, minimum CRF as caused by VBV */
         double    rfConstantMin;
+
+        /* Multi-pass encoding. When bStatWrite is enabled the encoder writes the
+         * slice type, QP, complexity and size of each frame to statFileName.
+         * When bStatRead is enabled the encoder reads that file back, plans the
+         * bit allocation of the whole stream to meet the ABR bitrate, and uses
+         * the frame types of the previous pass. Both may be enabled for the
+         * middle passes of an N-pass encode. Default disabled */
+        int       bStatWrite;
+        int       bStatRead;
+
+        /* Filename of the multi-pass stats file. Default "x265_2pass.log" */
+        const char* statFileName;
+
+        /* When writing stats without reading them (the first pass), the encoder
+         * replaces the most expensive analysis options (references, partitions,
+         * motion search and RD level) with fast ones, since only the relative
+         * complexity of frames is needed. Enabling this keeps the configured
+         * analysis in the first pass. Default disabled */
+        int       bEnableSlowFirstPass;
+
+        /* Multi-pass only. The span of the gaussian used to blur frame
+         * complexities before the quantizer curve is planned. Default 20 */
+        double    complexityBlur;
+
+        /* Multi-pass only. The span of the gaussian used to blur the planned
+         * quantizer curve. Default 0.5 */
+        double    qblur;
     } rc;
 
     /*== Video Usability Information ==*/